@@ -346,18 +346,87 @@ class Client:
                 '    ${camelcase} *self,\n'
                 '    GAsyncResult *res,\n'
                 '    GError **error);\n')
+
+            if message.output.fixed_layout:
+                translations['parse_into'] = message.parse_into_name()
+                template += (
+                    '\n'
+                    '/**\n'
+                    ' * ${underscore}_${message_underscore}_finish_into:\n'
+                    ' * @self: a #${camelcase}.\n'
+                    ' * @res: the #GAsyncResult obtained from the #GAsyncReadyCallback passed to ${underscore}_${message_underscore}().\n'
+                    ' * @values: a #${output_camelcase}Values to fill in.\n'
+                    ' * @error: Return location for error or %NULL.\n'
+                    ' *\n'
+                    ' * Finishes an async operation started with ${underscore}_${message_underscore}(),\n'
+                    ' * like ${underscore}_${message_underscore}_finish(), but parsing the response into\n'
+                    ' * @values instead of allocating a #${output_camelcase}.\n'
+                    ' *\n'
+                    ' * See ${parse_into}() for the contents of @values on errors.\n'
+                    ' *\n'
+                    ' * Returns: %TRUE if the operation succeeded, %FALSE if @error is set.\n'
+                    ' *\n'
+                    ' * Since: 1.24\n'
+                    ' */\n'
+                    'gboolean ${underscore}_${message_underscore}_finish_into (\n'
+                    '    ${camelcase} *self,\n'
+                    '    GAsyncResult *res,\n'
+                    '    ${output_camelcase}Values *values,\n'
+                    '    GError **error);\n')
             hfile.write(string.Template(template).substitute(translations))
 
-            template = (
-                '\n'
-                '${output_camelcase} *\n'
-                '${underscore}_${message_underscore}_finish (\n'
-                '    ${camelcase} *self,\n'
-                '    GAsyncResult *res,\n'
-                '    GError **error)\n'
-                '{\n'
-                '   return g_task_propagate_pointer (G_TASK (res), error);\n'
-                '}\n')
+            if message.output.fixed_layout:
+                # The response is kept unparsed, so that it can be parsed
+                # either into a new output bundle or into caller storage
+                template = (
+                    '\n'
+                    '${output_camelcase} *\n'
+                    '${underscore}_${message_underscore}_finish (\n'
+                    '    ${camelcase} *self,\n'
+                    '    GAsyncResult *res,\n'
+                    '    GError **error)\n'
+                    '{\n'
+                    '    QmiMessage *reply;\n'
+                    '    ${output_camelcase} *output;\n'
+                    '\n'
+                    '    reply = g_task_propagate_pointer (G_TASK (res), error);\n'
+                    '    if (!reply)\n'
+                    '        return NULL;\n'
+                    '\n'
+                    '    output = __${message_fullname_underscore}_response_parse (reply, error);\n'
+                    '    qmi_message_unref (reply);\n'
+                    '    return output;\n'
+                    '}\n'
+                    '\n'
+                    'gboolean\n'
+                    '${underscore}_${message_underscore}_finish_into (\n'
+                    '    ${camelcase} *self,\n'
+                    '    GAsyncResult *res,\n'
+                    '    ${output_camelcase}Values *values,\n'
+                    '    GError **error)\n'
+                    '{\n'
+                    '    QmiMessage *reply;\n'
+                    '    gboolean parsed;\n'
+                    '\n'
+                    '    reply = g_task_propagate_pointer (G_TASK (res), error);\n'
+                    '    if (!reply)\n'
+                    '        return FALSE;\n'
+                    '\n'
+                    '    parsed = ${parse_into} (reply, values, error);\n'
+                    '    qmi_message_unref (reply);\n'
+                    '    return parsed;\n'
+                    '}\n')
+            else:
+                template = (
+                    '\n'
+                    '${output_camelcase} *\n'
+                    '${underscore}_${message_underscore}_finish (\n'
+                    '    ${camelcase} *self,\n'
+                    '    GAsyncResult *res,\n'
+                    '    GError **error)\n'
+                    '{\n'
+                    '   return g_task_propagate_pointer (G_TASK (res), error);\n'
+                    '}\n')
 
             if message.abort:
                 template += (
@@ -394,8 +463,13 @@ class Client:
                 '    GTask *task)\n'
                 '{\n'
                 '    GError *error = NULL;\n'
-                '    QmiMessage *reply;\n'
-                '    ${output_camelcase} *output;\n'
+                '    QmiMessage *reply;\n')
+
+            if not message.output.fixed_layout:
+                template += (
+                    '    ${output_camelcase} *output;\n')
+
+            template += (
                 '\n'
                 '    reply = qmi_device_command_full_finish (device, res, &error);\n'
                 '    if (!reply) {\n')
@@ -442,18 +516,31 @@ class Client:
                 '        g_object_unref (task);\n'
                 '        return;\n'
                 '    }\n'
-                '\n'
-                '    /* Parse reply */\n'
-                '    output = __${message_fullname_underscore}_response_parse (reply, &error);\n'
-                '    if (!output)\n'
-                '        g_task_return_error (task, error);\n'
-                '    else\n'
-                '        g_task_return_pointer (task,\n'
-                '                               output,\n'
-                '                               (GDestroyNotify)${output_underscore}_unref);\n'
-                '    g_object_unref (task);\n'
-                '    qmi_message_unref (reply);\n'
-                '}\n'
+                '\n')
+
+            if message.output.fixed_layout:
+                template += (
+                    '    /* Parsed when finishing */\n'
+                    '    g_task_return_pointer (task,\n'
+                    '                           reply,\n'
+                    '                           (GDestroyNotify)qmi_message_unref);\n'
+                    '    g_object_unref (task);\n'
+                    '}\n')
+            else:
+                template += (
+                    '    /* Parse reply */\n'
+                    '    output = __${message_fullname_underscore}_response_parse (reply, &error);\n'
+                    '    if (!output)\n'
+                    '        g_task_return_error (task, error);\n'
+                    '    else\n'
+                    '        g_task_return_pointer (task,\n'
+                    '                               output,\n'
+                    '                               (GDestroyNotify)${output_underscore}_unref);\n'
+                    '    g_object_unref (task);\n'
+                    '    qmi_message_unref (reply);\n'
+                    '}\n')
+
+            template += (
                 '\n'
                 'void\n'
                 '${underscore}_${message_underscore} (\n'
@@ -23,6 +23,7 @@ import string
 import utils
 from FieldResult import FieldResult
 from Field import Field
+from VariableString import VariableString
 
 """
 The Container class takes care of handling collections of Input or
@@ -33,7 +34,7 @@ class Container:
     """
     Constructor
     """
-    def __init__(self, prefix, container_type, dictionary, common_objects_dictionary, static, since):
+    def __init__(self, prefix, container_type, dictionary, common_objects_dictionary, static, since, lazy = False):
         # The field container prefix usually contains the name of the Message,
         # e.g. "Qmi Message Ctl Something"
         self.prefix = prefix
@@ -102,6 +103,98 @@ class Container:
                     else:
                         self.fields.append(Field(self.fullname, field_dictionary, common_objects_dictionary, container_type, static))
 
+        # Strings in output containers are stored either directly in the
+        # container or in a single arena allocated along with it, sized from
+        # the lengths of the TLVs holding them
+        self.arena_fields = []
+        if self.readonly and self.fields is not None:
+            for field in self.fields:
+                if isinstance(field.variable, VariableString):
+                    field.variable.flag_output_field()
+                    if field.variable.storage == 'arena':
+                        self.arena_fields.append(field)
+
+        # Input containers keep the last request serialized from them, so that
+        # it can be sent again without building it from scratch, as long as
+        # all their contents are copied by the setters
+        self.serialized = False
+        if not self.readonly and self.fields is not None:
+            self.serialized = not [field for field in self.fields if field.variable.references_caller_data()]
+            for field in self.fields:
+                field.invalidates_serialized = self.serialized
+
+        # Output containers may have their optional fields parsed on first
+        # access. Fields other fields depend on, and fields depending on
+        # other optional fields, are always parsed right away.
+        self.lazy = False
+        if lazy and self.readonly and self.fields is not None:
+            mandatory = [field.name for field in self.fields if field.mandatory]
+            required = []
+            for field in self.fields:
+                for prerequisite in field.prerequisites:
+                    required.append(prerequisite['field'].split('.')[0])
+            for field in self.fields:
+                if field.mandatory or field.name in required:
+                    continue
+                if [p for p in field.prerequisites if p['field'].split('.')[0] not in mandatory]:
+                    continue
+                field.lazy = True
+                self.lazy = True
+
+        # Containers may be read or written by the generic codec, based on
+        # descriptor tables, instead of by unrolled code (set by the message)
+        self.codec_message_name = None
+
+        # Output containers with no heap-allocated contents may also be parsed
+        # into a plain struct given by the caller, if there is anything else
+        # than the result to parse
+        self.fixed_layout = False
+        if self.readonly and not self.static and self.fields is not None:
+            values = [field for field in self.fields if not isinstance(field, FieldResult)]
+            self.fixed_layout = len(values) > 0 and not [field for field in values if not field.variable.has_fixed_layout()]
+            # The plain struct is public, so its fields are laid out in the
+            # order of the version where they were introduced, and fields
+            # added in later versions go last, taking space from the padding
+            if self.fixed_layout:
+                self.values_fields = sorted(values, key = lambda field: [int(n) for n in field.since.split('.')])
+
+
+    """
+    Whether the container has the Result field
+    """
+    def has_result(self):
+        if self.fields is None:
+            return False
+        for field in self.fields:
+            if isinstance(field, FieldResult):
+                return True
+        return False
+
+
+    """
+    Whether all fields can be described in the tables of the generic codec,
+    which only supports equality prerequisites
+    """
+    def supports_codec(self):
+        if self.fields is None:
+            return False
+        for field in self.fields:
+            for prerequisite in field.prerequisites:
+                if prerequisite['operation'] not in ('==', '!='):
+                    return False
+        return True
+
+
+    """
+    Flag as being read or written by the generic codec
+    """
+    def flag_codec(self, message_name):
+        self.codec_message_name = message_name
+        codec_name = utils.build_underscore_name(self.fullname) + '_codec'
+        for i, field in enumerate(self.fields):
+            field.codec_name = codec_name
+            field.codec_index = i
+
 
     """
     Emit enumeration of TLVs in the container
@@ -122,7 +215,7 @@ class Container:
     """
     Emit new container types
     """
-    def __emit_types(self, hfile, cfile, translations):
+    def __emit_types(self, hfile, cfile, structfile, translations):
         translations['type_macro'] = 'QMI_TYPE_' + utils.remove_prefix(utils.build_underscore_uppercase_name(self.fullname), 'QMI_')
         # Emit types header
         template = (
@@ -132,7 +225,14 @@ class Container:
             ' *\n'
             ' * The #${camelcase} structure contains private data and should only be accessed\n'
             ' * using the provided API.\n'
-            ' *\n'
+            ' *\n')
+        if self.lazy:
+            template += (
+                ' * Most of its fields are parsed from the message on first access, so the\n'
+                ' * getters modify the #${camelcase}: unlike other bundles, it must not be\n'
+                ' * read from several threads at the same time.\n'
+                ' *\n')
+        template += (
             ' * Since: ${since}\n'
             ' */\n'
             'typedef struct _${camelcase} ${camelcase};\n'
@@ -145,7 +245,24 @@ class Container:
             '\n'
             'struct _${camelcase} {\n'
             '    volatile gint ref_count;\n')
-        cfile.write(string.Template(template).substitute(translations))
+        if self.lazy:
+            template += (
+                '\n'
+                '    /* Message where lazily parsed fields are read from */\n'
+                '    QmiMessage *message;\n')
+        if self.arena_fields:
+            template += (
+                '\n'
+                '    /* Storage for all strings */\n'
+                '    gchar *arena;\n'
+                '    gsize arena_size;\n'
+                '    gsize arena_used;\n')
+        if self.serialized:
+            template += (
+                '\n'
+                '    /* Request last serialized from the current contents */\n'
+                '    QmiMessage *serialized;\n')
+        structfile.write(string.Template(template).substitute(translations))
 
         if self.fields is not None:
             for field in self.fields:
@@ -157,11 +274,151 @@ class Container:
                         '\n'
                         '    /* ${field_name} */\n'
                         '    gboolean ${field_variable_name}_set;\n')
-                    cfile.write(string.Template(template).substitute(translations))
-                    cfile.write(variable_declaration)
+                    if field.lazy:
+                        template += (
+                            '    gboolean ${field_variable_name}_parsed;\n'
+                            '    GError *${field_variable_name}_error;\n')
+                    structfile.write(string.Template(template).substitute(translations))
+                    structfile.write(variable_declaration)
+
+        structfile.write(
+            '};\n')
+
 
-        cfile.write(
+    """
+    Emit the plain struct that fixed-layout containers may be parsed into
+    """
+    def __emit_values_type(self, hfile, translations):
+        template = (
+            '\n'
+            '/**\n'
+            ' * ${camelcase}Values:\n')
+        for field in self.values_fields:
+            underscore = utils.build_underscore_name(field.name)
+            template += ' * @%s_set: whether the \'%s\' field was found in the message.\n' % (underscore, field.name)
+            template += field.variable.build_struct_field_documentation(' * ', underscore)
+        template += (
+            ' *\n'
+            ' * The contents of a #${camelcase}, in a plain struct\n'
+            ' * that can be allocated by the caller, e.g. in the stack.\n'
+            ' *\n'
+            ' * The size of the struct doesn\'t change when new fields are added, as\n'
+            ' * they take space from the padding reserved at the end.\n'
+            ' *\n'
+            ' * Since: 1.24\n'
+            ' */\n'
+            'typedef struct {\n')
+        for field in self.values_fields:
+            underscore = utils.build_underscore_name(field.name)
+            template += '    gboolean %s_set;\n' % underscore
+            template += field.variable.build_variable_declaration(True, '    ', underscore)
+        template += (
+            '\n'
+            '    /*< private >*/\n'
+            '    gpointer reserved[8];\n'
+            '} ${camelcase}Values;\n')
+        hfile.write(string.Template(template).substitute(translations))
+
+
+    """
+    Emit the code copying the contents of the container in 'self' to the plain
+    struct in 'values'
+    """
+    def emit_values_copy(self, f, line_prefix):
+        for field in self.values_fields:
+            underscore = utils.build_underscore_name(field.name)
+            if field.lazy:
+                f.write('%s%s_parse_%s (&self, NULL);\n' % (line_prefix, utils.build_underscore_name(self.fullname), underscore))
+            f.write('%svalues->%s_set = self.%s_set;\n' % (line_prefix, underscore, field.variable_name))
+            f.write(field.variable.build_getter_implementation(line_prefix, 'self.' + field.variable_name, 'values->' + underscore, False))
+
+
+    """
+    Emit the descriptor tables of the fields in the container
+    """
+    def __emit_codec_tables(self, f, translations):
+        camelcase = translations['camelcase']
+        ops = []
+        op_comments = {}
+        prerequisites = []
+        tlvs = []
+        for field in self.fields:
+            first_op = len(ops)
+            op_comments[first_op] = field.name
+            field.variable.add_codec_ops(ops, camelcase, field.variable_name)
+
+            field_prerequisites = []
+            for prerequisite in field.prerequisites:
+                path = 'arg_' + utils.build_underscore_name(prerequisite['field'])
+                field_prerequisites.append('{ %s, sizeof (((%s *) 0)->%s), %s, %s }' % (utils.build_struct_offset(camelcase, path),
+                                                                                        camelcase,
+                                                                                        path,
+                                                                                        'TRUE' if prerequisite['operation'] == '==' else 'FALSE',
+                                                                                        prerequisite['value']))
+            # Fields usually share the same prerequisites, so reuse them if
+            # already in the table
+            for first_prerequisite in range(len(prerequisites) + 1):
+                if prerequisites[first_prerequisite:first_prerequisite + len(field_prerequisites)] == field_prerequisites:
+                    break
+            else:
+                first_prerequisite = len(prerequisites)
+            if first_prerequisite + len(field_prerequisites) > len(prerequisites):
+                prerequisites = prerequisites[:first_prerequisite] + field_prerequisites
+
+            if field.mandatory:
+                flags = 'QMI_CODEC_TLV_FLAG_MANDATORY'
+            elif field.lazy:
+                flags = 'QMI_CODEC_TLV_FLAG_LAZY'
+            else:
+                flags = 'QMI_CODEC_TLV_FLAG_NONE'
+            tlvs.append('{ %s, %s, %s, %d, %d, %d, %d, "%s" }' % (field.id_enum_name,
+                                                                  flags,
+                                                                  utils.build_struct_offset(camelcase, field.variable_name + '_set'),
+                                                                  first_op,
+                                                                  len(ops) - first_op,
+                                                                  first_prerequisite,
+                                                                  len(field.prerequisites),
+                                                                  field.name))
+
+        translations['message_name'] = self.codec_message_name
+        translations['arena_offset'] = utils.build_struct_offset(camelcase, 'arena' if self.arena_fields else '')
+        translations['prerequisites'] = translations['underscore'] + '_codec_prerequisites' if prerequisites else 'NULL'
+
+        f.write(string.Template(
+            '\n'
+            'static const QmiCodecOp ${underscore}_codec_ops[] = {\n').substitute(translations))
+        for i, op in enumerate(ops):
+            if i in op_comments:
+                f.write('    /* %s */\n' % op_comments[i])
+            f.write('    %s,\n' % op)
+        f.write('};\n')
+
+        if prerequisites:
+            f.write(string.Template(
+                '\n'
+                'static const QmiCodecPrerequisite ${underscore}_codec_prerequisites[] = {\n').substitute(translations))
+            for prerequisite in prerequisites:
+                f.write('    %s,\n' % prerequisite)
+            f.write('};\n')
+
+        f.write(string.Template(
+            '\n'
+            'static const QmiCodecTlv ${underscore}_codec_tlvs[] = {\n').substitute(translations))
+        for tlv in tlvs:
+            f.write('    %s,\n' % tlv)
+        f.write('};\n')
+
+        template = (
+            '\n'
+            'static const QmiCodecBundle ${underscore}_codec = {\n'
+            '    "${message_name}",\n'
+            '    ${underscore}_codec_tlvs,\n'
+            '    G_N_ELEMENTS (${underscore}_codec_tlvs),\n'
+            '    ${underscore}_codec_ops,\n'
+            '    ${prerequisites},\n'
+            '    ${arena_offset}\n'
             '};\n')
+        f.write(string.Template(template).substitute(translations))
 
 
     """
@@ -253,6 +510,25 @@ class Container:
                 if field.variable is not None and field.variable.needs_dispose is True:
                     template += field.variable.build_dispose('        ', 'self->' + field.variable_name)
 
+        if self.arena_fields:
+            template += (
+                '        g_free (self->arena);\n')
+
+        if self.fields is not None:
+            for field in self.fields:
+                if field.lazy:
+                    template += '        g_clear_error (&self->%s_error);\n' % field.variable_name
+
+        if self.lazy:
+            template += (
+                '        if (self->message)\n'
+                '            qmi_message_unref (self->message);\n')
+
+        if self.serialized:
+            template += (
+                '        if (self->serialized)\n'
+                '            qmi_message_unref (self->serialized);\n')
+
         template += (
             '        g_slice_free (${camelcase}, self);\n'
             '    }\n'
@@ -280,7 +556,7 @@ class Container:
     """
     Emit container implementation
     """
-    def emit(self, hfile, cfile):
+    def emit(self, hfile, cfile, pfile):
         translations = { 'name'       : self.name,
                          'camelcase'  : utils.build_camelcase_name (self.fullname),
                          'underscore' : utils.build_underscore_name (self.fullname),
@@ -301,14 +577,25 @@ class Container:
         if self.fields is not None:
             for field in self.fields:
                 field.emit_types(auxfile, cfile)
-        self.__emit_types(auxfile, cfile, translations)
+        # The contents of the inputs of public messages are shared with the
+        # tests
+        structfile = pfile if not self.static and not self.readonly else cfile
+        self.__emit_types(auxfile, cfile, structfile, translations)
+        if self.fixed_layout:
+            self.__emit_values_type(hfile, translations)
 
         # Emit TLV enums
         self.__emit_tlv_ids_enum(cfile)
 
+        # Emit the tables for the generic codec
+        if self.codec_message_name is not None:
+            self.__emit_codec_tables(cfile, translations)
+
         # Emit fields
         if self.fields is not None:
             for field in self.fields:
+                if field.lazy:
+                    field.emit_lazy_parser(cfile)
                 field.emit_getter(auxfile, cfile)
                 if self.readonly == False:
                     field.emit_setter(auxfile, cfile)
@@ -338,6 +625,9 @@ class Container:
         # Public types
         template = (
             '${camelcase}\n')
+        if self.fixed_layout:
+            template += (
+                '${camelcase}Values\n')
         sections['public-types'] += string.Template(template).substitute(translations)
 
         # Public methods
@@ -48,6 +48,17 @@ class Field:
         self.container_type = container_type
         # Whether the whole field is internally used only
         self.static = static
+        # Whether the field is parsed on first access (output only, set by
+        # the container)
+        self.lazy = False
+        # Whether setting the field drops the request serialized from the
+        # container (input only, set by the container)
+        self.invalidates_serialized = False
+        # The descriptor tables of the container and the index of the field
+        # within them, when read or written by the generic codec (set by the
+        # container)
+        self.codec_name = None
+        self.codec_index = None
 
         # Create the composed full name (prefix + name),
         #  e.g. "Qmi Message Ctl Something Output Result"
@@ -133,7 +144,13 @@ class Field:
             ' * @error: Return location for error or %NULL.\n'
             ' *\n'
             ' * Get the \'${name}\' field from @self.\n'
-            ' *\n'
+            ' *\n')
+        if self.lazy:
+            template += (
+                ' * The field is parsed from the message on the first call. If it cannot be\n'
+                ' * read, that call and all the following ones report the same @error.\n'
+                ' *\n')
+        template += (
             ' * Returns: %TRUE if the field is found, %FALSE otherwise.\n'
             ' *\n'
             ' * Since: ${since}\n'
@@ -154,7 +171,20 @@ class Field:
             '    GError **error)\n'
             '{\n'
             '    g_return_val_if_fail (self != NULL, FALSE);\n'
-            '\n'
+            '\n')
+        if self.lazy:
+            template += (
+                '    /* Errors parsing the TLV are kept, and reported on every call */\n'
+                '    if (!self->${variable_name}_parsed) {\n'
+                '        self->${variable_name}_parsed = TRUE;\n'
+                '        ${prefix_underscore}_parse_${underscore} (self, &self->${variable_name}_error);\n'
+                '    }\n'
+                '    if (self->${variable_name}_error) {\n'
+                '        g_propagate_error (error, g_error_copy (self->${variable_name}_error));\n'
+                '        return FALSE;\n'
+                '    }\n'
+                '\n')
+        template += (
             '    if (!self->${variable_name}_set) {\n'
             '        g_set_error (error,\n'
             '                     QMI_CORE_ERROR,\n'
@@ -170,6 +200,64 @@ class Field:
         cfile.write(string.Template(template).substitute(translations))
 
 
+    """
+    Emit the method responsible for parsing this TLV from the message on first
+    access, for lazily parsed output fields. Errors reading a TLV found in the
+    message are reported, and the field is left unset.
+    """
+    def emit_lazy_parser(self, cfile):
+        translations = { 'name'              : self.name,
+                         'variable_name'     : self.variable_name,
+                         'underscore'        : utils.build_underscore_name(self.name),
+                         'prefix_camelcase'  : utils.build_camelcase_name(self.prefix),
+                         'prefix_underscore' : utils.build_underscore_name(self.prefix),
+                         'codec_name'        : self.codec_name,
+                         'codec_index'       : self.codec_index }
+
+        if self.codec_name is not None:
+            template = (
+                '\n'
+                'static gboolean\n'
+                '${prefix_underscore}_parse_${underscore} (\n'
+                '    ${prefix_camelcase} *self,\n'
+                '    GError **error)\n'
+                '{\n'
+                '    return __qmi_codec_decode_tlv (&${codec_name}, ${codec_index}, self->message, self, error);\n'
+                '}\n')
+            cfile.write(string.Template(template).substitute(translations))
+            return
+
+        template = (
+            '\n'
+            'static gboolean\n'
+            '${prefix_underscore}_parse_${underscore} (\n'
+            '    ${prefix_camelcase} *self,\n'
+            '    GError **error)\n'
+            '{\n'
+            '    QmiMessage *message = self->message;\n'
+            '    GError *inner_error = NULL;\n'
+            '\n'
+            '    do {\n')
+        cfile.write(string.Template(template).substitute(translations))
+        self.emit_output_prerequisite_check(cfile, '        ')
+        cfile.write(
+            '\n'
+            '        {\n')
+        self.emit_output_tlv_get(cfile, '            ', read_error = '&inner_error')
+        template = (
+            '\n'
+            '        }\n'
+            '    } while (0);\n'
+            '\n'
+            '    if (inner_error) {\n'
+            '        g_propagate_prefixed_error (error, inner_error, "Couldn\'t get the ${name} TLV: ");\n'
+            '        return FALSE;\n'
+            '    }\n'
+            '    return TRUE;\n'
+            '}\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+
     """
     Emit the method responsible for setting this TLV in the input/output
     container
@@ -223,7 +311,11 @@ class Field:
             '    g_return_val_if_fail (self != NULL, FALSE);\n'
             '\n'
             '${variable_setter_imp}'
-            '    self->${variable_name}_set = TRUE;\n'
+            '    self->${variable_name}_set = TRUE;\n')
+        if self.invalidates_serialized:
+            template += (
+                '    __qmi_serialized_drop (&self->serialized);\n')
+        template += (
             '\n'
             '    return TRUE;\n'
             '}\n')
@@ -261,6 +353,38 @@ class Field:
         f.write(string.Template(template).substitute(translations))
 
 
+    """
+    Emit the code responsible for adding the size of the TLV to 'tlvs_size', if
+    it is going to be added to the message
+    """
+    def emit_input_tlv_size(self, f, line_prefix):
+        translations = { 'name'          : self.name,
+                         'variable_name' : self.variable_name,
+                         'lp'            : line_prefix }
+
+        value_size = self.variable.fixed_buffer_size()
+        if value_size is not None:
+            translations['value_size'] = value_size
+            template = (
+                '${lp}/* \'${name}\' TLV: header plus value */\n'
+                '${lp}if (input->${variable_name}_set)\n'
+                '${lp}    tlvs_size += 3 + ${value_size};\n')
+            f.write(string.Template(template).substitute(translations))
+            return
+
+        template = (
+            '${lp}/* \'${name}\' TLV: header plus value */\n'
+            '${lp}if (input->${variable_name}_set) {\n'
+            '${lp}    tlvs_size += 3;\n')
+        f.write(string.Template(template).substitute(translations))
+
+        self.variable.emit_buffer_size(f, line_prefix + '    ', 'input->' + self.variable_name)
+
+        template = (
+            '${lp}}\n')
+        f.write(string.Template(template).substitute(translations))
+
+
     """
     Emit the code responsible for checking prerequisites in output TLVs
     """
@@ -282,11 +406,23 @@ class Field:
 
 
     """
-    Emit the code responsible for retrieving the TLV from the QMI message
+    Emit the code responsible for retrieving the TLV from the QMI message. If
+    'failure' is given, it is the statement run when a mandatory TLV cannot be
+    read, instead of releasing 'self' and returning NULL. If 'read_error' is
+    given, it is where errors reading the contents of an optional TLV found in
+    the message are reported, instead of ignoring them.
     """
-    def emit_output_tlv_get(self, f, line_prefix):
+    def emit_output_tlv_get(self, f, line_prefix, failure = None, read_error = None):
         tlv_out = utils.build_underscore_name (self.fullname) + '_out'
         error = 'error' if self.mandatory else 'NULL'
+        if read_error is None:
+            read_error = error
+        if failure is None:
+            failure = (
+                '${lp}    ${container_underscore}_unref (self);\n'
+                '${lp}    return NULL;\n')
+        else:
+            failure = '${lp}    ' + failure + '\n'
         translations = { 'name'                 : self.name,
                          'container_underscore' : utils.build_underscore_name (self.prefix),
                          'tlv_out'              : tlv_out,
@@ -303,9 +439,8 @@ class Field:
 
         if self.mandatory:
             template += (
-                '${lp}    g_prefix_error (${error}, "Couldn\'t get the mandatory ${name} TLV: ");\n'
-                '${lp}    ${container_underscore}_unref (self);\n'
-                '${lp}    return NULL;\n')
+                '${lp}    g_prefix_error (${error}, "Couldn\'t get the mandatory ${name} TLV: ");\n' +
+                failure)
         else:
             template += (
                 '${lp}    goto ${tlv_out};\n')
@@ -316,7 +451,7 @@ class Field:
         f.write(string.Template(template).substitute(translations))
 
         # Now, read the contents of the buffer into the variable
-        self.variable.emit_buffer_read(f, line_prefix, tlv_out, error, 'self->' + self.variable_name)
+        self.variable.emit_buffer_read(f, line_prefix, tlv_out, read_error, 'self->' + self.variable_name)
 
         template = (
             '\n'
@@ -330,9 +465,8 @@ class Field:
             '${tlv_out}:\n')
         if self.mandatory:
             template += (
-                '${lp}if (!self->${variable_name}_set) {\n'
-                '${lp}    ${container_underscore}_unref (self);\n'
-                '${lp}    return NULL;\n'
+                '${lp}if (!self->${variable_name}_set) {\n' +
+                failure +
                 '${lp}}\n')
         else:
             template += (
@@ -341,7 +475,7 @@ class Field:
 
 
     """
-    Emit the method responsible for creating a printable representation of the TLV
+    Emit the method responsible for appending a printable representation of the TLV
     """
     def emit_tlv_helpers(self, f):
         if TypeFactory.helpers_emitted(self.fullname):
@@ -355,20 +489,17 @@ class Field:
 
         template = (
             '\n'
-            'static gchar *\n'
-            '${underscore}_get_printable (\n'
+            'static void\n'
+            '${underscore}_append_printable (\n'
             '    QmiMessage *message,\n'
-            '    const gchar *line_prefix)\n'
+            '    GString *printable)\n'
             '{\n'
             '    gsize offset = 0;\n'
             '    gsize init_offset;\n'
-            '    GString *printable;\n'
             '    GError *error = NULL;\n'
             '\n'
             '    if ((init_offset = qmi_message_tlv_read_init (message, ${tlv_id}, NULL, NULL)) == 0)\n'
-            '        return NULL;\n'
-            '\n'
-            '    printable = g_string_new ("");\n')
+            '        return;\n')
         f.write(string.Template(template).substitute(translations))
 
         # Now, read the contents of the buffer into the printable representation
@@ -380,9 +511,10 @@ class Field:
             '        g_string_append_printf (printable, "Additional unexpected \'%" G_GSIZE_FORMAT "\' bytes", offset);\n'
             '\n'
             'out:\n'
-            '    if (error)\n'
+            '    if (error) {\n'
             '        g_string_append_printf (printable, " ERROR: %s", error->message);\n'
-            '    return g_string_free (printable, FALSE);\n'
+            '        g_error_free (error);\n'
+            '    }\n'
             '}\n')
         f.write(string.Template(template).substitute(translations))
 
@@ -31,7 +31,7 @@ class Message:
     """
     Constructor
     """
-    def __init__(self, dictionary, common_objects_dictionary):
+    def __init__(self, dictionary, common_objects_dictionary, backend = 'unrolled'):
         # The message service, e.g. "Ctl"
         self.service = dictionary['service']
         # The name of the specific message, e.g. "Something"
@@ -45,6 +45,9 @@ class Message:
         self.version_info = dictionary['version'].split('.') if 'version' in dictionary else []
         self.static = True if 'scope' in dictionary and dictionary['scope'] == 'library-only' else False
         self.abort = True if 'abort' in dictionary and dictionary['abort'] == 'yes' else False
+        # Whether optional output fields are parsed on first access instead of
+        # when the response/indication is received
+        self.lazy_output = True if 'lazy-output' in dictionary and dictionary['lazy-output'] == 'yes' else False
 
         # libqmi version where the message was introduced
         self.since = dictionary['since'] if 'since' in dictionary else None
@@ -76,7 +79,8 @@ class Message:
                                 dictionary['output'] if 'output' in dictionary else None,
                                 common_objects_dictionary,
                                 self.static,
-                                self.since)
+                                self.since,
+                                self.lazy_output)
 
         self.input = None
         if self.type == 'Message':
@@ -91,34 +95,97 @@ class Message:
                                    self.static,
                                    self.since)
 
+        # With the 'tables' backend, the containers are read and written by
+        # the generic codec in the library, from descriptor tables, instead of
+        # by unrolled code
+        if backend == 'tables':
+            for container in (self.output, self.input):
+                if container is not None and container.supports_codec():
+                    container.flag_codec(self.name)
+
 
     """
     Emit method responsible for creating a new request of the given type
     """
-    def __emit_request_creator(self, hfile, cfile):
+    def __emit_request_creator(self, pfile, cfile):
         translations = { 'name'       : self.name,
                          'service'    : self.service,
                          'container'  : utils.build_camelcase_name (self.input.fullname),
                          'underscore' : utils.build_underscore_name (self.fullname),
-                         'message_id' : self.id_enum_name }
+                         'message_id' : self.id_enum_name,
+                         'static'     : 'static ' if self.static else '' }
 
         input_arg_template = 'gpointer unused' if self.input.fields is None else '${container} *input'
+
+        # Creators of public messages are shared with the tests
+        if not self.static:
+            template = (
+                '\n'
+                'G_GNUC_INTERNAL\n'
+                'QmiMessage *__${underscore}_request_create (\n'
+                '    guint16 transaction_id,\n'
+                '    guint8 cid,\n'
+                '    %s,\n'
+                '    GError **error);\n' % input_arg_template)
+            pfile.write(string.Template(template).substitute(translations))
+
         template = (
             '\n'
-            'static QmiMessage *\n'
+            '${static}QmiMessage *\n'
             '__${underscore}_request_create (\n'
             '    guint16 transaction_id,\n'
             '    guint8 cid,\n'
             '    %s,\n'
             '    GError **error)\n'
             '{\n'
-            '    QmiMessage *self;\n'
-            '\n'
-            '    self = qmi_message_new (QMI_SERVICE_${service},\n'
-            '                            cid,\n'
-            '                            transaction_id,\n'
-            '                            ${message_id});\n' % input_arg_template)
-        cfile.write(string.Template(template).substitute(translations))
+            '    QmiMessage *self;\n' % input_arg_template)
+
+        if self.input.codec_message_name is not None:
+            self.__emit_request_creator_codec(cfile, template, translations)
+            return
+
+        if not self.input.fields:
+            template += (
+                '\n'
+                '    self = qmi_message_new (QMI_SERVICE_${service},\n'
+                '                            cid,\n'
+                '                            transaction_id,\n'
+                '                            ${message_id});\n')
+            cfile.write(string.Template(template).substitute(translations))
+        else:
+            template += (
+                '    gsize tlvs_size = 0;\n'
+                '    gsize expected_length;\n'
+                '\n')
+            if self.input.serialized:
+                template += (
+                    '    /* Reuse the request last serialized from the same input contents */\n'
+                    '    if (input && (self = __qmi_serialized_reuse (&input->serialized, cid, transaction_id)) != NULL)\n'
+                    '        return self;\n'
+                    '\n')
+            template += (
+                '    /* Compute the size of all the TLVs to add, so that the message buffer\n'
+                '     * is allocated just once */\n'
+                '    if (input) {\n')
+            cfile.write(string.Template(template).substitute(translations))
+
+            first = True
+            for field in self.input.fields:
+                if not first:
+                    cfile.write('\n')
+                first = False
+                field.emit_input_tlv_size(cfile, '        ')
+
+            template = (
+                '    }\n'
+                '\n'
+                '    self = qmi_message_new_with_capacity (QMI_SERVICE_${service},\n'
+                '                                          cid,\n'
+                '                                          transaction_id,\n'
+                '                                          ${message_id},\n'
+                '                                          tlvs_size);\n'
+                '    expected_length = qmi_message_get_length (self) + tlvs_size;\n')
+            cfile.write(string.Template(template).substitute(translations))
 
         if self.input.fields:
             # Count how many mandatory fields we have
@@ -175,6 +242,17 @@ class Message:
 
                 cfile.write(
                     '    }\n')
+
+            cfile.write(
+                '\n'
+                '    /* The size computed above must match the TLVs actually written */\n'
+                '    g_warn_if_fail (qmi_message_get_length (self) == expected_length);\n')
+
+            if self.input.serialized:
+                cfile.write(
+                    '\n'
+                    '    /* Keep it to be reused while the input contents don\'t change */\n'
+                    '    __qmi_serialized_keep (&input->serialized, self);\n')
         cfile.write(
             '\n'
             '    return self;\n')
@@ -188,6 +266,88 @@ class Message:
             '}\n')
 
 
+    """
+    Emit the body of the request creator, serializing the input through the
+    generic codec
+    """
+    def __emit_request_creator_codec(self, cfile, template, translations):
+        translations['container_underscore'] = utils.build_underscore_name (self.input.fullname)
+
+        template += '\n'
+        if self.input.serialized:
+            template += (
+                '    /* Reuse the request last serialized from the same input contents */\n'
+                '    if (input && (self = __qmi_serialized_reuse (&input->serialized, cid, transaction_id)) != NULL)\n'
+                '        return self;\n'
+                '\n')
+        template += (
+            '    self = __qmi_codec_encode (&${container_underscore}_codec,\n'
+            '                               QMI_SERVICE_${service},\n'
+            '                               cid,\n'
+            '                               transaction_id,\n'
+            '                               ${message_id},\n'
+            '                               input,\n'
+            '                               error);\n')
+        if self.input.serialized:
+            template += (
+                '\n'
+                '    /* Keep it to be reused while the input contents don\'t change */\n'
+                '    if (self && input)\n'
+                '        __qmi_serialized_keep (&input->serialized, self);\n')
+        template += (
+            '\n'
+            '    return self;\n'
+            '}\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+
+    """
+    Emit the test of the request creator, which builds a request with all the
+    input fields set. The creator warns if the message buffer had to be
+    reallocated, which makes the test fail.
+    """
+    def emit_request_creator_test(self, cfile):
+        translations = { 'name'                 : self.name,
+                         'container'            : utils.build_camelcase_name (self.input.fullname),
+                         'container_underscore' : utils.build_underscore_name (self.input.fullname),
+                         'underscore'           : utils.build_underscore_name (self.fullname) }
+
+        template = (
+            '\n'
+            '    /* ${name} */\n'
+            '    {\n')
+        if self.input.fields:
+            template += (
+                '        ${container} *input;\n')
+        template += (
+            '        QmiMessage *request;\n'
+            '        GError *error = NULL;\n'
+            '\n')
+
+        if self.input.fields:
+            template += (
+                '        input = ${container_underscore}_new ();\n')
+            for field in self.input.fields:
+                template += '        input->%s_set = TRUE;\n' % field.variable_name
+                template += field.variable.build_test_value('        ', 'input->' + field.variable_name, True).replace('$', '$$')
+            template += (
+                '        request = __${underscore}_request_create (1, 1, input, &error);\n')
+        else:
+            template += (
+                '        request = __${underscore}_request_create (1, 1, NULL, &error);\n')
+
+        template += (
+            '        g_assert_no_error (error);\n'
+            '        g_assert (request != NULL);\n'
+            '        qmi_message_unref (request);\n')
+        if self.input.fields:
+            template += (
+                '        ${container_underscore}_unref (input);\n')
+        template += (
+            '    }\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+
     """
     Emit method responsible for parsing a response/indication of the given type
     """
@@ -203,6 +363,14 @@ class Message:
                          'underscore'           : utils.build_underscore_name (self.fullname),
                          'message_id'           : self.id_enum_name }
 
+        # Fixed-layout containers are read by a method shared with the parser
+        # into the caller-provided struct
+        if self.output.codec_message_name is not None:
+            translations['decode'] = '__qmi_codec_decode (&${container_underscore}_codec, message, ${self}, error)'
+        elif self.output.fixed_layout:
+            translations['decode'] = '__${underscore}_${type}_parse_fields (message, ${self}, error)'
+            self.__emit_response_or_indication_fields_parser(cfile, translations)
+
         template = (
             '\n'
             'static ${container} *\n'
@@ -216,9 +384,46 @@ class Message:
             '\n'
             '    self = g_slice_new0 (${container});\n'
             '    self->ref_count = 1;\n')
+        if self.output.lazy:
+            template += (
+                '\n'
+                '    /* Optional fields are parsed on first access */\n'
+                '    self->message = qmi_message_ref (message);\n')
+        if 'decode' in translations:
+            template += (
+                '\n'
+                '    if (!' + string.Template(translations['decode']).safe_substitute(self = 'self') + ') {\n'
+                '        ${container_underscore}_unref (self);\n'
+                '        return NULL;\n'
+                '    }\n'
+                '\n'
+                '    return self;\n'
+                '}\n')
+            cfile.write(string.Template(template).substitute(translations))
+            if self.output.fixed_layout:
+                self.__emit_response_or_indication_parser_into(hfile, cfile, translations)
+            return
+        if self.output.arena_fields:
+            template += (
+                '\n'
+                '    /* Strings are never longer than the TLVs holding them, so\n'
+                '     * the whole arena can be allocated at once */\n'
+                '    {\n'
+                '        guint16 tlv_length;\n'
+                '\n')
+            for field in self.output.arena_fields:
+                template += (
+                    '        if (qmi_message_tlv_read_init (message, %s, &tlv_length, NULL) > 0)\n'
+                    '            self->arena_size += tlv_length + 1;\n' % field.id_enum_name)
+            template += (
+                '        if (self->arena_size > 0)\n'
+                '            self->arena = g_malloc (self->arena_size);\n'
+                '    }\n')
         cfile.write(string.Template(template).substitute(translations))
 
         for field in self.output.fields:
+            if field.lazy:
+                continue
             cfile.write(
                 '\n'
                 '    do {\n')
@@ -238,6 +443,128 @@ class Message:
             '}\n')
 
 
+    """
+    Emit method reading all fields of a fixed-layout response/indication into
+    the given container
+    """
+    def __emit_response_or_indication_fields_parser(self, cfile, translations):
+        template = (
+            '\n'
+            'static gboolean\n'
+            '__${underscore}_${type}_parse_fields (\n'
+            '    QmiMessage *message,\n'
+            '    ${container} *self,\n'
+            '    GError **error)\n'
+            '{\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+        for field in self.output.fields:
+            if field.lazy:
+                continue
+            cfile.write(
+                '    do {\n')
+            field.emit_output_prerequisite_check(cfile, '        ')
+            cfile.write(
+                '\n'
+                '        {\n')
+            field.emit_output_tlv_get(cfile, '            ', 'return FALSE;')
+            cfile.write(
+                '\n'
+                '        }\n'
+                '    } while (0);\n'
+                '\n')
+        cfile.write(
+            '    return TRUE;\n'
+            '}\n')
+
+
+    """
+    Emit method parsing a fixed-layout response/indication into a plain struct
+    given by the caller, without allocating a container
+    """
+    def __emit_response_or_indication_parser_into(self, hfile, cfile, translations):
+        translations['parse_into'] = self.parse_into_name()
+        translations['decode_into'] = string.Template(translations['decode']).safe_substitute(translations, self = '&self')
+
+        template = (
+            '\n'
+            '/**\n'
+            ' * ${parse_into}:\n'
+            ' * @message: a #QmiMessage.\n'
+            ' * @values: a #${container}Values to fill in.\n'
+            ' * @error: Return location for error or %NULL.\n'
+            ' *\n'
+            ' * Parses the fields of a ${name} ${type} into @values, without\n'
+            ' * allocating a #${container}.\n'
+            ' *\n')
+        if self.output.has_result():
+            template += (
+                ' * If the ${type} reports a QMI protocol error, @values is filled in\n'
+                ' * anyway and the error is also reported.\n'
+                ' *\n'
+                ' * Returns: %TRUE if the message is parsed and reports success, %FALSE if @error is set.\n')
+        else:
+            template += (
+                ' * Returns: %TRUE if the message is parsed, %FALSE if @error is set.\n')
+        template += (
+            ' *\n'
+            ' * Since: 1.24\n'
+            ' */\n'
+            'gboolean ${parse_into} (\n'
+            '    QmiMessage *message,\n'
+            '    ${container}Values *values,\n'
+            '    GError **error);\n')
+        hfile.write(string.Template(template).substitute(translations))
+
+        template = (
+            '\n'
+            'gboolean\n'
+            '${parse_into} (\n'
+            '    QmiMessage *message,\n'
+            '    ${container}Values *values,\n'
+            '    GError **error)\n'
+            '{\n'
+            '    /* Nothing in the container is heap-allocated */\n'
+            '    ${container} self = { 0 };\n'
+            '\n'
+            '    g_return_val_if_fail (message != NULL, FALSE);\n'
+            '    g_return_val_if_fail (values != NULL, FALSE);\n'
+            '    g_return_val_if_fail (qmi_message_get_message_id (message) == ${message_id}, FALSE);\n'
+            '\n')
+        if self.output.lazy:
+            template += (
+                '    self.message = message;\n')
+        template += (
+            '    if (!${decode_into})\n'
+            '        return FALSE;\n'
+            '\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+        self.output.emit_values_copy(cfile, '    ')
+
+        if self.output.has_result():
+            template = (
+                '\n'
+                '    return ${container_underscore}_get_result (&self, error);\n'
+                '}\n')
+        else:
+            template = (
+                '\n'
+                '    return TRUE;\n'
+                '}\n')
+        cfile.write(string.Template(template).substitute(translations))
+
+
+    """
+    Name of the method parsing a fixed-layout response/indication into a plain
+    struct
+    """
+    def parse_into_name(self):
+        if self.type == 'Message':
+            return utils.build_underscore_name(self.fullname) + '_response_parse_into'
+        return utils.build_underscore_name(self.fullname) + '_parse_into'
+
+
     """
     Emit method responsible for getting a printable representation of the whole
     request/response
@@ -278,7 +605,7 @@ class Message:
                 '    struct ${type}_${underscore}_context *ctx)\n'
                 '{\n'
                 '    const gchar *tlv_type_str = NULL;\n'
-                '    gchar *translated_value;\n'
+                '    void (* append_translated) (QmiMessage *self, GString *printable) = NULL;\n'
                 '\n')
 
             if self.type == 'Message':
@@ -294,9 +621,7 @@ class Message:
                         field_template = (
                             '        case ${field_enum}:\n'
                             '            tlv_type_str = "${field_name}";\n'
-                            '            translated_value = ${underscore_field}_get_printable (\n'
-                            '                                   ctx->self,\n'
-                            '                                   ctx->line_prefix);\n'
+                            '            append_translated = ${underscore_field}_append_printable;\n'
                             '            break;\n')
                         template += string.Template(field_template).substitute(translations)
 
@@ -317,9 +642,7 @@ class Message:
                     field_template = (
                         '        case ${field_enum}:\n'
                         '            tlv_type_str = "${field_name}";\n'
-                        '            translated_value = ${underscore_field}_get_printable (\n'
-                        '                                   ctx->self,\n'
-                        '                                   ctx->line_prefix);\n'
+                        '            append_translated = ${underscore_field}_append_printable;\n'
                         '            break;\n')
                     template += string.Template(field_template).substitute(translations)
 
@@ -330,45 +653,38 @@ class Message:
                 '    }\n'
                 '\n'
                 '    if (!tlv_type_str) {\n'
-                '        gchar *value_str = NULL;\n'
-                '\n'
-                '        value_str = qmi_message_get_tlv_printable (ctx->self,\n'
-                '                                                   ctx->line_prefix,\n'
-                '                                                   type,\n'
-                '                                                   value,\n'
-                '                                                   length);\n'
-                '        g_string_append (ctx->printable, value_str);\n'
-                '        g_free (value_str);\n'
-                '    } else {\n'
-                '        gchar *value_hex;\n'
-                '\n'
-                '        value_hex = __qmi_utils_str_hex (value, length, \':\');\n'
-                '        g_string_append_printf (ctx->printable,\n'
-                '                                "%sTLV:\\n"\n'
-                '                                "%s  type       = \\"%s\\" (0x%02x)\\n"\n'
-                '                                "%s  length     = %" G_GSIZE_FORMAT "\\n"\n'
-                '                                "%s  value      = %s\\n"\n'
-                '                                "%s  translated = %s\\n",\n'
-                '                                ctx->line_prefix,\n'
-                '                                ctx->line_prefix, tlv_type_str, type,\n'
-                '                                ctx->line_prefix, length,\n'
-                '                                ctx->line_prefix, value_hex,\n'
-                '                                ctx->line_prefix, translated_value ? translated_value : "");\n'
-                '        g_free (value_hex);\n'
-                '        g_free (translated_value);\n'
+                '        __qmi_message_append_tlv_printable (ctx->printable,\n'
+                '                                            ctx->line_prefix,\n'
+                '                                            type,\n'
+                '                                            value,\n'
+                '                                            length);\n'
+                '        return;\n'
                 '    }\n'
+                '\n'
+                '    /* Everything is appended in place, no intermediate strings */\n'
+                '    g_string_append_printf (ctx->printable,\n'
+                '                            "%sTLV:\\n"\n'
+                '                            "%s  type       = \\"%s\\" (0x%02x)\\n"\n'
+                '                            "%s  length     = %" G_GSIZE_FORMAT "\\n"\n'
+                '                            "%s  value      = ",\n'
+                '                            ctx->line_prefix,\n'
+                '                            ctx->line_prefix, tlv_type_str, type,\n'
+                '                            ctx->line_prefix, length,\n'
+                '                            ctx->line_prefix);\n'
+                '    __qmi_utils_str_hex_append (ctx->printable, value, length, \':\');\n'
+                '    g_string_append_printf (ctx->printable, "\\n%s  translated = ", ctx->line_prefix);\n'
+                '    append_translated (ctx->self, ctx->printable);\n'
+                '    g_string_append_c (ctx->printable, \'\\n\');\n'
                 '}\n')
 
         template += (
             '\n'
-            'static gchar *\n'
-            '${type}_${underscore}_get_printable (\n'
+            'static void\n'
+            '${type}_${underscore}_append_printable (\n'
             '    QmiMessage *self,\n'
-            '    const gchar *line_prefix)\n'
+            '    const gchar *line_prefix,\n'
+            '    GString *printable)\n'
             '{\n'
-            '    GString *printable;\n'
-            '\n'
-            '    printable = g_string_new ("");\n'
             '    g_string_append_printf (printable,\n'
             '                            "%s  message     = \\\"${name}\\\" (${id})\\n",\n'
             '                            line_prefix);\n')
@@ -386,8 +702,6 @@ class Message:
                 '                                     &ctx);\n'
                 '    }\n')
         template += (
-            '\n'
-            '    return g_string_free (printable, FALSE);\n'
             '}\n')
         cfile.write(string.Template(template).substitute(translations))
 
@@ -395,7 +709,7 @@ class Message:
     """
     Emit request/response/indication handling implementation
     """
-    def emit(self, hfile, cfile):
+    def emit(self, hfile, cfile, pfile):
         if self.type == 'Message':
             utils.add_separator(hfile, 'REQUEST/RESPONSE', self.fullname);
             utils.add_separator(cfile, 'REQUEST/RESPONSE', self.fullname);
@@ -406,12 +720,12 @@ class Message:
         if self.type == 'Message':
             hfile.write('\n/* --- Input -- */\n');
             cfile.write('\n/* --- Input -- */\n');
-            self.input.emit(hfile, cfile)
-            self.__emit_request_creator(hfile, cfile)
+            self.input.emit(hfile, cfile, pfile)
+            self.__emit_request_creator(pfile, cfile)
 
         hfile.write('\n/* --- Output -- */\n');
         cfile.write('\n/* --- Output -- */\n');
-        self.output.emit(hfile, cfile)
+        self.output.emit(hfile, cfile, pfile)
         self.__emit_helpers(hfile, cfile)
         self.__emit_response_or_indication_parser(hfile, cfile)
 
@@ -438,12 +752,17 @@ class Message:
         if self.input:
             self.input.add_sections (sections)
         self.output.add_sections (sections)
+        if self.output.fixed_layout:
+            sections['public-methods'] += self.parse_into_name() + '\n'
 
         if self.type == 'Message':
             template = (
                 '<SUBSECTION ${camelcase}ClientMethods>\n'
                 'qmi_client_${service}_${name_underscore}\n'
                 'qmi_client_${service}_${name_underscore}_finish\n')
+            if self.output.fixed_layout:
+                template += (
+                    'qmi_client_${service}_${name_underscore}_finish_into\n')
             sections['public-methods'] += string.Template(template).substitute(translations)
             translations['message_type'] = 'request'
         elif self.type == 'Indication':
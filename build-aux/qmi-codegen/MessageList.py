@@ -32,7 +32,7 @@ class MessageList:
     """
     Constructor
     """
-    def __init__(self, objects_dictionary, common_objects_dictionary):
+    def __init__(self, objects_dictionary, common_objects_dictionary, backend = 'unrolled'):
         self.list = []
         self.message_id_enum_name = None
         self.indication_id_enum_name = None
@@ -43,7 +43,7 @@ class MessageList:
         for object_dictionary in objects_dictionary:
             if object_dictionary['type'] == 'Message' or \
                object_dictionary['type'] == 'Indication':
-                message = Message(object_dictionary, common_objects_dictionary)
+                message = Message(object_dictionary, common_objects_dictionary, backend)
                 self.list.append(message)
             elif object_dictionary['type'] == 'Message-ID-Enum':
                 self.message_id_enum_name = object_dictionary['name']
@@ -110,8 +110,8 @@ class MessageList:
 
 
     """
-    Emit the method responsible for getting a printable representation of all
-    messages of a given service.
+    Emit the method responsible for appending a printable representation of
+    all messages of a given service.
     """
     def __emit_get_printable(self, hfile, cfile):
         translations = { 'service'    : self.service.lower() }
@@ -121,10 +121,11 @@ class MessageList:
             '#if defined (LIBQMI_GLIB_COMPILATION)\n'
             '\n'
             'G_GNUC_INTERNAL\n'
-            'gchar *__qmi_message_${service}_get_printable (\n'
+            'gboolean __qmi_message_${service}_append_printable (\n'
             '    QmiMessage *self,\n'
             '    QmiMessageContext *context,\n'
-            '    const gchar *line_prefix);\n'
+            '    const gchar *line_prefix,\n'
+            '    GString *printable);\n'
             '\n'
             '#endif\n'
             '\n')
@@ -132,11 +133,12 @@ class MessageList:
 
         template = (
             '\n'
-            'gchar *\n'
-            '__qmi_message_${service}_get_printable (\n'
+            'gboolean\n'
+            '__qmi_message_${service}_append_printable (\n'
             '    QmiMessage *self,\n'
             '    QmiMessageContext *context,\n'
-            '    const gchar *line_prefix)\n'
+            '    const gchar *line_prefix,\n'
+            '    GString *printable)\n'
             '{\n'
             '    if (qmi_message_is_indication (self)) {\n'
             '        switch (qmi_message_get_message_id (self)) {\n')
@@ -147,12 +149,13 @@ class MessageList:
                 translations['message_underscore'] = utils.build_underscore_name (message.name)
                 inner_template = (
                     '        case ${enum_name}:\n'
-                    '            return indication_${message_underscore}_get_printable (self, line_prefix);\n')
+                    '            indication_${message_underscore}_append_printable (self, line_prefix, printable);\n'
+                    '            return TRUE;\n')
                 template += string.Template(inner_template).substitute(translations)
 
         template += (
             '        default:\n'
-            '             return NULL;\n'
+            '             return FALSE;\n'
             '        }\n'
             '    } else {\n'
             '        guint16 vendor_id;\n'
@@ -167,12 +170,13 @@ class MessageList:
                 translations['message_underscore'] = utils.build_underscore_name (message.name)
                 inner_template = (
                     '            case ${enum_name}:\n'
-                    '                return message_${message_underscore}_get_printable (self, line_prefix);\n')
+                    '                message_${message_underscore}_append_printable (self, line_prefix, printable);\n'
+                    '                return TRUE;\n')
                 template += string.Template(inner_template).substitute(translations)
 
         template += (
             '             default:\n'
-            '                 return NULL;\n'
+            '                 return FALSE;\n'
             '            }\n'
             '        } else {\n')
 
@@ -182,12 +186,14 @@ class MessageList:
                 translations['message_underscore'] = utils.build_underscore_name (message.name)
                 translations['message_vendor'] = message.vendor
                 inner_template = (
-                    '            if (vendor_id == ${message_vendor} && (qmi_message_get_message_id (self) == ${enum_name}))\n'
-                    '                return message_${message_underscore}_get_printable (self, line_prefix);\n')
+                    '            if (vendor_id == ${message_vendor} && (qmi_message_get_message_id (self) == ${enum_name})) {\n'
+                    '                message_${message_underscore}_append_printable (self, line_prefix, printable);\n'
+                    '                return TRUE;\n'
+                    '            }\n')
                 template += string.Template(inner_template).substitute(translations)
 
         template += (
-            '            return NULL;\n'
+            '            return FALSE;\n'
             '        }\n'
             '    }\n'
             '}\n')
@@ -274,10 +280,44 @@ class MessageList:
         cfile.write(string.Template(template).substitute(translations))
 
 
+    """
+    Emit the method building a request with every request creator, only
+    compiled in the test of the request creators. Library-only messages are
+    not reachable from the test, so they are skipped.
+    """
+    def __emit_request_creators_test(self, pfile, tfile):
+        translations = { 'service'    : self.service.lower() }
+
+        template = (
+            '\n'
+            'void __qmi_message_${service}_test_request_creators (void);\n')
+        pfile.write(string.Template(template).substitute(translations))
+
+        template = (
+            '\n'
+            'void\n'
+            '__qmi_message_${service}_test_request_creators (void)\n'
+            '{\n'
+            '    GPtrArray *unowned_arrays;\n'
+            '\n'
+            '    /* Arrays within array items, not released by the input containers */\n'
+            '    unowned_arrays = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);\n')
+        tfile.write(string.Template(template).substitute(translations))
+
+        for message in self.list:
+            if message.type == 'Message' and not message.static:
+                message.emit_request_creator_test(tfile)
+
+        tfile.write(
+            '\n'
+            '    g_ptr_array_unref (unowned_arrays);\n'
+            '}\n')
+
+
     """
     Emit the message list handling implementation
     """
-    def emit(self, hfile, cfile):
+    def emit(self, hfile, cfile, pfile, tfile):
         # First, emit the message/indication IDs enum
         self.emit_message_ids_enum(cfile)
         if self.indication_id_enum_name is not None:
@@ -285,13 +325,14 @@ class MessageList:
 
         # Then, emit all message handlers
         for message in self.list:
-            message.emit(hfile, cfile)
+            message.emit(hfile, cfile, pfile)
 
         # First, emit common class code
         utils.add_separator(hfile, 'Service-specific printable', self.service);
         utils.add_separator(cfile, 'Service-specific printable', self.service);
         self.__emit_get_printable(hfile, cfile)
         self.__emit_get_version_introduced(hfile, cfile)
+        self.__emit_request_creators_test(pfile, tfile)
 
     """
     Emit the sections
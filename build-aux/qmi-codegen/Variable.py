@@ -95,6 +95,54 @@ class Variable:
         pass
 
 
+    """
+    Returns the number of bytes the variable takes in the raw byte stream, or
+    None if that depends on the actual value of the variable.
+    """
+    def fixed_buffer_size(self):
+        return None
+
+
+    """
+    Emits the code adding to 'tlvs_size' the number of bytes the variable
+    takes once written to the raw byte stream.
+    """
+    def emit_buffer_size(self, f, line_prefix, variable_name):
+        f.write('%stlvs_size += %d;\n' % (line_prefix, self.fixed_buffer_size()))
+
+
+    """
+    Whether the variable keeps a reference to data given by the caller of the
+    setter, which may then be modified without going through the setter.
+    """
+    def references_caller_data(self):
+        return False
+
+
+    """
+    Whether the variable is stored in a fixed amount of memory, with no heap
+    allocations, and can therefore be copied around by value.
+    """
+    def has_fixed_layout(self):
+        return False
+
+
+    """
+    Appends to 'ops' the descriptors used by the table-driven codec to read
+    and write the variable, stored at 'path' within the given C type.
+    """
+    def add_codec_ops(self, ops, struct_type, path):
+        raise ValueError('Variable format \'%s\' unsupported by the table-driven codec' % self.format)
+
+
+    """
+    Whether arrays of this variable can be read and written in bulk, with a
+    single call, instead of item by item.
+    """
+    def supports_bulk_array(self):
+        return False
+
+
     """
     Emits the code to get the contents of the given variable as a printable string.
     """
@@ -155,6 +203,15 @@ class Variable:
     def build_dispose(self, line_prefix, variable_name):
         return ''
 
+    """
+    Builds the code giving the variable a valid value to build requests with
+    in tests, if its zero-initialized storage isn't one. If 'owned', the value
+    is released along with the container; otherwise arrays are added to the
+    'unowned_arrays' of the test and strings are not allocated.
+    """
+    def build_test_value(self, line_prefix, variable_name, owned):
+        return ''
+
     """
     Add sections
     """
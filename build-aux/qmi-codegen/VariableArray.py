@@ -141,9 +141,9 @@ class VariableArray(Variable):
                          'underscore'                  : self.clear_func_name(),
                          'common_var_prefix'           : common_var_prefix }
 
-        template = (
-            '${lp}{\n'
-            '${lp}    guint ${common_var_prefix}_i;\n')
+        template = '${lp}{\n'
+        if not self.array_element.supports_bulk_array():
+            template += '${lp}    guint ${common_var_prefix}_i;\n'
         f.write(string.Template(template).substitute(translations))
 
         if self.fixed_size:
@@ -196,6 +196,12 @@ class VariableArray(Variable):
                 '${lp}                            (GDestroyNotify)${underscore}_clear);\n'
                 '\n')
 
+        if self.array_element.supports_bulk_array():
+            f.write(string.Template(template).substitute(translations))
+            self.array_element.emit_buffer_read_array(f, line_prefix + '    ', tlv_out, error, variable_name, common_var_prefix + '_n_items')
+            f.write(string.Template('${lp}}\n').substitute(translations))
+            return
+
         template += (
             '${lp}    for (${common_var_prefix}_i = 0; ${common_var_prefix}_i < ${common_var_prefix}_n_items; ${common_var_prefix}_i++) {\n'
             '${lp}        ${public_array_element_format} ${common_var_prefix}_aux;\n'
@@ -221,9 +227,9 @@ class VariableArray(Variable):
                          'variable_name'     : variable_name,
                          'common_var_prefix' : common_var_prefix }
 
-        template = (
-            '${lp}{\n'
-            '${lp}    guint ${common_var_prefix}_i;\n')
+        template = '${lp}{\n'
+        if not self.array_element.supports_bulk_array():
+            template += '${lp}    guint ${common_var_prefix}_i;\n'
         f.write(string.Template(template).substitute(translations))
 
         if self.fixed_size == 0:
@@ -242,6 +248,13 @@ class VariableArray(Variable):
             self.array_sequence_element.emit_buffer_write(f, line_prefix + '    ', tlv_name, variable_name + '_sequence')
 
 
+        if self.array_element.supports_bulk_array():
+            if self.fixed_size == 0 or self.array_sequence_element != '':
+                f.write('\n')
+            self.array_element.emit_buffer_write_array(f, line_prefix + '    ', tlv_name, variable_name)
+            f.write(string.Template('${lp}}\n').substitute(translations))
+            return
+
         template = (
             '\n'
             '${lp}    for (${common_var_prefix}_i = 0; ${common_var_prefix}_i < ${variable_name}->len; ${common_var_prefix}_i++) {\n')
@@ -255,6 +268,88 @@ class VariableArray(Variable):
         f.write(string.Template(template).substitute(translations))
 
 
+    """
+    The array is described by an array op followed by the ops describing each
+    of its elements
+    """
+    def add_codec_ops(self, ops, struct_type, path):
+        element_ops = []
+        self.array_element.add_codec_ops(element_ops, self.array_element.public_format, '')
+
+        translations = { 'offset'       : utils.build_struct_offset(struct_type, path),
+                         'element_size' : 'sizeof (%s)' % self.array_element.public_format,
+                         'clear_func'   : 'NULL',
+                         'n_ops'        : len(element_ops) }
+
+        if self.array_element.needs_dispose and self.container_type != 'Input':
+            translations['clear_func'] = '(GDestroyNotify)%s_clear' % self.clear_func_name()
+
+        if self.fixed_size:
+            translations['fixed_size'] = self.fixed_size
+            template = 'QMI_CODEC_FIXED_ARRAY (${fixed_size}, ${offset}, ${element_size}, ${clear_func}, ${n_ops})'
+        else:
+            translations['length'] = self.array_size_element.fixed_buffer_size()
+            if self.array_sequence_element != '':
+                translations['sequence_length'] = self.array_sequence_element.fixed_buffer_size()
+                translations['sequence_offset'] = utils.build_struct_offset(struct_type, path + '_sequence')
+            else:
+                translations['sequence_length'] = 0
+                translations['sequence_offset'] = '0'
+            template = 'QMI_CODEC_ARRAY (${length}, ${sequence_length}, ${sequence_offset}, ${offset}, ${element_size}, ${clear_func}, ${n_ops})'
+
+        ops.append(string.Template(template).substitute(translations))
+        ops.extend(element_ops)
+
+
+    """
+    Setters keep a reference to the GArray given by the caller
+    """
+    def references_caller_data(self):
+        return True
+
+
+    """
+    The array takes its size and sequence prefixes plus the size of every
+    element
+    """
+    def emit_buffer_size(self, f, line_prefix, variable_name):
+        common_var_prefix = utils.build_underscore_name(self.name)
+        translations = { 'lp'                          : line_prefix,
+                         'variable_name'               : variable_name,
+                         'public_array_element_format' : self.array_element.public_format,
+                         'common_var_prefix'           : common_var_prefix }
+
+        prefix_size = 0
+        if self.fixed_size == 0:
+            prefix_size += self.array_size_element.fixed_buffer_size()
+        if self.array_sequence_element != '':
+            prefix_size += self.array_sequence_element.fixed_buffer_size()
+        if prefix_size > 0:
+            translations['prefix_size'] = prefix_size
+            f.write(string.Template('${lp}tlvs_size += ${prefix_size};\n').substitute(translations))
+
+        element_size = self.array_element.fixed_buffer_size()
+        if element_size is not None:
+            translations['element_size'] = element_size
+            template = '${lp}tlvs_size += ${variable_name}->len * ${element_size};\n'
+            f.write(string.Template(template).substitute(translations))
+            return
+
+        template = (
+            '${lp}{\n'
+            '${lp}    guint ${common_var_prefix}_i;\n'
+            '\n'
+            '${lp}    for (${common_var_prefix}_i = 0; ${common_var_prefix}_i < ${variable_name}->len; ${common_var_prefix}_i++) {\n')
+        f.write(string.Template(template).substitute(translations))
+
+        self.array_element.emit_buffer_size(f, line_prefix + '        ', 'g_array_index (' + variable_name + ', ' + self.array_element.public_format + ',' + common_var_prefix + '_i)')
+
+        template = (
+            '${lp}    }\n'
+            '${lp}}\n')
+        f.write(string.Template(template).substitute(translations))
+
+
     """
     The array will be printed as a list of fields enclosed between curly
     brackets
@@ -506,6 +601,47 @@ class VariableArray(Variable):
         return string.Template(template).substitute(translations)
 
 
+    """
+    Test arrays get as many items as required, or a single one, each with its
+    own test value. Input containers don't dispose the contents of the items,
+    so their values are never owned.
+    """
+    def build_test_value(self, line_prefix, variable_name, owned):
+        common_var_prefix = utils.build_underscore_name(self.name)
+        translations = { 'lp'                          : line_prefix,
+                         'variable_name'               : variable_name,
+                         'public_array_element_format' : self.array_element.public_format,
+                         'n_items'                     : self.fixed_size if self.fixed_size else 1,
+                         'common_var_prefix'           : common_var_prefix }
+
+        template = (
+            '${lp}${variable_name} = g_array_new (FALSE, TRUE, sizeof (${public_array_element_format}));\n'
+            '${lp}g_array_set_size (${variable_name}, ${n_items});\n')
+        if not owned:
+            template += (
+                '${lp}g_ptr_array_add (unowned_arrays, ${variable_name});\n')
+        built = string.Template(template).substitute(translations)
+
+        item_value = self.array_element.build_test_value(line_prefix + '        ',
+                                                         'g_array_index (' + variable_name + ', ' + self.array_element.public_format + ', ' + common_var_prefix + '_i)',
+                                                         False)
+        if item_value == '':
+            return built
+
+        template = (
+            '${lp}{\n'
+            '${lp}    guint ${common_var_prefix}_i;\n'
+            '\n'
+            '${lp}    for (${common_var_prefix}_i = 0; ${common_var_prefix}_i < ${variable_name}->len; ${common_var_prefix}_i++) {\n')
+        built += string.Template(template).substitute(translations)
+        built += item_value
+        template = (
+            '${lp}    }\n'
+            '${lp}}\n')
+        built += string.Template(template).substitute(translations)
+        return built
+
+
     """
     Add sections
     """
@@ -161,6 +161,84 @@ class VariableInteger(Variable):
         f.write(string.Template(template).substitute(translations))
 
 
+    """
+    Integers are stored by value
+    """
+    def has_fixed_layout(self):
+        return self.visible
+
+
+    """
+    Integers always take the same number of bytes in the raw byte buffer
+    """
+    def fixed_buffer_size(self):
+        if self.format == 'guint-sized':
+            return int(self.guint_sized_size)
+        if self.private_format == 'gfloat':
+            return 4
+        if self.private_format == 'gdouble':
+            return 8
+        return VariableInteger.fixed_type_byte_size(self.private_format)
+
+
+    """
+    Integers are converted from the private format to the public one by the
+    codec, based on the size of the latter
+    """
+    def add_codec_ops(self, ops, struct_type, path):
+        offset = utils.build_struct_offset(struct_type, path)
+        if self.format == 'guint-sized':
+            ops.append('QMI_CODEC_SIZED_GUINT (%s, %s, %s)' % (self.endian, self.guint_sized_size, offset))
+        else:
+            ops.append('QMI_CODEC_INTEGER (QMI_CODEC_TYPE_%s, %s, %s, sizeof (%s))' % (self.private_format.upper(), self.endian, offset, self.public_format))
+
+
+    """
+    Fixed-width unsigned integers stored with the same public and private
+    format can be copied to and from the raw byte buffer in bulk.
+    """
+    def supports_bulk_array(self):
+        return self.private_format in ('guint16', 'guint32', 'guint64') and self.private_format == self.public_format
+
+
+    """
+    Read n_items integers from the raw byte buffer into the GArray storage
+    """
+    def emit_buffer_read_array(self, f, line_prefix, tlv_out, error, array_name, n_items):
+        translations = { 'lp'             : line_prefix,
+                         'tlv_out'        : tlv_out,
+                         'error'          : error,
+                         'array_name'     : array_name,
+                         'n_items'        : n_items,
+                         'private_format' : self.private_format,
+                         'endian'         : self.endian }
+
+        template = (
+            '${lp}g_array_set_size (${array_name}, (guint)${n_items});\n'
+            '${lp}if (!qmi_message_tlv_read_${private_format}_array (message, init_offset, &offset, ${endian}, (guint)${n_items}, (${private_format} *)${array_name}->data, ${error}))\n'
+            '${lp}    goto ${tlv_out};\n')
+        f.write(string.Template(template).substitute(translations))
+
+
+    """
+    Write all the integers in the GArray storage to the raw byte buffer
+    """
+    def emit_buffer_write_array(self, f, line_prefix, tlv_name, array_name):
+        translations = { 'lp'             : line_prefix,
+                         'tlv_name'       : tlv_name,
+                         'array_name'     : array_name,
+                         'private_format' : self.private_format,
+                         'endian'         : self.endian }
+
+        template = (
+            '${lp}/* Write all the ${private_format} variables to the buffer */\n'
+            '${lp}if (!qmi_message_tlv_write_${private_format}_array (self, ${endian}, (const ${private_format} *)${array_name}->data, ${array_name}->len, error)) {\n'
+            '${lp}    g_prefix_error (error, "Cannot write integer array in TLV \'${tlv_name}\': ");\n'
+            '${lp}    goto error_out;\n'
+            '${lp}}\n')
+        f.write(string.Template(template).substitute(translations))
+
+
     """
     Get the integer as a printable string.
     """
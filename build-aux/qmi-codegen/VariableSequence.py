@@ -89,6 +89,72 @@ class VariableSequence(Variable):
             member['object'].emit_buffer_write(f, line_prefix, tlv_name, variable_name + '_' +  member['name'])
 
 
+    """
+    The members of the sequence are described one after the other
+    """
+    def add_codec_ops(self, ops, struct_type, path):
+        for member in self.members:
+            member['object'].add_codec_ops(ops, struct_type, path + '_' + member['name'])
+
+
+    """
+    The sequence references caller data if any of its members does
+    """
+    def references_caller_data(self):
+        for member in self.members:
+            if member['object'].references_caller_data():
+                return True
+        return False
+
+
+    """
+    The sequence has a fixed layout if all its members have one
+    """
+    def has_fixed_layout(self):
+        if not self.visible:
+            return False
+        for member in self.members:
+            if not member['object'].has_fixed_layout():
+                return False
+        return True
+
+
+    """
+    The sequence size is known if the size of all its members is known
+    """
+    def fixed_buffer_size(self):
+        size = 0
+        for member in self.members:
+            member_size = member['object'].fixed_buffer_size()
+            if member_size is None:
+                return None
+            size += member_size
+        return size
+
+
+    """
+    Add up the size of each of the members
+    """
+    def emit_buffer_size(self, f, line_prefix, variable_name):
+        if self.fixed_buffer_size() is not None:
+            Variable.emit_buffer_size(self, f, line_prefix, variable_name)
+            return
+
+        # Consecutive members of known size are added up together
+        pending_size = 0
+        for member in self.members:
+            member_size = member['object'].fixed_buffer_size()
+            if member_size is not None:
+                pending_size += member_size
+                continue
+            if pending_size > 0:
+                f.write('%stlvs_size += %d;\n' % (line_prefix, pending_size))
+                pending_size = 0
+            member['object'].emit_buffer_size(f, line_prefix, variable_name + '_' +  member['name'])
+        if pending_size > 0:
+            f.write('%stlvs_size += %d;\n' % (line_prefix, pending_size))
+
+
     """
     The sequence will be printed as a list of fields enclosed between square
     brackets
@@ -212,6 +278,16 @@ class VariableSequence(Variable):
         return built
 
 
+    """
+    Documentation for each of the sequence fields, when flattened into a struct
+    """
+    def build_struct_field_documentation(self, line_prefix, variable_name):
+        built = ''
+        for member in self.members:
+            built += member['object'].build_struct_field_documentation(line_prefix, variable_name + '_' + member['name'])
+        return built
+
+
     """
     Disposing a sequence is just about disposing each of the sequence fields one by
     one.
@@ -223,6 +299,16 @@ class VariableSequence(Variable):
         return built
 
 
+    """
+    Test values for each of the members
+    """
+    def build_test_value(self, line_prefix, variable_name, owned):
+        built = ''
+        for member in self.members:
+            built += member['object'].build_test_value(line_prefix, variable_name + '_' + member['name'], owned)
+        return built
+
+
     """
     Add sections
     """
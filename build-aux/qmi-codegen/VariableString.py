@@ -22,6 +22,12 @@ import string
 import utils
 from Variable import Variable
 
+"""
+Strings with a 'max-size' up to this length are stored directly in output
+bundles, without additional heap allocations
+"""
+MAX_INLINE_SIZE = 64
+
 """
 Variable type for Strings ('string' format)
 """
@@ -71,6 +77,25 @@ class VariableString(Variable):
                 self.n_size_prefix_bytes = 1
             self.max_size = dictionary['max-size'] if 'max-size' in dictionary else ''
 
+        # Where the string is stored when read from a message: 'heap' for
+        # separately allocated strings, 'inline' for arrays within the output
+        # bundle, 'arena' for strings in the single per-bundle arena
+        self.storage = 'heap'
+
+
+    """
+    Flag as being a field of an output bundle, which doesn't need to store the
+    string in its own heap allocation
+    """
+    def flag_output_field(self):
+        if self.is_fixed_size:
+            return
+        if self.max_size != '' and int(self.max_size) <= MAX_INLINE_SIZE:
+            self.storage = 'inline'
+        else:
+            self.storage = 'arena'
+        self.needs_dispose = False
+
 
     """
     Read a string from the raw byte buffer.
@@ -104,9 +129,26 @@ class VariableString(Variable):
         else:
             translations['n_size_prefix_bytes'] = self.n_size_prefix_bytes
             translations['max_size'] = self.max_size if self.max_size != '' else '0'
-            template = (
-                '${lp}if (!qmi_message_tlv_read_string (message, init_offset, &offset, ${n_size_prefix_bytes}, ${max_size}, &(${variable_name}), ${error}))\n'
-                '${lp}    goto ${tlv_out};\n')
+            if self.storage == 'inline':
+                template = (
+                    '${lp}if (!__qmi_message_tlv_read_string_into (message, init_offset, &offset, ${n_size_prefix_bytes}, ${max_size}, ${variable_name}, sizeof (${variable_name}), NULL, ${error}))\n'
+                    '${lp}    goto ${tlv_out};\n')
+            elif self.storage == 'arena':
+                template = (
+                    '${lp}{\n'
+                    '${lp}    gsize string_length;\n'
+                    '\n'
+                    '${lp}    if (!__qmi_message_tlv_read_string_into (message, init_offset, &offset, ${n_size_prefix_bytes}, ${max_size},\n'
+                    '${lp}                                             &self->arena[self->arena_used], self->arena_size - self->arena_used,\n'
+                    '${lp}                                             &string_length, ${error}))\n'
+                    '${lp}        goto ${tlv_out};\n'
+                    '${lp}    ${variable_name} = &self->arena[self->arena_used];\n'
+                    '${lp}    self->arena_used += string_length + 1;\n'
+                    '${lp}}\n')
+            else:
+                template = (
+                    '${lp}if (!qmi_message_tlv_read_string (message, init_offset, &offset, ${n_size_prefix_bytes}, ${max_size}, &(${variable_name}), ${error}))\n'
+                    '${lp}    goto ${tlv_out};\n')
         f.write(string.Template(template).substitute(translations))
 
 
@@ -129,6 +171,48 @@ class VariableString(Variable):
         f.write(string.Template(template).substitute(translations))
 
 
+    """
+    Only fixed-size strings have a known size in the raw byte buffer
+    """
+    def fixed_buffer_size(self):
+        return int(self.fixed_size) if self.is_fixed_size else None
+
+
+    """
+    Strings are described along with where they are stored
+    """
+    def add_codec_ops(self, ops, struct_type, path):
+        offset = utils.build_struct_offset(struct_type, path)
+        if self.is_fixed_size:
+            codec_type = 'QMI_CODEC_TYPE_FIXED_STRING_HEAP' if self.public else 'QMI_CODEC_TYPE_FIXED_STRING'
+            ops.append('QMI_CODEC_FIXED_STRING (%s, %s, %s)' % (codec_type, self.fixed_size, offset))
+        else:
+            codec_type = { 'heap'   : 'QMI_CODEC_TYPE_STRING',
+                           'inline' : 'QMI_CODEC_TYPE_STRING_INLINE',
+                           'arena'  : 'QMI_CODEC_TYPE_STRING_ARENA' }[self.storage]
+            max_size = self.max_size if self.max_size != '' else '0'
+            ops.append('QMI_CODEC_STRING (%s, %d, %s, %s)' % (codec_type, self.n_size_prefix_bytes, max_size, offset))
+
+
+    """
+    Variable-length strings take their length plus the size prefix
+    """
+    def emit_buffer_size(self, f, line_prefix, variable_name):
+        if self.is_fixed_size:
+            Variable.emit_buffer_size(self, f, line_prefix, variable_name)
+            return
+
+        translations = { 'lp'                  : line_prefix,
+                         'variable_name'       : variable_name,
+                         'n_size_prefix_bytes' : self.n_size_prefix_bytes }
+
+        if self.n_size_prefix_bytes > 0:
+            template = '${lp}tlvs_size += ${n_size_prefix_bytes} + strlen (${variable_name});\n'
+        else:
+            template = '${lp}tlvs_size += strlen (${variable_name});\n'
+        f.write(string.Template(template).substitute(translations))
+
+
     """
     Get the string as printable
     """
@@ -182,6 +266,10 @@ class VariableString(Variable):
             translations['fixed_size_plus_one'] = int(self.fixed_size) + 1
             template = (
                 '${lp}gchar ${name}[${fixed_size_plus_one}];\n')
+        elif self.storage == 'inline':
+            translations['max_size_plus_one'] = int(self.max_size) + 1
+            template = (
+                '${lp}gchar ${name}[${max_size_plus_one}];\n')
         else:
             template = (
                 '${lp}gchar *${name};\n')
@@ -358,6 +446,31 @@ class VariableString(Variable):
         return string.Template(template).substitute(translations)
 
 
+    """
+    Strings are given as many characters as allowed, up to a few
+    """
+    def build_test_value(self, line_prefix, variable_name, owned):
+        if self.is_fixed_size:
+            length = int(self.fixed_size)
+        elif self.max_size != '':
+            length = min(int(self.max_size), 4)
+        else:
+            length = 4
+
+        translations = { 'lp'            : line_prefix,
+                         'variable_name' : variable_name,
+                         'value'         : 'a' * length,
+                         'length'        : length }
+
+        if self.is_fixed_size and not self.public:
+            template = '${lp}memcpy (${variable_name}, "${value}", ${length});\n'
+        elif owned:
+            template = '${lp}${variable_name} = g_strdup ("${value}");\n'
+        else:
+            template = '${lp}${variable_name} = (gchar *) "${value}";\n'
+        return string.Template(template).substitute(translations)
+
+
     """
     Flag as being public
     """
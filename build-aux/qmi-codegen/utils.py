@@ -105,26 +105,67 @@ def add_header_stop(f, output_name):
     f.write(template.substitute(guard = build_header_guard(output_name)))
 
 
+"""
+Write the private header file start chunk, with the internals of the
+service shared with the tests
+"""
+def add_private_header_start(f, output_name):
+    translations = { 'guard' : build_header_guard(output_name + '-private'),
+                     'name'  : output_name }
+    template = (
+        "\n"
+        "#ifndef ${guard}\n"
+        "#define ${guard}\n"
+        "\n"
+        "#if !defined (LIBQMI_GLIB_COMPILATION)\n"
+        "#error \"This is a private header.\"\n"
+        "#endif\n"
+        "\n"
+        "#include \"${name}.h\"\n"
+        "\n"
+        "G_BEGIN_DECLS\n"
+        "\n")
+    f.write(string.Template(template).substitute(translations))
+
+
+"""
+Write the test source file start chunk
+"""
+def add_test_source_start(f, output_name):
+    template = (
+        "\n"
+        "#include <string.h>\n"
+        "\n"
+        "#include \"${name}-private.h\"\n")
+    f.write(string.Template(template).substitute(name = output_name))
+
+
 """
 Write the common source file start chunk
 """
-def add_source_start(f, output_name):
-    template = string.Template (
+def add_source_start(f, output_name, backend = 'unrolled'):
+    template = (
         "\n"
         "#include <string.h>\n"
         "\n"
         "#include \"${name}.h\"\n"
+        "#include \"${name}-private.h\"\n"
         "#include \"qmi-enum-types.h\"\n"
         "#include \"qmi-enum-types-private.h\"\n"
         "#include \"qmi-flags64-types.h\"\n"
         "#include \"qmi-error-types.h\"\n"
         "#include \"qmi-device.h\"\n"
         "#include \"qmi-utils.h\"\n"
+        "#include \"qmi-serialized.h\"\n")
+    if backend == 'tables':
+        template += (
+            "#include \"qmi-codec.h\"\n")
+    template += (
         '\n'
         '#define QMI_STATUS_SUCCESS 0x0000\n'
         '#define QMI_STATUS_FAILURE 0x0001\n'
         "\n")
-    f.write(template.substitute(name = output_name))
+    f.write(string.Template(template).substitute(name = output_name))
 
 
 """
@@ -189,6 +230,14 @@ def remove_prefix(line, prefix):
     return line[len(prefix):] if line.startswith(prefix) else line
 
 
+"""
+Build the offset of the member at the given path within the given C type
+e.g.: "QmiFoo", "arg_bar.baz" --> "G_STRUCT_OFFSET (QmiFoo, arg_bar.baz)"
+"""
+def build_struct_offset(struct_type, path):
+    return 'G_STRUCT_OFFSET (%s, %s)' % (struct_type, path) if path else '0'
+
+
 """
 Read the contents of the JSON file, skipping lines prefixed with '//', which are
 considered comments.
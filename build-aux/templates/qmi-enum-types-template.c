@@ -1,5 +1,150 @@
 /*** BEGIN file-header ***/
 
+/* Lookup tables for the string getters, built on first use from the
+ * GEnumValue/GFlagsValue arrays, which are also what the GTypes register. */
+
+typedef struct {
+    gint          min;
+    guint         n_nicks; /* 0 if values are too sparse for a direct index */
+    const gchar **nicks;
+} EnumLookup;
+
+G_GNUC_UNUSED static const gchar *
+enum_lookup_get_string (volatile gsize   *lookup_volatile,
+                        const GEnumValue *values,
+                        gint              val)
+{
+    const EnumLookup *lookup;
+    guint             i;
+
+    if (g_once_init_enter (lookup_volatile)) {
+        EnumLookup *new_lookup;
+        gint        min = G_MAXINT;
+        gint        max = G_MININT;
+
+        new_lookup = g_new0 (EnumLookup, 1);
+        for (i = 0; values[i].value_nick; i++) {
+            min = MIN (min, values[i].value);
+            max = MAX (max, values[i].value);
+        }
+
+        /* Index directly by value if at most half of the slots are holes */
+        if (i > 0 && ((gint64) max - min + 1) <= 2 * (gint64) i) {
+            new_lookup->min = min;
+            new_lookup->n_nicks = (guint) ((gint64) max - min + 1);
+            new_lookup->nicks = g_new0 (const gchar *, new_lookup->n_nicks);
+            /* On duplicate values the first one listed wins */
+            for (i = 0; values[i].value_nick; i++) {
+                if (!new_lookup->nicks[values[i].value - min])
+                    new_lookup->nicks[values[i].value - min] = values[i].value_nick;
+            }
+        }
+
+        g_once_init_leave (lookup_volatile, (gsize) new_lookup);
+    }
+
+    lookup = (const EnumLookup *) *lookup_volatile;
+    if (lookup->n_nicks) {
+        if ((gint64) val < lookup->min || (gint64) val - lookup->min >= lookup->n_nicks)
+            return NULL;
+        return lookup->nicks[val - lookup->min];
+    }
+
+    for (i = 0; values[i].value_nick; i++) {
+        if (val == values[i].value)
+            return values[i].value_nick;
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    /* Values with zero or several bits set, only matched exactly */
+    guint               n_composite;
+    const GFlagsValue **composite;
+    /* Nicks of the single-bit values indexed by bit, only used if they
+     * are listed in ascending order so that the output order is kept */
+    gboolean            bits_sorted;
+    const gchar        *bit_nicks[32];
+} FlagsLookup;
+
+G_GNUC_UNUSED static gchar *
+flags_lookup_build_string (volatile gsize    *lookup_volatile,
+                           const GFlagsValue *values,
+                           guint              mask)
+{
+    const FlagsLookup *lookup;
+    GString           *str = NULL;
+    guint              i;
+
+    if (g_once_init_enter (lookup_volatile)) {
+        FlagsLookup *new_lookup;
+        gint         last_bit = -1;
+
+        new_lookup = g_new0 (FlagsLookup, 1);
+        new_lookup->bits_sorted = TRUE;
+        for (i = 0; values[i].value_nick; i++) {
+            if (values[i].value == 0 || (values[i].value & (values[i].value - 1))) {
+                new_lookup->composite = g_renew (const GFlagsValue *, new_lookup->composite, new_lookup->n_composite + 1);
+                new_lookup->composite[new_lookup->n_composite++] = &values[i];
+            } else {
+                gint bit;
+
+                for (bit = 0; !(values[i].value & (1U << bit)); bit++);
+                if (bit <= last_bit)
+                    new_lookup->bits_sorted = FALSE;
+                new_lookup->bit_nicks[bit] = values[i].value_nick;
+                last_bit = bit;
+            }
+        }
+
+        g_once_init_leave (lookup_volatile, (gsize) new_lookup);
+    }
+
+    lookup = (const FlagsLookup *) *lookup_volatile;
+
+    /* Exact matches are preferred over lists of single-bit masks */
+    for (i = 0; i < lookup->n_composite; i++) {
+        if (mask == lookup->composite[i]->value)
+            return g_strdup (lookup->composite[i]->value_nick);
+    }
+
+    if (lookup->bits_sorted) {
+        for (i = 0; i < 32 && (mask >> i); i++) {
+            if (!(mask & (1U << i)) || !lookup->bit_nicks[i])
+                continue;
+            if (!str)
+                str = g_string_new (lookup->bit_nicks[i]);
+            else {
+                g_string_append (str, ", ");
+                g_string_append (str, lookup->bit_nicks[i]);
+            }
+        }
+        return (str ? g_string_free (str, FALSE) : NULL);
+    }
+
+    for (i = 0; values[i].value_nick; i++) {
+        /* We also look for exact matches */
+        if (mask == values[i].value) {
+            if (str)
+                g_string_free (str, TRUE);
+            return g_strdup (values[i].value_nick);
+        }
+
+        /* Build list with single-bit masks */
+        if ((mask & values[i].value) && !(values[i].value & (values[i].value - 1))) {
+            if (!str)
+                str = g_string_new (values[i].value_nick);
+            else {
+                g_string_append (str, ", ");
+                g_string_append (str, values[i].value_nick);
+            }
+        }
+    }
+
+    return (str ? g_string_free (str, FALSE) : NULL);
+}
+
 /*** END file-header ***/
 
 /*** BEGIN file-production ***/
@@ -40,14 +185,9 @@ GType
 const gchar *
 @enum_name@_get_string (@EnumName@ val)
 {
-    guint i;
+    static volatile gsize lookup = 0;
 
-    for (i = 0; @enum_name@_values[i].value_nick; i++) {
-        if (val == @enum_name@_values[i].value)
-            return @enum_name@_values[i].value_nick;
-    }
-
-    return NULL;
+    return enum_lookup_get_string (&lookup, @enum_name@_values, (gint) val);
 }
 #endif /* __@ENUMNAME@_IS_ENUM__ */
 
@@ -59,39 +199,9 @@ const gchar *
 gchar *
 @enum_name@_build_string_from_mask (@EnumName@ mask)
 {
-    guint i;
-    gboolean first = TRUE;
-    GString *str = NULL;
-
-    for (i = 0; @enum_name@_values[i].value_nick; i++) {
-        /* We also look for exact matches */
-        if (mask == @enum_name@_values[i].value) {
-            if (str)
-                g_string_free (str, TRUE);
-            return g_strdup (@enum_name@_values[i].value_nick);
-        }
+    static volatile gsize lookup = 0;
 
-        /* Build list with single-bit masks */
-        if (mask & @enum_name@_values[i].value) {
-            guint c;
-            gulong number = @enum_name@_values[i].value;
-
-            for (c = 0; number; c++)
-                number &= number - 1;
-
-            if (c == 1) {
-                if (!str)
-                    str = g_string_new ("");
-                g_string_append_printf (str, "%s%s",
-                                        first ? "" : ", ",
-                                        @enum_name@_values[i].value_nick);
-                if (first)
-                    first = FALSE;
-            }
-        }
-    }
-
-    return (str ? g_string_free (str, FALSE) : NULL);
+    return flags_lookup_build_string (&lookup, @enum_name@_values, (guint) mask);
 }
 #endif /* __@ENUMNAME@_IS_FLAGS__ */
 
@@ -6,6 +6,96 @@ typedef struct {
   const gchar *value_nick;
 } GFlags64Value;
 
+/* Lookup table for the string builder, built on first use from the
+ * GFlags64Value array */
+
+typedef struct {
+    /* Values with zero or several bits set, only matched exactly */
+    guint                 n_composite;
+    const GFlags64Value **composite;
+    /* Nicks of the single-bit values indexed by bit, only used if they
+     * are listed in ascending order so that the output order is kept */
+    gboolean              bits_sorted;
+    const gchar          *bit_nicks[64];
+} Flags64Lookup;
+
+static gchar *
+flags64_lookup_build_string (volatile gsize      *lookup_volatile,
+                             const GFlags64Value *values,
+                             guint64              mask)
+{
+    const Flags64Lookup *lookup;
+    GString             *str = NULL;
+    guint                i;
+
+    if (g_once_init_enter (lookup_volatile)) {
+        Flags64Lookup *new_lookup;
+        gint           last_bit = -1;
+
+        new_lookup = g_new0 (Flags64Lookup, 1);
+        new_lookup->bits_sorted = TRUE;
+        for (i = 0; values[i].value_nick; i++) {
+            if (values[i].value == 0 || (values[i].value & (values[i].value - 1))) {
+                new_lookup->composite = g_renew (const GFlags64Value *, new_lookup->composite, new_lookup->n_composite + 1);
+                new_lookup->composite[new_lookup->n_composite++] = &values[i];
+            } else {
+                gint bit;
+
+                for (bit = 0; !(values[i].value & (G_GUINT64_CONSTANT (1) << bit)); bit++);
+                if (bit <= last_bit)
+                    new_lookup->bits_sorted = FALSE;
+                new_lookup->bit_nicks[bit] = values[i].value_nick;
+                last_bit = bit;
+            }
+        }
+
+        g_once_init_leave (lookup_volatile, (gsize) new_lookup);
+    }
+
+    lookup = (const Flags64Lookup *) *lookup_volatile;
+
+    /* Exact matches are preferred over lists of single-bit masks */
+    for (i = 0; i < lookup->n_composite; i++) {
+        if (mask == lookup->composite[i]->value)
+            return g_strdup (lookup->composite[i]->value_nick);
+    }
+
+    if (lookup->bits_sorted) {
+        for (i = 0; i < 64 && (mask >> i); i++) {
+            if (!(mask & (G_GUINT64_CONSTANT (1) << i)) || !lookup->bit_nicks[i])
+                continue;
+            if (!str)
+                str = g_string_new (lookup->bit_nicks[i]);
+            else {
+                g_string_append (str, ", ");
+                g_string_append (str, lookup->bit_nicks[i]);
+            }
+        }
+        return (str ? g_string_free (str, FALSE) : NULL);
+    }
+
+    for (i = 0; values[i].value_nick; i++) {
+        /* We also look for exact matches */
+        if (mask == values[i].value) {
+            if (str)
+                g_string_free (str, TRUE);
+            return g_strdup (values[i].value_nick);
+        }
+
+        /* Build list with single-bit masks */
+        if ((mask & values[i].value) && !(values[i].value & (values[i].value - 1))) {
+            if (!str)
+                str = g_string_new (values[i].value_nick);
+            else {
+                g_string_append (str, ", ");
+                g_string_append (str, values[i].value_nick);
+            }
+        }
+    }
+
+    return (str ? g_string_free (str, FALSE) : NULL);
+}
+
 /*** END file-header ***/
 
 /*** BEGIN file-production ***/
@@ -25,39 +115,9 @@ static const GFlags64Value @enum_name@_values[] = {
 gchar *
 @enum_name@_build_string_from_mask (@EnumName@ mask)
 {
-    guint i;
-    gboolean first = TRUE;
-    GString *str = NULL;
+    static volatile gsize lookup = 0;
 
-    for (i = 0; @enum_name@_values[i].value_nick; i++) {
-        /* We also look for exact matches */
-        if (mask == @enum_name@_values[i].value) {
-            if (str)
-                g_string_free (str, TRUE);
-            return g_strdup (@enum_name@_values[i].value_nick);
-        }
-
-        /* Build list with single-bit masks */
-        if (mask & @enum_name@_values[i].value) {
-            guint c;
-            guint64 number = @enum_name@_values[i].value;
-
-            for (c = 0; number; c++)
-                number &= number - 1;
-
-            if (c == 1) {
-                if (!str)
-                    str = g_string_new ("");
-                g_string_append_printf (str, "%s%s",
-                                        first ? "" : ", ",
-                                        @enum_name@_values[i].value_nick);
-                if (first)
-                    first = FALSE;
-            }
-        }
-    }
-
-    return (str ? g_string_free (str, FALSE) : NULL);
+    return flags64_lookup_build_string (&lookup, @enum_name@_values, (guint64) mask);
 }
 
 /*** END value-tail ***/
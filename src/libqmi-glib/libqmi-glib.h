@@ -34,6 +34,7 @@
 #include "qmi-proxy.h"
 #include "qmi-message.h"
 #include "qmi-message-context.h"
+#include "qmi-capture.h"
 #include "qmi-enums.h"
 #include "qmi-utils.h"
 
@@ -0,0 +1,582 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#include "qmi-capture.h"
+#include "qmi-errors.h"
+#include "qmi-error-types.h"
+
+#define PACKED __attribute__((packed))
+
+/* Capture file header, all fields little endian */
+struct file_header {
+    guint32 magic;
+    guint16 version;
+    guint16 record_header_size;
+} PACKED;
+
+/* Header of each captured message, both in the ring and in capture files,
+ * all fields little endian. The raw frame follows right after. */
+struct record_header {
+    guint64 timestamp;
+    guint32 length;
+    guint16 vendor_id;
+    guint8  direction;
+    guint8  reserved;
+} PACKED;
+
+#define CAPTURE_FILE_MAGIC   0x43494d51 /* "QMIC" */
+#define CAPTURE_FILE_VERSION 1
+
+/*****************************************************************************/
+/* Basic capture */
+
+struct _QmiCapture {
+    volatile gint ref_count;
+
+    /* Messages may be captured from devices running in different threads */
+    GMutex mutex;
+
+    /* Ring of records; a record may wrap around the end of the buffer */
+    guint8 *ring;
+    gsize   size;
+    gsize   head;
+    gsize   used;
+
+    guint   n_messages;
+    guint64 n_lost;
+
+    /* Spill file */
+    FILE  *spill;
+    gchar *spill_path;
+};
+
+QmiCapture *
+qmi_capture_new (gsize size)
+{
+    QmiCapture *self;
+
+    g_return_val_if_fail (size > sizeof (struct record_header), NULL);
+
+    self = g_slice_new0 (QmiCapture);
+    self->ref_count = 1;
+    g_mutex_init (&self->mutex);
+    self->ring = g_malloc (size);
+    self->size = size;
+    return self;
+}
+
+GType
+qmi_capture_get_type (void)
+{
+    static volatile gsize g_define_type_id__volatile = 0;
+
+    if (g_once_init_enter (&g_define_type_id__volatile)) {
+        GType g_define_type_id =
+            g_boxed_type_register_static (g_intern_static_string ("QmiCapture"),
+                                          (GBoxedCopyFunc) qmi_capture_ref,
+                                          (GBoxedFreeFunc) qmi_capture_unref);
+
+        g_once_init_leave (&g_define_type_id__volatile, g_define_type_id);
+    }
+
+    return g_define_type_id__volatile;
+}
+
+QmiCapture *
+qmi_capture_ref (QmiCapture *self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+static gboolean spill_close (QmiCapture *self, GError **error);
+
+void
+qmi_capture_unref (QmiCapture *self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test (&self->ref_count)) {
+        GError *error = NULL;
+
+        if (self->spill && !spill_close (self, &error)) {
+            g_warning ("couldn't write capture spill file: %s", error->message);
+            g_error_free (error);
+        }
+        g_mutex_clear (&self->mutex);
+        g_free (self->ring);
+        g_slice_free (QmiCapture, self);
+    }
+}
+
+/*****************************************************************************/
+/* Ring management, all called with the mutex held */
+
+static void
+ring_write (QmiCapture    *self,
+            gsize          offset,
+            gconstpointer  data,
+            gsize          length)
+{
+    gsize first;
+
+    offset %= self->size;
+    first = MIN (length, self->size - offset);
+    memcpy (&self->ring[offset], data, first);
+    if (first < length)
+        memcpy (self->ring, (const guint8 *)data + first, length - first);
+}
+
+static void
+ring_read (QmiCapture *self,
+           gsize       offset,
+           gpointer    data,
+           gsize       length)
+{
+    gsize first;
+
+    offset %= self->size;
+    first = MIN (length, self->size - offset);
+    memcpy (data, &self->ring[offset], first);
+    if (first < length)
+        memcpy ((guint8 *)data + first, self->ring, length - first);
+}
+
+static gsize
+ring_record_size (QmiCapture *self,
+                  gsize       offset)
+{
+    struct record_header header;
+
+    ring_read (self, offset, &header, sizeof (header));
+    return sizeof (header) + GUINT32_FROM_LE (header.length);
+}
+
+static gboolean
+ring_spill_range (QmiCapture  *self,
+                  gsize        offset,
+                  gsize        length,
+                  FILE        *file,
+                  GError     **error)
+{
+    gsize first;
+
+    offset %= self->size;
+    first = MIN (length, self->size - offset);
+    if (fwrite (&self->ring[offset], 1, first, file) != first ||
+        (first < length && fwrite (self->ring, 1, length - first, file) != length - first)) {
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errno),
+                     "Couldn't write capture records: %s",
+                     g_strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+ring_drop_oldest (QmiCapture *self)
+{
+    gsize record_size;
+
+    record_size = ring_record_size (self, self->head);
+
+    if (self->spill) {
+        GError *error = NULL;
+
+        if (!ring_spill_range (self, self->head, record_size, self->spill, &error)) {
+            /* Stop spilling on the first failure, instead of warning once
+             * for every single message captured afterwards */
+            g_warning ("couldn't write capture spill file '%s': %s", self->spill_path, error->message);
+            g_error_free (error);
+            fclose (self->spill);
+            self->spill = NULL;
+            g_clear_pointer (&self->spill_path, g_free);
+            self->n_lost++;
+        }
+    } else
+        self->n_lost++;
+
+    self->head = (self->head + record_size) % self->size;
+    self->used -= record_size;
+    self->n_messages--;
+}
+
+/*****************************************************************************/
+/* Capturing messages */
+
+void
+qmi_capture_add_message (QmiCapture          *self,
+                         QmiCaptureDirection  direction,
+                         QmiMessage          *message,
+                         QmiMessageContext   *context)
+{
+    struct record_header header;
+    const guint8 *frame;
+    gsize frame_length;
+    gsize record_size;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (message != NULL);
+
+    frame = ((GByteArray *)message)->data;
+    frame_length = ((GByteArray *)message)->len;
+    record_size = sizeof (header) + frame_length;
+
+    header.timestamp = GUINT64_TO_LE ((guint64) g_get_real_time ());
+    header.length = GUINT32_TO_LE ((guint32) frame_length);
+    header.vendor_id = GUINT16_TO_LE (context ? qmi_message_context_get_vendor_id (context) : QMI_MESSAGE_VENDOR_GENERIC);
+    header.direction = (guint8) direction;
+    header.reserved = 0;
+
+    g_mutex_lock (&self->mutex);
+
+    if (record_size > self->size)
+        self->n_lost++;
+    else {
+        while (self->size - self->used < record_size)
+            ring_drop_oldest (self);
+
+        ring_write (self, self->head + self->used, &header, sizeof (header));
+        ring_write (self, self->head + self->used + sizeof (header), frame, frame_length);
+        self->used += record_size;
+        self->n_messages++;
+    }
+
+    g_mutex_unlock (&self->mutex);
+}
+
+void
+qmi_capture_clear (QmiCapture *self)
+{
+    g_return_if_fail (self != NULL);
+
+    g_mutex_lock (&self->mutex);
+    self->head = 0;
+    self->used = 0;
+    self->n_messages = 0;
+    g_mutex_unlock (&self->mutex);
+}
+
+void
+qmi_capture_get_stats (QmiCapture *self,
+                       guint      *n_messages,
+                       guint64    *n_lost)
+{
+    g_return_if_fail (self != NULL);
+
+    g_mutex_lock (&self->mutex);
+    if (n_messages)
+        *n_messages = self->n_messages;
+    if (n_lost)
+        *n_lost = self->n_lost;
+    g_mutex_unlock (&self->mutex);
+}
+
+/*****************************************************************************/
+/* Capture files */
+
+static FILE *
+capture_file_open (const gchar  *path,
+                   GError      **error)
+{
+    FILE *file;
+    struct file_header header;
+
+    file = g_fopen (path, "wb");
+    if (!file) {
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errno),
+                     "Couldn't open capture file '%s': %s",
+                     path, g_strerror (errno));
+        return NULL;
+    }
+
+    header.magic = GUINT32_TO_LE (CAPTURE_FILE_MAGIC);
+    header.version = GUINT16_TO_LE (CAPTURE_FILE_VERSION);
+    header.record_header_size = GUINT16_TO_LE (sizeof (struct record_header));
+    if (fwrite (&header, sizeof (header), 1, file) != 1) {
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errno),
+                     "Couldn't write capture file header: %s",
+                     g_strerror (errno));
+        fclose (file);
+        return NULL;
+    }
+
+    return file;
+}
+
+static gboolean
+capture_file_close (FILE    *file,
+                    GError **error)
+{
+    if (fclose (file) != 0) {
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errno),
+                     "Couldn't close capture file: %s",
+                     g_strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Called with the mutex held, or from the last unref */
+static gboolean
+spill_flush (QmiCapture  *self,
+             GError     **error)
+{
+    if (!self->spill)
+        return TRUE;
+
+    if (self->used > 0) {
+        if (!ring_spill_range (self, self->head, self->used, self->spill, error))
+            return FALSE;
+        self->head = 0;
+        self->used = 0;
+        self->n_messages = 0;
+    }
+
+    if (fflush (self->spill) != 0) {
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errno),
+                     "Couldn't flush capture spill file: %s",
+                     g_strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+spill_close (QmiCapture  *self,
+             GError     **error)
+{
+    gboolean flushed;
+    gboolean closed;
+    GError *inner_error = NULL;
+
+    flushed = spill_flush (self, &inner_error);
+    closed = capture_file_close (self->spill, flushed ? &inner_error : NULL);
+    self->spill = NULL;
+    g_clear_pointer (&self->spill_path, g_free);
+
+    if (!flushed || !closed) {
+        g_propagate_error (error, inner_error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+qmi_capture_set_spill_file (QmiCapture   *self,
+                            const gchar  *path,
+                            GError      **error)
+{
+    gboolean result = TRUE;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    g_mutex_lock (&self->mutex);
+
+    if (self->spill)
+        result = spill_close (self, error);
+
+    if (result && path) {
+        self->spill = capture_file_open (path, error);
+        if (self->spill)
+            self->spill_path = g_strdup (path);
+        else
+            result = FALSE;
+    }
+
+    g_mutex_unlock (&self->mutex);
+    return result;
+}
+
+gboolean
+qmi_capture_flush (QmiCapture  *self,
+                   GError     **error)
+{
+    gboolean result;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    g_mutex_lock (&self->mutex);
+    result = spill_flush (self, error);
+    g_mutex_unlock (&self->mutex);
+    return result;
+}
+
+gboolean
+qmi_capture_save (QmiCapture   *self,
+                  const gchar  *path,
+                  GError      **error)
+{
+    FILE *file;
+    gboolean result;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    file = capture_file_open (path, error);
+    if (!file)
+        return FALSE;
+
+    /* Records are stored in the ring already in the file format */
+    g_mutex_lock (&self->mutex);
+    result = ring_spill_range (self, self->head, self->used, file, error);
+    g_mutex_unlock (&self->mutex);
+
+    if (!result) {
+        fclose (file);
+        return FALSE;
+    }
+
+    return capture_file_close (file, error);
+}
+
+QmiCapture *
+qmi_capture_new_from_file (const gchar  *path,
+                           GError      **error)
+{
+    QmiCapture *self;
+    gchar *contents = NULL;
+    gsize contents_length = 0;
+    const struct file_header *header;
+    gsize offset;
+    guint n_messages = 0;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    if (!g_file_get_contents (path, &contents, &contents_length, error))
+        return NULL;
+
+    header = (const struct file_header *)contents;
+    if (contents_length < sizeof (struct file_header) ||
+        GUINT32_FROM_LE (header->magic) != CAPTURE_FILE_MAGIC) {
+        g_set_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED,
+                     "'%s' is not a QMI capture file", path);
+        g_free (contents);
+        return NULL;
+    }
+
+    if (GUINT16_FROM_LE (header->version) != CAPTURE_FILE_VERSION ||
+        GUINT16_FROM_LE (header->record_header_size) != sizeof (struct record_header)) {
+        g_set_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_UNSUPPORTED,
+                     "Unsupported QMI capture file version: %u",
+                     GUINT16_FROM_LE (header->version));
+        g_free (contents);
+        return NULL;
+    }
+
+    /* Validate all records before building the ring */
+    offset = sizeof (struct file_header);
+    while (offset < contents_length) {
+        struct record_header record;
+
+        if (contents_length - offset < sizeof (record)) {
+            g_set_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED,
+                         "Truncated QMI capture record header at offset %" G_GSIZE_FORMAT,
+                         offset);
+            g_free (contents);
+            return NULL;
+        }
+
+        memcpy (&record, &contents[offset], sizeof (record));
+        if (contents_length - offset - sizeof (record) < GUINT32_FROM_LE (record.length)) {
+            g_set_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED,
+                         "Truncated QMI capture record at offset %" G_GSIZE_FORMAT,
+                         offset);
+            g_free (contents);
+            return NULL;
+        }
+
+        offset += sizeof (record) + GUINT32_FROM_LE (record.length);
+        n_messages++;
+    }
+
+    /* The ring is sized to exactly fit all the records in the file, so that
+     * they can all be moved in one go */
+    self = qmi_capture_new (MAX (contents_length - sizeof (struct file_header), sizeof (struct record_header) + 1));
+    memcpy (self->ring, &contents[sizeof (struct file_header)], contents_length - sizeof (struct file_header));
+    self->used = contents_length - sizeof (struct file_header);
+    self->n_messages = n_messages;
+    g_free (contents);
+
+    return self;
+}
+
+/*****************************************************************************/
+/* Reading captured messages */
+
+void
+qmi_capture_foreach (QmiCapture          *self,
+                     QmiCaptureForeachFn  func,
+                     gpointer             user_data)
+{
+    guint8 *records;
+    gsize used;
+    gsize offset = 0;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (func != NULL);
+
+    /* Copy the records, so that the callback runs without the lock held */
+    g_mutex_lock (&self->mutex);
+    used = self->used;
+    records = g_malloc (used);
+    if (used > 0)
+        ring_read (self, self->head, records, used);
+    g_mutex_unlock (&self->mutex);
+
+    while (offset < used) {
+        struct record_header header;
+        guint32 frame_length;
+
+        memcpy (&header, &records[offset], sizeof (header));
+        frame_length = GUINT32_FROM_LE (header.length);
+
+        func ((gint64) GUINT64_FROM_LE (header.timestamp),
+              (QmiCaptureDirection) header.direction,
+              GUINT16_FROM_LE (header.vendor_id),
+              &records[offset + sizeof (header)],
+              frame_length,
+              user_data);
+
+        offset += sizeof (header) + frame_length;
+    }
+
+    g_free (records);
+}
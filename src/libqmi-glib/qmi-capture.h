@@ -0,0 +1,283 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_CAPTURE_H_
+#define _LIBQMI_GLIB_QMI_CAPTURE_H_
+
+#if !defined (__LIBQMI_GLIB_H_INSIDE__) && !defined (LIBQMI_GLIB_COMPILATION)
+#error "Only <libqmi-glib.h> can be included directly."
+#endif
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "qmi-message.h"
+#include "qmi-message-context.h"
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:qmi-capture
+ * @title: QmiCapture
+ * @short_description: binary capture of QMI traffic
+ *
+ * The #QmiCapture keeps a binary copy of the QMI messages sent and received
+ * by a #QmiDevice, in a fixed-size in-memory ring. Each captured message
+ * costs a single copy of the raw frame, so unlike the text traces enabled with
+ * qmi_utils_set_traces_enabled(), a capture may be left enabled permanently.
+ *
+ * When the ring is full, the oldest messages are discarded, or written to a
+ * spill file if one was set with qmi_capture_set_spill_file().
+ *
+ * Captures are stored in files with a simple pcap-like format: a file header
+ * followed by one record per message, each with its own timestamp, direction,
+ * vendor ID and raw frame. These files can be loaded back with
+ * qmi_capture_new_from_file() and decoded offline, e.g. with
+ * <literal>qmicli --decode-capture</literal>.
+ */
+
+/**
+ * QmiCapture:
+ *
+ * An opaque type representing a QMI traffic capture.
+ *
+ * Since: 1.24
+ */
+typedef struct _QmiCapture QmiCapture;
+
+GType qmi_capture_get_type (void);
+
+/**
+ * QmiCaptureDirection:
+ * @QMI_CAPTURE_DIRECTION_RECEIVED: Message received from the device.
+ * @QMI_CAPTURE_DIRECTION_SENT: Message sent to the device.
+ *
+ * Direction of a captured message.
+ *
+ * Since: 1.24
+ */
+typedef enum {
+    QMI_CAPTURE_DIRECTION_RECEIVED = 0,
+    QMI_CAPTURE_DIRECTION_SENT     = 1,
+} QmiCaptureDirection;
+
+/*****************************************************************************/
+/* Basic capture */
+
+/**
+ * qmi_capture_new:
+ * @size: size of the in-memory ring, in bytes.
+ *
+ * Create a new empty #QmiCapture, which will keep up to @size bytes of
+ * captured messages in memory.
+ *
+ * Returns: (transfer full): a newly created #QmiCapture. The returned value should be freed with qmi_capture_unref().
+ *
+ * Since: 1.24
+ */
+QmiCapture *qmi_capture_new (gsize size);
+
+/**
+ * qmi_capture_new_from_file:
+ * @path: path to a capture file.
+ * @error: return location for error or %NULL.
+ *
+ * Create a new #QmiCapture with all the messages stored in the capture file
+ * at @path, e.g. for offline decoding.
+ *
+ * Returns: (transfer full): a newly created #QmiCapture, or %NULL if @error is set. The returned value should be freed with qmi_capture_unref().
+ *
+ * Since: 1.24
+ */
+QmiCapture *qmi_capture_new_from_file (const gchar  *path,
+                                       GError      **error);
+
+/**
+ * qmi_capture_ref:
+ * @self: a #QmiCapture.
+ *
+ * Atomically increments the reference count of @self by one.
+ *
+ * Returns: (transfer full) the new reference to @self.
+ *
+ * Since: 1.24
+ */
+QmiCapture *qmi_capture_ref (QmiCapture *self);
+
+/**
+ * qmi_capture_unref:
+ * @self: a #QmiCapture.
+ *
+ * Atomically decrements the reference count of @self by one.
+ * If the reference count drops to 0, @self is completely disposed, and if a
+ * spill file was set, all the messages still in the ring are written to it.
+ *
+ * Since: 1.24
+ */
+void qmi_capture_unref (QmiCapture *self);
+
+/*****************************************************************************/
+/* Capturing messages */
+
+/**
+ * qmi_capture_add_message:
+ * @self: a #QmiCapture.
+ * @direction: a #QmiCaptureDirection.
+ * @message: a #QmiMessage.
+ * @context: (allow-none): a #QmiMessageContext, or %NULL.
+ *
+ * Adds a copy of the raw @message to the capture, timestamped with the
+ * current time.
+ *
+ * If the message doesn't fit in the ring at all, it is discarded.
+ *
+ * Since: 1.24
+ */
+void qmi_capture_add_message (QmiCapture          *self,
+                              QmiCaptureDirection  direction,
+                              QmiMessage          *message,
+                              QmiMessageContext   *context);
+
+/**
+ * qmi_capture_clear:
+ * @self: a #QmiCapture.
+ *
+ * Discards all the messages kept in the ring.
+ *
+ * Since: 1.24
+ */
+void qmi_capture_clear (QmiCapture *self);
+
+/**
+ * qmi_capture_get_stats:
+ * @self: a #QmiCapture.
+ * @n_messages: (out) (allow-none): return location for the number of messages currently in the ring, or %NULL.
+ * @n_lost: (out) (allow-none): return location for the number of messages discarded without being written to a spill file, or %NULL.
+ *
+ * Gets statistics of the capture.
+ *
+ * Since: 1.24
+ */
+void qmi_capture_get_stats (QmiCapture *self,
+                            guint      *n_messages,
+                            guint64    *n_lost);
+
+/*****************************************************************************/
+/* Capture files */
+
+/**
+ * qmi_capture_set_spill_file:
+ * @self: a #QmiCapture.
+ * @path: (allow-none): path to the spill file, or %NULL to stop spilling.
+ * @error: return location for error or %NULL.
+ *
+ * Sets the file where messages are written when they're discarded from the
+ * ring to make room for new ones. The file is truncated and a new capture
+ * header written to it.
+ *
+ * If a spill file was already set, all the messages in the ring are written
+ * to it before it is closed.
+ *
+ * Returns: %TRUE if the spill file was set, %FALSE if @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_capture_set_spill_file (QmiCapture   *self,
+                                     const gchar  *path,
+                                     GError      **error);
+
+/**
+ * qmi_capture_flush:
+ * @self: a #QmiCapture.
+ * @error: return location for error or %NULL.
+ *
+ * Writes all the messages in the ring to the spill file, and removes them
+ * from the ring. If no spill file is set, this method does nothing.
+ *
+ * Returns: %TRUE if the messages were written, %FALSE if @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_capture_flush (QmiCapture  *self,
+                            GError     **error);
+
+/**
+ * qmi_capture_save:
+ * @self: a #QmiCapture.
+ * @path: path to the capture file.
+ * @error: return location for error or %NULL.
+ *
+ * Writes a capture file at @path with all the messages currently in the ring.
+ * The ring itself is not modified.
+ *
+ * Returns: %TRUE if the file was written, %FALSE if @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_capture_save (QmiCapture   *self,
+                           const gchar  *path,
+                           GError      **error);
+
+/*****************************************************************************/
+/* Reading captured messages */
+
+/**
+ * QmiCaptureForeachFn:
+ * @timestamp: time when the message was captured, in microseconds since January 1, 1970 UTC.
+ * @direction: a #QmiCaptureDirection.
+ * @vendor_id: the vendor ID of the message context, or %QMI_MESSAGE_VENDOR_GENERIC.
+ * @frame: the raw message frame.
+ * @frame_length: length of @frame.
+ * @user_data: user data.
+ *
+ * Callback used to iterate the messages in a #QmiCapture.
+ *
+ * Since: 1.24
+ */
+typedef void (* QmiCaptureForeachFn) (gint64               timestamp,
+                                      QmiCaptureDirection  direction,
+                                      guint16              vendor_id,
+                                      const guint8        *frame,
+                                      gsize                frame_length,
+                                      gpointer             user_data);
+
+/**
+ * qmi_capture_foreach:
+ * @self: a #QmiCapture.
+ * @func: the function to call for each captured message.
+ * @user_data: user data to pass to the function.
+ *
+ * Calls the given function for each message in the ring, oldest first.
+ *
+ * The messages are copied before iterating, so @func may call any other
+ * #QmiCapture method on @self; messages captured meanwhile are not iterated.
+ *
+ * Since: 1.24
+ */
+void qmi_capture_foreach (QmiCapture          *self,
+                          QmiCaptureForeachFn  func,
+                          gpointer             user_data);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_CAPTURE_H_ */
@@ -0,0 +1,848 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <string.h>
+
+#include "qmi-codec.h"
+#include "qmi-errors.h"
+#include "qmi-error-types.h"
+
+/* Layout of the string arena fields in output bundles */
+typedef struct {
+    gchar *arena;
+    gsize  arena_size;
+    gsize  arena_used;
+} Arena;
+
+/*****************************************************************************/
+/* Storage access */
+
+static guint64
+load_value (gconstpointer base,
+            guint16       offset,
+            guint         size)
+{
+    switch (size) {
+    case 1:
+        return G_STRUCT_MEMBER (guint8, base, offset);
+    case 2:
+        return G_STRUCT_MEMBER (guint16, base, offset);
+    case 4:
+        return G_STRUCT_MEMBER (guint32, base, offset);
+    case 8:
+        return G_STRUCT_MEMBER (guint64, base, offset);
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static void
+store_value (gpointer base,
+             guint16  offset,
+             guint    size,
+             guint64  value)
+{
+    switch (size) {
+    case 1:
+        G_STRUCT_MEMBER (guint8, base, offset) = (guint8) value;
+        break;
+    case 2:
+        G_STRUCT_MEMBER (guint16, base, offset) = (guint16) value;
+        break;
+    case 4:
+        G_STRUCT_MEMBER (guint32, base, offset) = (guint32) value;
+        break;
+    case 8:
+        G_STRUCT_MEMBER (guint64, base, offset) = value;
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static gboolean
+prerequisites_met (const QmiCodecBundle *bundle,
+                   const QmiCodecTlv    *tlv,
+                   gconstpointer         output)
+{
+    guint i;
+
+    for (i = 0; i < tlv->n_prerequisites; i++) {
+        const QmiCodecPrerequisite *prerequisite;
+        guint64 expected;
+
+        prerequisite = &bundle->prerequisites[tlv->first_prerequisite + i];
+        expected = prerequisite->value;
+        if (prerequisite->size < 8)
+            expected &= (G_GUINT64_CONSTANT (1) << (prerequisite->size * 8)) - 1;
+        if ((load_value (output, prerequisite->offset, prerequisite->size) == expected) != !!prerequisite->equal)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Arrays of unsigned integers stored with their own width can be read and
+ * written in bulk */
+static gboolean
+array_is_bulk (const QmiCodecOp *op)
+{
+    const QmiCodecOp *element = &op[1];
+
+    if (op->n_ops != 1 || element->offset != 0)
+        return FALSE;
+
+    switch (element->type) {
+    case QMI_CODEC_TYPE_GUINT16:
+        return element->size == 2;
+    case QMI_CODEC_TYPE_GUINT32:
+        return element->size == 4;
+    case QMI_CODEC_TYPE_GUINT64:
+        return element->size == 8;
+    default:
+        return FALSE;
+    }
+}
+
+/*****************************************************************************/
+/* Decoder */
+
+static gboolean decode_ops (QmiMessage        *message,
+                            gsize              tlv_offset,
+                            gsize             *offset,
+                            const QmiCodecOp  *ops,
+                            guint              n_ops,
+                            gpointer           base,
+                            Arena             *arena,
+                            GError           **error);
+
+static gboolean
+read_prefix (QmiMessage  *message,
+             gsize        tlv_offset,
+             gsize       *offset,
+             guint8       length,
+             guint32     *out,
+             GError     **error)
+{
+    switch (length) {
+    case 1: {
+        guint8 value;
+
+        if (!qmi_message_tlv_read_guint8 (message, tlv_offset, offset, &value, error))
+            return FALSE;
+        *out = value;
+        return TRUE;
+    }
+    case 2: {
+        guint16 value;
+
+        if (!qmi_message_tlv_read_guint16 (message, tlv_offset, offset, QMI_ENDIAN_LITTLE, &value, error))
+            return FALSE;
+        *out = value;
+        return TRUE;
+    }
+    case 4:
+        return qmi_message_tlv_read_guint32 (message, tlv_offset, offset, QMI_ENDIAN_LITTLE, out, error);
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static gboolean
+decode_integer (QmiMessage        *message,
+                gsize              tlv_offset,
+                gsize             *offset,
+                const QmiCodecOp  *op,
+                gpointer           base,
+                GError           **error)
+{
+    guint64 value;
+
+    /* Signed values are sign-extended, so that they are kept when stored in a
+     * wider type */
+    switch ((QmiCodecType) op->type) {
+    case QMI_CODEC_TYPE_GUINT8: {
+        guint8 tmp;
+
+        if (!qmi_message_tlv_read_guint8 (message, tlv_offset, offset, &tmp, error))
+            return FALSE;
+        value = tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GINT8: {
+        gint8 tmp;
+
+        if (!qmi_message_tlv_read_gint8 (message, tlv_offset, offset, &tmp, error))
+            return FALSE;
+        value = (guint64) (gint64) tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GUINT16: {
+        guint16 tmp;
+
+        if (!qmi_message_tlv_read_guint16 (message, tlv_offset, offset, op->endian, &tmp, error))
+            return FALSE;
+        value = tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GINT16: {
+        gint16 tmp;
+
+        if (!qmi_message_tlv_read_gint16 (message, tlv_offset, offset, op->endian, &tmp, error))
+            return FALSE;
+        value = (guint64) (gint64) tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GUINT32: {
+        guint32 tmp;
+
+        if (!qmi_message_tlv_read_guint32 (message, tlv_offset, offset, op->endian, &tmp, error))
+            return FALSE;
+        value = tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GINT32: {
+        gint32 tmp;
+
+        if (!qmi_message_tlv_read_gint32 (message, tlv_offset, offset, op->endian, &tmp, error))
+            return FALSE;
+        value = (guint64) (gint64) tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_GUINT64:
+        if (!qmi_message_tlv_read_guint64 (message, tlv_offset, offset, op->endian, &value, error))
+            return FALSE;
+        break;
+    case QMI_CODEC_TYPE_GINT64: {
+        gint64 tmp;
+
+        if (!qmi_message_tlv_read_gint64 (message, tlv_offset, offset, op->endian, &tmp, error))
+            return FALSE;
+        value = (guint64) tmp;
+        break;
+    }
+    case QMI_CODEC_TYPE_SIZED_GUINT:
+        if (!qmi_message_tlv_read_sized_guint (message, tlv_offset, offset, op->length, op->endian, &value, error))
+            return FALSE;
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+
+    store_value (base, op->offset, op->size, value);
+    return TRUE;
+}
+
+static gboolean
+decode_array (QmiMessage        *message,
+              gsize              tlv_offset,
+              gsize             *offset,
+              const QmiCodecOp  *op,
+              gpointer           base,
+              Arena             *arena,
+              GError           **error)
+{
+    GArray *array;
+    guint32 n_items;
+    guint32 i;
+
+    if (op->n_items)
+        n_items = op->n_items;
+    else if (!read_prefix (message, tlv_offset, offset, op->length, &n_items, error))
+        return FALSE;
+
+    if (op->sequence_length) {
+        guint32 sequence;
+
+        if (!read_prefix (message, tlv_offset, offset, op->sequence_length, &sequence, error))
+            return FALSE;
+        store_value (base, op->sequence_offset, op->sequence_length, sequence);
+    }
+
+    array = g_array_sized_new (FALSE, FALSE, op->size, n_items);
+    if (op->clear_func)
+        g_array_set_clear_func (array, op->clear_func);
+    G_STRUCT_MEMBER (GArray *, base, op->offset) = array;
+
+    if (array_is_bulk (op)) {
+        g_array_set_size (array, n_items);
+        switch ((QmiCodecType) op[1].type) {
+        case QMI_CODEC_TYPE_GUINT16:
+            return qmi_message_tlv_read_guint16_array (message, tlv_offset, offset, op[1].endian, n_items, (guint16 *) array->data, error);
+        case QMI_CODEC_TYPE_GUINT32:
+            return qmi_message_tlv_read_guint32_array (message, tlv_offset, offset, op[1].endian, n_items, (guint32 *) array->data, error);
+        case QMI_CODEC_TYPE_GUINT64:
+            return qmi_message_tlv_read_guint64_array (message, tlv_offset, offset, op[1].endian, n_items, (guint64 *) array->data, error);
+        default:
+            g_assert_not_reached ();
+        }
+    }
+
+    /* Elements are read in place; one failing to be read is removed, so that
+     * whatever it got is disposed by the clear function */
+    for (i = 0; i < n_items; i++) {
+        gpointer element;
+
+        g_array_set_size (array, i + 1);
+        element = array->data + (gsize) i * op->size;
+        memset (element, 0, op->size);
+        if (!decode_ops (message, tlv_offset, offset, &op[1], op->n_ops, element, arena, error)) {
+            g_array_set_size (array, i);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+decode_op (QmiMessage        *message,
+           gsize              tlv_offset,
+           gsize             *offset,
+           const QmiCodecOp  *op,
+           gpointer           base,
+           Arena             *arena,
+           GError           **error)
+{
+    switch ((QmiCodecType) op->type) {
+    case QMI_CODEC_TYPE_GUINT8:
+    case QMI_CODEC_TYPE_GINT8:
+    case QMI_CODEC_TYPE_GUINT16:
+    case QMI_CODEC_TYPE_GINT16:
+    case QMI_CODEC_TYPE_GUINT32:
+    case QMI_CODEC_TYPE_GINT32:
+    case QMI_CODEC_TYPE_GUINT64:
+    case QMI_CODEC_TYPE_GINT64:
+    case QMI_CODEC_TYPE_SIZED_GUINT:
+        return decode_integer (message, tlv_offset, offset, op, base, error);
+
+    case QMI_CODEC_TYPE_GFLOAT:
+        return qmi_message_tlv_read_gfloat_endian (message, tlv_offset, offset, op->endian,
+                                                   &G_STRUCT_MEMBER (gfloat, base, op->offset), error);
+
+    case QMI_CODEC_TYPE_GDOUBLE:
+        return qmi_message_tlv_read_gdouble (message, tlv_offset, offset, op->endian,
+                                             &G_STRUCT_MEMBER (gdouble, base, op->offset), error);
+
+    case QMI_CODEC_TYPE_STRING:
+        return qmi_message_tlv_read_string (message, tlv_offset, offset, op->length, op->size,
+                                            &G_STRUCT_MEMBER (gchar *, base, op->offset), error);
+
+    case QMI_CODEC_TYPE_STRING_INLINE:
+        return __qmi_message_tlv_read_string_into (message, tlv_offset, offset, op->length, op->size,
+                                                   G_STRUCT_MEMBER_P (base, op->offset), op->size + 1,
+                                                   NULL, error);
+
+    case QMI_CODEC_TYPE_STRING_ARENA: {
+        gsize string_length;
+
+        if (!__qmi_message_tlv_read_string_into (message, tlv_offset, offset, op->length, op->size,
+                                                 &arena->arena[arena->arena_used], arena->arena_size - arena->arena_used,
+                                                 &string_length, error))
+            return FALSE;
+        G_STRUCT_MEMBER (gchar *, base, op->offset) = &arena->arena[arena->arena_used];
+        arena->arena_used += string_length + 1;
+        return TRUE;
+    }
+
+    case QMI_CODEC_TYPE_FIXED_STRING: {
+        gchar *str;
+
+        str = G_STRUCT_MEMBER_P (base, op->offset);
+        if (!qmi_message_tlv_read_fixed_size_string (message, tlv_offset, offset, op->size, str, error))
+            return FALSE;
+        str[op->size] = '\0';
+        return TRUE;
+    }
+
+    case QMI_CODEC_TYPE_FIXED_STRING_HEAP: {
+        gchar *str;
+
+        str = g_malloc (op->size + 1);
+        if (!qmi_message_tlv_read_fixed_size_string (message, tlv_offset, offset, op->size, str, error)) {
+            g_free (str);
+            return FALSE;
+        }
+        str[op->size] = '\0';
+        G_STRUCT_MEMBER (gchar *, base, op->offset) = str;
+        return TRUE;
+    }
+
+    case QMI_CODEC_TYPE_ARRAY:
+        return decode_array (message, tlv_offset, offset, op, base, arena, error);
+
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static gboolean
+decode_ops (QmiMessage        *message,
+            gsize              tlv_offset,
+            gsize             *offset,
+            const QmiCodecOp  *ops,
+            guint              n_ops,
+            gpointer           base,
+            Arena             *arena,
+            GError           **error)
+{
+    guint i;
+
+    for (i = 0; i < n_ops; i++) {
+        if (!decode_op (message, tlv_offset, offset, &ops[i], base, arena, error))
+            return FALSE;
+        /* Skip the array element ops */
+        if (ops[i].type == QMI_CODEC_TYPE_ARRAY)
+            i += ops[i].n_ops;
+    }
+    return TRUE;
+}
+
+/* Returns FALSE if a mandatory TLV isn't found, or if a TLV found can't be
+ * read; optional TLVs not found are just left unset */
+static gboolean
+decode_tlv (const QmiCodecBundle  *bundle,
+            const QmiCodecTlv     *tlv,
+            QmiMessage            *message,
+            gpointer               output,
+            GError               **error)
+{
+    gboolean mandatory;
+    Arena *arena;
+    gsize init_offset;
+    gsize offset = 0;
+
+    if (!prerequisites_met (bundle, tlv, output))
+        return TRUE;
+
+    mandatory = !!(tlv->flags & QMI_CODEC_TLV_FLAG_MANDATORY);
+
+    if ((init_offset = qmi_message_tlv_read_init (message, tlv->id, NULL, mandatory ? error : NULL)) == 0) {
+        if (!mandatory)
+            return TRUE;
+        g_prefix_error (error, "Couldn't get the mandatory %s TLV: ", tlv->name);
+        return FALSE;
+    }
+
+    arena = bundle->arena_offset ? G_STRUCT_MEMBER_P (output, bundle->arena_offset) : NULL;
+    if (!decode_ops (message, init_offset, &offset, &bundle->ops[tlv->first_op], tlv->n_ops, output, arena, error)) {
+        if (!mandatory)
+            g_prefix_error (error, "Couldn't get the %s TLV: ", tlv->name);
+        return FALSE;
+    }
+
+    /* The remaining size of the buffer needs to be 0 if we successfully read the TLV */
+    if ((offset = __qmi_message_tlv_read_remaining_size (message, init_offset, offset)) > 0)
+        g_warning ("Left '%" G_GSIZE_FORMAT "' bytes unread when getting the '%s' TLV", offset, tlv->name);
+
+    G_STRUCT_MEMBER (gboolean, output, tlv->set_offset) = TRUE;
+    return TRUE;
+}
+
+gboolean
+__qmi_codec_decode (const QmiCodecBundle  *bundle,
+                    QmiMessage            *message,
+                    gpointer               output,
+                    GError               **error)
+{
+    guint i;
+
+    /* Strings are never longer than the TLVs holding them, so the whole arena
+     * can be allocated at once */
+    if (bundle->arena_offset) {
+        Arena *arena;
+
+        arena = G_STRUCT_MEMBER_P (output, bundle->arena_offset);
+        for (i = 0; i < bundle->n_tlvs; i++) {
+            const QmiCodecTlv *tlv = &bundle->tlvs[i];
+            guint16 tlv_length;
+
+            if (bundle->ops[tlv->first_op].type == QMI_CODEC_TYPE_STRING_ARENA &&
+                qmi_message_tlv_read_init (message, tlv->id, &tlv_length, NULL) > 0)
+                arena->arena_size += tlv_length + 1;
+        }
+        if (arena->arena_size > 0)
+            arena->arena = g_malloc (arena->arena_size);
+    }
+
+    for (i = 0; i < bundle->n_tlvs; i++) {
+        const QmiCodecTlv *tlv = &bundle->tlvs[i];
+
+        if (tlv->flags & QMI_CODEC_TLV_FLAG_LAZY)
+            continue;
+        /* Optional TLVs which can't be read are just left unset */
+        if (!(tlv->flags & QMI_CODEC_TLV_FLAG_MANDATORY))
+            decode_tlv (bundle, tlv, message, output, NULL);
+        else if (!decode_tlv (bundle, tlv, message, output, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+__qmi_codec_decode_tlv (const QmiCodecBundle  *bundle,
+                        guint                  tlv_index,
+                        QmiMessage            *message,
+                        gpointer               output,
+                        GError               **error)
+{
+    g_assert (tlv_index < bundle->n_tlvs);
+    g_assert (!(bundle->tlvs[tlv_index].flags & QMI_CODEC_TLV_FLAG_MANDATORY));
+
+    return decode_tlv (bundle, &bundle->tlvs[tlv_index], message, output, error);
+}
+
+/*****************************************************************************/
+/* Encoder */
+
+static gboolean encode_ops (QmiMessage        *self,
+                            const QmiCodecOp  *ops,
+                            guint              n_ops,
+                            gconstpointer      base,
+                            GError           **error);
+
+static gboolean
+write_prefix (QmiMessage  *self,
+              guint8       length,
+              guint32      value,
+              GError     **error)
+{
+    switch (length) {
+    case 1:
+        return qmi_message_tlv_write_guint8 (self, (guint8) value, error);
+    case 2:
+        return qmi_message_tlv_write_guint16 (self, QMI_ENDIAN_LITTLE, (guint16) value, error);
+    case 4:
+        return qmi_message_tlv_write_guint32 (self, QMI_ENDIAN_LITTLE, value, error);
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+/* Number of bytes taken by the ops in the raw byte buffer, or -1 if that
+ * depends on the actual values */
+static gssize
+ops_fixed_size (const QmiCodecOp *ops,
+                guint             n_ops)
+{
+    gssize size = 0;
+    guint i;
+
+    for (i = 0; i < n_ops; i++) {
+        switch ((QmiCodecType) ops[i].type) {
+        case QMI_CODEC_TYPE_GUINT8:
+        case QMI_CODEC_TYPE_GINT8:
+            size += 1;
+            break;
+        case QMI_CODEC_TYPE_GUINT16:
+        case QMI_CODEC_TYPE_GINT16:
+            size += 2;
+            break;
+        case QMI_CODEC_TYPE_GUINT32:
+        case QMI_CODEC_TYPE_GINT32:
+        case QMI_CODEC_TYPE_GFLOAT:
+            size += 4;
+            break;
+        case QMI_CODEC_TYPE_GUINT64:
+        case QMI_CODEC_TYPE_GINT64:
+        case QMI_CODEC_TYPE_GDOUBLE:
+            size += 8;
+            break;
+        case QMI_CODEC_TYPE_SIZED_GUINT:
+            size += ops[i].length;
+            break;
+        case QMI_CODEC_TYPE_FIXED_STRING:
+        case QMI_CODEC_TYPE_FIXED_STRING_HEAP:
+            size += ops[i].size;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return size;
+}
+
+static gsize
+ops_size (const QmiCodecOp *ops,
+          guint             n_ops,
+          gconstpointer     base)
+{
+    gsize size = 0;
+    guint i;
+
+    for (i = 0; i < n_ops; i++) {
+        const QmiCodecOp *op = &ops[i];
+        gssize fixed_size;
+
+        switch ((QmiCodecType) op->type) {
+        case QMI_CODEC_TYPE_STRING:
+        case QMI_CODEC_TYPE_STRING_ARENA:
+            size += op->length + strlen (G_STRUCT_MEMBER (const gchar *, base, op->offset));
+            break;
+        case QMI_CODEC_TYPE_STRING_INLINE:
+            size += op->length + strlen (G_STRUCT_MEMBER_P (base, op->offset));
+            break;
+        case QMI_CODEC_TYPE_ARRAY: {
+            const GArray *array;
+
+            array = G_STRUCT_MEMBER (const GArray *, base, op->offset);
+            size += (op->n_items ? 0 : op->length) + op->sequence_length;
+            fixed_size = ops_fixed_size (&op[1], op->n_ops);
+            if (fixed_size >= 0)
+                size += array->len * (gsize) fixed_size;
+            else {
+                guint j;
+
+                for (j = 0; j < array->len; j++)
+                    size += ops_size (&op[1], op->n_ops, array->data + (gsize) j * op->size);
+            }
+            i += op->n_ops;
+            break;
+        }
+        default:
+            fixed_size = ops_fixed_size (op, 1);
+            g_assert (fixed_size >= 0);
+            size += fixed_size;
+            break;
+        }
+    }
+    return size;
+}
+
+static gboolean
+encode_integer (QmiMessage        *self,
+                const QmiCodecOp  *op,
+                gconstpointer      base,
+                GError           **error)
+{
+    guint64 value;
+
+    value = load_value (base, op->offset, op->size);
+
+    switch ((QmiCodecType) op->type) {
+    case QMI_CODEC_TYPE_GUINT8:
+        return qmi_message_tlv_write_guint8 (self, (guint8) value, error);
+    case QMI_CODEC_TYPE_GINT8:
+        return qmi_message_tlv_write_gint8 (self, (gint8) value, error);
+    case QMI_CODEC_TYPE_GUINT16:
+        return qmi_message_tlv_write_guint16 (self, op->endian, (guint16) value, error);
+    case QMI_CODEC_TYPE_GINT16:
+        return qmi_message_tlv_write_gint16 (self, op->endian, (gint16) value, error);
+    case QMI_CODEC_TYPE_GUINT32:
+        return qmi_message_tlv_write_guint32 (self, op->endian, (guint32) value, error);
+    case QMI_CODEC_TYPE_GINT32:
+        return qmi_message_tlv_write_gint32 (self, op->endian, (gint32) value, error);
+    case QMI_CODEC_TYPE_GUINT64:
+        return qmi_message_tlv_write_guint64 (self, op->endian, value, error);
+    case QMI_CODEC_TYPE_GINT64:
+        return qmi_message_tlv_write_gint64 (self, op->endian, (gint64) value, error);
+    case QMI_CODEC_TYPE_SIZED_GUINT:
+        return qmi_message_tlv_write_sized_guint (self, op->length, op->endian, value, error);
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static gboolean
+encode_array (QmiMessage        *self,
+              const QmiCodecOp  *op,
+              gconstpointer      base,
+              GError           **error)
+{
+    const GArray *array;
+    guint i;
+
+    array = G_STRUCT_MEMBER (const GArray *, base, op->offset);
+
+    if (!op->n_items && !write_prefix (self, op->length, array->len, error))
+        return FALSE;
+
+    if (op->sequence_length &&
+        !write_prefix (self, op->sequence_length, (guint32) load_value (base, op->sequence_offset, op->sequence_length), error))
+        return FALSE;
+
+    if (array_is_bulk (op)) {
+        switch ((QmiCodecType) op[1].type) {
+        case QMI_CODEC_TYPE_GUINT16:
+            return qmi_message_tlv_write_guint16_array (self, op[1].endian, (const guint16 *) array->data, array->len, error);
+        case QMI_CODEC_TYPE_GUINT32:
+            return qmi_message_tlv_write_guint32_array (self, op[1].endian, (const guint32 *) array->data, array->len, error);
+        case QMI_CODEC_TYPE_GUINT64:
+            return qmi_message_tlv_write_guint64_array (self, op[1].endian, (const guint64 *) array->data, array->len, error);
+        default:
+            g_assert_not_reached ();
+        }
+    }
+
+    for (i = 0; i < array->len; i++) {
+        if (!encode_ops (self, &op[1], op->n_ops, array->data + (gsize) i * op->size, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+encode_op (QmiMessage        *self,
+           const QmiCodecOp  *op,
+           gconstpointer      base,
+           GError           **error)
+{
+    switch ((QmiCodecType) op->type) {
+    case QMI_CODEC_TYPE_GUINT8:
+    case QMI_CODEC_TYPE_GINT8:
+    case QMI_CODEC_TYPE_GUINT16:
+    case QMI_CODEC_TYPE_GINT16:
+    case QMI_CODEC_TYPE_GUINT32:
+    case QMI_CODEC_TYPE_GINT32:
+    case QMI_CODEC_TYPE_GUINT64:
+    case QMI_CODEC_TYPE_GINT64:
+    case QMI_CODEC_TYPE_SIZED_GUINT:
+        return encode_integer (self, op, base, error);
+
+    case QMI_CODEC_TYPE_GFLOAT:
+    case QMI_CODEC_TYPE_GDOUBLE:
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Writing floating point values is unsupported");
+        return FALSE;
+
+    case QMI_CODEC_TYPE_STRING:
+    case QMI_CODEC_TYPE_STRING_ARENA:
+        return qmi_message_tlv_write_string (self, op->length, G_STRUCT_MEMBER (const gchar *, base, op->offset), -1, error);
+
+    case QMI_CODEC_TYPE_STRING_INLINE:
+        return qmi_message_tlv_write_string (self, op->length, G_STRUCT_MEMBER_P (base, op->offset), -1, error);
+
+    case QMI_CODEC_TYPE_FIXED_STRING:
+        return qmi_message_tlv_write_string (self, 0, G_STRUCT_MEMBER_P (base, op->offset), op->size, error);
+
+    case QMI_CODEC_TYPE_FIXED_STRING_HEAP:
+        return qmi_message_tlv_write_string (self, 0, G_STRUCT_MEMBER (const gchar *, base, op->offset), op->size, error);
+
+    case QMI_CODEC_TYPE_ARRAY:
+        return encode_array (self, op, base, error);
+
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static gboolean
+encode_ops (QmiMessage        *self,
+            const QmiCodecOp  *ops,
+            guint              n_ops,
+            gconstpointer      base,
+            GError           **error)
+{
+    guint i;
+
+    for (i = 0; i < n_ops; i++) {
+        if (!encode_op (self, &ops[i], base, error))
+            return FALSE;
+        /* Skip the array element ops */
+        if (ops[i].type == QMI_CODEC_TYPE_ARRAY)
+            i += ops[i].n_ops;
+    }
+    return TRUE;
+}
+
+QmiMessage *
+__qmi_codec_encode (const QmiCodecBundle  *bundle,
+                    QmiService             service,
+                    guint8                 client_id,
+                    guint16                transaction_id,
+                    guint16                message_id,
+                    gconstpointer          input,
+                    GError               **error)
+{
+    QmiMessage *self;
+    gsize tlvs_size = 0;
+    gsize expected_length;
+    guint i;
+
+    if (!input) {
+        /* Only allow NULL input if all TLVs are optional */
+        for (i = 0; i < bundle->n_tlvs; i++) {
+            if (bundle->tlvs[i].flags & QMI_CODEC_TLV_FLAG_MANDATORY) {
+                g_set_error (error,
+                             QMI_CORE_ERROR,
+                             QMI_CORE_ERROR_INVALID_ARGS,
+                             "Message '%s' has mandatory TLVs",
+                             bundle->message_name);
+                return NULL;
+            }
+        }
+        return qmi_message_new (service, client_id, transaction_id, message_id);
+    }
+
+    /* Compute the size of all the TLVs to add, so that the message buffer is
+     * allocated just once */
+    for (i = 0; i < bundle->n_tlvs; i++) {
+        const QmiCodecTlv *tlv = &bundle->tlvs[i];
+
+        if (G_STRUCT_MEMBER (gboolean, input, tlv->set_offset))
+            tlvs_size += 3 + ops_size (&bundle->ops[tlv->first_op], tlv->n_ops, input);
+    }
+
+    self = qmi_message_new_with_capacity (service, client_id, transaction_id, message_id, tlvs_size);
+    expected_length = qmi_message_get_length (self) + tlvs_size;
+
+    for (i = 0; i < bundle->n_tlvs; i++) {
+        const QmiCodecTlv *tlv = &bundle->tlvs[i];
+        gsize tlv_offset;
+
+        if (!G_STRUCT_MEMBER (gboolean, input, tlv->set_offset)) {
+            if (!(tlv->flags & QMI_CODEC_TLV_FLAG_MANDATORY))
+                continue;
+            g_set_error (error,
+                         QMI_CORE_ERROR,
+                         QMI_CORE_ERROR_INVALID_ARGS,
+                         "Missing mandatory TLV '%s' in message '%s'",
+                         tlv->name, bundle->message_name);
+            goto error_out;
+        }
+
+        if (!(tlv_offset = qmi_message_tlv_write_init (self, tlv->id, error))) {
+            g_prefix_error (error, "Cannot initialize TLV '%s': ", tlv->name);
+            goto error_out;
+        }
+
+        if (!encode_ops (self, &bundle->ops[tlv->first_op], tlv->n_ops, input, error)) {
+            g_prefix_error (error, "Cannot write TLV '%s': ", tlv->name);
+            goto error_out;
+        }
+
+        if (!qmi_message_tlv_write_complete (self, tlv_offset, error)) {
+            g_prefix_error (error, "Cannot complete TLV '%s': ", tlv->name);
+            goto error_out;
+        }
+    }
+
+    /* The size computed above must match the TLVs actually written */
+    g_warn_if_fail (qmi_message_get_length (self) == expected_length);
+
+    return self;
+
+error_out:
+    qmi_message_unref (self);
+    return NULL;
+}
@@ -0,0 +1,157 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_CODEC_H_
+#define _LIBQMI_GLIB_QMI_CODEC_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+#include "qmi-message.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Table-driven encoding and decoding of input and output bundles, used by the
+ * code generated with 'qmi-codegen --backend=tables'.
+ *
+ * The value of each TLV is described by a flat list of ops, each one reading
+ * or writing a single integer, string or array stored at a given offset of
+ * the bundle struct. Struct and sequence members are just consecutive ops.
+ * Array ops are followed by the ops describing each array element, with
+ * offsets relative to the start of the element.
+ */
+
+typedef enum {
+    QMI_CODEC_TYPE_GUINT8,
+    QMI_CODEC_TYPE_GINT8,
+    QMI_CODEC_TYPE_GUINT16,
+    QMI_CODEC_TYPE_GINT16,
+    QMI_CODEC_TYPE_GUINT32,
+    QMI_CODEC_TYPE_GINT32,
+    QMI_CODEC_TYPE_GUINT64,
+    QMI_CODEC_TYPE_GINT64,
+    QMI_CODEC_TYPE_SIZED_GUINT,
+    QMI_CODEC_TYPE_GFLOAT,
+    QMI_CODEC_TYPE_GDOUBLE,
+    /* Variable-length string, in its own heap allocation */
+    QMI_CODEC_TYPE_STRING,
+    /* Variable-length string, in a char array within the struct */
+    QMI_CODEC_TYPE_STRING_INLINE,
+    /* Variable-length string, in the arena of the output bundle */
+    QMI_CODEC_TYPE_STRING_ARENA,
+    /* Fixed-size string, in a char array within the struct */
+    QMI_CODEC_TYPE_FIXED_STRING,
+    /* Fixed-size string, in its own heap allocation */
+    QMI_CODEC_TYPE_FIXED_STRING_HEAP,
+    QMI_CODEC_TYPE_ARRAY,
+} QmiCodecType;
+
+typedef struct {
+    guint8         type;            /* QmiCodecType */
+    guint8         endian;          /* QmiEndian */
+    guint8         length;          /* Size prefix bytes of strings and arrays, bytes of sized integers */
+    guint8         sequence_length; /* Sequence prefix bytes of arrays */
+    guint16        offset;          /* Where the value is stored */
+    guint16        size;            /* Storage size of integers and array elements, max or fixed size of strings */
+    guint16        n_items;         /* Number of items of fixed-size arrays */
+    guint16        n_ops;           /* Number of ops describing each array element */
+    guint16        sequence_offset; /* Where the array sequence is stored */
+    GDestroyNotify clear_func;      /* Array element clear function */
+} QmiCodecOp;
+
+#define QMI_CODEC_INTEGER(type, endian, offset, size) \
+    { type, endian, 0, 0, offset, size, 0, 0, 0, NULL }
+#define QMI_CODEC_SIZED_GUINT(endian, length, offset) \
+    { QMI_CODEC_TYPE_SIZED_GUINT, endian, length, 0, offset, sizeof (guint64), 0, 0, 0, NULL }
+#define QMI_CODEC_STRING(type, length, max_size, offset) \
+    { type, 0, length, 0, offset, max_size, 0, 0, 0, NULL }
+#define QMI_CODEC_FIXED_STRING(type, fixed_size, offset) \
+    { type, 0, 0, 0, offset, fixed_size, 0, 0, 0, NULL }
+#define QMI_CODEC_ARRAY(length, sequence_length, sequence_offset, offset, element_size, clear_func, n_ops) \
+    { QMI_CODEC_TYPE_ARRAY, 0, length, sequence_length, offset, element_size, 0, n_ops, sequence_offset, clear_func }
+#define QMI_CODEC_FIXED_ARRAY(n_items, offset, element_size, clear_func, n_ops) \
+    { QMI_CODEC_TYPE_ARRAY, 0, 0, 0, offset, element_size, n_items, n_ops, 0, clear_func }
+
+/* Field must be equal (or not) to the given value for the TLV to be read */
+typedef struct {
+    guint16 offset;
+    guint8  size;
+    guint8  equal;
+    guint64 value;
+} QmiCodecPrerequisite;
+
+typedef enum {
+    QMI_CODEC_TLV_FLAG_NONE      = 0,
+    QMI_CODEC_TLV_FLAG_MANDATORY = 1 << 0,
+    /* Not read along with the whole bundle, but on first access */
+    QMI_CODEC_TLV_FLAG_LAZY      = 1 << 1,
+} QmiCodecTlvFlags;
+
+typedef struct {
+    guint8       id;
+    guint8       flags;              /* QmiCodecTlvFlags */
+    guint16      set_offset;         /* Where the gboolean flagging the TLV as set is stored */
+    guint16      first_op;
+    guint16      n_ops;
+    guint16      first_prerequisite;
+    guint16      n_prerequisites;
+    const gchar *name;
+} QmiCodecTlv;
+
+typedef struct {
+    const gchar                *message_name;
+    const QmiCodecTlv          *tlvs;
+    guint                       n_tlvs;
+    const QmiCodecOp           *ops;
+    const QmiCodecPrerequisite *prerequisites;
+    /* Output bundles with strings in an arena hold its 'gchar *arena',
+     * 'gsize arena_size' and 'gsize arena_used' at this offset, 0 if none */
+    guint16                     arena_offset;
+} QmiCodecBundle;
+
+G_GNUC_INTERNAL
+gboolean    __qmi_codec_decode     (const QmiCodecBundle  *bundle,
+                                    QmiMessage            *message,
+                                    gpointer               output,
+                                    GError               **error);
+G_GNUC_INTERNAL
+gboolean    __qmi_codec_decode_tlv (const QmiCodecBundle  *bundle,
+                                    guint                  tlv_index,
+                                    QmiMessage            *message,
+                                    gpointer               output,
+                                    GError               **error);
+G_GNUC_INTERNAL
+QmiMessage *__qmi_codec_encode     (const QmiCodecBundle  *bundle,
+                                    QmiService             service,
+                                    guint8                 client_id,
+                                    guint16                transaction_id,
+                                    guint16                message_id,
+                                    gconstpointer          input,
+                                    GError               **error);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_CODEC_H_ */
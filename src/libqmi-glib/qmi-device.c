@@ -33,6 +33,8 @@
 #include <gio/gunixinputstream.h>
 #include <gio/gunixoutputstream.h>
 #include <gio/gunixsocketaddress.h>
+#include <gio/gunixfdmessage.h>
+#include <glib-unix.h>
 
 #if defined MBIM_QMUX_ENABLED
 #include <libmbim-glib.h>
@@ -40,6 +42,7 @@
 
 #include "qmi-device.h"
 #include "qmi-message.h"
+#include "qmi-capture.h"
 #include "qmi-ctl.h"
 #include "qmi-dms.h"
 #include "qmi-wds.h"
@@ -56,6 +59,8 @@
 #include "qmi-qos.h"
 #include "qmi-utils.h"
 #include "qmi-error-types.h"
+#include "qmi-transaction-table.h"
+#include "qmi-shm-ring.h"
 #include "qmi-enum-types.h"
 #include "qmi-proxy.h"
 
@@ -72,6 +77,11 @@ enum {
     PROP_NO_FILE_CHECK,
     PROP_PROXY_PATH,
     PROP_WWAN_IFACE,
+    PROP_READ_BUDGET,
+    PROP_OUTPUT_HIGH_WATER,
+    PROP_OUTPUT_BLOCKED,
+    PROP_CAPTURE,
+    PROP_PROXY_RING_SIZE,
     PROP_LAST
 };
 
@@ -84,6 +94,31 @@ enum {
 static GParamSpec *properties[PROP_LAST];
 static guint       signals   [SIGNAL_LAST] = { 0 };
 
+/* Transaction timeouts are tracked in a hashed timer wheel with one slot per
+ * second, driven by a single source which only exists while there are
+ * transactions waiting to time out. */
+#define TIMER_WHEEL_SLOTS 64
+
+typedef struct _Transaction Transaction;
+
+typedef struct {
+    GSource     *source;
+    gint64       tick;
+    guint        n_transactions;
+    Transaction *slots[TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+/* Requests of a given service sent to the device and waiting for a
+ * response are limited by an optional send window; requests exceeding it
+ * are queued until one of the in-flight ones completes. */
+typedef struct {
+    guint    max_in_flight; /* 0 if unlimited */
+    guint    n_in_flight;
+    GQueue   queue;
+    guint    max_queued;
+    gboolean releasing;
+} SendWindow;
+
 struct _QmiDevicePrivate {
     /* File */
     GFile *file;
@@ -114,39 +149,266 @@ struct _QmiDevicePrivate {
     GOutputStream *ostream;
     GSource *input_source;
     GByteArray *buffer;
+    guint buffer_offset;
+    guint read_budget;
+
+    /* Output queue, written whenever the stream is writable */
+    GSource *output_source;
+    GByteArray *output_buffer;
+    guint output_offset;
+    GArray *output_frames;
+    guint output_high_water;
+    gboolean output_blocked;
 
     /* Support for qmi-proxy */
     GSocketClient *socket_client;
     GSocketConnection *socket_connection;
 
-    /* HT to keep track of ongoing transactions */
-    GHashTable *transactions;
+    /* Shared memory ring with the messages from qmi-proxy, if any */
+    guint proxy_ring_size;
+    gboolean ring_negotiating;
+    GUnixFDList *ring_fds;
+    QmiShmRing *ring;
+    GSource *ring_source;
+
+    /* Table to keep track of ongoing transactions */
+    QmiTransactionTable *transactions;
+
+    /* Timer wheel driving all transaction timeouts */
+    TimerWheel timer_wheel;
+
+    /* Pool of unused transaction records */
+    Transaction *transaction_pool;
+    guint transaction_pool_size;
+
+    /* Per-service send windows */
+    SendWindow *send_windows[G_MAXUINT8 + 1];
 
     /* HT of clients that want to get indications */
     GHashTable *registered_clients;
+
+    /* Registered clients indexed by service, for broadcast indications */
+    GPtrArray *service_clients[G_MAXUINT8 + 1];
+    guint64 n_broadcast_indications;
+    guint64 n_broadcast_deliveries;
+
+    /* Indications pending to be reported to clients, all of them
+     * processed in a single dispatch of the indication source */
+    GArray *pending_indications;
+    GSource *indication_source;
+
+    /* Scratch buffer reused by every message trace */
+    GString *trace_buffer;
+
+    /* Binary capture of the traffic, if any */
+    QmiCapture *capture;
 };
 
 #define BUFFER_SIZE 2048
-
-static void destroy_iostream (QmiDevice *self);
+#define DEFAULT_READ_BUDGET (16 * BUFFER_SIZE)
+#define DEFAULT_OUTPUT_HIGH_WATER (16 * BUFFER_SIZE)
+
+static void     destroy_iostream        (QmiDevice *self);
+static gboolean device_send_transaction (QmiDevice    *self,
+                                         Transaction  *tr,
+                                         GError      **error);
+static void     transaction_early_error (QmiDevice   *self,
+                                         Transaction *tr,
+                                         gboolean     stored,
+                                         GError      *error);
 
 /*****************************************************************************/
 /* Message transactions (private) */
 
-typedef struct {
-    QmiDevice *self;
-    gpointer key;
-} TransactionWaitContext;
+/* Maximum number of unused transaction records kept around for reuse */
+#define TRANSACTION_POOL_MAX 32
 
-typedef struct {
+struct _Transaction {
+    QmiDevice              *self;
+    guint32                 key; /* valid as long as the transaction is in the table */
     QmiMessage             *message;
     QmiMessageContext      *message_context;
-    GSimpleAsyncResult     *result;
-    GSource                *timeout_source;
+    GTask                  *task;
+    guint                   timeout;
     GCancellable           *cancellable;
     gulong                  cancellable_id;
-    TransactionWaitContext *wait_ctx;
-} Transaction;
+
+    /* Send window state */
+    gboolean                in_flight;
+    gboolean                queued;
+    GList                   queue_link;
+
+    /* Timer wheel node, also used to link unused records in the pool */
+    TimerWheel             *wheel;
+    gint64                  expiration_tick;
+    Transaction            *wheel_prev;
+    Transaction            *wheel_next;
+};
+
+static inline gint64
+timer_wheel_get_now_tick (void)
+{
+    return g_get_monotonic_time () / G_USEC_PER_SEC;
+}
+
+static void
+timer_wheel_unlink (TimerWheel  *wheel,
+                    Transaction *tr)
+{
+    if (tr->wheel_prev)
+        tr->wheel_prev->wheel_next = tr->wheel_next;
+    else
+        wheel->slots[tr->expiration_tick % TIMER_WHEEL_SLOTS] = tr->wheel_next;
+    if (tr->wheel_next)
+        tr->wheel_next->wheel_prev = tr->wheel_prev;
+
+    tr->wheel = NULL;
+    tr->wheel_prev = NULL;
+    tr->wheel_next = NULL;
+
+    g_assert (wheel->n_transactions > 0);
+    wheel->n_transactions--;
+}
+
+static void
+timer_wheel_remove (Transaction *tr)
+{
+    TimerWheel *wheel;
+
+    wheel = tr->wheel;
+    if (!wheel)
+        return;
+
+    timer_wheel_unlink (wheel, tr);
+
+    /* Don't keep waking up if there's nothing else to time out */
+    if (!wheel->n_transactions && wheel->source) {
+        g_source_destroy (wheel->source);
+        g_clear_pointer (&wheel->source, g_source_unref);
+    }
+}
+
+static SendWindow *
+send_window_get (QmiDevice  *self,
+                 QmiService  service)
+{
+    SendWindow **window;
+
+    window = &self->priv->send_windows[(guint8) service];
+    if (G_UNLIKELY (!*window)) {
+        *window = g_slice_new0 (SendWindow);
+        g_queue_init (&(*window)->queue);
+    }
+    return *window;
+}
+
+/* Returns TRUE if the transaction can be sent right away, FALSE if it was
+ * queued */
+static gboolean
+send_window_acquire (QmiDevice   *self,
+                     Transaction *tr)
+{
+    SendWindow *window;
+
+    window = send_window_get (self, qmi_message_get_service (tr->message));
+    if (window->max_in_flight &&
+        (window->n_in_flight >= window->max_in_flight || window->queue.length > 0)) {
+        tr->queue_link.data = tr;
+        g_queue_push_tail_link (&window->queue, &tr->queue_link);
+        tr->queued = TRUE;
+        window->max_queued = MAX (window->max_queued, window->queue.length);
+        return FALSE;
+    }
+
+    window->n_in_flight++;
+    tr->in_flight = TRUE;
+    return TRUE;
+}
+
+static void
+send_window_done (QmiDevice   *self,
+                  Transaction *tr)
+{
+    SendWindow *window;
+
+    if (!tr->in_flight && !tr->queued)
+        return;
+
+    window = send_window_get (self, qmi_message_get_service (tr->message));
+    if (tr->in_flight) {
+        g_assert (window->n_in_flight > 0);
+        window->n_in_flight--;
+        tr->in_flight = FALSE;
+    } else {
+        g_queue_unlink (&window->queue, &tr->queue_link);
+        tr->queued = FALSE;
+    }
+}
+
+static void
+send_window_release (QmiDevice  *self,
+                     QmiService  service)
+{
+    SendWindow *window;
+
+    window = self->priv->send_windows[(guint8) service];
+
+    /* Sending queued requests may end up completing other transactions,
+     * which will also try to release queued requests */
+    if (!window || window->releasing || !window->queue.length)
+        return;
+
+    g_object_ref (self);
+    window->releasing = TRUE;
+    while (window->queue.length > 0 &&
+           (!window->max_in_flight || window->n_in_flight < window->max_in_flight)) {
+        Transaction *tr;
+        GError *error = NULL;
+
+        tr = g_queue_pop_head_link (&window->queue)->data;
+        tr->queued = FALSE;
+        tr->in_flight = TRUE;
+        window->n_in_flight++;
+
+        if (!device_send_transaction (self, tr, &error))
+            transaction_early_error (self, tr, TRUE, error);
+    }
+    window->releasing = FALSE;
+    g_object_unref (self);
+}
+
+void
+qmi_device_set_send_window (QmiDevice  *self,
+                            QmiService  service,
+                            guint       max_in_flight)
+{
+    g_return_if_fail (QMI_IS_DEVICE (self));
+
+    send_window_get (self, service)->max_in_flight = max_in_flight;
+
+    /* The window may have been enlarged */
+    send_window_release (self, service);
+}
+
+void
+qmi_device_get_send_window_stats (QmiDevice  *self,
+                                  QmiService  service,
+                                  guint      *n_in_flight,
+                                  guint      *n_queued,
+                                  guint      *max_queued)
+{
+    SendWindow *window;
+
+    g_return_if_fail (QMI_IS_DEVICE (self));
+
+    window = self->priv->send_windows[(guint8) service];
+    if (n_in_flight)
+        *n_in_flight = window ? window->n_in_flight : 0;
+    if (n_queued)
+        *n_queued = window ? window->queue.length : 0;
+    if (max_queued)
+        *max_queued = window ? window->max_queued : 0;
+}
 
 static Transaction *
 transaction_new (QmiDevice           *self,
@@ -158,13 +420,20 @@ transaction_new (QmiDevice           *self,
 {
     Transaction *tr;
 
-    tr = g_slice_new0 (Transaction);
+    if (self->priv->transaction_pool) {
+        tr = self->priv->transaction_pool;
+        self->priv->transaction_pool = tr->wheel_next;
+        self->priv->transaction_pool_size--;
+        memset (tr, 0, sizeof (Transaction));
+    } else
+        tr = g_slice_new0 (Transaction);
+
+    tr->self = self;
     tr->message = qmi_message_ref (message);
     tr->message_context = (message_context ? qmi_message_context_ref (message_context) : NULL);
-    tr->result = g_simple_async_result_new (G_OBJECT (self),
-                                            callback,
-                                            user_data,
-                                            transaction_new);
+    /* The cancellable is not given to the task, as we want to report our own
+     * error when the transaction is cancelled */
+    tr->task = g_task_new (self, NULL, callback, user_data);
     if (cancellable)
         tr->cancellable = g_object_ref (cancellable);
 
@@ -176,10 +445,17 @@ transaction_complete_and_free (Transaction *tr,
                                QmiMessage *reply,
                                const GError *error)
 {
+    QmiDevice *self;
+    GTask *task;
+    QmiService service;
+
     g_assert (reply != NULL || error != NULL);
 
-    if (tr->timeout_source)
-        g_source_destroy (tr->timeout_source);
+    self = tr->self;
+    service = qmi_message_get_service (tr->message);
+
+    timer_wheel_remove (tr);
+    send_window_done (self, tr);
 
     if (tr->cancellable) {
         if (tr->cancellable_id)
@@ -187,28 +463,35 @@ transaction_complete_and_free (Transaction *tr,
         g_object_unref (tr->cancellable);
     }
 
-    if (tr->wait_ctx)
-        g_slice_free (TransactionWaitContext, tr->wait_ctx);
-
-    if (reply)
-        g_simple_async_result_set_op_res_gpointer (tr->result,
-                                                   qmi_message_ref (reply),
-                                                   (GDestroyNotify)qmi_message_unref);
-    else
-        g_simple_async_result_set_from_error (tr->result, error);
-
-    g_simple_async_result_complete_in_idle (tr->result);
-    g_object_unref (tr->result);
     if (tr->message_context)
         qmi_message_context_unref (tr->message_context);
     qmi_message_unref (tr->message);
-    g_slice_free (Transaction, tr);
+
+    /* Recycle the record before completing the task, as the task may hold
+     * the last reference to the device */
+    task = tr->task;
+    if (self->priv->transaction_pool_size < TRANSACTION_POOL_MAX) {
+        tr->wheel_next = self->priv->transaction_pool;
+        self->priv->transaction_pool = tr;
+        self->priv->transaction_pool_size++;
+    } else
+        g_slice_free (Transaction, tr);
+
+    /* Keep the pipeline full */
+    send_window_release (self, service);
+
+    /* The task completes right away if we're already in a different main
+     * loop iteration than the one the request was sent in */
+    if (reply)
+        g_task_return_pointer (task, qmi_message_ref (reply), (GDestroyNotify)qmi_message_unref);
+    else
+        g_task_return_error (task, g_error_copy (error));
+    g_object_unref (task);
 }
 
-static inline gpointer
+static inline guint32
 build_transaction_key (QmiMessage *message)
 {
-    gpointer key;
     guint8 service;
     guint8 client_id;
     guint16 transaction_id;
@@ -217,61 +500,139 @@ build_transaction_key (QmiMessage *message)
     client_id = qmi_message_get_client_id (message);
     transaction_id = qmi_message_get_transaction_id (message);
 
-    /* We're putting a 32 bit value into a gpointer */
-    key = GUINT_TO_POINTER ((((service << 8) | client_id) << 16) | transaction_id);
-
-    return key;
+    return (((guint32)service << 24) | ((guint32)client_id << 16) | transaction_id);
 }
 
 static Transaction *
 device_release_transaction (QmiDevice *self,
-                            gconstpointer key)
+                            guint32    key)
 {
-    Transaction *tr = NULL;
-
-    if (self->priv->transactions) {
-        tr = g_hash_table_lookup (self->priv->transactions, key);
-        if (tr)
-            /* If found, remove it from the HT */
-            g_hash_table_remove (self->priv->transactions, key);
-    }
+    if (!self->priv->transactions)
+        return NULL;
 
-    return tr;
+    /* If found, it's also removed from the table */
+    return __qmi_transaction_table_take (self->priv->transactions, key);
 }
 
-static gboolean
-transaction_timed_out (TransactionWaitContext *ctx)
+static void
+transaction_timed_out (Transaction *tr)
 {
-    Transaction *tr;
     GError *error = NULL;
 
-    tr = device_release_transaction (ctx->self, ctx->key);
-    tr->timeout_source = NULL;
-
     /* Complete transaction with a timeout error */
     error = g_error_new (QMI_CORE_ERROR,
                          QMI_CORE_ERROR_TIMEOUT,
                          "Transaction timed out");
     transaction_complete_and_free (tr, NULL, error);
     g_error_free (error);
+}
 
-    return FALSE;
+static gboolean
+timer_wheel_tick_cb (QmiDevice *self)
+{
+    TimerWheel *wheel = &self->priv->timer_wheel;
+    Transaction *expired = NULL;
+    gboolean ret;
+    gint64 now_tick;
+    gint64 n_ticks;
+    gint64 i;
+
+    now_tick = timer_wheel_get_now_tick ();
+
+    /* Collect all expired transactions in the slots of all ticks elapsed
+     * since the last run (a full turn of the wheel at most) */
+    n_ticks = MIN (now_tick - wheel->tick, TIMER_WHEEL_SLOTS);
+    for (i = 1; i <= n_ticks; i++) {
+        Transaction *tr;
+        Transaction *next;
+
+        for (tr = wheel->slots[(wheel->tick + i) % TIMER_WHEEL_SLOTS]; tr; tr = next) {
+            Transaction *released G_GNUC_UNUSED; /* only checked in asserts */
+
+            next = tr->wheel_next;
+            if (tr->expiration_tick > now_tick)
+                continue;
+
+            /* Also remove from the tracking table right away, so that it's
+             * not found by anyone else before being completed */
+            timer_wheel_unlink (wheel, tr);
+            released = device_release_transaction (self, tr->key);
+            g_assert (released == tr);
+            tr->wheel_next = expired;
+            expired = tr;
+        }
+    }
+    wheel->tick = MAX (wheel->tick, now_tick);
+
+    /* Stop ticking if nothing else to time out. Decided before completing the
+     * expired transactions, as the completions may add new ones (attached to
+     * a new source) or remove the remaining ones (destroying this source) */
+    if (wheel->n_transactions)
+        ret = G_SOURCE_CONTINUE;
+    else {
+        g_clear_pointer (&wheel->source, g_source_unref);
+        ret = G_SOURCE_REMOVE;
+    }
+
+    /* Completing transactions may end up releasing the last reference to the
+     * device, so keep one until we're done */
+    g_object_ref (self);
+    while (expired) {
+        Transaction *tr;
+
+        tr = expired;
+        expired = tr->wheel_next;
+        tr->wheel_next = NULL;
+        transaction_timed_out (tr);
+    }
+    g_object_unref (self);
+
+    return ret;
+}
+
+static void
+timer_wheel_add (QmiDevice   *self,
+                 Transaction *tr,
+                 guint        timeout)
+{
+    TimerWheel *wheel = &self->priv->timer_wheel;
+    guint slot;
+
+    g_assert (!tr->wheel);
+
+    if (!wheel->source) {
+        wheel->tick = timer_wheel_get_now_tick ();
+        wheel->source = g_timeout_source_new_seconds (1);
+        g_source_set_callback (wheel->source, (GSourceFunc)timer_wheel_tick_cb, self, NULL);
+        g_source_attach (wheel->source, g_main_context_get_thread_default ());
+    }
+
+    /* Ticks are truncated to seconds, so add an additional one to make sure
+     * we never time out earlier than requested */
+    tr->wheel = wheel;
+    tr->expiration_tick = timer_wheel_get_now_tick () + timeout + 1;
+
+    slot = tr->expiration_tick % TIMER_WHEEL_SLOTS;
+    tr->wheel_prev = NULL;
+    tr->wheel_next = wheel->slots[slot];
+    if (tr->wheel_next)
+        tr->wheel_next->wheel_prev = tr;
+    wheel->slots[slot] = tr;
+    wheel->n_transactions++;
 }
 
 static void
 transaction_cancelled (GCancellable *cancellable,
-                       TransactionWaitContext *ctx)
+                       Transaction  *tr)
 {
-    Transaction *tr;
     GError *error = NULL;
 
-    tr = device_release_transaction (ctx->self, ctx->key);
-
     /* The transaction may have already been cancelled before we stored it in
      * the tracking table */
-    if (!tr)
+    if (__qmi_transaction_table_lookup (tr->self->priv->transactions, tr->key) != tr)
         return;
 
+    device_release_transaction (tr->self, tr->key);
     tr->cancellable_id = 0;
 
     /* Complete transaction with an abort error */
@@ -288,31 +649,24 @@ device_store_transaction (QmiDevice *self,
                           guint timeout,
                           GError **error)
 {
-    gpointer     key;
+    guint32      key;
     Transaction *existing;
 
     key = build_transaction_key (tr->message);
+    tr->key = key;
 
     /* Setup the timeout and cancellation */
 
-    tr->wait_ctx = g_slice_new (TransactionWaitContext);
-    tr->wait_ctx->self = self;
-    tr->wait_ctx->key = key; /* valid as long as the transaction is in the HT */
-
     /* Timeout is optional (e.g. disabled when MBIM is used) */
-    if (timeout > 0) {
-        tr->timeout_source = g_timeout_source_new_seconds (timeout);
-        g_source_set_callback (tr->timeout_source, (GSourceFunc)transaction_timed_out, tr->wait_ctx, NULL);
-        g_source_attach (tr->timeout_source, g_main_context_get_thread_default ());
-        g_source_unref (tr->timeout_source);
-    }
+    if (timeout > 0)
+        timer_wheel_add (self, tr, timeout);
 
     if (tr->cancellable) {
         /* Note: transaction_cancelled() will also be called directly if the
          * cancellable is already cancelled */
         tr->cancellable_id = g_cancellable_connect (tr->cancellable,
                                                     (GCallback)transaction_cancelled,
-                                                    tr->wait_ctx,
+                                                    tr,
                                                     NULL);
         if (!tr->cancellable_id) {
             g_set_error (error,
@@ -339,8 +693,8 @@ device_store_transaction (QmiDevice *self,
         g_error_free (inner_error);
     }
 
-    /* Keep in the HT */
-    g_hash_table_insert (self->priv->transactions, key, tr);
+    /* Keep in the table */
+    __qmi_transaction_table_insert (self->priv->transactions, key, tr);
 
     return TRUE;
 }
@@ -665,6 +1019,21 @@ qmi_device_get_wwan_iface (QmiDevice *self)
     return self->priv->wwan_iface;
 }
 
+/*****************************************************************************/
+
+void
+qmi_device_get_broadcast_stats (QmiDevice *self,
+                                guint64   *n_indications,
+                                guint64   *n_deliveries)
+{
+    g_return_if_fail (QMI_IS_DEVICE (self));
+
+    if (n_indications)
+        *n_indications = self->priv->n_broadcast_indications;
+    if (n_deliveries)
+        *n_deliveries = self->priv->n_broadcast_deliveries;
+}
+
 /*****************************************************************************/
 /* Expected data format */
 
@@ -827,6 +1196,32 @@ build_registered_client_key (guint8 cid,
     return GUINT_TO_POINTER (((guint8)service << 8) | cid);
 }
 
+/* The per-service index doesn't hold additional references, the clients
+ * are owned by the registered clients HT */
+
+static void
+service_clients_add (QmiDevice *self,
+                     QmiClient *client)
+{
+    guint8 service;
+
+    service = (guint8) qmi_client_get_service (client);
+    if (!self->priv->service_clients[service])
+        self->priv->service_clients[service] = g_ptr_array_sized_new (4);
+    g_ptr_array_add (self->priv->service_clients[service], client);
+}
+
+static void
+service_clients_remove (QmiDevice *self,
+                        QmiClient *client)
+{
+    guint8 service;
+
+    service = (guint8) qmi_client_get_service (client);
+    if (self->priv->service_clients[service])
+        g_ptr_array_remove_fast (self->priv->service_clients[service], client);
+}
+
 static gboolean
 register_client (QmiDevice *self,
                  QmiClient *client,
@@ -851,6 +1246,7 @@ register_client (QmiDevice *self,
     g_hash_table_insert (self->priv->registered_clients,
                          key,
                          g_object_ref (client));
+    service_clients_add (self, client);
     return TRUE;
 }
 
@@ -858,9 +1254,17 @@ static void
 unregister_client (QmiDevice *self,
                    QmiClient *client)
 {
-    g_hash_table_remove (self->priv->registered_clients,
-                         build_registered_client_key (qmi_client_get_cid (client),
-                                                      qmi_client_get_service (client)));
+    gpointer key;
+    QmiClient *registered;
+
+    key = build_registered_client_key (qmi_client_get_cid (client),
+                                       qmi_client_get_service (client));
+    registered = g_hash_table_lookup (self->priv->registered_clients, key);
+    if (!registered)
+        return;
+
+    service_clients_remove (self, registered);
+    g_hash_table_remove (self->priv->registered_clients, key);
 }
 
 /*****************************************************************************/
@@ -1345,38 +1749,101 @@ qmi_device_set_instance_id (QmiDevice *self,
 typedef struct {
     QmiClient *client;
     QmiMessage *message;
-} IdleIndicationContext;
+} PendingIndication;
+
+static void
+pending_indication_clear (PendingIndication *pending)
+{
+    g_object_unref (pending->client);
+    qmi_message_unref (pending->message);
+}
 
 static gboolean
-process_indication_idle (IdleIndicationContext *ctx)
+indication_source_dispatch (GSource     *source,
+                            GSourceFunc  callback,
+                            gpointer     user_data)
 {
-    g_assert (ctx->client != NULL);
-    g_assert (ctx->message != NULL);
+    /* Sleep until a new indication is queued */
+    g_source_set_ready_time (source, -1);
+    return callback (user_data);
+}
 
-    __qmi_client_process_indication (ctx->client, ctx->message);
+static GSourceFuncs indication_source_funcs = {
+    NULL, /* prepare */
+    NULL, /* check */
+    indication_source_dispatch,
+    NULL  /* finalize */
+};
 
-    g_object_unref (ctx->client);
-    qmi_message_unref (ctx->message);
-    g_slice_free (IdleIndicationContext, ctx);
-    return FALSE;
+static gboolean
+process_pending_indications (QmiDevice *self)
+{
+    guint i;
+
+    /* Processing the indications may end up releasing the last reference
+     * to the device */
+    g_object_ref (self);
+
+    /* Indications queued while processing are also handled in this same
+     * loop, as the array length is checked in every iteration */
+    for (i = 0; self->priv->pending_indications && i < self->priv->pending_indications->len; i++) {
+        PendingIndication pending;
+
+        pending = g_array_index (self->priv->pending_indications, PendingIndication, i);
+        __qmi_client_process_indication (pending.client, pending.message);
+    }
+
+    if (self->priv->pending_indications)
+        g_array_set_size (self->priv->pending_indications, 0);
+
+    g_object_unref (self);
+    return G_SOURCE_CONTINUE;
 }
 
 static void
-report_indication (QmiClient *client,
+report_indication (QmiDevice *self,
+                   QmiClient *client,
                    QmiMessage *message)
 {
-    IdleIndicationContext *ctx;
-    GSource *source;
+    PendingIndication pending;
+
+    /* Device already disposed */
+    if (G_UNLIKELY (!self->priv->pending_indications))
+        return;
+
+    /* Setup the single source used to pass the indications down to the
+     * clients the first time it's needed */
+    if (G_UNLIKELY (!self->priv->indication_source)) {
+        self->priv->indication_source = g_source_new (&indication_source_funcs, sizeof (GSource));
+        g_source_set_callback (self->priv->indication_source,
+                               (GSourceFunc)process_pending_indications,
+                               self,
+                               NULL);
+        g_source_attach (self->priv->indication_source, g_main_context_get_thread_default ());
+    }
+
+    pending.client = g_object_ref (client);
+    pending.message = qmi_message_ref (message);
+    g_array_append_val (self->priv->pending_indications, pending);
+
+    /* Wake up the source if this is the first one pending */
+    if (self->priv->pending_indications->len == 1)
+        g_source_set_ready_time (self->priv->indication_source, 0);
+}
 
-    /* Setup an idle to Pass the indication down to the client */
-    ctx = g_slice_new (IdleIndicationContext);
-    ctx->client = g_object_ref (client);
-    ctx->message = qmi_message_ref (message);
+static void
+capture_message (QmiDevice         *self,
+                 QmiMessage        *message,
+                 gboolean           sent_or_received,
+                 QmiMessageContext *message_context)
+{
+    if (!self->priv->capture)
+        return;
 
-    source = g_idle_source_new ();
-    g_source_set_callback (source, (GSourceFunc)process_indication_idle, ctx, NULL);
-    g_source_attach (source, g_main_context_get_thread_default ());
-    g_source_unref (source);
+    qmi_capture_add_message (self->priv->capture,
+                             sent_or_received ? QMI_CAPTURE_DIRECTION_SENT : QMI_CAPTURE_DIRECTION_RECEIVED,
+                             message,
+                             message_context);
 }
 
 static void
@@ -1386,14 +1853,24 @@ trace_message (QmiDevice         *self,
                const gchar       *message_str,
                QmiMessageContext *message_context)
 {
-    gchar       *printable;
+    GString     *printable;
     const gchar *prefix_str;
     const gchar *action_str;
     gchar       *vendor_str = NULL;
 
+    /* The binary capture is independent of the text traces */
+    capture_message (self, message, sent_or_received, message_context);
+
     if (!qmi_utils_get_traces_enabled ())
         return;
 
+    /* Both the raw and the translated representations are built in the same
+     * buffer, which is kept around so that its allocation is reused by every
+     * message traced on this device. */
+    if (!self->priv->trace_buffer)
+        self->priv->trace_buffer = g_string_sized_new (BUFFER_SIZE);
+    printable = self->priv->trace_buffer;
+
     if (sent_or_received) {
         prefix_str = "<<<<<< ";
         action_str = "sent";
@@ -1402,9 +1879,11 @@ trace_message (QmiDevice         *self,
         action_str = "received";
     }
 
-    printable = __qmi_utils_str_hex (((GByteArray *)message)->data,
-                                     ((GByteArray *)message)->len,
-                                     ':');
+    g_string_truncate (printable, 0);
+    __qmi_utils_str_hex_append (printable,
+                                ((GByteArray *)message)->data,
+                                ((GByteArray *)message)->len,
+                                ':');
     g_debug ("[%s] %s message...\n"
              "%sRAW:\n"
              "%s  length = %u\n"
@@ -1412,8 +1891,7 @@ trace_message (QmiDevice         *self,
              self->priv->path_display, action_str,
              prefix_str,
              prefix_str, ((GByteArray *)message)->len,
-             prefix_str, printable);
-    g_free (printable);
+             prefix_str, printable->str);
 
     if (message_context) {
         guint16 vendor_id;
@@ -1423,14 +1901,14 @@ trace_message (QmiDevice         *self,
             vendor_str = g_strdup_printf ("vendor-specific (0x%04x)", vendor_id);
     }
 
-    printable = qmi_message_get_printable_full (message, message_context, prefix_str);
+    g_string_truncate (printable, 0);
+    __qmi_message_append_printable_full (message, message_context, prefix_str, printable);
     g_debug ("[%s] %s %s %s (translated)...\n%s",
              self->priv->path_display,
              action_str,
              vendor_str ? vendor_str : "generic",
              message_str,
-             printable);
-    g_free (printable);
+             printable->str);
 
     g_free (vendor_str);
 }
@@ -1447,15 +1925,19 @@ process_message (QmiDevice *self,
         g_signal_emit (self, signals[SIGNAL_INDICATION], 0, message);
 
         if (qmi_message_get_client_id (message) == QMI_CID_BROADCAST) {
-            GHashTableIter iter;
-            gpointer key;
-            QmiClient *client;
+            GPtrArray *clients;
+
+            self->priv->n_broadcast_indications++;
 
-            g_hash_table_iter_init (&iter, self->priv->registered_clients);
-            while (g_hash_table_iter_next (&iter, &key, (gpointer *)&client)) {
-                /* For broadcast messages, report them just if the service matches */
-                if (qmi_message_get_service (message) == qmi_client_get_service (client))
-                    report_indication (client, message);
+            /* For broadcast messages, report them just to the clients of the
+             * same service */
+            clients = self->priv->service_clients[(guint8) qmi_message_get_service (message)];
+            if (clients) {
+                guint i;
+
+                for (i = 0; i < clients->len; i++)
+                    report_indication (self, g_ptr_array_index (clients, i), message);
+                self->priv->n_broadcast_deliveries += clients->len;
             }
         } else {
             QmiClient *client;
@@ -1464,7 +1946,7 @@ process_message (QmiDevice *self,
                                           build_registered_client_key (qmi_message_get_client_id (message),
                                                                        qmi_message_get_service (message)));
             if (client)
-                report_indication (client, message);
+                report_indication (self, client, message);
         }
 
         return;
@@ -1495,30 +1977,96 @@ process_message (QmiDevice *self,
              self->priv->path_display);
 }
 
+/* The input buffer is used as a plain FIFO: new data is always read directly
+ * into its tail, and complete messages are framed in place from the read
+ * offset, so parsing N messages doesn't require moving the remaining data N
+ * times. Only the trailing partial message (if any) is moved back to the
+ * start of the buffer once all complete messages have been processed. */
+
+static guint8 *
+input_buffer_reserve (QmiDevice *self,
+                      guint      size)
+{
+    guint len;
+
+    if (G_UNLIKELY (!self->priv->buffer))
+        self->priv->buffer = g_byte_array_sized_new (MAX (size, BUFFER_SIZE));
+
+    len = self->priv->buffer->len;
+    g_byte_array_set_size (self->priv->buffer, len + size);
+    return &self->priv->buffer->data[len];
+}
+
+static void
+input_buffer_release (QmiDevice *self,
+                      guint      size)
+{
+    g_assert (self->priv->buffer);
+    g_assert (self->priv->buffer->len >= self->priv->buffer_offset + size);
+    g_byte_array_set_size (self->priv->buffer, self->priv->buffer->len - size);
+}
+
+static void
+input_buffer_append (QmiDevice    *self,
+                     const guint8 *data,
+                     guint         len)
+{
+    memcpy (input_buffer_reserve (self, len), data, len);
+}
+
+static void
+input_buffer_compact (QmiDevice *self)
+{
+    guint pending;
+
+    if (!self->priv->buffer || !self->priv->buffer_offset)
+        return;
+
+    pending = self->priv->buffer->len - self->priv->buffer_offset;
+    if (pending > 0)
+        memmove (self->priv->buffer->data,
+                 &self->priv->buffer->data[self->priv->buffer_offset],
+                 pending);
+    g_byte_array_set_size (self->priv->buffer, pending);
+    self->priv->buffer_offset = 0;
+}
+
 static void
 parse_response (QmiDevice *self)
 {
-    do {
+    /* Completing transactions may end up releasing the last reference to the
+     * device */
+    g_object_ref (self);
+
+    /* The buffer may be gone if the device got closed while processing
+     * one of the messages */
+    while (self->priv->buffer &&
+           self->priv->buffer_offset < self->priv->buffer->len) {
         GError *error = NULL;
         QmiMessage *message;
+        const guint8 *data;
+        gsize data_len;
+        gsize consumed = 0;
+
+        data = &self->priv->buffer->data[self->priv->buffer_offset];
+        data_len = self->priv->buffer->len - self->priv->buffer_offset;
 
         /* Every message received must start with the QMUX marker.
          * If it doesn't, we broke framing :-/
          * If we broke framing, an error should be reported and the device
          * should get closed */
-        if (self->priv->buffer->len > 0 &&
-            self->priv->buffer->data[0] != QMI_MESSAGE_QMUX_MARKER) {
+        if (data[0] != QMI_MESSAGE_QMUX_MARKER) {
             /* TODO: Report fatal error */
             g_warning ("[%s] QMI framing error detected",
                        self->priv->path_display);
-            return;
+            break;
         }
 
-        message = qmi_message_new_from_raw (self->priv->buffer, &error);
+        message = qmi_message_new_from_raw_buffer (data, data_len, &consumed, &error);
         if (!message) {
             if (!error)
                 /* More data we need */
-                return;
+                break;
 
             /* Warn about the issue */
             g_warning ("[%s] Invalid QMI message received: '%s'",
@@ -1528,62 +2076,281 @@ parse_response (QmiDevice *self)
 
             if (qmi_utils_get_traces_enabled ()) {
                 gchar *printable;
-                guint len = MIN (self->priv->buffer->len, 2048);
+                guint len = MIN (data_len, 2048);
 
-                printable = __qmi_utils_str_hex (self->priv->buffer->data, len, ':');
+                printable = __qmi_utils_str_hex (data, len, ':');
                 g_debug ("<<<<<< RAW INVALID MESSAGE:\n"
-                         "<<<<<<   length = %u\n"
+                         "<<<<<<   length = %" G_GSIZE_FORMAT "\n"
                          "<<<<<<   data   = %s\n",
-                         self->priv->buffer->len, /* show full buffer len */
+                         data_len, /* show full buffer len */
                          printable);
                 g_free (printable);
             }
 
+            /* Skip the invalid message */
+            self->priv->buffer_offset += consumed;
         } else {
+            /* Skip the message before processing it, as processing may
+             * end up modifying the buffer */
+            self->priv->buffer_offset += consumed;
+
             /* Play with the received message */
             process_message (self, message);
             qmi_message_unref (message);
         }
-    } while (self->priv->buffer->len > 0);
+    }
+
+    input_buffer_compact (self);
+    g_object_unref (self);
+}
+
+/*****************************************************************************/
+/* Shared memory ring with qmi-proxy
+ *
+ * When requested, the proxy passes a memfd and an eventfd along with the
+ * response to the open request, and from then on sends all messages through
+ * the ring, until one doesn't fit and it falls back to the socket. The ring
+ * is always drained before reading from the socket, and once the proxy has
+ * closed it, drained again before processing what was read from the socket,
+ * so that messages are processed in the same order as they were sent. */
+
+static void
+ring_destroy (QmiDevice *self)
+{
+    if (self->priv->ring_source) {
+        g_source_destroy (self->priv->ring_source);
+        g_clear_pointer (&self->priv->ring_source, g_source_unref);
+    }
+    g_clear_pointer (&self->priv->ring, __qmi_shm_ring_free);
+    g_clear_object (&self->priv->ring_fds);
+    self->priv->ring_negotiating = FALSE;
+}
+
+static void
+ring_drain (QmiDevice *self)
+{
+    gsize r;
+
+    do {
+        guint8 *buffer;
+
+        /* Read directly into the tail of the input buffer */
+        buffer = input_buffer_reserve (self, BUFFER_SIZE);
+        r = __qmi_shm_ring_read (self->priv->ring, buffer, BUFFER_SIZE);
+        input_buffer_release (self, BUFFER_SIZE - r);
+    } while (r == BUFFER_SIZE);
 }
 
 static gboolean
-input_ready_cb (GInputStream *istream,
-                QmiDevice *self)
+ring_ready_cb (gint          fd,
+               GIOCondition  condition,
+               QmiDevice    *self)
 {
-    guint8 buffer[BUFFER_SIZE];
+    gboolean closed = FALSE;
+
+    /* Keep on reading until the ring is found empty after announcing that
+     * we're going to wait for the doorbell */
+    do {
+        ring_drain (self);
+        if (__qmi_shm_ring_is_closed (self->priv->ring)) {
+            /* Everything published before closing is already there */
+            ring_drain (self);
+            closed = TRUE;
+            break;
+        }
+    } while (!__qmi_shm_ring_prepare_wait (self->priv->ring));
+
+    if (closed) {
+        g_debug ("[%s] shared memory ring closed by the proxy", self->priv->path_display);
+        ring_destroy (self);
+    }
+
+    parse_response (self);
+
+    return closed ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+}
+
+static void
+ring_setup (QmiDevice *self,
+            guint32    size)
+{
+    gint n_fds = 0;
+    gint *fds;
+    gint eventfd;
     GError *error = NULL;
+
+    if (!self->priv->ring_fds || g_unix_fd_list_get_length (self->priv->ring_fds) != 2) {
+        g_debug ("[%s] shared memory ring not received: using socket", self->priv->path_display);
+        ring_destroy (self);
+        return;
+    }
+
+    fds = g_unix_fd_list_steal_fds (self->priv->ring_fds, &n_fds);
+    ring_destroy (self);
+
+    eventfd = fds[1];
+    self->priv->ring = __qmi_shm_ring_new_from_fds (fds[0], eventfd, &error);
+    g_free (fds);
+    if (!self->priv->ring) {
+        /* The ring is never activated, so the proxy keeps on using the socket */
+        g_debug ("[%s] couldn't setup shared memory ring: %s: using socket",
+                 self->priv->path_display, error->message);
+        g_error_free (error);
+        return;
+    }
+
+    self->priv->ring_source = g_unix_fd_source_new (eventfd, G_IO_IN);
+    g_source_set_callback (self->priv->ring_source,
+                           (GSourceFunc) ring_ready_cb,
+                           self,
+                           NULL);
+    g_source_attach (self->priv->ring_source, g_main_context_get_thread_default ());
+
+    __qmi_shm_ring_activate (self->priv->ring);
+    g_debug ("[%s] shared memory ring of %u bytes setup", self->priv->path_display, size);
+}
+
+/* Used only while the proxy open request is in flight, to get the file
+ * descriptors sent along with the response */
+static gssize
+input_receive_with_fds (QmiDevice  *self,
+                        guint8     *buffer,
+                        gsize       size,
+                        GError    **error)
+{
+    GInputVector vector;
+    GSocketControlMessage **messages = NULL;
+    gint n_messages = 0;
+    gint flags = 0;
+    gssize r;
+    gint i;
+
+    vector.buffer = buffer;
+    vector.size = size;
+    r = g_socket_receive_message (g_socket_connection_get_socket (self->priv->socket_connection),
+                                  NULL,
+                                  &vector,
+                                  1,
+                                  &messages,
+                                  &n_messages,
+                                  &flags,
+                                  NULL,
+                                  error);
+
+    for (i = 0; i < n_messages; i++) {
+        if (G_IS_UNIX_FD_MESSAGE (messages[i]) && !self->priv->ring_fds)
+            self->priv->ring_fds = g_object_ref (g_unix_fd_message_get_fd_list (G_UNIX_FD_MESSAGE (messages[i])));
+        g_object_unref (messages[i]);
+    }
+    g_free (messages);
+
+    return r;
+}
+
+/* Reads from the socket while the shared memory ring is in use. The proxy
+ * only falls back to the socket after closing the ring, so by then the ring
+ * may hold messages sent before the ones just read from the socket. */
+static gssize
+input_read_with_ring (QmiDevice     *self,
+                      GInputStream  *istream,
+                      GError       **error)
+{
+    guint8 buffer[BUFFER_SIZE];
     gssize r;
 
     r = g_pollable_input_stream_read_nonblocking (G_POLLABLE_INPUT_STREAM (istream),
                                                   buffer,
                                                   BUFFER_SIZE,
                                                   NULL,
-                                                  &error);
-    if (r < 0) {
+                                                  error);
+    if (r <= 0)
+        return r;
+
+    if (__qmi_shm_ring_is_closed (self->priv->ring)) {
+        ring_drain (self);
+        g_debug ("[%s] shared memory ring closed by the proxy", self->priv->path_display);
+        ring_destroy (self);
+    }
+
+    input_buffer_append (self, buffer, r);
+    return r;
+}
+
+static gboolean
+input_ready_cb (GInputStream *istream,
+                QmiDevice *self)
+{
+    GError *error = NULL;
+    gboolean failed = FALSE;
+    gboolean hup = FALSE;
+    gboolean ret = G_SOURCE_CONTINUE;
+    guint total = 0;
+
+    /* Messages in the shared memory ring were sent before any message in
+     * the socket */
+    if (self->priv->ring)
+        ring_drain (self);
+
+    /* Drain as much data as available (up to the configured budget) before
+     * parsing, so that a burst of messages is processed in a single wakeup */
+    do {
+        guint8 *buffer;
+        gssize r;
+
+        if (self->priv->ring)
+            r = input_read_with_ring (self, istream, &error);
+        else {
+            /* Read directly into the tail of the input buffer */
+            buffer = input_buffer_reserve (self, BUFFER_SIZE);
+            if (self->priv->ring_negotiating && total == 0)
+                r = input_receive_with_fds (self, buffer, BUFFER_SIZE, &error);
+            else
+                r = g_pollable_input_stream_read_nonblocking (G_POLLABLE_INPUT_STREAM (istream),
+                                                              buffer,
+                                                              BUFFER_SIZE,
+                                                              NULL,
+                                                              &error);
+            input_buffer_release (self, BUFFER_SIZE - MAX (r, 0));
+        }
+
+        if (r < 0) {
+            if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+                /* Nothing else to read right now */
+                g_clear_error (&error);
+            else
+                failed = TRUE;
+            break;
+        }
+
+        if (r == 0) {
+            hup = TRUE;
+            break;
+        }
+
+        /* else, r > 0 */
+        total += r;
+    } while (total < self->priv->read_budget);
+
+    /* Messages read before an error or a HUP must not be lost, e.g. the last
+     * response sent by the proxy right before closing. Processing them may
+     * end up releasing the last reference to the device. */
+    g_object_ref (self);
+    parse_response (self);
+
+    if (failed) {
         g_warning ("Error reading from istream: %s", error ? error->message : "unknown");
-        if (error)
-            g_error_free (error);
+        g_clear_error (&error);
         /* Close the device */
         qmi_device_close_async (self, 0, NULL, NULL, NULL);
-        return G_SOURCE_REMOVE;
-    }
-
-    if (r == 0) {
-        /* HUP! */
+        ret = G_SOURCE_REMOVE;
+    } else if (hup) {
         g_warning ("Cannot read from istream: connection broken");
         g_signal_emit (self, signals[SIGNAL_REMOVED], 0);
-        return G_SOURCE_REMOVE;
+        ret = G_SOURCE_REMOVE;
     }
 
-    /* else, r > 0 */
-    if (!G_UNLIKELY (self->priv->buffer))
-        self->priv->buffer = g_byte_array_sized_new (r);
-    g_byte_array_append (self->priv->buffer, buffer, r);
-
-    parse_response (self);
-
-    return G_SOURCE_CONTINUE;
+    g_object_unref (self);
+    return ret;
 }
 
 typedef struct {
@@ -2106,10 +2873,13 @@ internal_proxy_open_ready (QmiClientCtl *client_ctl,
                            GAsyncResult *res,
                            GTask *task)
 {
+    QmiDevice *self;
     DeviceOpenContext *ctx;
     QmiMessageCtlInternalProxyOpenOutput *output;
     GError *error = NULL;
 
+    self = g_task_get_source_object (task);
+
     /* Check result of the async operation */
     output = qmi_client_ctl_internal_proxy_open_finish (client_ctl, res, &error);
     if (!output) {
@@ -2126,6 +2896,18 @@ internal_proxy_open_ready (QmiClientCtl *client_ctl,
         return;
     }
 
+    /* Older proxies don't know about shared memory rings, and just ignore
+     * the request */
+    if (self->priv->ring_negotiating) {
+        guint32 ring_size;
+
+        self->priv->ring_negotiating = FALSE;
+        if (qmi_message_ctl_internal_proxy_open_output_get_shared_memory_ring_size (output, &ring_size, NULL))
+            ring_setup (self, ring_size);
+        else
+            ring_destroy (self);
+    }
+
     qmi_message_ctl_internal_proxy_open_output_unref (output);
 
     /* Go on */
@@ -2370,6 +3152,10 @@ device_open_step (GTask *task)
 
             input = qmi_message_ctl_internal_proxy_open_input_new ();
             qmi_message_ctl_internal_proxy_open_input_set_device_path (input, self->priv->path, NULL);
+            if (self->priv->proxy_ring_size > 0) {
+                qmi_message_ctl_internal_proxy_open_input_set_shared_memory_ring_size (input, self->priv->proxy_ring_size, NULL);
+                self->priv->ring_negotiating = TRUE;
+            }
             qmi_client_ctl_internal_proxy_open (self->priv->client_ctl,
                                                 input,
                                                 5,
@@ -2542,17 +3328,207 @@ qmi_device_open (QmiDevice *self,
     device_open_step (task);
 }
 
+/*****************************************************************************/
+/* Output queue */
+
+static void
+output_set_blocked (QmiDevice *self,
+                    gboolean   blocked)
+{
+    if (self->priv->output_blocked == blocked)
+        return;
+
+    self->priv->output_blocked = blocked;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_OUTPUT_BLOCKED]);
+}
+
+static void
+output_clear (QmiDevice *self)
+{
+    if (self->priv->output_source) {
+        g_source_destroy (self->priv->output_source);
+        g_clear_pointer (&self->priv->output_source, g_source_unref);
+    }
+    g_clear_pointer (&self->priv->output_buffer, g_byte_array_unref);
+    g_clear_pointer (&self->priv->output_frames, g_array_unref);
+    self->priv->output_offset = 0;
+    output_set_blocked (self, FALSE);
+}
+
+/* Writes as much queued output as possible without blocking. Returns FALSE
+ * only on a fatal write error. */
+static gboolean
+output_flush (QmiDevice  *self,
+              GError    **error)
+{
+    GByteArray *output = self->priv->output_buffer;
+
+    while (self->priv->output_offset < output->len) {
+        GError *inner_error = NULL;
+        gsize len;
+        gssize r;
+
+        /* All queued frames are written at once to the proxy socket, but the
+         * cdc-wdm driver takes exactly one QMI frame per write() */
+        if (self->priv->output_frames) {
+            g_assert (self->priv->output_frames->len > 0);
+            len = g_array_index (self->priv->output_frames, gsize, 0);
+        } else
+            len = output->len - self->priv->output_offset;
+
+        r = g_pollable_output_stream_write_nonblocking (G_POLLABLE_OUTPUT_STREAM (self->priv->ostream),
+                                                        output->data + self->priv->output_offset,
+                                                        len,
+                                                        NULL,
+                                                        &inner_error);
+        if (r < 0) {
+            if (g_error_matches (inner_error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+                g_error_free (inner_error);
+                break;
+            }
+            g_propagate_error (error, inner_error);
+            return FALSE;
+        }
+        self->priv->output_offset += r;
+
+        if (self->priv->output_frames) {
+            gsize *pending;
+
+            pending = &g_array_index (self->priv->output_frames, gsize, 0);
+            *pending -= r;
+            if (*pending == 0)
+                g_array_remove_index (self->priv->output_frames, 0);
+        }
+    }
+
+    if (self->priv->output_offset == output->len) {
+        g_byte_array_set_size (output, 0);
+        self->priv->output_offset = 0;
+    } else if (self->priv->output_offset >= BUFFER_SIZE) {
+        /* Don't let the written data pile up at the head of the buffer */
+        g_byte_array_remove_range (output, 0, self->priv->output_offset);
+        self->priv->output_offset = 0;
+    }
+
+    return TRUE;
+}
+
+static gboolean output_ready_cb (GPollableOutputStream *ostream,
+                                 QmiDevice             *self);
+
+static void
+output_update (QmiDevice *self)
+{
+    guint pending;
+
+    pending = self->priv->output_buffer->len - self->priv->output_offset;
+
+    if (!pending) {
+        if (self->priv->output_source) {
+            g_source_destroy (self->priv->output_source);
+            g_clear_pointer (&self->priv->output_source, g_source_unref);
+        }
+        output_set_blocked (self, FALSE);
+        return;
+    }
+
+    if (!self->priv->output_source) {
+        self->priv->output_source = g_pollable_output_stream_create_source (G_POLLABLE_OUTPUT_STREAM (self->priv->ostream),
+                                                                            NULL);
+        g_source_set_callback (self->priv->output_source,
+                               (GSourceFunc)output_ready_cb,
+                               self,
+                               NULL);
+        g_source_attach (self->priv->output_source, g_main_context_get_thread_default ());
+    }
+
+    if (pending > self->priv->output_high_water)
+        output_set_blocked (self, TRUE);
+}
+
+static gboolean
+output_ready_cb (GPollableOutputStream *ostream,
+                 QmiDevice             *self)
+{
+    GError *error = NULL;
+
+    if (!output_flush (self, &error)) {
+        /* Requests which didn't get fully written will time out */
+        g_warning ("[%s] Cannot write queued messages: %s",
+                   self->priv->path_display, error->message);
+        g_error_free (error);
+        g_clear_pointer (&self->priv->output_source, g_source_unref);
+        g_byte_array_set_size (self->priv->output_buffer, 0);
+        if (self->priv->output_frames)
+            g_array_set_size (self->priv->output_frames, 0);
+        self->priv->output_offset = 0;
+        output_set_blocked (self, FALSE);
+        return FALSE;
+    }
+
+    if (self->priv->output_offset == self->priv->output_buffer->len) {
+        g_clear_pointer (&self->priv->output_source, g_source_unref);
+        output_set_blocked (self, FALSE);
+        return FALSE;
+    }
+
+    output_update (self);
+    return TRUE;
+}
+
+static gboolean
+output_write (QmiDevice      *self,
+              gconstpointer   data,
+              gsize           len,
+              GError        **error)
+{
+    /* Streams which cannot be polled are written synchronously */
+    if (!G_IS_POLLABLE_OUTPUT_STREAM (self->priv->ostream) ||
+        !g_pollable_output_stream_can_poll (G_POLLABLE_OUTPUT_STREAM (self->priv->ostream))) {
+        if (!g_output_stream_write_all (self->priv->ostream, data, len, NULL, NULL, error))
+            return FALSE;
+        g_output_stream_flush (self->priv->ostream, NULL, NULL);
+        return TRUE;
+    }
+
+    if (G_UNLIKELY (!self->priv->output_buffer)) {
+        self->priv->output_buffer = g_byte_array_sized_new (BUFFER_SIZE);
+        /* Frame boundaries are only kept for the QMI port itself */
+        if (!self->priv->socket_connection)
+            self->priv->output_frames = g_array_new (FALSE, FALSE, sizeof (gsize));
+    }
+
+    /* Frames queued while the stream isn't writable are kept contiguous;
+     * when writing to the proxy socket they are coalesced and written
+     * together once it is writable */
+    g_byte_array_append (self->priv->output_buffer, data, len);
+    if (self->priv->output_frames)
+        g_array_append_val (self->priv->output_frames, len);
+    if (self->priv->output_source) {
+        output_update (self);
+        return TRUE;
+    }
+
+    if (!output_flush (self, error))
+        return FALSE;
+    output_update (self);
+    return TRUE;
+}
+
 /*****************************************************************************/
 /* Close stream */
 
 static void
 destroy_iostream (QmiDevice *self)
 {
+    ring_destroy (self);
     if (self->priv->input_source) {
         g_source_destroy (self->priv->input_source);
         g_clear_pointer (&self->priv->input_source, g_source_unref);
     }
     g_clear_pointer (&self->priv->buffer, g_byte_array_unref);
+    self->priv->buffer_offset = 0;
+    output_clear (self);
     g_clear_object (&self->priv->istream);
     g_clear_object (&self->priv->ostream);
     g_clear_object (&self->priv->socket_connection);
@@ -2628,13 +3604,13 @@ qmi_device_close_async (QmiDevice           *self,
 #if defined MBIM_QMUX_ENABLED
 
 typedef struct {
-    QmiDevice     *self;
-    gconstpointer  transaction_key;
+    QmiDevice *self;
+    guint32    transaction_key;
 } MbimTransactionContext;
 
 static MbimTransactionContext *
-mbim_transaction_context_new (QmiDevice     *self,
-                              gconstpointer  transaction_key)
+mbim_transaction_context_new (QmiDevice *self,
+                              guint32    transaction_key)
 {
     MbimTransactionContext *ctx;
 
@@ -2665,7 +3641,7 @@ mbim_device_command_ready (MbimDevice             *dev,
     /* It is possible that the transaction doesn't exist, when it gets cancelled
      * by the user before the response arrives. In such a case, we just return
      * without processing the response */
-    tr = g_hash_table_lookup (ctx->self->priv->transactions, ctx->transaction_key);
+    tr = __qmi_transaction_table_lookup (ctx->self->priv->transactions, ctx->transaction_key);
     if (!tr) {
         mbim_device_command_finish (dev, res, NULL);
         mbim_transaction_context_free (ctx);
@@ -2686,9 +3662,7 @@ mbim_device_command_ready (MbimDevice             *dev,
     /* Store the raw information buffer in the internal reception buffer,
      * as if we had read from a iochannel. */
     buf = mbim_message_command_done_get_raw_information_buffer (response, &len);
-    if (!G_UNLIKELY (ctx->self->priv->buffer))
-        ctx->self->priv->buffer = g_byte_array_sized_new (len);
-    g_byte_array_append (ctx->self->priv->buffer, buf, len);
+    input_buffer_append (ctx->self, buf, len);
 
     /* And parse it as QMI; it should remove and cleanup the transaction */
     parse_response (ctx->self);
@@ -2697,7 +3671,7 @@ mbim_device_command_ready (MbimDevice             *dev,
     /* After processing the QMI message, we check whether the transaction id was
      * removed from our tables, and if it wasn't (e.g. the QMI message embedded
      * in MBIM wasn't the proper one), we remove it ourselves. This is so that
-     * we don't leave unused transactions in the HT, given that we've disabled
+     * we don't leave unused transactions in the table, given that we've disabled
      * the transaction timeout for MBIM based ones */
     tr = device_release_transaction (ctx->self, ctx->transaction_key);
     if (tr) {
@@ -2716,7 +3690,7 @@ static gboolean
 mbim_command (QmiDevice      *self,
               gconstpointer   raw_message,
               gsize           raw_message_len,
-              gconstpointer   transaction_key,
+              guint32         transaction_key,
               guint           timeout,
               GCancellable   *cancellable,
               GError        **error)
@@ -2755,11 +3729,7 @@ qmi_device_command_full_finish (QmiDevice     *self,
                                 GAsyncResult  *res,
                                 GError       **error)
 {
-    if (g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), error))
-        return NULL;
-
-    return qmi_message_ref (g_simple_async_result_get_op_res_gpointer (
-                                G_SIMPLE_ASYNC_RESULT (res)));
+    return g_task_propagate_pointer (G_TASK (res), error);
 }
 
 static void
@@ -2779,6 +3749,58 @@ transaction_early_error (QmiDevice   *self,
     g_error_free (error);
 }
 
+static gboolean
+device_send_transaction (QmiDevice    *self,
+                         Transaction  *tr,
+                         GError      **error)
+{
+    gconstpointer raw_message;
+    gsize raw_message_len;
+
+    /* Device may have been closed while the request was queued */
+    if (!self->priv->istream || !self->priv->ostream) {
+#if defined MBIM_QMUX_ENABLED
+        if (!self->priv->mbimdev)
+#endif
+        {
+            g_set_error (error,
+                         QMI_CORE_ERROR,
+                         QMI_CORE_ERROR_WRONG_STATE,
+                         "Device must be open to send commands");
+            return FALSE;
+        }
+    }
+
+    /* Already validated before storing the transaction */
+    raw_message = qmi_message_get_raw (tr->message, &raw_message_len, NULL);
+    g_assert (raw_message);
+
+    trace_message (self, tr->message, TRUE, "request", tr->message_context);
+
+#if defined MBIM_QMUX_ENABLED
+    if (self->priv->mbimdev) {
+        if (!mbim_command (self,
+                           raw_message,
+                           raw_message_len,
+                           tr->key,
+                           tr->timeout,
+                           tr->cancellable,
+                           error)) {
+            g_prefix_error (error, "Cannot create MBIM command: ");
+            return FALSE;
+        }
+        return TRUE;
+    }
+#endif
+
+    if (!output_write (self, raw_message, raw_message_len, error)) {
+        g_prefix_error (error, "Cannot write message: ");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 void
 qmi_device_command_full (QmiDevice           *self,
                          QmiMessage          *message,
@@ -2809,6 +3831,7 @@ qmi_device_command_full (QmiDevice           *self,
     }
 
     tr = transaction_new (self, message, message_context, cancellable, callback, user_data);
+    tr->timeout = timeout;
 
     /* Device must be open */
     if (!self->priv->istream || !self->priv->ostream) {
@@ -2869,37 +3892,13 @@ qmi_device_command_full (QmiDevice           *self,
     /* From now on, if we want to complete the transaction with an early error,
      *  it needs to be removed from the tracking table as well. */
 
-    trace_message (self, message, TRUE, "request", message_context);
-
-#if defined MBIM_QMUX_ENABLED
-    if (self->priv->mbimdev) {
-        if (!mbim_command (self,
-                           raw_message,
-                           raw_message_len,
-                           build_transaction_key (message),
-                           timeout,
-                           cancellable,
-                           &error)) {
-            g_prefix_error (&error, "Cannot create MBIM command: ");
-            transaction_early_error (self, tr, TRUE, error);
-        }
+    /* If the send window of the service is full, the request will be sent
+     * once another one completes */
+    if (!send_window_acquire (self, tr))
         return;
-    }
-#endif
 
-    if (!g_output_stream_write_all (self->priv->ostream,
-                                    raw_message,
-                                    raw_message_len,
-                                    NULL, /* bytes_written */
-                                    NULL, /* cancellable */
-                                    &error)) {
-        g_prefix_error (&error, "Cannot write message: ");
+    if (!device_send_transaction (self, tr, &error))
         transaction_early_error (self, tr, TRUE, error);
-        return;
-    }
-
-    /* Flush explicitly if correctly written */
-    g_output_stream_flush (self->priv->ostream, NULL, NULL);
 }
 
 /*****************************************************************************/
@@ -3108,6 +4107,19 @@ set_property (GObject *object,
         g_free (self->priv->proxy_path);
         self->priv->proxy_path = g_value_dup_string (value);
         break;
+    case PROP_READ_BUDGET:
+        self->priv->read_budget = g_value_get_uint (value);
+        break;
+    case PROP_OUTPUT_HIGH_WATER:
+        self->priv->output_high_water = g_value_get_uint (value);
+        break;
+    case PROP_CAPTURE:
+        g_clear_pointer (&self->priv->capture, qmi_capture_unref);
+        self->priv->capture = g_value_dup_boxed (value);
+        break;
+    case PROP_PROXY_RING_SIZE:
+        self->priv->proxy_ring_size = g_value_get_uint (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -3130,6 +4142,21 @@ get_property (GObject *object,
         reload_wwan_iface_name (self);
         g_value_set_string (value, self->priv->wwan_iface);
         break;
+    case PROP_READ_BUDGET:
+        g_value_set_uint (value, self->priv->read_budget);
+        break;
+    case PROP_OUTPUT_HIGH_WATER:
+        g_value_set_uint (value, self->priv->output_high_water);
+        break;
+    case PROP_OUTPUT_BLOCKED:
+        g_value_set_boolean (value, self->priv->output_blocked);
+        break;
+    case PROP_CAPTURE:
+        g_value_set_boxed (value, self->priv->capture);
+        break;
+    case PROP_PROXY_RING_SIZE:
+        g_value_set_uint (value, self->priv->proxy_ring_size);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -3143,8 +4170,7 @@ qmi_device_init (QmiDevice *self)
                                               QMI_TYPE_DEVICE,
                                               QmiDevicePrivate);
 
-    self->priv->transactions = g_hash_table_new (g_direct_hash,
-                                                 g_direct_equal);
+    self->priv->transactions = __qmi_transaction_table_new ();
 
     self->priv->registered_clients = g_hash_table_new_full (g_direct_hash,
                                                             g_direct_equal,
@@ -3152,6 +4178,11 @@ qmi_device_init (QmiDevice *self)
                                                             g_object_unref);
     self->priv->proxy_path = g_strdup (QMI_PROXY_SOCKET_PATH);
     self->priv->fd = -1;
+    self->priv->read_budget = DEFAULT_READ_BUDGET;
+    self->priv->output_high_water = DEFAULT_OUTPUT_HIGH_WATER;
+
+    self->priv->pending_indications = g_array_new (FALSE, FALSE, sizeof (PendingIndication));
+    g_array_set_clear_func (self->priv->pending_indications, (GDestroyNotify)pending_indication_clear);
 }
 
 static gboolean
@@ -3171,9 +4202,17 @@ static void
 dispose (GObject *object)
 {
     QmiDevice *self = QMI_DEVICE (object);
+    guint i;
 
     g_clear_object (&self->priv->file);
 
+    /* Indications not yet reported are just discarded */
+    if (self->priv->indication_source) {
+        g_source_destroy (self->priv->indication_source);
+        g_clear_pointer (&self->priv->indication_source, g_source_unref);
+    }
+    g_clear_pointer (&self->priv->pending_indications, g_array_unref);
+
     /* unregister our CTL client */
     if (self->priv->client_ctl)
         unregister_client (self, QMI_CLIENT (self->priv->client_ctl));
@@ -3184,6 +4223,8 @@ dispose (GObject *object)
     g_hash_table_foreach_remove (self->priv->registered_clients,
                                  (GHRFunc)foreach_warning,
                                  self);
+    for (i = 0; i < G_N_ELEMENTS (self->priv->service_clients); i++)
+        g_clear_pointer (&self->priv->service_clients[i], g_ptr_array_unref);
 
 #if defined MBIM_QMUX_ENABLED
     if (self->priv->mbimdev) {
@@ -3212,12 +4253,30 @@ static void
 finalize (GObject *object)
 {
     QmiDevice *self = QMI_DEVICE (object);
+    guint i;
 
     /* Transactions keep refs to the device, so it's actually
      * impossible to have any content in the HT */
     if (self->priv->transactions) {
-        g_assert (g_hash_table_size (self->priv->transactions) == 0);
-        g_hash_table_unref (self->priv->transactions);
+        g_assert (__qmi_transaction_table_size (self->priv->transactions) == 0);
+        __qmi_transaction_table_free (self->priv->transactions);
+    }
+    g_assert (self->priv->timer_wheel.n_transactions == 0);
+    g_assert (self->priv->timer_wheel.source == NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (self->priv->send_windows); i++) {
+        if (self->priv->send_windows[i]) {
+            g_assert (g_queue_is_empty (&self->priv->send_windows[i]->queue));
+            g_slice_free (SendWindow, self->priv->send_windows[i]);
+        }
+    }
+
+    while (self->priv->transaction_pool) {
+        Transaction *tr;
+
+        tr = self->priv->transaction_pool;
+        self->priv->transaction_pool = tr->wheel_next;
+        g_slice_free (Transaction, tr);
     }
 
     g_hash_table_unref (self->priv->registered_clients);
@@ -3230,6 +4289,11 @@ finalize (GObject *object)
     g_free (self->priv->proxy_path);
     g_free (self->priv->wwan_iface);
 
+    if (self->priv->trace_buffer)
+        g_string_free (self->priv->trace_buffer, TRUE);
+    if (self->priv->capture)
+        qmi_capture_unref (self->priv->capture);
+
     destroy_iostream (self);
 
     G_OBJECT_CLASS (qmi_device_parent_class)->finalize (object);
@@ -3306,6 +4370,98 @@ qmi_device_class_init (QmiDeviceClass *klass)
                              G_PARAM_READABLE);
     g_object_class_install_property (object_class, PROP_WWAN_IFACE, properties[PROP_WWAN_IFACE]);
 
+    /**
+     * QmiDevice:device-read-budget:
+     *
+     * Maximum number of bytes read from the port in a single main loop
+     * wakeup before processing the received messages. If 0, a single read
+     * is done per wakeup.
+     *
+     * Since: 1.24
+     */
+    properties[PROP_READ_BUDGET] =
+        g_param_spec_uint (QMI_DEVICE_READ_BUDGET,
+                           "Read budget",
+                           "Maximum number of bytes to read from the port in a single wakeup.",
+                           0,
+                           G_MAXUINT,
+                           DEFAULT_READ_BUDGET,
+                           G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_READ_BUDGET, properties[PROP_READ_BUDGET]);
+
+    /**
+     * QmiDevice:device-output-high-water:
+     *
+     * Number of bytes queued waiting for the port to be writable above
+     * which the #QmiDevice:device-output-blocked property is set.
+     *
+     * Since: 1.24
+     */
+    properties[PROP_OUTPUT_HIGH_WATER] =
+        g_param_spec_uint (QMI_DEVICE_OUTPUT_HIGH_WATER,
+                           "Output high water",
+                           "Number of queued output bytes above which the device is reported as blocked.",
+                           0,
+                           G_MAXUINT,
+                           DEFAULT_OUTPUT_HIGH_WATER,
+                           G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_OUTPUT_HIGH_WATER, properties[PROP_OUTPUT_HIGH_WATER]);
+
+    /**
+     * QmiDevice:device-output-blocked:
+     *
+     * Whether the amount of requests waiting for the port to be writable is
+     * above #QmiDevice:device-output-high-water. Users sending requests in
+     * bulk should stop doing so while this property is %TRUE, and wait for
+     * the notification telling that the output queue has been drained.
+     *
+     * Since: 1.24
+     */
+    properties[PROP_OUTPUT_BLOCKED] =
+        g_param_spec_boolean (QMI_DEVICE_OUTPUT_BLOCKED,
+                              "Output blocked",
+                              "Whether the output queue is above its high water mark.",
+                              FALSE,
+                              G_PARAM_READABLE);
+    g_object_class_install_property (object_class, PROP_OUTPUT_BLOCKED, properties[PROP_OUTPUT_BLOCKED]);
+
+    /**
+     * QmiDevice:device-capture:
+     *
+     * The #QmiCapture where all the messages sent and received by the device
+     * are copied, or %NULL if the traffic is not captured.
+     *
+     * Since: 1.24
+     */
+    properties[PROP_CAPTURE] =
+        g_param_spec_boxed (QMI_DEVICE_CAPTURE,
+                            "Capture",
+                            "Binary capture of the messages sent and received",
+                            qmi_capture_get_type (),
+                            G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_CAPTURE, properties[PROP_CAPTURE]);
+
+    /**
+     * QmiDevice:device-proxy-ring-size:
+     *
+     * Size of the shared memory ring requested to the qmi-proxy when the
+     * device is opened with %QMI_DEVICE_OPEN_FLAGS_PROXY, through which the
+     * proxy sends responses and indications without any syscall while the
+     * device keeps up with them. If 0, or if the proxy doesn't support it,
+     * all messages go through the proxy socket.
+     *
+     * Since: 1.24
+     */
+    properties[PROP_PROXY_RING_SIZE] =
+        g_param_spec_uint (QMI_DEVICE_PROXY_RING_SIZE,
+                           "Proxy ring size",
+                           "Size of the shared memory ring requested to the proxy",
+                           0,
+                           G_MAXUINT32,
+                           0,
+                           G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_PROXY_RING_SIZE, properties[PROP_PROXY_RING_SIZE]);
+
     /**
      * QmiDevice::indication:
      * @object: A #QmiDevice.
@@ -95,6 +95,51 @@ typedef struct _QmiDevicePrivate QmiDevicePrivate;
  */
 #define QMI_DEVICE_WWAN_IFACE "device-wwan-iface"
 
+/**
+ * QMI_DEVICE_READ_BUDGET:
+ *
+ * Symbol defining the #QmiDevice:device-read-budget property.
+ *
+ * Since: 1.24
+ */
+#define QMI_DEVICE_READ_BUDGET "device-read-budget"
+
+/**
+ * QMI_DEVICE_OUTPUT_HIGH_WATER:
+ *
+ * Symbol defining the #QmiDevice:device-output-high-water property.
+ *
+ * Since: 1.24
+ */
+#define QMI_DEVICE_OUTPUT_HIGH_WATER "device-output-high-water"
+
+/**
+ * QMI_DEVICE_OUTPUT_BLOCKED:
+ *
+ * Symbol defining the #QmiDevice:device-output-blocked property.
+ *
+ * Since: 1.24
+ */
+#define QMI_DEVICE_OUTPUT_BLOCKED "device-output-blocked"
+
+/**
+ * QMI_DEVICE_CAPTURE:
+ *
+ * Symbol defining the #QmiDevice:device-capture property.
+ *
+ * Since: 1.24
+ */
+#define QMI_DEVICE_CAPTURE "device-capture"
+
+/**
+ * QMI_DEVICE_PROXY_RING_SIZE:
+ *
+ * Symbol defining the #QmiDevice:device-proxy-ring-size property.
+ *
+ * Since: 1.24
+ */
+#define QMI_DEVICE_PROXY_RING_SIZE "device-proxy-ring-size"
+
 /**
  * QMI_DEVICE_SIGNAL_INDICATION:
  *
@@ -228,6 +273,58 @@ const gchar *qmi_device_get_path_display (QmiDevice *self);
  */
 const gchar *qmi_device_get_wwan_iface (QmiDevice *self);
 
+/**
+ * qmi_device_get_broadcast_stats:
+ * @self: a #QmiDevice.
+ * @n_indications: (out) (allow-none): return location for the number of broadcast indications received, or %NULL.
+ * @n_deliveries: (out) (allow-none): return location for the number of times a broadcast indication was reported to a client, or %NULL.
+ *
+ * Gets statistics of the broadcast indications received by the device, which
+ * allow to compute the average fan-out cost of each broadcast indication.
+ *
+ * Since: 1.24
+ */
+void qmi_device_get_broadcast_stats (QmiDevice *self,
+                                     guint64   *n_indications,
+                                     guint64   *n_deliveries);
+
+/**
+ * qmi_device_set_send_window:
+ * @self: a #QmiDevice.
+ * @service: a #QmiService.
+ * @max_in_flight: maximum number of requests of @service sent to the device and waiting for a response, or 0 for no limit.
+ *
+ * Limits the number of requests of the given @service which are sent to the
+ * device without having received a response yet. Requests exceeding the limit
+ * are queued in order, and sent as soon as previous ones are completed.
+ *
+ * The window applies to all the clients of the given @service. By default
+ * there is no limit.
+ *
+ * Since: 1.24
+ */
+void qmi_device_set_send_window (QmiDevice  *self,
+                                 QmiService  service,
+                                 guint       max_in_flight);
+
+/**
+ * qmi_device_get_send_window_stats:
+ * @self: a #QmiDevice.
+ * @service: a #QmiService.
+ * @n_in_flight: (out) (allow-none): return location for the number of requests of @service waiting for a response, or %NULL.
+ * @n_queued: (out) (allow-none): return location for the number of requests of @service waiting to be sent, or %NULL.
+ * @max_queued: (out) (allow-none): return location for the maximum number of requests of @service that were waiting to be sent at the same time, or %NULL.
+ *
+ * Gets the current state of the send window of the given @service.
+ *
+ * Since: 1.24
+ */
+void qmi_device_get_send_window_stats (QmiDevice  *self,
+                                       QmiService  service,
+                                       guint      *n_in_flight,
+                                       guint      *n_queued,
+                                       guint      *max_queued);
+
 /**
  * qmi_device_is_open:
  * @self: a #QmiDevice.
@@ -292,6 +292,181 @@ qmi_tlv_next (QmiMessage *self,
     return (next < end ? next : NULL);
 }
 
+/*****************************************************************************/
+/* TLV index
+ *
+ * QmiMessage is a plain GByteArray, so there is no room to attach the index
+ * to the message itself. Instead, each thread keeps the indexes of the last
+ * few messages it looked up TLVs in, which include the message being parsed
+ * in the common case of a generated response parser looking up each of its
+ * output TLVs in turn.
+ *
+ * Each cached index holds a reference to its message, so that no other
+ * message can be allocated at the same address while the index is around,
+ * however the message is released by its other owners. The reference is
+ * dropped as soon as the message is unref-ed with qmi_message_unref() in the
+ * same thread, or otherwise once the index is evicted or the thread exits.
+ * So a message looked up in one thread and released in another one, e.g.
+ * a response parsed in a device thread, stays alive in the cache of the
+ * first thread until then; at most TLV_INDEX_CACHE_SIZE per thread.
+ *
+ * Messages are only indexed once looked up more than once, so that single
+ * lookups in many different messages cost the same as a linear lookup. The
+ * index is only used if the message buffer address and length are the same
+ * as when it was built, and it is dropped when TLV writes are reset in the
+ * same thread. Writing different TLVs of the same total size after a reset
+ * in another thread would still go unnoticed, so the type of the TLV found
+ * is also checked, and the index rebuilt if it doesn't match.
+ */
+
+#define TLV_INDEX_CACHE_SIZE 4
+
+typedef struct {
+    QmiMessage   *message; /* Full ref */
+    const guint8 *data;
+    guint         len;
+    gboolean      built;
+    guint         last_used;
+    /* Offset of the first TLV of each type, 0 if not found (offset 0 is the
+     * QMUX marker, so never a TLV) */
+    guint16       offsets[G_MAXUINT8 + 1];
+} TlvIndex;
+
+typedef struct {
+    TlvIndex indexes[TLV_INDEX_CACHE_SIZE];
+    guint    n_lookups;
+} TlvIndexCache;
+
+static void
+tlv_index_clear (TlvIndex *index)
+{
+    /* Not qmi_message_unref(), which would look for the index again */
+    if (index->message)
+        g_byte_array_unref (index->message);
+    index->message = NULL;
+    index->built = FALSE;
+    index->last_used = 0;
+}
+
+static void
+tlv_index_cache_free (TlvIndexCache *cache)
+{
+    guint i;
+
+    for (i = 0; i < TLV_INDEX_CACHE_SIZE; i++)
+        tlv_index_clear (&cache->indexes[i]);
+    g_free (cache);
+}
+
+static GPrivate tlv_index_private = G_PRIVATE_INIT ((GDestroyNotify) tlv_index_cache_free);
+
+static TlvIndexCache *
+tlv_index_cache_get (void)
+{
+    TlvIndexCache *cache;
+
+    cache = g_private_get (&tlv_index_private);
+    if (G_UNLIKELY (!cache)) {
+        cache = g_new0 (TlvIndexCache, 1);
+        g_private_set (&tlv_index_private, cache);
+    }
+    return cache;
+}
+
+static void
+tlv_index_invalidate (QmiMessage *self)
+{
+    TlvIndexCache *cache;
+    guint i;
+
+    cache = g_private_get (&tlv_index_private);
+    if (!cache)
+        return;
+
+    for (i = 0; i < TLV_INDEX_CACHE_SIZE; i++) {
+        if (cache->indexes[i].message == self) {
+            tlv_index_clear (&cache->indexes[i]);
+            return;
+        }
+    }
+}
+
+static void
+tlv_index_build (TlvIndex   *index,
+                 QmiMessage *self)
+{
+    struct tlv *tlv;
+
+    memset (index->offsets, 0, sizeof (index->offsets));
+    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv)) {
+        /* Keep the first one, like a linear lookup would */
+        if (!index->offsets[tlv->type])
+            index->offsets[tlv->type] = (guint16)(((guint8 *)tlv) - self->data);
+    }
+    index->data = self->data;
+    index->len = self->len;
+    index->built = TRUE;
+}
+
+static struct tlv *
+tlv_lookup (QmiMessage *self,
+            guint8      type)
+{
+    struct tlv *tlv;
+
+    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv)) {
+        if (tlv->type == type)
+            return tlv;
+    }
+    return NULL;
+}
+
+static struct tlv *
+tlv_index_lookup (QmiMessage *self,
+                  guint8      type)
+{
+    TlvIndexCache *cache;
+    TlvIndex *index = NULL;
+    TlvIndex *oldest;
+    guint16 offset;
+    guint i;
+
+    cache = tlv_index_cache_get ();
+    cache->n_lookups++;
+
+    oldest = &cache->indexes[0];
+    for (i = 0; i < TLV_INDEX_CACHE_SIZE; i++) {
+        if (cache->indexes[i].message == self) {
+            index = &cache->indexes[i];
+            break;
+        }
+        if (cache->indexes[i].last_used < oldest->last_used)
+            oldest = &cache->indexes[i];
+    }
+
+    /* First lookup in the message: remember it, but don't index it yet */
+    if (!index) {
+        tlv_index_clear (oldest);
+        oldest->message = g_byte_array_ref (self);
+        oldest->last_used = cache->n_lookups;
+        return tlv_lookup (self, type);
+    }
+
+    index->last_used = cache->n_lookups;
+    if (!index->built || index->data != self->data || index->len != self->len)
+        tlv_index_build (index, self);
+
+    offset = index->offsets[type];
+    if (offset && ((struct tlv *) &(self->data[offset]))->type != type) {
+        /* Stale index, the TLVs were rewritten */
+        tlv_index_build (index, self);
+        offset = index->offsets[type];
+    }
+    return offset ? (struct tlv *) &(self->data[offset]) : NULL;
+}
+
+/*****************************************************************************/
+
 /*
  * Checks the validity of a QMI message.
  *
@@ -397,6 +572,16 @@ qmi_message_new (QmiService service,
                  guint8 client_id,
                  guint16 transaction_id,
                  guint16 message_id)
+{
+    return qmi_message_new_with_capacity (service, client_id, transaction_id, message_id, 0);
+}
+
+QmiMessage *
+qmi_message_new_with_capacity (QmiService service,
+                               guint8     client_id,
+                               guint16    transaction_id,
+                               guint16    message_id,
+                               gsize      tlvs_capacity)
 {
     GByteArray *self;
     struct full_message *buffer;
@@ -418,8 +603,9 @@ qmi_message_new (QmiService service,
      * https://bugzilla.gnome.org/show_bug.cgi?id=738170
      */
 
-    /* Create the GByteArray with buffer_len bytes preallocated */
-    self = g_byte_array_sized_new (buffer_len);
+    /* Create the GByteArray with buffer_len bytes preallocated, plus the space
+     * requested for the TLVs to be written afterwards */
+    self = g_byte_array_sized_new (buffer_len + MIN (tlvs_capacity, G_MAXUINT16));
     /* Actually flag as all the buffer_len bytes being used. */
     g_byte_array_set_size (self, buffer_len);
 
@@ -449,6 +635,24 @@ qmi_message_new (QmiService service,
     return (QmiMessage *)self;
 }
 
+QmiMessage *
+__qmi_message_copy (QmiMessage *self,
+                    guint8      client_id,
+                    guint16     transaction_id)
+{
+    GByteArray *copy;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    copy = g_byte_array_sized_new (self->len);
+    g_byte_array_append (copy, self->data, self->len);
+
+    ((struct full_message *)(copy->data))->qmux.client = client_id;
+    qmi_message_set_transaction_id ((QmiMessage *)copy, transaction_id);
+
+    return (QmiMessage *)copy;
+}
+
 QmiMessage *
 qmi_message_new_from_data (QmiService   service,
                            guint8       client_id,
@@ -542,6 +746,7 @@ qmi_message_unref (QmiMessage *self)
 {
     g_return_if_fail (self != NULL);
 
+    tlv_index_invalidate (self);
     g_byte_array_unref (self);
 }
 
@@ -573,6 +778,77 @@ qmi_message_get_data (QmiMessage *self,
     return (guint8 *)(&((struct full_message *)(self->data))->qmi);
 }
 
+/*****************************************************************************/
+/* Integer array byte swapping
+ *
+ * Arrays are copied in bulk and then swapped in place when the wire and host
+ * byte orders differ; the loops are simple enough for the compiler to
+ * vectorize. Items may not be aligned, so they're accessed with memcpy(). */
+
+static inline gboolean
+endian_needs_swap (QmiEndian endian)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    return (endian == QMI_ENDIAN_BIG);
+#else
+    return (endian == QMI_ENDIAN_LITTLE);
+#endif
+}
+
+/* Arrays can never be longer than a whole message; clamp the size so that it
+ * doesn't overflow and still makes the read/write overflow checks fail */
+static inline gsize
+array_byte_size (guint n_items,
+                 gsize item_size)
+{
+    return (n_items > G_MAXUINT16 ? ((gsize) G_MAXUINT16 + 1) : (gsize) n_items * item_size);
+}
+
+static void
+swap_guint16_array (guint8 *buffer,
+                    guint   n_items)
+{
+    guint i;
+
+    for (i = 0; i < n_items; i++) {
+        guint16 tmp;
+
+        memcpy (&tmp, &buffer[i * sizeof (tmp)], sizeof (tmp));
+        tmp = GUINT16_SWAP_LE_BE (tmp);
+        memcpy (&buffer[i * sizeof (tmp)], &tmp, sizeof (tmp));
+    }
+}
+
+static void
+swap_guint32_array (guint8 *buffer,
+                    guint   n_items)
+{
+    guint i;
+
+    for (i = 0; i < n_items; i++) {
+        guint32 tmp;
+
+        memcpy (&tmp, &buffer[i * sizeof (tmp)], sizeof (tmp));
+        tmp = GUINT32_SWAP_LE_BE (tmp);
+        memcpy (&buffer[i * sizeof (tmp)], &tmp, sizeof (tmp));
+    }
+}
+
+static void
+swap_guint64_array (guint8 *buffer,
+                    guint   n_items)
+{
+    guint i;
+
+    for (i = 0; i < n_items; i++) {
+        guint64 tmp;
+
+        memcpy (&tmp, &buffer[i * sizeof (tmp)], sizeof (tmp));
+        tmp = GUINT64_SWAP_LE_BE (tmp);
+        memcpy (&buffer[i * sizeof (tmp)], &tmp, sizeof (tmp));
+    }
+}
+
 /*****************************************************************************/
 /* TLV builder & writer */
 
@@ -635,6 +911,8 @@ qmi_message_tlv_write_reset (QmiMessage *self,
 {
     g_return_if_fail (self != NULL);
 
+    /* TLVs of the same total size may be written again */
+    tlv_index_invalidate (self);
     g_byte_array_set_size (self, tlv_offset);
 }
 
@@ -847,6 +1125,81 @@ qmi_message_tlv_write_sized_guint (QmiMessage  *self,
     return TRUE;
 }
 
+gboolean
+qmi_message_tlv_write_guint16_array (QmiMessage     *self,
+                                     QmiEndian       endian,
+                                     const guint16  *in,
+                                     guint           n_items,
+                                     GError        **error)
+{
+    guint old_len;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (in != NULL || n_items == 0, FALSE);
+
+    /* Check for overflow of message size */
+    len = array_byte_size (n_items, sizeof (guint16));
+    if (!tlv_error_if_write_overflow (self, len, error))
+        return FALSE;
+
+    old_len = self->len;
+    g_byte_array_append (self, (const guint8 *)in, len);
+    if (endian_needs_swap (endian))
+        swap_guint16_array (&self->data[old_len], n_items);
+    return TRUE;
+}
+
+gboolean
+qmi_message_tlv_write_guint32_array (QmiMessage     *self,
+                                     QmiEndian       endian,
+                                     const guint32  *in,
+                                     guint           n_items,
+                                     GError        **error)
+{
+    guint old_len;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (in != NULL || n_items == 0, FALSE);
+
+    /* Check for overflow of message size */
+    len = array_byte_size (n_items, sizeof (guint32));
+    if (!tlv_error_if_write_overflow (self, len, error))
+        return FALSE;
+
+    old_len = self->len;
+    g_byte_array_append (self, (const guint8 *)in, len);
+    if (endian_needs_swap (endian))
+        swap_guint32_array (&self->data[old_len], n_items);
+    return TRUE;
+}
+
+gboolean
+qmi_message_tlv_write_guint64_array (QmiMessage     *self,
+                                     QmiEndian       endian,
+                                     const guint64  *in,
+                                     guint           n_items,
+                                     GError        **error)
+{
+    guint old_len;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (in != NULL || n_items == 0, FALSE);
+
+    /* Check for overflow of message size */
+    len = array_byte_size (n_items, sizeof (guint64));
+    if (!tlv_error_if_write_overflow (self, len, error))
+        return FALSE;
+
+    old_len = self->len;
+    g_byte_array_append (self, (const guint8 *)in, len);
+    if (endian_needs_swap (endian))
+        swap_guint64_array (&self->data[old_len], n_items);
+    return TRUE;
+}
+
 gboolean
 qmi_message_tlv_write_string (QmiMessage   *self,
                               guint8        n_size_prefix_bytes,
@@ -919,11 +1272,7 @@ qmi_message_tlv_read_init (QmiMessage  *self,
     g_return_val_if_fail (self != NULL, 0);
     g_return_val_if_fail (self->len > 0, 0);
 
-    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv)) {
-        if (tlv->type == type)
-            break;
-    }
-
+    tlv = tlv_index_lookup (self, type);
     if (!tlv) {
         g_set_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_NOT_FOUND,
                      "TLV 0x%02X not found", type);
@@ -1207,6 +1556,87 @@ qmi_message_tlv_read_sized_guint (QmiMessage  *self,
     return TRUE;
 }
 
+gboolean
+qmi_message_tlv_read_guint16_array (QmiMessage  *self,
+                                    gsize        tlv_offset,
+                                    gsize       *offset,
+                                    QmiEndian    endian,
+                                    guint        n_items,
+                                    guint16     *out,
+                                    GError     **error)
+{
+    const guint8 *ptr;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (offset != NULL, FALSE);
+    g_return_val_if_fail (out != NULL || n_items == 0, FALSE);
+
+    len = array_byte_size (n_items, sizeof (guint16));
+    if (!(ptr = tlv_error_if_read_overflow (self, tlv_offset, *offset, len, error)))
+        return FALSE;
+
+    memcpy (out, ptr, len);
+    if (endian_needs_swap (endian))
+        swap_guint16_array ((guint8 *)out, n_items);
+    *offset = *offset + len;
+    return TRUE;
+}
+
+gboolean
+qmi_message_tlv_read_guint32_array (QmiMessage  *self,
+                                    gsize        tlv_offset,
+                                    gsize       *offset,
+                                    QmiEndian    endian,
+                                    guint        n_items,
+                                    guint32     *out,
+                                    GError     **error)
+{
+    const guint8 *ptr;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (offset != NULL, FALSE);
+    g_return_val_if_fail (out != NULL || n_items == 0, FALSE);
+
+    len = array_byte_size (n_items, sizeof (guint32));
+    if (!(ptr = tlv_error_if_read_overflow (self, tlv_offset, *offset, len, error)))
+        return FALSE;
+
+    memcpy (out, ptr, len);
+    if (endian_needs_swap (endian))
+        swap_guint32_array ((guint8 *)out, n_items);
+    *offset = *offset + len;
+    return TRUE;
+}
+
+gboolean
+qmi_message_tlv_read_guint64_array (QmiMessage  *self,
+                                    gsize        tlv_offset,
+                                    gsize       *offset,
+                                    QmiEndian    endian,
+                                    guint        n_items,
+                                    guint64     *out,
+                                    GError     **error)
+{
+    const guint8 *ptr;
+    gsize len;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (offset != NULL, FALSE);
+    g_return_val_if_fail (out != NULL || n_items == 0, FALSE);
+
+    len = array_byte_size (n_items, sizeof (guint64));
+    if (!(ptr = tlv_error_if_read_overflow (self, tlv_offset, *offset, len, error)))
+        return FALSE;
+
+    memcpy (out, ptr, len);
+    if (endian_needs_swap (endian))
+        swap_guint64_array ((guint8 *)out, n_items);
+    *offset = *offset + len;
+    return TRUE;
+}
+
 gboolean
 qmi_message_tlv_read_gfloat_endian (QmiMessage  *self,
                                     gsize        tlv_offset,
@@ -1260,24 +1690,22 @@ qmi_message_tlv_read_gdouble (QmiMessage  *self,
     return TRUE;
 }
 
-gboolean
-qmi_message_tlv_read_string (QmiMessage  *self,
-                             gsize        tlv_offset,
-                             gsize       *offset,
-                             guint8       n_size_prefix_bytes,
-                             guint16      max_size,
-                             gchar      **out,
-                             GError     **error)
+/* Reads the string length prefix (if any) and gets the string contents,
+ * truncated to max_size; @offset is updated past the whole string */
+static gboolean
+tlv_read_string_contents (QmiMessage    *self,
+                          gsize          tlv_offset,
+                          gsize         *offset,
+                          guint8         n_size_prefix_bytes,
+                          guint16        max_size,
+                          const guint8 **out_ptr,
+                          guint16       *out_length,
+                          GError       **error)
 {
     const guint8 *ptr;
     guint16 string_length;
     guint16 valid_string_length;
 
-    g_return_val_if_fail (self != NULL, FALSE);
-    g_return_val_if_fail (offset != NULL, FALSE);
-    g_return_val_if_fail (out != NULL, FALSE);
-    g_return_val_if_fail (n_size_prefix_bytes <= 2, FALSE);
-
     switch (n_size_prefix_bytes) {
     case 0: {
         struct tlv *tlv;
@@ -1307,7 +1735,8 @@ qmi_message_tlv_read_string (QmiMessage  *self,
     }
 
     if (string_length == 0) {
-        *out = g_strdup ("");
+        *out_ptr = NULL;
+        *out_length = 0;
         return TRUE;
     }
 
@@ -1319,14 +1748,81 @@ qmi_message_tlv_read_string (QmiMessage  *self,
     if (!(ptr = tlv_error_if_read_overflow (self, tlv_offset, *offset, valid_string_length, error)))
         return FALSE;
 
-    *out = g_malloc (valid_string_length + 1);
-    memcpy (*out, ptr, valid_string_length);
-    (*out)[valid_string_length] = '\0';
-
+    *out_ptr = ptr;
+    *out_length = valid_string_length;
     *offset = (*offset + string_length);
     return TRUE;
 }
 
+gboolean
+qmi_message_tlv_read_string (QmiMessage  *self,
+                             gsize        tlv_offset,
+                             gsize       *offset,
+                             guint8       n_size_prefix_bytes,
+                             guint16      max_size,
+                             gchar      **out,
+                             GError     **error)
+{
+    const guint8 *ptr;
+    guint16 length;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (offset != NULL, FALSE);
+    g_return_val_if_fail (out != NULL, FALSE);
+    g_return_val_if_fail (n_size_prefix_bytes <= 2, FALSE);
+
+    if (!tlv_read_string_contents (self, tlv_offset, offset, n_size_prefix_bytes, max_size, &ptr, &length, error))
+        return FALSE;
+
+    *out = g_malloc (length + 1);
+    if (length)
+        memcpy (*out, ptr, length);
+    (*out)[length] = '\0';
+    return TRUE;
+}
+
+gboolean
+__qmi_message_tlv_read_string_into (QmiMessage  *self,
+                                    gsize        tlv_offset,
+                                    gsize       *offset,
+                                    guint8       n_size_prefix_bytes,
+                                    guint16      max_size,
+                                    gchar       *out,
+                                    gsize        out_size,
+                                    gsize       *out_length,
+                                    GError     **error)
+{
+    const guint8 *ptr;
+    guint16 length;
+    gsize prev_offset;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (offset != NULL, FALSE);
+    g_return_val_if_fail (out != NULL, FALSE);
+    g_return_val_if_fail (n_size_prefix_bytes <= 2, FALSE);
+
+    prev_offset = *offset;
+    if (!tlv_read_string_contents (self, tlv_offset, offset, n_size_prefix_bytes, max_size, &ptr, &length, error))
+        return FALSE;
+
+    if ((gsize) length >= out_size) {
+        *offset = prev_offset;
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_TLV_TOO_LONG,
+                     "String of %" G_GUINT16_FORMAT " bytes doesn't fit in %" G_GSIZE_FORMAT " bytes",
+                     length, out_size);
+        return FALSE;
+    }
+
+    if (length)
+        memcpy (out, ptr, length);
+    out[length] = '\0';
+    if (out_length)
+        *out_length = length;
+    return TRUE;
+}
+
 gboolean
 qmi_message_tlv_read_fixed_size_string (QmiMessage  *self,
                                         gsize        tlv_offset,
@@ -1379,14 +1875,12 @@ qmi_message_get_raw_tlv (QmiMessage *self,
     g_return_val_if_fail (self != NULL, NULL);
     g_return_val_if_fail (length != NULL, NULL);
 
-    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv)) {
-        if (tlv->type == type) {
-            *length = GUINT16_FROM_LE (tlv->length);
-            return (guint8 *)&(tlv->value[0]);
-        }
-    }
+    tlv = tlv_index_lookup (self, type);
+    if (!tlv)
+        return NULL;
 
-    return NULL;
+    *length = GUINT16_FROM_LE (tlv->length);
+    return (guint8 *)&(tlv->value[0]);
 }
 
 void
@@ -1453,31 +1947,37 @@ qmi_message_add_raw_tlv (QmiMessage *self,
 }
 
 QmiMessage *
-qmi_message_new_from_raw (GByteArray *raw,
-                          GError **error)
+qmi_message_new_from_raw_buffer (const guint8  *buffer,
+                                 gsize          buffer_len,
+                                 gsize         *consumed,
+                                 GError       **error)
 {
     GByteArray *self;
     gsize message_len;
 
-    g_return_val_if_fail (raw != NULL, NULL);
+    g_return_val_if_fail (buffer != NULL || buffer_len == 0, NULL);
+    g_return_val_if_fail (consumed != NULL, NULL);
+
+    *consumed = 0;
 
     /* If we didn't even read the QMUX header (comes after the 1-byte marker),
      * leave */
-    if (raw->len < (sizeof (struct qmux) + 1))
+    if (buffer_len < (sizeof (struct qmux) + 1))
         return NULL;
 
     /* We need to have read the length reported by the QMUX header (plus the
      * initial 1-byte marker) */
-    message_len = GUINT16_FROM_LE (((struct full_message *)raw->data)->qmux.length);
-    if (raw->len < (message_len + 1))
+    message_len = GUINT16_FROM_LE (((struct full_message *)buffer)->qmux.length);
+    if (buffer_len < (message_len + 1))
         return NULL;
 
-    /* Ok, so we should have all the data available already */
+    /* Ok, so we should have all the data available already; this is the only
+     * copy of the frame we do */
     self = g_byte_array_sized_new (message_len + 1);
-    g_byte_array_prepend (self, raw->data, message_len + 1);
+    g_byte_array_append (self, buffer, message_len + 1);
 
-    /* We got a complete QMI message, remove from input buffer */
-    g_byte_array_remove_range (raw, 0, self->len);
+    /* We got a complete QMI message, let the caller skip it */
+    *consumed = self->len;
 
     /* Check input message validity as soon as we create the QmiMessage */
     if (!message_check (self, error)) {
@@ -1489,6 +1989,44 @@ qmi_message_new_from_raw (GByteArray *raw,
     return (QmiMessage *)self;
 }
 
+QmiMessage *
+qmi_message_new_from_raw (GByteArray *raw,
+                          GError **error)
+{
+    QmiMessage *self;
+    gsize consumed = 0;
+
+    g_return_val_if_fail (raw != NULL, NULL);
+
+    self = qmi_message_new_from_raw_buffer (raw->data, raw->len, &consumed, error);
+
+    /* We got a complete QMI message, remove from input buffer */
+    if (consumed > 0)
+        g_byte_array_remove_range (raw, 0, consumed);
+
+    return self;
+}
+
+void
+__qmi_message_append_tlv_printable (GString      *printable,
+                                    const gchar  *line_prefix,
+                                    guint8        type,
+                                    const guint8 *raw,
+                                    gsize         raw_length)
+{
+    g_string_append_printf (printable,
+                            "%sTLV:\n"
+                            "%s  type   = 0x%02x\n"
+                            "%s  length = %" G_GSIZE_FORMAT "\n"
+                            "%s  value  = ",
+                            line_prefix,
+                            line_prefix, type,
+                            line_prefix, raw_length,
+                            line_prefix);
+    __qmi_utils_str_hex_append (printable, raw, raw_length, ':');
+    g_string_append_c (printable, '\n');
+}
+
 gchar *
 qmi_message_get_tlv_printable (QmiMessage *self,
                                const gchar *line_prefix,
@@ -1496,71 +2034,46 @@ qmi_message_get_tlv_printable (QmiMessage *self,
                                const guint8 *raw,
                                gsize raw_length)
 {
-    gchar *printable;
-    gchar *value_hex;
+    GString *printable;
 
     g_return_val_if_fail (self != NULL, NULL);
     g_return_val_if_fail (line_prefix != NULL, NULL);
     g_return_val_if_fail (raw != NULL, NULL);
     g_return_val_if_fail (raw_length > 0, NULL);
 
-    value_hex = __qmi_utils_str_hex (raw, raw_length, ':');
-    printable = g_strdup_printf ("%sTLV:\n"
-                                 "%s  type   = 0x%02x\n"
-                                 "%s  length = %" G_GSIZE_FORMAT "\n"
-                                 "%s  value  = %s\n",
-                                 line_prefix,
-                                 line_prefix, type,
-                                 line_prefix, raw_length,
-                                 line_prefix, value_hex);
-    g_free (value_hex);
-    return printable;
+    printable = g_string_new ("");
+    __qmi_message_append_tlv_printable (printable, line_prefix, type, raw, raw_length);
+    return g_string_free (printable, FALSE);
 }
 
-static gchar *
-get_generic_printable (QmiMessage *self,
-                       const gchar *line_prefix)
+static void
+append_generic_printable (QmiMessage  *self,
+                          const gchar *line_prefix,
+                          GString     *printable)
 {
-    GString *printable;
     struct tlv *tlv;
 
-    printable = g_string_new ("");
-
     g_string_append_printf (printable,
                             "%s  message     = (0x%04x)\n",
                             line_prefix, qmi_message_get_message_id (self));
 
-    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv)) {
-        gchar *printable_tlv;
-
-        printable_tlv = qmi_message_get_tlv_printable (self,
-                                                       line_prefix,
-                                                       tlv->type,
-                                                       tlv->value,
-                                                       GUINT16_FROM_LE (tlv->length));
-        g_string_append (printable, printable_tlv);
-        g_free (printable_tlv);
-    }
-
-    return g_string_free (printable, FALSE);
+    for (tlv = qmi_tlv_first (self); tlv; tlv = qmi_tlv_next (self, tlv))
+        __qmi_message_append_tlv_printable (printable,
+                                            line_prefix,
+                                            tlv->type,
+                                            tlv->value,
+                                            GUINT16_FROM_LE (tlv->length));
 }
 
-gchar *
-qmi_message_get_printable_full (QmiMessage        *self,
-                                QmiMessageContext *context,
-                                const gchar       *line_prefix)
+void
+__qmi_message_append_printable_full (QmiMessage        *self,
+                                     QmiMessageContext *context,
+                                     const gchar       *line_prefix,
+                                     GString           *printable)
 {
-    GString *printable;
     gchar *qmi_flags_str;
-    gchar *contents;
-
-    g_return_val_if_fail (self != NULL, NULL);
-    g_return_val_if_fail (line_prefix != NULL, NULL);
+    gboolean translated;
 
-    if (!line_prefix)
-        line_prefix = "";
-
-    printable = g_string_new ("");
     g_string_append_printf (printable,
                             "%sQMUX:\n"
                             "%s  length  = %u\n"
@@ -1589,59 +2102,70 @@ qmi_message_get_printable_full (QmiMessage        *self,
                             line_prefix, get_all_tlvs_length (self));
     g_free (qmi_flags_str);
 
-    contents = NULL;
+    translated = FALSE;
     switch (qmi_message_get_service (self)) {
     case QMI_SERVICE_CTL:
-        contents = __qmi_message_ctl_get_printable (self, context, line_prefix);
+        translated = __qmi_message_ctl_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_DMS:
-        contents = __qmi_message_dms_get_printable (self, context, line_prefix);
+        translated = __qmi_message_dms_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_WDS:
-        contents = __qmi_message_wds_get_printable (self, context, line_prefix);
+        translated = __qmi_message_wds_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_NAS:
-        contents = __qmi_message_nas_get_printable (self, context, line_prefix);
+        translated = __qmi_message_nas_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_WMS:
-        contents = __qmi_message_wms_get_printable (self, context, line_prefix);
+        translated = __qmi_message_wms_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_PDC:
-        contents = __qmi_message_pdc_get_printable (self, context, line_prefix);
+        translated = __qmi_message_pdc_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_PDS:
-        contents = __qmi_message_pds_get_printable (self, context, line_prefix);
+        translated = __qmi_message_pds_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_PBM:
-        contents = __qmi_message_pbm_get_printable (self, context, line_prefix);
+        translated = __qmi_message_pbm_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_UIM:
-        contents = __qmi_message_uim_get_printable (self, context, line_prefix);
+        translated = __qmi_message_uim_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_OMA:
-        contents = __qmi_message_oma_get_printable (self, context, line_prefix);
+        translated = __qmi_message_oma_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_WDA:
-        contents = __qmi_message_wda_get_printable (self, context, line_prefix);
+        translated = __qmi_message_wda_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_VOICE:
-        contents = __qmi_message_voice_get_printable (self, context, line_prefix);
+        translated = __qmi_message_voice_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_LOC:
-        contents = __qmi_message_loc_get_printable (self, context, line_prefix);
+        translated = __qmi_message_loc_append_printable (self, context, line_prefix, printable);
         break;
     case QMI_SERVICE_QOS:
-        contents = __qmi_message_qos_get_printable (self, context, line_prefix);
+        translated = __qmi_message_qos_append_printable (self, context, line_prefix, printable);
         break;
     default:
         break;
     }
 
-    if (!contents)
-        contents = get_generic_printable (self, line_prefix);
-    g_string_append (printable, contents);
-    g_free (contents);
+    if (!translated)
+        append_generic_printable (self, line_prefix, printable);
+}
 
+gchar *
+qmi_message_get_printable_full (QmiMessage        *self,
+                                QmiMessageContext *context,
+                                const gchar       *line_prefix)
+{
+    GString *printable;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (line_prefix != NULL, NULL);
+
+    printable = g_string_new ("");
+    __qmi_message_append_printable_full (self, context, line_prefix, printable);
     return g_string_free (printable, FALSE);
 }
 
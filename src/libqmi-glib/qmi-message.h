@@ -106,6 +106,32 @@ QmiMessage *qmi_message_new (QmiService service,
                              guint16    transaction_id,
                              guint16    message_id);
 
+/**
+ * qmi_message_new_with_capacity:
+ * @service: a #QmiService
+ * @client_id: client ID of the originating control point.
+ * @transaction_id: transaction ID.
+ * @message_id: message ID.
+ * @tlvs_capacity: number of bytes to preallocate for the TLVs.
+ *
+ * Create a new #QmiMessage with the specified parameters, just like
+ * qmi_message_new(), but preallocating enough space to hold @tlvs_capacity
+ * bytes of TLVs (including their headers), so that writing them afterwards
+ * doesn't require reallocating the message buffer.
+ *
+ * Note that @transaction_id must be less than #G_MAXUINT8 if @service is
+ * #QMI_SERVICE_CTL.
+ *
+ * Returns: (transfer full): a newly created #QmiMessage. The returned value should be freed with qmi_message_unref().
+ *
+ * Since: 1.24
+ */
+QmiMessage *qmi_message_new_with_capacity (QmiService service,
+                                           guint8     client_id,
+                                           guint16    transaction_id,
+                                           guint16    message_id,
+                                           gsize      tlvs_capacity);
+
 /**
  * qmi_message_new_from_raw:
  * @raw: (inout): raw data buffer.
@@ -122,6 +148,30 @@ QmiMessage *qmi_message_new (QmiService service,
 QmiMessage *qmi_message_new_from_raw (GByteArray  *raw,
                                       GError     **error);
 
+/**
+ * qmi_message_new_from_raw_buffer:
+ * @buffer: (array length=buffer_len): raw data buffer.
+ * @buffer_len: length of @buffer.
+ * @consumed: (out): return location for the number of bytes of @buffer used.
+ * @error: return location for error or %NULL.
+ *
+ * Create a new #QmiMessage from the first QMI message found at the start of
+ * the given raw data @buffer.
+ *
+ * Unlike qmi_message_new_from_raw(), @buffer is never modified; instead, the
+ * size of the complete QMI message read is returned in @consumed, so that
+ * callers framing a stream of messages can just advance their read position
+ * without moving the remaining data around.
+ *
+ * Returns: (transfer full): a newly created #QmiMessage, which should be freed with qmi_message_unref(). If @buffer doesn't contain a complete QMI message #NULL is returned and @consumed is set to 0. If there is a complete QMI message but it appears not to be valid, #NULL is returned, @error is set and @consumed reports the length of the invalid message.
+ *
+ * Since: 1.24
+ */
+QmiMessage *qmi_message_new_from_raw_buffer (const guint8  *buffer,
+                                             gsize          buffer_len,
+                                             gsize         *consumed,
+                                             GError       **error);
+
 /**
  * qmi_message_new_from_data:
  * @service: a #QmiService
@@ -572,6 +622,72 @@ gboolean qmi_message_tlv_write_sized_guint (QmiMessage  *self,
                                             guint64      in,
                                             GError     **error);
 
+/**
+ * qmi_message_tlv_write_guint16_array:
+ * @self: a #QmiMessage.
+ * @endian: target endianness, swapped from host byte order if necessary.
+ * @in: an array of @n_items #guint16 values in host byte order.
+ * @n_items: number of items in @in.
+ * @error: return location for error or %NULL.
+ *
+ * Appends @n_items unsigned 16-bit integers to the TLV being built, the same
+ * way as calling qmi_message_tlv_write_guint16() for each of them, but with a
+ * single overflow check.
+ *
+ * Returns: %TRUE if the variables are successfully added, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_write_guint16_array (QmiMessage     *self,
+                                              QmiEndian       endian,
+                                              const guint16  *in,
+                                              guint           n_items,
+                                              GError        **error);
+
+/**
+ * qmi_message_tlv_write_guint32_array:
+ * @self: a #QmiMessage.
+ * @endian: target endianness, swapped from host byte order if necessary.
+ * @in: an array of @n_items #guint32 values in host byte order.
+ * @n_items: number of items in @in.
+ * @error: return location for error or %NULL.
+ *
+ * Appends @n_items unsigned 32-bit integers to the TLV being built, the same
+ * way as calling qmi_message_tlv_write_guint32() for each of them, but with a
+ * single overflow check.
+ *
+ * Returns: %TRUE if the variables are successfully added, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_write_guint32_array (QmiMessage     *self,
+                                              QmiEndian       endian,
+                                              const guint32  *in,
+                                              guint           n_items,
+                                              GError        **error);
+
+/**
+ * qmi_message_tlv_write_guint64_array:
+ * @self: a #QmiMessage.
+ * @endian: target endianness, swapped from host byte order if necessary.
+ * @in: an array of @n_items #guint64 values in host byte order.
+ * @n_items: number of items in @in.
+ * @error: return location for error or %NULL.
+ *
+ * Appends @n_items unsigned 64-bit integers to the TLV being built, the same
+ * way as calling qmi_message_tlv_write_guint64() for each of them, but with a
+ * single overflow check.
+ *
+ * Returns: %TRUE if the variables are successfully added, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_write_guint64_array (QmiMessage     *self,
+                                              QmiEndian       endian,
+                                              const guint64  *in,
+                                              guint           n_items,
+                                              GError        **error);
+
 
 /**
  * qmi_message_tlv_write_string:
@@ -848,6 +964,96 @@ gboolean qmi_message_tlv_read_sized_guint (QmiMessage  *self,
                                            guint64     *out,
                                            GError     **error);
 
+/**
+ * qmi_message_tlv_read_guint16_array:
+ * @self: a #QmiMessage.
+ * @tlv_offset: offset that was returned by qmi_message_tlv_read_init().
+ * @offset: address of a the offset within the TLV value.
+ * @endian: source endianness, which will be swapped to host byte order if necessary.
+ * @n_items: number of items to read.
+ * @out: return location for the @n_items read #guint16 values.
+ * @error: return location for error or %NULL.
+ *
+ * Reads @n_items unsigned 16-bit integers from the TLV, in host byte order,
+ * the same way as calling qmi_message_tlv_read_guint16() for each of them,
+ * but with a single overflow check.
+ *
+ * @offset needs to point to a valid @gsize specifying the index to start
+ * reading from within the TLV value (0 for the first item). If the variables
+ * are successfully read, @offset will be updated to point past the read items.
+ *
+ * Returns: %TRUE if the variables are successfully read, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_read_guint16_array (QmiMessage  *self,
+                                             gsize        tlv_offset,
+                                             gsize       *offset,
+                                             QmiEndian    endian,
+                                             guint        n_items,
+                                             guint16     *out,
+                                             GError     **error);
+
+/**
+ * qmi_message_tlv_read_guint32_array:
+ * @self: a #QmiMessage.
+ * @tlv_offset: offset that was returned by qmi_message_tlv_read_init().
+ * @offset: address of a the offset within the TLV value.
+ * @endian: source endianness, which will be swapped to host byte order if necessary.
+ * @n_items: number of items to read.
+ * @out: return location for the @n_items read #guint32 values.
+ * @error: return location for error or %NULL.
+ *
+ * Reads @n_items unsigned 32-bit integers from the TLV, in host byte order,
+ * the same way as calling qmi_message_tlv_read_guint32() for each of them,
+ * but with a single overflow check.
+ *
+ * @offset needs to point to a valid @gsize specifying the index to start
+ * reading from within the TLV value (0 for the first item). If the variables
+ * are successfully read, @offset will be updated to point past the read items.
+ *
+ * Returns: %TRUE if the variables are successfully read, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_read_guint32_array (QmiMessage  *self,
+                                             gsize        tlv_offset,
+                                             gsize       *offset,
+                                             QmiEndian    endian,
+                                             guint        n_items,
+                                             guint32     *out,
+                                             GError     **error);
+
+/**
+ * qmi_message_tlv_read_guint64_array:
+ * @self: a #QmiMessage.
+ * @tlv_offset: offset that was returned by qmi_message_tlv_read_init().
+ * @offset: address of a the offset within the TLV value.
+ * @endian: source endianness, which will be swapped to host byte order if necessary.
+ * @n_items: number of items to read.
+ * @out: return location for the @n_items read #guint64 values.
+ * @error: return location for error or %NULL.
+ *
+ * Reads @n_items unsigned 64-bit integers from the TLV, in host byte order,
+ * the same way as calling qmi_message_tlv_read_guint64() for each of them,
+ * but with a single overflow check.
+ *
+ * @offset needs to point to a valid @gsize specifying the index to start
+ * reading from within the TLV value (0 for the first item). If the variables
+ * are successfully read, @offset will be updated to point past the read items.
+ *
+ * Returns: %TRUE if the variables are successfully read, otherwise %FALSE is returned and @error is set.
+ *
+ * Since: 1.24
+ */
+gboolean qmi_message_tlv_read_guint64_array (QmiMessage  *self,
+                                             gsize        tlv_offset,
+                                             gsize       *offset,
+                                             QmiEndian    endian,
+                                             guint        n_items,
+                                             guint64     *out,
+                                             GError     **error);
+
 /**
  * qmi_message_tlv_read_gfloat_endian:
  * @self: a #QmiMessage.
@@ -961,6 +1167,39 @@ G_GNUC_INTERNAL
 guint16 __qmi_message_tlv_read_remaining_size (QmiMessage  *self,
                                                gsize        tlv_offset,
                                                gsize        offset);
+
+/* Like qmi_message_tlv_read_string(), but reading into a caller-provided
+ * buffer of @out_size bytes, which must also fit the trailing NUL. */
+G_GNUC_INTERNAL
+gboolean __qmi_message_tlv_read_string_into (QmiMessage  *self,
+                                             gsize        tlv_offset,
+                                             gsize       *offset,
+                                             guint8       n_size_prefix_bytes,
+                                             guint16      max_size,
+                                             gchar       *out,
+                                             gsize        out_size,
+                                             gsize       *out_length,
+                                             GError     **error);
+
+/* Copy of a whole message, with the client and transaction IDs replaced */
+G_GNUC_INTERNAL
+QmiMessage *__qmi_message_copy (QmiMessage *self,
+                                guint8      client_id,
+                                guint16     transaction_id);
+
+/* Like qmi_message_get_printable_full() and qmi_message_get_tlv_printable(),
+ * but appending to the given string */
+G_GNUC_INTERNAL
+void __qmi_message_append_printable_full (QmiMessage        *self,
+                                          QmiMessageContext *context,
+                                          const gchar       *line_prefix,
+                                          GString           *printable);
+G_GNUC_INTERNAL
+void __qmi_message_append_tlv_printable (GString      *printable,
+                                         const gchar  *line_prefix,
+                                         guint8        type,
+                                         const guint8 *raw,
+                                         gsize         raw_length);
 #endif
 
 /*****************************************************************************/
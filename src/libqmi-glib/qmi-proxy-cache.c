@@ -0,0 +1,249 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include "qmi-proxy-cache.h"
+
+#define QMI_MESSAGE_OUTPUT_TLV_RESULT 0x02
+
+/* Purge expired entries once the cache grows beyond this */
+#define PURGE_SIZE 64
+
+typedef struct {
+    QmiMessage *response; /* NULL while in flight */
+    guint       ttl;
+    gint64      expiry;
+    gboolean    stale;
+    GList      *waiters;  /* Coalesced requests */
+} Entry;
+
+struct _QmiProxyCache {
+    volatile gint   ref_count;
+    GHashTable     *entries;
+    GDestroyNotify  waiter_free;
+};
+
+static void
+entry_free (Entry *entry)
+{
+    g_assert (!entry->waiters);
+    if (entry->response)
+        qmi_message_unref (entry->response);
+    g_slice_free (Entry, entry);
+}
+
+QmiProxyCache *
+__qmi_proxy_cache_new (GDestroyNotify waiter_free)
+{
+    QmiProxyCache *self;
+
+    self = g_slice_new0 (QmiProxyCache);
+    self->ref_count = 1;
+    self->waiter_free = waiter_free;
+    self->entries = g_hash_table_new_full (g_bytes_hash,
+                                           g_bytes_equal,
+                                           (GDestroyNotify) g_bytes_unref,
+                                           (GDestroyNotify) entry_free);
+    return self;
+}
+
+QmiProxyCache *
+__qmi_proxy_cache_ref (QmiProxyCache *self)
+{
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+void
+__qmi_proxy_cache_unref (QmiProxyCache *self)
+{
+    GHashTableIter iter;
+    Entry *entry;
+
+    if (!g_atomic_int_dec_and_test (&self->ref_count))
+        return;
+
+    /* Waiters of the entries still in flight are never given back */
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry)) {
+        g_list_free_full (entry->waiters, self->waiter_free);
+        entry->waiters = NULL;
+    }
+    g_hash_table_unref (self->entries);
+    g_slice_free (QmiProxyCache, self);
+}
+
+guint
+__qmi_proxy_cache_get_size (QmiProxyCache *self)
+{
+    return g_hash_table_size (self->entries);
+}
+
+/*****************************************************************************/
+
+static void
+key_append_tlv (guint8        type,
+                const guint8 *value,
+                gsize         length,
+                GByteArray   *key)
+{
+    guint16 length_le;
+
+    length_le = GUINT16_TO_LE ((guint16) length);
+    g_byte_array_append (key, &type, 1);
+    g_byte_array_append (key, (const guint8 *)&length_le, 2);
+    g_byte_array_append (key, value, length);
+}
+
+static GBytes *
+key_new (QmiMessage *message)
+{
+    GByteArray *key;
+    guint8 service;
+    guint16 message_id;
+
+    key = g_byte_array_sized_new (qmi_message_get_length (message));
+    service = (guint8) qmi_message_get_service (message);
+    message_id = GUINT16_TO_LE (qmi_message_get_message_id (message));
+    g_byte_array_append (key, &service, 1);
+    g_byte_array_append (key, (const guint8 *)&message_id, 2);
+    qmi_message_foreach_raw_tlv (message, (QmiMessageForeachRawTlvFn) key_append_tlv, key);
+    return g_byte_array_free_to_bytes (key);
+}
+
+static gboolean
+entry_remove_expired (GBytes *key,
+                      Entry  *entry,
+                      gint64 *now)
+{
+    return (entry->response && entry->expiry <= *now);
+}
+
+QmiProxyCacheLookup
+__qmi_proxy_cache_lookup (QmiProxyCache  *self,
+                          QmiMessage     *request,
+                          guint           ttl,
+                          gint64          now,
+                          gpointer        waiter,
+                          QmiMessage    **response,
+                          GBytes        **key)
+{
+    Entry *entry;
+    GBytes *request_key;
+
+    request_key = key_new (request);
+    entry = g_hash_table_lookup (self->entries, request_key);
+
+    if (entry && entry->response && entry->expiry > now) {
+        g_bytes_unref (request_key);
+        *response = qmi_message_ref (entry->response);
+        return QMI_PROXY_CACHE_LOOKUP_HIT;
+    }
+
+    if (entry && !entry->response) {
+        g_bytes_unref (request_key);
+        /* Stale entries cannot be used, and the request won't be cached
+         * either, as there is already one in flight with the same key */
+        if (entry->stale)
+            return QMI_PROXY_CACHE_LOOKUP_UNCACHEABLE;
+        entry->waiters = g_list_append (entry->waiters, waiter);
+        return QMI_PROXY_CACHE_LOOKUP_COALESCED;
+    }
+
+    if (g_hash_table_size (self->entries) >= PURGE_SIZE)
+        g_hash_table_foreach_remove (self->entries, (GHRFunc) entry_remove_expired, &now);
+
+    /* New entry in flight, replacing the expired one if any */
+    entry = g_slice_new0 (Entry);
+    entry->ttl = ttl;
+    g_hash_table_replace (self->entries, g_bytes_ref (request_key), entry);
+    *key = request_key;
+    return QMI_PROXY_CACHE_LOOKUP_MISS;
+}
+
+static gboolean
+response_is_success (QmiMessage *response)
+{
+    gsize offset = 0;
+    gsize init_offset;
+    guint16 error_status;
+    guint16 error_code;
+
+    return ((init_offset = qmi_message_tlv_read_init (response, QMI_MESSAGE_OUTPUT_TLV_RESULT, NULL, NULL)) > 0 &&
+            qmi_message_tlv_read_guint16 (response, init_offset, &offset, QMI_ENDIAN_LITTLE, &error_status, NULL) &&
+            qmi_message_tlv_read_guint16 (response, init_offset, &offset, QMI_ENDIAN_LITTLE, &error_code, NULL) &&
+            error_status == 0x00 &&
+            error_code == QMI_PROTOCOL_ERROR_NONE);
+}
+
+GList *
+__qmi_proxy_cache_complete (QmiProxyCache *self,
+                            GBytes        *key,
+                            QmiMessage    *response,
+                            gint64         now)
+{
+    Entry *entry;
+    GList *waiters;
+
+    /* Entries in flight are never removed from the cache */
+    entry = g_hash_table_lookup (self->entries, key);
+    g_assert (entry && !entry->response);
+
+    waiters = entry->waiters;
+    entry->waiters = NULL;
+
+    if (response && !entry->stale && response_is_success (response)) {
+        entry->response = qmi_message_ref (response);
+        entry->expiry = now + (gint64) entry->ttl * G_USEC_PER_SEC;
+    } else
+        g_hash_table_remove (self->entries, key);
+
+    return waiters;
+}
+
+static gboolean
+entry_invalidate (GBytes   *key,
+                  Entry    *entry,
+                  gpointer  service)
+{
+    /* The service is the first byte of the key */
+    if (GPOINTER_TO_UINT (service) != QMI_SERVICE_CTL &&
+        GPOINTER_TO_UINT (service) != *((const guint8 *) g_bytes_get_data (key, NULL)))
+        return FALSE;
+
+    if (!entry->response) {
+        entry->stale = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void
+__qmi_proxy_cache_invalidate (QmiProxyCache *self,
+                              QmiService     service)
+{
+    if (!g_hash_table_size (self->entries))
+        return;
+
+    g_hash_table_foreach_remove (self->entries,
+                                 (GHRFunc) entry_invalidate,
+                                 GUINT_TO_POINTER ((guint) service));
+}
@@ -0,0 +1,99 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_PROXY_CACHE_H_
+#define _LIBQMI_GLIB_QMI_PROXY_CACHE_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+#include "qmi-enums.h"
+#include "qmi-message.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Cache of the responses to idempotent requests, used by the proxy for each
+ * device. Entries are keyed by service, message and request TLVs, so that
+ * identical requests from any client share them; client and transaction IDs
+ * are not part of the key.
+ *
+ * A request not found in the cache creates an entry in flight, which the
+ * caller completes once the device replies. Identical requests arriving in
+ * the meantime are kept in the entry as opaque waiters, and are given back
+ * to the caller when the entry is completed, whether the response was cached
+ * or not. Times are given by the caller, in microseconds.
+ */
+typedef struct _QmiProxyCache QmiProxyCache;
+
+typedef enum {
+    QMI_PROXY_CACHE_LOOKUP_UNCACHEABLE,
+    QMI_PROXY_CACHE_LOOKUP_HIT,
+    QMI_PROXY_CACHE_LOOKUP_COALESCED,
+    QMI_PROXY_CACHE_LOOKUP_MISS,
+} QmiProxyCacheLookup;
+
+G_GNUC_INTERNAL
+QmiProxyCache       *__qmi_proxy_cache_new        (GDestroyNotify   waiter_free);
+G_GNUC_INTERNAL
+QmiProxyCache       *__qmi_proxy_cache_ref        (QmiProxyCache   *self);
+G_GNUC_INTERNAL
+void                 __qmi_proxy_cache_unref      (QmiProxyCache   *self);
+G_GNUC_INTERNAL
+guint                __qmi_proxy_cache_get_size   (QmiProxyCache   *self);
+
+/* On HIT, @response is set to a new reference of the cached response. On
+ * COALESCED, @waiter is kept in the entry in flight. On MISS, a new entry
+ * in flight is created and @key is set to a new reference of its key, to
+ * be given back in __qmi_proxy_cache_complete(). UNCACHEABLE is returned
+ * if an identical request is in flight but its entry is stale, in which
+ * case the request must just be sent without caching it. */
+G_GNUC_INTERNAL
+QmiProxyCacheLookup  __qmi_proxy_cache_lookup     (QmiProxyCache   *self,
+                                                   QmiMessage      *request,
+                                                   guint            ttl,
+                                                   gint64           now,
+                                                   gpointer         waiter,
+                                                   QmiMessage     **response,
+                                                   GBytes         **key);
+
+/* Completes the entry in flight with the given @response, or with NULL if
+ * the request failed. The response is cached only if successful and if the
+ * entry wasn't invalidated in the meantime. Returns the list of waiters,
+ * which the caller takes ownership of. */
+G_GNUC_INTERNAL
+GList               *__qmi_proxy_cache_complete   (QmiProxyCache   *self,
+                                                   GBytes          *key,
+                                                   QmiMessage      *response,
+                                                   gint64           now);
+
+/* Invalidating the CTL service invalidates all entries */
+G_GNUC_INTERNAL
+void                 __qmi_proxy_cache_invalidate (QmiProxyCache   *self,
+                                                   QmiService       service);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_PROXY_CACHE_H_ */
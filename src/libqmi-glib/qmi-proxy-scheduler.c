@@ -0,0 +1,231 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include "qmi-proxy-scheduler.h"
+
+typedef struct {
+    gpointer item;
+    gsize    size;
+    gint64   queued_time;
+} Item;
+
+struct _QmiProxySchedulerQueue {
+    GQueue   items;
+    guint    weight;
+    guint    deficit;
+    gboolean visited;
+};
+
+struct _QmiProxyScheduler {
+    volatile gint ref_count;
+    gboolean      running;
+
+    /* Maximum number of items in flight, 0 if unlimited */
+    guint max_in_flight;
+    guint n_in_flight;
+
+    /* Queues with items, in round-robin order */
+    GQueue active;
+
+    QmiProxySchedulerSendFn send_fn;
+    gpointer                user_data;
+};
+
+QmiProxyScheduler *
+__qmi_proxy_scheduler_new (guint                   max_in_flight,
+                           QmiProxySchedulerSendFn send_fn,
+                           gpointer                user_data)
+{
+    QmiProxyScheduler *self;
+
+    self = g_slice_new0 (QmiProxyScheduler);
+    self->ref_count = 1;
+    self->max_in_flight = max_in_flight;
+    self->send_fn = send_fn;
+    self->user_data = user_data;
+    g_queue_init (&self->active);
+    return self;
+}
+
+QmiProxyScheduler *
+__qmi_proxy_scheduler_ref (QmiProxyScheduler *self)
+{
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+void
+__qmi_proxy_scheduler_unref (QmiProxyScheduler *self)
+{
+    if (!g_atomic_int_dec_and_test (&self->ref_count))
+        return;
+
+    /* All queues must have been flushed */
+    g_assert (g_queue_is_empty (&self->active));
+    g_slice_free (QmiProxyScheduler, self);
+}
+
+guint
+__qmi_proxy_scheduler_get_n_in_flight (QmiProxyScheduler *self)
+{
+    return self->n_in_flight;
+}
+
+/*****************************************************************************/
+
+static void
+queue_reset (QmiProxySchedulerQueue *queue)
+{
+    queue->deficit = 0;
+    queue->visited = FALSE;
+}
+
+static void
+scheduler_run (QmiProxyScheduler *self,
+               gint64             now)
+{
+    while (self->running &&
+           !g_queue_is_empty (&self->active) &&
+           (!self->max_in_flight || self->n_in_flight < self->max_in_flight)) {
+        QmiProxySchedulerQueue *queue;
+        Item *item;
+        gpointer data;
+        gint64 wait_time;
+
+        queue = g_queue_peek_head (&self->active);
+        item = g_queue_peek_head (&queue->items);
+
+        /* The quantum is given once per visit; the visit may span several
+         * runs if the cap of items in flight is reached */
+        if (!queue->visited) {
+            queue->deficit += QMI_PROXY_SCHEDULER_QUANTUM * queue->weight;
+            queue->visited = TRUE;
+        }
+
+        if (item->size > queue->deficit) {
+            queue->visited = FALSE;
+            g_queue_push_tail (&self->active, g_queue_pop_head (&self->active));
+            continue;
+        }
+
+        g_queue_pop_head (&queue->items);
+        queue->deficit -= item->size;
+
+        /* Queues without items don't accumulate deficit */
+        if (g_queue_is_empty (&queue->items)) {
+            g_queue_pop_head (&self->active);
+            queue_reset (queue);
+        }
+
+        data = item->item;
+        wait_time = now - item->queued_time;
+        g_slice_free (Item, item);
+
+        self->n_in_flight++;
+        self->send_fn (data, wait_time, self->user_data);
+    }
+}
+
+void
+__qmi_proxy_scheduler_start (QmiProxyScheduler *self,
+                             gint64             now)
+{
+    self->running = TRUE;
+    scheduler_run (self, now);
+}
+
+void
+__qmi_proxy_scheduler_stop (QmiProxyScheduler *self)
+{
+    self->running = FALSE;
+}
+
+void
+__qmi_proxy_scheduler_complete (QmiProxyScheduler *self,
+                                gint64             now)
+{
+    g_assert (self->n_in_flight > 0);
+    self->n_in_flight--;
+    scheduler_run (self, now);
+}
+
+/*****************************************************************************/
+
+QmiProxySchedulerQueue *
+__qmi_proxy_scheduler_queue_new (guint weight)
+{
+    QmiProxySchedulerQueue *queue;
+
+    queue = g_slice_new0 (QmiProxySchedulerQueue);
+    queue->weight = MAX (weight, 1);
+    g_queue_init (&queue->items);
+    return queue;
+}
+
+void
+__qmi_proxy_scheduler_queue_free (QmiProxySchedulerQueue *queue)
+{
+    /* Must have been flushed */
+    g_assert (g_queue_is_empty (&queue->items));
+    g_slice_free (QmiProxySchedulerQueue, queue);
+}
+
+void
+__qmi_proxy_scheduler_push (QmiProxyScheduler      *self,
+                            QmiProxySchedulerQueue *queue,
+                            gpointer                item,
+                            gsize                   size,
+                            gint64                  now)
+{
+    Item *entry;
+
+    entry = g_slice_new (Item);
+    entry->item = item;
+    entry->size = size;
+    entry->queued_time = now;
+
+    if (g_queue_is_empty (&queue->items))
+        g_queue_push_tail (&self->active, queue);
+    g_queue_push_tail (&queue->items, entry);
+
+    scheduler_run (self, now);
+}
+
+GList *
+__qmi_proxy_scheduler_flush (QmiProxyScheduler      *self,
+                             QmiProxySchedulerQueue *queue)
+{
+    GList *items = NULL;
+    Item *item;
+
+    if (g_queue_is_empty (&queue->items))
+        return NULL;
+
+    g_queue_remove (&self->active, queue);
+    queue_reset (queue);
+
+    while ((item = g_queue_pop_tail (&queue->items)) != NULL) {
+        items = g_list_prepend (items, item->item);
+        g_slice_free (Item, item);
+    }
+    return items;
+}
@@ -0,0 +1,101 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_PROXY_SCHEDULER_H_
+#define _LIBQMI_GLIB_QMI_PROXY_SCHEDULER_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Deficit round-robin scheduler of the requests of the clients of a device,
+ * used by the proxy. Each client has its own queue of opaque items, and
+ * items are released through the send callback while the scheduler is
+ * running and the number of items in flight is below the cap, if any.
+ *
+ * Each time a queue is visited in a round, it is given a quantum of bytes
+ * proportional to its weight, and it sends items while their size fits in
+ * the quantum accumulated. The size not sent is kept as deficit for the
+ * next round, so that queues with large items get their fair share too.
+ * Without a cap, items are sent right away in arrival order.
+ *
+ * Times are given by the caller, in microseconds, and the send callback is
+ * told how long each item waited in its queue.
+ */
+typedef struct _QmiProxyScheduler      QmiProxyScheduler;
+typedef struct _QmiProxySchedulerQueue QmiProxySchedulerQueue;
+
+/* Bytes a queue with the default weight may send in each round */
+#define QMI_PROXY_SCHEDULER_QUANTUM 512
+
+typedef void (* QmiProxySchedulerSendFn) (gpointer item,
+                                          gint64   wait_time,
+                                          gpointer user_data);
+
+G_GNUC_INTERNAL
+QmiProxyScheduler      *__qmi_proxy_scheduler_new             (guint                    max_in_flight,
+                                                               QmiProxySchedulerSendFn  send_fn,
+                                                               gpointer                 user_data);
+G_GNUC_INTERNAL
+QmiProxyScheduler      *__qmi_proxy_scheduler_ref             (QmiProxyScheduler       *self);
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_unref           (QmiProxyScheduler       *self);
+G_GNUC_INTERNAL
+guint                   __qmi_proxy_scheduler_get_n_in_flight (QmiProxyScheduler       *self);
+
+/* Items are only sent while running */
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_start           (QmiProxyScheduler       *self,
+                                                               gint64                   now);
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_stop            (QmiProxyScheduler       *self);
+
+/* Each item sent must be completed once done, to release the next ones */
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_complete        (QmiProxyScheduler       *self,
+                                                               gint64                   now);
+
+G_GNUC_INTERNAL
+QmiProxySchedulerQueue *__qmi_proxy_scheduler_queue_new       (guint                    weight);
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_queue_free      (QmiProxySchedulerQueue  *queue);
+G_GNUC_INTERNAL
+void                    __qmi_proxy_scheduler_push            (QmiProxyScheduler       *self,
+                                                               QmiProxySchedulerQueue  *queue,
+                                                               gpointer                 item,
+                                                               gsize                    size,
+                                                               gint64                   now);
+
+/* Removes all the items not sent yet from the queue, and returns them in
+ * order; the caller takes ownership of the list */
+G_GNUC_INTERNAL
+GList                  *__qmi_proxy_scheduler_flush           (QmiProxyScheduler       *self,
+                                                               QmiProxySchedulerQueue  *queue);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_PROXY_SCHEDULER_H_ */
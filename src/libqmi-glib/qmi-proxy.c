@@ -30,6 +30,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <gio/gunixsocketaddress.h>
+#include <gio/gunixfdmessage.h>
 
 #include "config.h"
 #include "qmi-enum-types.h"
@@ -38,36 +39,73 @@
 #include "qmi-ctl.h"
 #include "qmi-utils.h"
 #include "qmi-proxy.h"
+#include "qmi-shm-ring.h"
+#include "qmi-proxy-cache.h"
+#include "qmi-proxy-scheduler.h"
 
 #define BUFFER_SIZE 512
+#define READ_BUDGET (16 * BUFFER_SIZE)
 
 #define QMI_MESSAGE_OUTPUT_TLV_RESULT 0x02
 #define QMI_MESSAGE_OUTPUT_TLV_ALLOCATION_INFO 0x01
 #define QMI_MESSAGE_CTL_ALLOCATE_CID 0x0022
 #define QMI_MESSAGE_CTL_RELEASE_CID 0x0023
+#define QMI_MESSAGE_CTL_SYNC 0x0027
+#define QMI_MESSAGE_DMS_SET_OPERATING_MODE 0x002E
 
 #define QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN 0xFF00
 #define QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_INPUT_TLV_DEVICE_PATH 0x01
+#define QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_INPUT_TLV_SHM_RING_SIZE 0x10
+#define QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_OUTPUT_TLV_SHM_RING_SIZE 0x10
 
 G_DEFINE_TYPE (QmiProxy, qmi_proxy, G_TYPE_OBJECT)
 
 enum {
     PROP_0,
     PROP_N_CLIENTS,
+    PROP_DEVICE_THREADS,
+    PROP_MAX_IN_FLIGHT,
     PROP_LAST
 };
 
 static GParamSpec *properties[PROP_LAST];
 
+#define CACHE_TTL_KEY(service, message_id) GUINT_TO_POINTER (((guint)(service) << 16) | (guint)(message_id))
+
 struct _QmiProxyPrivate {
+    /* Context where the proxy was created, where connections are accepted */
+    GMainContext *context;
+
     /* Unix socket service */
     GSocketService *socket_service;
 
+    /* Whether new devices get their own thread */
+    gboolean device_threads;
+
+    /* Maximum number of requests in flight in new devices, 0 if unlimited */
+    guint max_in_flight;
+
+    /* Clients and devices may be tracked and untracked from the device
+     * threads, so both lists are protected by the lock */
+    GMutex lock;
+    gboolean disposing;
+
     /* Clients */
     GList *clients;
 
-    /* Devices */
+    /* Devices, each one with its own indication routing table */
     GList *devices;
+
+    /* Threads of the devices stopped, to be joined in the context of the
+     * proxy */
+    GList *stopped_threads;
+
+    /* Time to live of the cached responses, in seconds, for each service
+     * and message; protected by the lock */
+    GHashTable *cache_ttls;
+
+    /* Scheduling weight of the clients of each user; protected by the lock */
+    GHashTable *uid_weights;
 };
 
 /*****************************************************************************/
@@ -75,12 +113,127 @@ struct _QmiProxyPrivate {
 guint
 qmi_proxy_get_n_clients (QmiProxy *self)
 {
+    guint n_clients;
+
     g_return_val_if_fail (QMI_IS_PROXY (self), 0);
 
-    return g_list_length (self->priv->clients);
+    g_mutex_lock (&self->priv->lock);
+    n_clients = g_list_length (self->priv->clients);
+    g_mutex_unlock (&self->priv->lock);
+
+    return n_clients;
+}
+
+void
+qmi_proxy_set_cache_ttl (QmiProxy   *self,
+                         QmiService  service,
+                         guint16     message_id,
+                         guint       ttl)
+{
+    g_return_if_fail (QMI_IS_PROXY (self));
+
+    g_mutex_lock (&self->priv->lock);
+    if (ttl > 0) {
+        if (!self->priv->cache_ttls)
+            self->priv->cache_ttls = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (self->priv->cache_ttls, CACHE_TTL_KEY (service, message_id), GUINT_TO_POINTER (ttl));
+    } else if (self->priv->cache_ttls)
+        g_hash_table_remove (self->priv->cache_ttls, CACHE_TTL_KEY (service, message_id));
+    g_mutex_unlock (&self->priv->lock);
+}
+
+void
+qmi_proxy_set_uid_weight (QmiProxy *self,
+                          guint     uid,
+                          guint     weight)
+{
+    g_return_if_fail (QMI_IS_PROXY (self));
+
+    weight = MIN (weight, QMI_PROXY_MAX_UID_WEIGHT);
+
+    g_mutex_lock (&self->priv->lock);
+    if (weight > 1) {
+        if (!self->priv->uid_weights)
+            self->priv->uid_weights = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (self->priv->uid_weights, GUINT_TO_POINTER (uid), GUINT_TO_POINTER (weight));
+    } else if (self->priv->uid_weights)
+        g_hash_table_remove (self->priv->uid_weights, GUINT_TO_POINTER (uid));
+    g_mutex_unlock (&self->priv->lock);
+}
+
+static gboolean
+notify_n_clients_cb (QmiProxy *self)
+{
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_N_CLIENTS]);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+notify_n_clients (QmiProxy *self)
+{
+    /* Clients may be untracked from the device threads, but the property
+     * is always notified in the context of the proxy */
+    g_main_context_invoke_full (self->priv->context,
+                                G_PRIORITY_DEFAULT,
+                                (GSourceFunc) notify_n_clients_cb,
+                                g_object_ref (self),
+                                (GDestroyNotify) g_object_unref);
 }
 
 /*****************************************************************************/
+/* Devices
+ *
+ * Each device runs in its own context: either the one of the proxy, or, if
+ * device threads are enabled, a new one with its own thread. All the clients
+ * of the device are handed off to that context once they have requested to
+ * open it, so that the I/O of each device and of its clients never waits for
+ * any other device.
+ *
+ * Each device keeps a single indication handler, which forwards each
+ * indication with one lookup: either in the table of clients owning each
+ * (service, cid) pair, or in the list of clients with at least one CID of the
+ * service, for broadcast indications. Clients are not referenced in either of
+ * them, they are removed when untracked.
+ *
+ * Requests are queued per client, and released to the device by the
+ * scheduler of the device, see below. */
+
+#define ROUTE_KEY(service, cid) GUINT_TO_POINTER (((guint)(service) << 8) | (guint)(cid))
+
+typedef struct {
+    QmiProxy *proxy; /* not full ref */
+    gchar *path;
+
+    /* Context of the device, and its loop and thread if it has its own */
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+
+    /* Number of tracked clients of the device, protected by the proxy lock */
+    guint n_clients;
+
+    /* All fields below are only used in the context of the device */
+    QmiDevice *qmi_device;
+    gboolean opening;
+    gboolean stop_pending;
+
+    /* Clients attached while the device is being opened */
+    GList *pending_clients;
+
+    guint indication_id;
+
+    /* Client owning each (service, cid) pair */
+    GHashTable *routes;
+
+    /* Clients with CIDs allocated, indexed by service */
+    GPtrArray *broadcast_routes[G_MAXUINT8 + 1];
+
+    /* Cached responses, created when first needed */
+    QmiProxyCache *cache;
+
+    /* Outlives the device while requests are in flight */
+    QmiProxyScheduler *scheduler;
+} Device;
 
 typedef struct {
     QmiService service;
@@ -91,28 +244,69 @@ typedef struct {
     volatile gint ref_count;
 
     QmiProxy *proxy; /* not full ref */
+    Device *device; /* not full ref, set while tracked */
+    gboolean attached;
     GSocketConnection *connection;
     GSource *connection_readable_source;
     GByteArray *buffer;
-    QmiDevice *device;
     QmiMessage *internal_proxy_open_request;
     GArray *qmi_client_info_array;
-    guint indication_id;
     guint device_removed_id;
+    guint output_blocked_id;
+
+    /* Shared memory ring for the messages sent to the client, if requested */
+    guint32 ring_size;
+    QmiShmRing *ring;
+
+    /* Requests not sent to the device yet */
+    guint uid;
+    QmiProxySchedulerQueue *queue;
+
+    /* Time spent by the requests in the queue, in microseconds; updated in
+     * the context of the device with the proxy lock held */
+    guint n_requests;
+    gint64 total_wait;
+    gint64 max_wait;
 } Client;
 
 static gboolean connection_readable_cb (GSocket *socket, GIOCondition condition, Client *client);
 static void     track_client           (QmiProxy *self, Client *client);
 static void     untrack_client         (QmiProxy *self, Client *client);
+static void     parse_request          (QmiProxy *self, Client *client);
+static void     cache_invalidate       (Device *device, QmiService service);
+static void     client_drop_requests   (Client *client);
+static void     device_send_request    (gpointer item, gint64 wait_time, gpointer user_data);
 
 static void
-client_disconnect (Client *client)
+client_stop_reading (Client *client)
 {
     if (client->connection_readable_source) {
         g_source_destroy (client->connection_readable_source);
         g_source_unref (client->connection_readable_source);
         client->connection_readable_source = 0;
     }
+}
+
+static void
+client_start_reading (Client *client)
+{
+    if (client->connection_readable_source || !client->connection)
+        return;
+
+    client->connection_readable_source = g_socket_create_source (g_socket_connection_get_socket (client->connection),
+                                                                 G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
+                                                                 NULL);
+    g_source_set_callback (client->connection_readable_source,
+                           (GSourceFunc)connection_readable_cb,
+                           client,
+                           NULL);
+    g_source_attach (client->connection_readable_source, g_main_context_get_thread_default ());
+}
+
+static void
+client_disconnect (Client *client)
+{
+    client_stop_reading (client);
 
     if (client->connection) {
         g_debug ("Client (%d) connection closed...", g_socket_get_fd (g_socket_connection_get_socket (client->connection)));
@@ -129,14 +323,6 @@ client_unref (Client *client)
         /* Ensure disconnected */
         client_disconnect (client);
 
-        if (client->device) {
-            if (g_signal_handler_is_connected (client->device, client->indication_id))
-                g_signal_handler_disconnect (client->device, client->indication_id);
-            if (g_signal_handler_is_connected (client->device, client->device_removed_id))
-                g_signal_handler_disconnect (client->device, client->device_removed_id);
-            g_object_unref (client->device);
-        }
-
         if (client->buffer)
             g_byte_array_unref (client->buffer);
 
@@ -145,6 +331,11 @@ client_unref (Client *client)
 
         g_array_unref (client->qmi_client_info_array);
 
+        if (client->ring)
+            __qmi_shm_ring_free (client->ring);
+
+        __qmi_proxy_scheduler_queue_free (client->queue);
+
         g_slice_free (Client, client);
     }
 }
@@ -169,6 +360,18 @@ client_send_message (Client      *client,
         return FALSE;
     }
 
+    /* Once the client has activated the shared memory ring, use it until a
+     * message doesn't fit, and then fall back to the socket for good; the
+     * client always drains the ring before reading from the socket, so
+     * messages are never reordered */
+    if (client->ring && __qmi_shm_ring_is_active (client->ring)) {
+        if (__qmi_shm_ring_write (client->ring, message->data, message->len))
+            return TRUE;
+        g_debug ("Client (%d) shared memory ring full: falling back to socket",
+                 g_socket_get_fd (g_socket_connection_get_socket (client->connection)));
+        __qmi_shm_ring_close (client->ring);
+    }
+
     g_debug ("Client (%d) TX: %u bytes", g_socket_get_fd (g_socket_connection_get_socket (client->connection)), message->len);
     if (!g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
                                     message->data,
@@ -183,228 +386,694 @@ client_send_message (Client      *client,
     return TRUE;
 }
 
+/* The memfd and eventfd of the ring go along with the message, which must
+ * be the response to the proxy open request */
+static gboolean
+client_send_message_with_ring (Client      *client,
+                               QmiMessage  *message,
+                               GError     **error)
+{
+    GSocketControlMessage *scm;
+    GOutputVector vector;
+    gssize r;
+
+    scm = g_unix_fd_message_new ();
+    if (!g_unix_fd_message_append_fd (G_UNIX_FD_MESSAGE (scm), __qmi_shm_ring_get_memfd (client->ring), error) ||
+        !g_unix_fd_message_append_fd (G_UNIX_FD_MESSAGE (scm), __qmi_shm_ring_get_eventfd (client->ring), error)) {
+        g_object_unref (scm);
+        return FALSE;
+    }
+
+    vector.buffer = message->data;
+    vector.size = message->len;
+
+    g_debug ("Client (%d) TX: %u bytes (with shared memory ring)", g_socket_get_fd (g_socket_connection_get_socket (client->connection)), message->len);
+    r = g_socket_send_message (g_socket_connection_get_socket (client->connection),
+                               NULL,
+                               &vector,
+                               1,
+                               &scm,
+                               1,
+                               G_SOCKET_MSG_NONE,
+                               NULL,
+                               error);
+    g_object_unref (scm);
+
+    if (r < 0) {
+        g_prefix_error (error, "Cannot send message to client: ");
+        return FALSE;
+    }
+
+    /* Rest of the message, if any, without file descriptors */
+    if ((gsize) r < message->len &&
+        !g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
+                                    &message->data[r],
+                                    message->len - r,
+                                    NULL, /* bytes_written */
+                                    NULL, /* cancellable */
+                                    error)) {
+        g_prefix_error (error, "Cannot send message to client: ");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /*****************************************************************************/
-/* Track/untrack clients */
+/* Indication routing */
 
 static void
-track_client (QmiProxy *self,
-              Client   *client)
+device_indication_cb (QmiDevice  *qmi_device,
+                      QmiMessage *message,
+                      Device     *device)
 {
-    self->priv->clients = g_list_append (self->priv->clients, client_ref (client));
-    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_N_CLIENTS]);
+    QmiService service;
+    guint8 cid;
+    GError *error = NULL;
+
+    service = qmi_message_get_service (message);
+    cid = qmi_message_get_client_id (message);
+
+    /* Any indication may report a change in what the cached responses of
+     * the service say */
+    cache_invalidate (device, service);
+
+    if (cid == QMI_CID_BROADCAST) {
+        GPtrArray *clients;
+        guint i;
+
+        clients = device->broadcast_routes[(guint8) service];
+        if (!clients)
+            return;
+
+        for (i = 0; i < clients->len; i++) {
+            if (!client_send_message (g_ptr_array_index (clients, i), message, &error)) {
+                g_warning ("couldn't forward indication to client: %s", error->message);
+                g_clear_error (&error);
+            }
+        }
+    } else {
+        Client *client;
+
+        client = g_hash_table_lookup (device->routes, ROUTE_KEY (service, cid));
+        if (client && !client_send_message (client, message, &error)) {
+            g_warning ("couldn't forward indication to client: %s", error->message);
+            g_error_free (error);
+        }
+    }
 }
 
-static guint
-get_n_clients_with_device (QmiProxy *self,
-                           QmiDevice *device)
+static void
+device_add_route (Device     *device,
+                  Client     *client,
+                  QmiService  service,
+                  guint8      cid)
 {
-    GList *l;
-    guint n = 0;
+    GPtrArray *clients;
+    guint i;
 
-    for (l = self->priv->clients; l; l = g_list_next (l)) {
-        Client *client = l->data;
+    g_hash_table_insert (device->routes, ROUTE_KEY (service, cid), client);
 
-        if (client->device && (device == client->device ||
-            g_str_equal (qmi_device_get_path (device), qmi_device_get_path (client->device))))
-            n++;
+    clients = device->broadcast_routes[(guint8) service];
+    if (!clients) {
+        clients = g_ptr_array_new ();
+        device->broadcast_routes[(guint8) service] = clients;
     }
 
-    return n;
+    /* Broadcast indications are forwarded once per client, however many CIDs
+     * of the service it has */
+    for (i = 0; i < clients->len; i++) {
+        if (g_ptr_array_index (clients, i) == client)
+            return;
+    }
+    g_ptr_array_add (clients, client);
 }
 
 static void
-untrack_client (QmiProxy *self,
-                Client   *client)
+device_remove_route (Device     *device,
+                     Client     *client,
+                     QmiService  service,
+                     guint8      cid)
 {
-    QmiDevice *device;
+    GPtrArray *clients;
+    guint i;
 
-    device = client->device ? g_object_ref (client->device) : NULL;
+    if (g_hash_table_lookup (device->routes, ROUTE_KEY (service, cid)) == client)
+        g_hash_table_remove (device->routes, ROUTE_KEY (service, cid));
 
-    /* Disconnect the client explicitly when untracking */
-    client_disconnect (client);
+    /* Keep the client in the broadcast list while it has other CIDs of the
+     * same service */
+    for (i = 0; i < client->qmi_client_info_array->len; i++) {
+        QmiClientInfo *info;
 
-    if (g_list_find (self->priv->clients, client)) {
-        self->priv->clients = g_list_remove (self->priv->clients, client);
-        client_unref (client);
-        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_N_CLIENTS]);
+        info = &g_array_index (client->qmi_client_info_array, QmiClientInfo, i);
+        if (info->service == service && info->cid != cid)
+            return;
     }
 
-    if (!device)
+    clients = device->broadcast_routes[(guint8) service];
+    if (clients)
+        g_ptr_array_remove_fast (clients, client);
+}
+
+static void
+device_remove_client_routes (Device *device,
+                             Client *client)
+{
+    guint i;
+
+    for (i = 0; i < client->qmi_client_info_array->len; i++) {
+        QmiClientInfo *info;
+
+        info = &g_array_index (client->qmi_client_info_array, QmiClientInfo, i);
+        if (g_hash_table_lookup (device->routes, ROUTE_KEY (info->service, info->cid)) == client)
+            g_hash_table_remove (device->routes, ROUTE_KEY (info->service, info->cid));
+        if (device->broadcast_routes[(guint8) info->service])
+            g_ptr_array_remove_fast (device->broadcast_routes[(guint8) info->service], client);
+    }
+}
+
+/*****************************************************************************/
+/* Device lifecycle */
+
+static void client_device_ready (Client *client);
+
+static void
+device_free (Device *device)
+{
+    guint i;
+
+    g_assert (!device->pending_clients);
+
+    if (device->qmi_device) {
+        if (g_signal_handler_is_connected (device->qmi_device, device->indication_id))
+            g_signal_handler_disconnect (device->qmi_device, device->indication_id);
+        g_object_unref (device->qmi_device);
+    }
+    g_hash_table_unref (device->routes);
+    for (i = 0; i < G_N_ELEMENTS (device->broadcast_routes); i++)
+        g_clear_pointer (&device->broadcast_routes[i], g_ptr_array_unref);
+    /* Requests in flight may still keep the cache and the scheduler around,
+     * but nothing else is sent */
+    if (device->cache)
+        __qmi_proxy_cache_unref (device->cache);
+    __qmi_proxy_scheduler_stop (device->scheduler);
+    __qmi_proxy_scheduler_unref (device->scheduler);
+    if (device->thread)
+        g_thread_unref (device->thread);
+    if (device->loop)
+        g_main_loop_unref (device->loop);
+    g_main_context_unref (device->context);
+    g_free (device->path);
+    g_slice_free (Device, device);
+}
+
+static gboolean
+device_stop_cb (Device *device)
+{
+    /* Wait for the open operation to finish before closing */
+    if (device->opening) {
+        device->stop_pending = TRUE;
+        return G_SOURCE_REMOVE;
+    }
+
+    if (device->qmi_device) {
+        g_debug ("closing device '%s': no longer used", qmi_device_get_path_display (device->qmi_device));
+        if (g_signal_handler_is_connected (device->qmi_device, device->indication_id))
+            g_signal_handler_disconnect (device->qmi_device, device->indication_id);
+        qmi_device_close_async (device->qmi_device, 0, NULL, NULL, NULL);
+    }
+
+    /* The thread of the device frees it once its loop is done */
+    if (device->thread)
+        g_main_loop_quit (device->loop);
+    else
+        device_free (device);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+device_stop (Device *device)
+{
+    g_main_context_invoke (device->context, (GSourceFunc) device_stop_cb, device);
+}
+
+static void
+device_open_finish (Device    *device,
+                    QmiDevice *qmi_device)
+{
+    GList *pending;
+    GList *l;
+
+    device->opening = FALSE;
+
+    if (qmi_device) {
+        device->qmi_device = g_object_ref (qmi_device);
+        __qmi_proxy_scheduler_start (device->scheduler, g_get_monotonic_time ());
+        device->indication_id = g_signal_connect (qmi_device,
+                                                  "indication",
+                                                  G_CALLBACK (device_indication_cb),
+                                                  device);
+    }
+
+    /* All clients were untracked while opening */
+    if (device->stop_pending) {
+        device_stop_cb (device);
         return;
+    }
 
-    /* If no more clients using the device, close and cleanup */
-    if (get_n_clients_with_device (self, device) == 0) {
-        GList *l;
+    /* Note: if the open failed, the device is freed along with its last
+     * pending client */
+    pending = device->pending_clients;
+    device->pending_clients = NULL;
+    for (l = pending; l; l = g_list_next (l)) {
+        Client *client = l->data;
 
-        for (l = self->priv->devices; l; l = g_list_next (l)) {
-            QmiDevice *device_in_list = QMI_DEVICE (l->data);
+        if (client->device != device)
+            continue;
+        if (qmi_device)
+            client_device_ready (client);
+        else
+            untrack_client (client->proxy, client);
+    }
+    g_list_free_full (pending, (GDestroyNotify) client_unref);
+}
 
-            if (device_in_list && (device == device_in_list ||
-                g_str_equal (qmi_device_get_path (device), qmi_device_get_path (device_in_list)))) {
-                g_debug ("closing device '%s': no longer used", qmi_device_get_path_display (device));
-                qmi_device_close_async (device_in_list, 0, NULL, NULL, NULL);
-                g_object_unref (device_in_list);
-                self->priv->devices = g_list_remove (self->priv->devices, device_in_list);
-                break;
-            }
-        }
+static void
+device_open_ready (QmiDevice    *qmi_device,
+                   GAsyncResult *res,
+                   Device       *device)
+{
+    GError *error = NULL;
+
+    if (!qmi_device_open_finish (qmi_device, res, &error)) {
+        g_debug ("couldn't open QMI device: %s", error->message);
+        g_error_free (error);
+        device_open_finish (device, NULL);
+        return;
+    }
+
+    device_open_finish (device, qmi_device);
+}
+
+static void
+device_new_ready (GObject      *source,
+                  GAsyncResult *res,
+                  Device       *device)
+{
+    QmiDevice *qmi_device;
+    GError *error = NULL;
+
+    qmi_device = qmi_device_new_finish (res, &error);
+    if (!qmi_device) {
+        g_debug ("couldn't open QMI device: %s", error->message);
+        g_error_free (error);
+        device_open_finish (device, NULL);
+        return;
     }
 
-    g_object_unref (device);
+    qmi_device_open (qmi_device,
+                     QMI_DEVICE_OPEN_FLAGS_NONE,
+                     10,
+                     NULL,
+                     (GAsyncReadyCallback)device_open_ready,
+                     device);
+    g_object_unref (qmi_device);
+}
+
+static gboolean
+device_open_cb (Device *device)
+{
+    GFile *file;
+
+    /* Created in the context of the device, so that all its I/O runs there */
+    file = g_file_new_for_path (device->path);
+    qmi_device_new (file,
+                    NULL,
+                    (GAsyncReadyCallback)device_new_ready,
+                    device);
+    g_object_unref (file);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer
+device_thread_func (Device *device)
+{
+    g_main_context_push_thread_default (device->context);
+    g_main_loop_run (device->loop);
+    g_main_context_pop_thread_default (device->context);
+
+    device_free (device);
+    return NULL;
+}
+
+/* Must be called with the proxy lock held */
+static Device *
+device_new (QmiProxy    *self,
+            const gchar *path)
+{
+    Device *device;
+
+    device = g_slice_new0 (Device);
+    device->proxy = self;
+    device->path = g_strdup (path);
+    device->routes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    device->opening = TRUE;
+    device->scheduler = __qmi_proxy_scheduler_new (self->priv->max_in_flight, device_send_request, device);
+
+    if (self->priv->device_threads) {
+        device->context = g_main_context_new ();
+        device->loop = g_main_loop_new (device->context, FALSE);
+        device->thread = g_thread_new ("qmi-proxy-device", (GThreadFunc) device_thread_func, device);
+    } else
+        device->context = g_main_context_ref (self->priv->context);
+
+    g_main_context_invoke (device->context, (GSourceFunc) device_open_cb, device);
+    return device;
 }
 
-static QmiDevice *
-find_device_for_path (QmiProxy *self,
+/* Must be called with the proxy lock held */
+static Device *
+find_device_for_path (QmiProxy    *self,
                       const gchar *path)
 {
     GList *l;
 
     for (l = self->priv->devices; l; l = g_list_next (l)) {
-        QmiDevice *device;
+        Device *device;
 
-        device = (QmiDevice *)l->data;
+        device = (Device *)l->data;
 
         /* Return if found */
-        if (g_str_equal (qmi_device_get_path (device), path))
+        if (g_str_equal (device->path, path))
             return device;
     }
 
     return NULL;
 }
 
+/*****************************************************************************/
+/* Track/untrack clients */
+
 static void
-complete_internal_proxy_open (QmiProxy *self,
-                              Client   *client)
+join_stopped_threads (QmiProxy *self)
 {
-    QmiMessage *response;
-    GError *error = NULL;
+    GList *threads;
+    GList *l;
 
-    g_debug ("connection to QMI device '%s' established", qmi_device_get_path (client->device));
+    g_mutex_lock (&self->priv->lock);
+    threads = self->priv->stopped_threads;
+    self->priv->stopped_threads = NULL;
+    g_mutex_unlock (&self->priv->lock);
 
-    g_assert (client->internal_proxy_open_request != NULL);
-    response = qmi_message_response_new (client->internal_proxy_open_request, QMI_PROTOCOL_ERROR_NONE);
-    qmi_message_unref (client->internal_proxy_open_request);
-    client->internal_proxy_open_request = NULL;
+    /* Each thread exits right after freeing its device */
+    for (l = threads; l; l = g_list_next (l))
+        g_thread_join ((GThread *)l->data);
+    g_list_free (threads);
+}
 
-    if (!client_send_message (client, response, &error)) {
-        g_warning ("couldn't send proxy open response to client: %s", error->message);
-        g_error_free (error);
-        untrack_client (self, client);
-    }
+static gboolean
+join_stopped_threads_cb (QmiProxy *self)
+{
+    join_stopped_threads (self);
+    return G_SOURCE_REMOVE;
+}
 
-    qmi_message_unref (response);
+static void
+track_client (QmiProxy *self,
+              Client   *client)
+{
+    g_mutex_lock (&self->priv->lock);
+    self->priv->clients = g_list_append (self->priv->clients, client_ref (client));
+    g_mutex_unlock (&self->priv->lock);
+
+    notify_n_clients (self);
 }
 
 static void
-indication_cb (QmiDevice *device,
-               QmiMessage *message,
-               Client *client)
+untrack_client (QmiProxy *self,
+                Client   *client)
 {
-    guint i;
+    Device *device;
+    gboolean found;
+    gboolean notify;
+    gboolean last = FALSE;
+    gboolean join = FALSE;
 
-    for (i = 0; i < client->qmi_client_info_array->len; i++) {
-        QmiClientInfo *info;
+    device = client->device;
 
-        info = &g_array_index (client->qmi_client_info_array, QmiClientInfo, i);
-        /* If service and CID match; or if service and broadcast, forward to
-         * the remote client */
-        if ((qmi_message_get_service (message) == info->service) &&
-            (qmi_message_get_client_id (message) == info->cid ||
-             qmi_message_get_client_id (message) == QMI_CID_BROADCAST)) {
-            GError *error = NULL;
-
-            if (!client_send_message (client, message, &error)) {
-                g_warning ("couldn't forward indication to client: %s", error->message);
-                g_error_free (error);
-            }
+    /* Disconnect the client explicitly when untracking, which also prevents
+     * new routes from being added by responses still in flight, and its
+     * requests from being queued again */
+    client_disconnect (client);
 
-            /* Avoid forwarding broadcast messages multiple times */
-            break;
+    /* Stop forwarding indications and device events to the client; only
+     * clients already attached to the device context have any of them */
+    if (device && client->attached) {
+        GList *l;
+
+        device_remove_client_routes (device, client);
+
+        if (device->qmi_device) {
+            if (g_signal_handler_is_connected (device->qmi_device, client->device_removed_id))
+                g_signal_handler_disconnect (device->qmi_device, client->device_removed_id);
+            if (g_signal_handler_is_connected (device->qmi_device, client->output_blocked_id))
+                g_signal_handler_disconnect (device->qmi_device, client->output_blocked_id);
+            client->device_removed_id = 0;
+            client->output_blocked_id = 0;
+        }
+
+        client_drop_requests (client);
+
+        l = g_list_find (device->pending_clients, client);
+        if (l) {
+            device->pending_clients = g_list_delete_link (device->pending_clients, l);
+            client_unref (client);
+        }
+    }
+
+    g_mutex_lock (&self->priv->lock);
+    found = !!g_list_find (self->priv->clients, client);
+    if (found) {
+        self->priv->clients = g_list_remove (self->priv->clients, client);
+        if (device) {
+            client->device = NULL;
+            g_assert (device->n_clients > 0);
+            /* If no more clients using the device, it can no longer be found
+             * by new clients */
+            if (--device->n_clients == 0) {
+                self->priv->devices = g_list_remove (self->priv->devices, device);
+                last = TRUE;
+                /* When disposing, all threads are joined right away */
+                if (device->thread && !self->priv->disposing) {
+                    self->priv->stopped_threads = g_list_prepend (self->priv->stopped_threads, g_thread_ref (device->thread));
+                    join = TRUE;
+                }
+            }
         }
     }
+    notify = found && !self->priv->disposing;
+    g_mutex_unlock (&self->priv->lock);
+
+    if (!found)
+        return;
+
+    if (notify)
+        notify_n_clients (self);
+
+    /* Close and cleanup; the thread of the device, if any, is joined once
+     * the device is freed */
+    if (last)
+        device_stop (device);
+    if (join)
+        g_main_context_invoke_full (self->priv->context,
+                                    G_PRIORITY_DEFAULT,
+                                    (GSourceFunc) join_stopped_threads_cb,
+                                    g_object_ref (self),
+                                    (GDestroyNotify) g_object_unref);
+
+    client_unref (client);
 }
 
-static void
-device_removed_cb (QmiDevice *device,
-                   Client *client)
+typedef struct {
+    guint   uid;
+    gchar  *device_path;
+    guint   n_requests;
+    gint64  total_wait;
+    gint64  max_wait;
+} ClientStats;
+
+void
+qmi_proxy_foreach_client_stats (QmiProxy                     *self,
+                                QmiProxyClientStatsForeachFn  callback,
+                                gpointer                      user_data)
 {
-    untrack_client (client->proxy, client);
+    ClientStats *stats;
+    guint n_stats;
+    guint i;
+    GList *l;
+
+    g_return_if_fail (QMI_IS_PROXY (self));
+    g_return_if_fail (callback != NULL);
+
+    /* Copied under the lock, reported without it */
+    g_mutex_lock (&self->priv->lock);
+    stats = g_new0 (ClientStats, g_list_length (self->priv->clients));
+    for (l = self->priv->clients, n_stats = 0; l; l = g_list_next (l), n_stats++) {
+        Client *client = l->data;
+
+        stats[n_stats].uid = client->uid;
+        stats[n_stats].device_path = client->device ? g_strdup (client->device->path) : NULL;
+        stats[n_stats].n_requests = client->n_requests;
+        stats[n_stats].total_wait = client->total_wait;
+        stats[n_stats].max_wait = client->max_wait;
+    }
+    g_mutex_unlock (&self->priv->lock);
+
+    for (i = 0; i < n_stats; i++) {
+        callback (stats[i].uid,
+                  stats[i].device_path,
+                  stats[i].n_requests,
+                  stats[i].total_wait,
+                  stats[i].max_wait,
+                  user_data);
+        g_free (stats[i].device_path);
+    }
+    g_free (stats);
 }
 
 static void
-device_open_ready (QmiDevice *device,
-                   GAsyncResult *res,
-                   Client *client)
+device_output_blocked_cb (QmiDevice  *device,
+                          GParamSpec *pspec,
+                          Client     *client)
+{
+    gboolean blocked;
+
+    /* Stop reading requests from the client while the device cannot take
+     * them, so that a slow device only stalls its own clients */
+    g_object_get (device, QMI_DEVICE_OUTPUT_BLOCKED, &blocked, NULL);
+    if (blocked)
+        client_stop_reading (client);
+    else
+        client_start_reading (client);
+}
+
+static gboolean
+complete_internal_proxy_open (QmiProxy *self,
+                              Client   *client)
 {
-    QmiProxy *self = client->proxy;
-    QmiDevice *existing;
+    QmiMessage *response;
     GError *error = NULL;
+    gboolean sent;
 
-    /* Note: we get a full client ref */
+    g_debug ("connection to QMI device '%s' established", qmi_device_get_path (client->device->qmi_device));
 
-    if (!qmi_device_open_finish (device, res, &error)) {
-        g_debug ("couldn't open QMI device: %s", error->message);
+    g_assert (client->internal_proxy_open_request != NULL);
+    response = qmi_message_response_new (client->internal_proxy_open_request, QMI_PROTOCOL_ERROR_NONE);
+
+    /* Offer the shared memory ring if requested; if it cannot be setup, the
+     * response doesn't report it and the socket is used for everything */
+    if (client->ring_size) {
+        gsize init_offset;
+
+        client->ring = __qmi_shm_ring_new (client->ring_size, &error);
+        if (!client->ring ||
+            !(init_offset = qmi_message_tlv_write_init (response, QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_OUTPUT_TLV_SHM_RING_SIZE, &error)) ||
+            !qmi_message_tlv_write_guint32 (response, QMI_ENDIAN_LITTLE, __qmi_shm_ring_get_size (client->ring), &error) ||
+            !qmi_message_tlv_write_complete (response, init_offset, &error)) {
+            g_debug ("couldn't setup shared memory ring for client: %s", error->message);
+            g_clear_error (&error);
+            g_clear_pointer (&client->ring, __qmi_shm_ring_free);
+            qmi_message_unref (response);
+            response = qmi_message_response_new (client->internal_proxy_open_request, QMI_PROTOCOL_ERROR_NONE);
+        }
+    }
+
+    qmi_message_unref (client->internal_proxy_open_request);
+    client->internal_proxy_open_request = NULL;
+
+    if (client->ring)
+        sent = client_send_message_with_ring (client, response, &error);
+    else
+        sent = client_send_message (client, response, &error);
+    qmi_message_unref (response);
+
+    if (!sent) {
+        g_warning ("couldn't send proxy open response to client: %s", error->message);
         g_error_free (error);
         untrack_client (self, client);
-        goto out;
     }
 
-    /* Store device in the proxy independently */
-    existing = find_device_for_path (self, qmi_device_get_path (client->device));
-    if (existing) {
-        /* Race condition, we created two QmiDevices for the same port, just skip ours, no big deal */
-        g_object_unref (client->device);
-        client->device = g_object_ref (existing);
-    } else {
-        /* Keep the newly added device in the proxy */
-        self->priv->devices = g_list_append (self->priv->devices, g_object_ref (client->device));
-    }
+    return sent;
+}
+
+static void
+device_removed_cb (QmiDevice *device,
+                   Client *client)
+{
+    untrack_client (client->proxy, client);
+}
+
+/* Run in the context of the device, once it is open */
+static void
+client_device_ready (Client *client)
+{
+    QmiDevice *qmi_device;
 
-    /* Register for device indications */
-    client->indication_id = g_signal_connect (client->device,
-                                              "indication",
-                                              G_CALLBACK (indication_cb),
-                                              client);
-    client->device_removed_id = g_signal_connect (client->device,
+    qmi_device = client->device->qmi_device;
+    client->device_removed_id = g_signal_connect (qmi_device,
                                                   "device-removed",
                                                   G_CALLBACK (device_removed_cb),
                                                   client);
+    client->output_blocked_id = g_signal_connect (qmi_device,
+                                                  "notify::" QMI_DEVICE_OUTPUT_BLOCKED,
+                                                  G_CALLBACK (device_output_blocked_cb),
+                                                  client);
 
-    complete_internal_proxy_open (self, client);
+    if (!complete_internal_proxy_open (client->proxy, client))
+        return;
 
-out:
-    /* Balance out the reference we got */
-    client_unref (client);
+    /* From now on, requests are read in the context of the device; process
+     * right away the ones received along with the open request */
+    client_start_reading (client);
+    if (client->buffer && client->buffer->len > 0)
+        parse_request (client->proxy, client);
 }
 
-static void
-device_new_ready (GObject *source,
-                  GAsyncResult *res,
-                  Client *client)
+static gboolean
+client_attach_cb (Client *client)
 {
-    QmiProxy *self = client->proxy;
-    GError *error = NULL;
+    Device *device;
 
-    /* Note: we get a full client ref */
+    /* Untracked while being handed off */
+    device = client->device;
+    if (!device)
+        return G_SOURCE_REMOVE;
 
-    client->device = qmi_device_new_finish (res, &error);
-    if (!client->device) {
-        g_debug ("couldn't open QMI device: %s", error->message);
-        g_error_free (error);
-        untrack_client (self, client);
-        goto out;
-    }
+    client->attached = TRUE;
 
-    qmi_device_open (client->device,
-                     QMI_DEVICE_OPEN_FLAGS_NONE,
-                     10,
-                     NULL,
-                     (GAsyncReadyCallback)device_open_ready,
-                     client_ref (client)); /* Full ref */
+    if (device->opening)
+        device->pending_clients = g_list_append (device->pending_clients, client_ref (client));
+    else if (device->qmi_device)
+        client_device_ready (client);
+    else
+        untrack_client (client->proxy, client);
 
-out:
-    /* Balance out the reference we got */
-    client_unref (client);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+client_hand_off (Client *client)
+{
+    /* Nothing else is read from the client until it is attached in the
+     * context of the device */
+    client_stop_reading (client);
+    g_main_context_invoke_full (client->device->context,
+                                G_PRIORITY_DEFAULT,
+                                (GSourceFunc) client_attach_cb,
+                                client_ref (client),
+                                (GDestroyNotify) client_unref);
 }
 
 static gboolean
@@ -415,8 +1084,14 @@ process_internal_proxy_open (QmiProxy   *self,
     gsize   offset = 0;
     gsize   init_offset;
     gchar  *device_file_path;
+    Device *device;
     GError *error = NULL;
 
+    if (client->device) {
+        g_debug ("ignoring message from client: device already open");
+        return FALSE;
+    }
+
     if ((init_offset = qmi_message_tlv_read_init (message, QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_INPUT_TLV_DEVICE_PATH, NULL, &error)) == 0) {
         g_debug ("ignoring message from client: invalid proxy open request: %s", error->message);
         g_error_free (error);
@@ -433,39 +1108,37 @@ process_internal_proxy_open (QmiProxy   *self,
     if ((offset = __qmi_message_tlv_read_remaining_size (message, init_offset, offset)) > 0)
         g_warning ("Left '%" G_GSIZE_FORMAT "' bytes unread when getting the 'Device Path' TLV", offset);
 
+    /* Optional shared memory ring requested by the client */
+    offset = 0;
+    if ((init_offset = qmi_message_tlv_read_init (message, QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN_INPUT_TLV_SHM_RING_SIZE, NULL, NULL)) > 0 &&
+        !qmi_message_tlv_read_guint32 (message, init_offset, &offset, QMI_ENDIAN_LITTLE, &client->ring_size, NULL))
+        client->ring_size = 0;
+
     g_debug ("valid request to open connection to QMI device file: %s", device_file_path);
 
     /* Keep it */
     client->internal_proxy_open_request = qmi_message_ref (message);
 
-    client->device = find_device_for_path (self, device_file_path);
-
-    /* Need to create a device ourselves */
-    if (!client->device) {
-        GFile *file;
-
-        file = g_file_new_for_path (device_file_path);
-        qmi_device_new (file,
-                        NULL,
-                        (GAsyncReadyCallback)device_new_ready,
-                        client_ref (client)); /* Full ref */
-        g_object_unref (file);
-        g_free (device_file_path);
-        return TRUE;
+    /* Need to create a device ourselves if not found; the client is handed
+     * off to the context of the device by the caller */
+    g_mutex_lock (&self->priv->lock);
+    device = find_device_for_path (self, device_file_path);
+    if (!device) {
+        device = device_new (self, device_file_path);
+        self->priv->devices = g_list_append (self->priv->devices, device);
     }
+    device->n_clients++;
+    client->device = device;
+    g_mutex_unlock (&self->priv->lock);
 
     g_free (device_file_path);
-
-    /* Keep a reference to the device in the client */
-    g_object_ref (client->device);
-
-    complete_internal_proxy_open (self, client);
-    return FALSE;
+    return TRUE;
 }
 
 static void
-track_cid (Client *client,
-           gboolean track,
+track_cid (QmiProxy   *self,
+           Client     *client,
+           gboolean    track,
            QmiMessage *message)
 {
     gsize          offset = 0;
@@ -477,6 +1150,13 @@ track_cid (Client *client,
     QmiClientInfo  info;
     gboolean       exists;
     guint          i;
+    Device        *device;
+
+    /* Responses may still arrive for clients already untracked, which no
+     * longer have a device; no routes for those */
+    device = client->connection ? client->device : NULL;
+    if (!device)
+        return;
 
     if (((init_offset = qmi_message_tlv_read_init (message, QMI_MESSAGE_OUTPUT_TLV_RESULT, NULL, &error)) == 0) ||
         !qmi_message_tlv_read_guint16 (message, init_offset, &offset, QMI_ENDIAN_LITTLE, &error_status, &error) ||
@@ -511,23 +1191,33 @@ track_cid (Client *client,
 
     if (track && !exists) {
         g_debug ("QMI client tracked [%s,%s,%u]",
-                 qmi_device_get_path_display (client->device),
+                 qmi_device_get_path_display (device->qmi_device),
                  qmi_service_get_string (info.service),
                  info.cid);
         g_array_append_val (client->qmi_client_info_array, info);
+        device_add_route (device, client, info.service, info.cid);
     } else if (!track && exists) {
         g_debug ("QMI client untracked [%s,%s,%u]",
-                 qmi_device_get_path_display (client->device),
+                 qmi_device_get_path_display (device->qmi_device),
                  qmi_service_get_string (info.service),
                  info.cid);
+        device_remove_route (device, client, info.service, info.cid);
         g_array_remove_index (client->qmi_client_info_array, i);
     }
 }
 
 typedef struct {
-    QmiProxy *self;   /* Full ref */
-    Client   *client; /* Full ref */
-    guint8    in_trid;
+    Client     *client; /* Full ref */
+    QmiMessage *message;
+    guint8      in_cid;
+    guint16     in_trid;
+
+    /* Set once in flight */
+    QmiProxyScheduler *scheduler;
+
+    /* Cache entry to complete with the response, if any */
+    QmiProxyCache *cache;
+    GBytes        *cache_key;
 } Request;
 
 static void
@@ -535,23 +1225,284 @@ request_free (Request *request)
 {
     if (!request)
         return;
+    if (request->scheduler)
+        __qmi_proxy_scheduler_unref (request->scheduler);
+    if (request->message)
+        qmi_message_unref (request->message);
+    if (request->cache_key)
+        g_bytes_unref (request->cache_key);
+    if (request->cache)
+        __qmi_proxy_cache_unref (request->cache);
     client_unref (request->client);
-    g_object_unref (request->self);
     g_slice_free (Request, request);
 }
 
 static void
-device_command_ready (QmiDevice *device,
+request_reply (Request    *request,
+               QmiMessage *response)
+{
+    QmiMessage *copy;
+    GError *error = NULL;
+
+    /* Untracked in the meantime */
+    if (!request->client->connection)
+        return;
+
+    copy = __qmi_message_copy (response, request->in_cid, request->in_trid);
+    if (!client_send_message (request->client, copy, &error)) {
+        g_warning ("sending response to client failed: %s", error->message);
+        g_error_free (error);
+        untrack_client (request->client->proxy, request->client);
+    }
+    qmi_message_unref (copy);
+}
+
+static void
+request_queue (Request *request)
+{
+    Client *client;
+
+    client = request->client;
+    __qmi_proxy_scheduler_push (client->device->scheduler,
+                                client->queue,
+                                request,
+                                qmi_message_get_length (request->message),
+                                g_get_monotonic_time ());
+}
+
+/*****************************************************************************/
+/* Response cache
+ *
+ * Responses to the messages with a time to live configured are kept in the
+ * cache of the device, so that identical requests from any client are
+ * replied right away. Identical requests sent while the first one is still
+ * in flight are coalesced, and all of them are replied with the same
+ * response. If the device doesn't reply, the coalesced requests are queued
+ * again on their own, the first one taking over the entry in flight.
+ *
+ * Entries are invalidated whenever an indication of the same service is
+ * received, and all of them when the device is reset. Entries still in
+ * flight when invalidated are marked as stale, and are removed once their
+ * response arrives instead of being kept. */
+
+static guint
+cache_get_ttl (QmiProxy   *self,
+               QmiMessage *message)
+{
+    guint ttl = 0;
+
+    /* Never cache messages that change the state of the proxy itself */
+    if (qmi_message_get_service (message) == QMI_SERVICE_CTL &&
+        (qmi_message_get_message_id (message) == QMI_MESSAGE_CTL_ALLOCATE_CID ||
+         qmi_message_get_message_id (message) == QMI_MESSAGE_CTL_RELEASE_CID))
+        return 0;
+
+    g_mutex_lock (&self->priv->lock);
+    if (self->priv->cache_ttls)
+        ttl = GPOINTER_TO_UINT (g_hash_table_lookup (self->priv->cache_ttls,
+                                                     CACHE_TTL_KEY (qmi_message_get_service (message),
+                                                                    qmi_message_get_message_id (message))));
+    g_mutex_unlock (&self->priv->lock);
+
+    return ttl;
+}
+
+/* Returns TRUE if the request is already taken care of by the cache */
+static gboolean
+cache_process_request (QmiProxy   *self,
+                       Device     *device,
+                       QmiMessage *message,
+                       Request    *request)
+{
+    QmiMessage *response = NULL;
+    GBytes *key = NULL;
+    guint ttl;
+
+    ttl = cache_get_ttl (self, message);
+    if (!ttl)
+        return FALSE;
+
+    if (!device->cache)
+        device->cache = __qmi_proxy_cache_new ((GDestroyNotify) request_free);
+
+    switch (__qmi_proxy_cache_lookup (device->cache, message, ttl, g_get_monotonic_time (), request, &response, &key)) {
+    case QMI_PROXY_CACHE_LOOKUP_HIT:
+        g_debug ("replying request from cache [%s,0x%04x]",
+                 qmi_service_get_string (qmi_message_get_service (message)),
+                 qmi_message_get_message_id (message));
+        request_reply (request, response);
+        qmi_message_unref (response);
+        request_free (request);
+        return TRUE;
+    case QMI_PROXY_CACHE_LOOKUP_COALESCED:
+        g_debug ("coalescing request with the one in flight [%s,0x%04x]",
+                 qmi_service_get_string (qmi_message_get_service (message)),
+                 qmi_message_get_message_id (message));
+        return TRUE;
+    case QMI_PROXY_CACHE_LOOKUP_MISS:
+        request->cache = __qmi_proxy_cache_ref (device->cache);
+        request->cache_key = key;
+        return FALSE;
+    case QMI_PROXY_CACHE_LOOKUP_UNCACHEABLE:
+    default:
+        return FALSE;
+    }
+}
+
+static void
+request_requeue (Request *request)
+{
+    Client *client;
+
+    /* Untracked in the meantime */
+    client = request->client;
+    if (!client->connection || !client->device) {
+        request_free (request);
+        return;
+    }
+
+    if (!cache_process_request (client->proxy, client->device, request->message, request))
+        request_queue (request);
+}
+
+static void
+cache_process_response (Request    *request,
+                        QmiMessage *response)
+{
+    GList *waiters;
+    GList *l;
+
+    waiters = __qmi_proxy_cache_complete (request->cache, request->cache_key, response, g_get_monotonic_time ());
+    g_clear_pointer (&request->cache_key, g_bytes_unref);
+
+    /* If the device didn't reply, the coalesced requests are queued again
+     * instead of being dropped along with the original one */
+    for (l = waiters; l; l = g_list_next (l)) {
+        if (response) {
+            request_reply ((Request *)l->data, response);
+            request_free ((Request *)l->data);
+        } else
+            request_requeue ((Request *)l->data);
+    }
+    g_list_free (waiters);
+}
+
+static void
+cache_invalidate (Device     *device,
+                  QmiService  service)
+{
+    if (device->cache)
+        __qmi_proxy_cache_invalidate (device->cache, service);
+}
+
+/*****************************************************************************/
+/* Request scheduling
+ *
+ * Requests are queued per client, and released to the device by the
+ * deficit round-robin scheduler of the device, so that clients sending
+ * lots of requests don't delay the ones of other clients once the number
+ * of requests in flight is capped. The time spent by the requests of each
+ * client in the queue is kept for qmi_proxy_foreach_client_stats(). */
+
+static void device_command_ready (QmiDevice    *device,
+                                  GAsyncResult *res,
+                                  Request      *request);
+
+static void
+device_send_request (gpointer item,
+                     gint64   wait_time,
+                     gpointer user_data)
+{
+    Request *request = item;
+    Device *device = user_data;
+    Client *client;
+
+    client = request->client;
+    g_mutex_lock (&device->proxy->priv->lock);
+    client->n_requests++;
+    client->total_wait += wait_time;
+    if (wait_time > client->max_wait)
+        client->max_wait = wait_time;
+    g_mutex_unlock (&device->proxy->priv->lock);
+
+    if (qmi_message_get_service (request->message) == QMI_SERVICE_CTL)
+        qmi_message_set_transaction_id (request->message, 0);
+
+    request->scheduler = __qmi_proxy_scheduler_ref (device->scheduler);
+
+    /* The timeout needs to be big enough for any kind of transaction to
+     * complete, otherwise the remote clients will lose the reply if they
+     * configured a timeout bigger than this internal one. We should likely
+     * make this value configurable per-client, instead of a hardcoded value.
+     *
+     * Note: the proxy will not translate vendor-specific messages in its
+     * logs (as it doesn't have the orignal message context with the vendor id).
+     */
+    qmi_device_command (device->qmi_device,
+                        request->message,
+                        300,
+                        NULL,
+                        (GAsyncReadyCallback)device_command_ready,
+                        request);
+}
+
+static void
+client_drop_requests (Client *client)
+{
+    GList *requests;
+    GList *l;
+
+    if (client->n_requests > 0)
+        g_debug ("client (uid %u) scheduling stats: %u requests sent, queue wait time %.3f ms average, %.3f ms max",
+                 client->uid,
+                 client->n_requests,
+                 (gdouble) client->total_wait / client->n_requests / 1000.0,
+                 (gdouble) client->max_wait / 1000.0);
+
+    /* The requests coalesced with the ones dropped are queued again on
+     * their own */
+    requests = __qmi_proxy_scheduler_flush (client->device->scheduler, client->queue);
+    for (l = requests; l; l = g_list_next (l)) {
+        Request *request = l->data;
+
+        if (request->cache_key)
+            cache_process_response (request, NULL);
+        request_free (request);
+    }
+    g_list_free (requests);
+}
+
+/*****************************************************************************/
+
+static void
+device_command_ready (QmiDevice    *device,
                       GAsyncResult *res,
-                      Request *request)
+                      Request      *request)
 {
     QmiMessage *response;
     GError *error = NULL;
 
+    /* Release the next request right away */
+    __qmi_proxy_scheduler_complete (request->scheduler, g_get_monotonic_time ());
+
     response = qmi_device_command_finish (device, res, &error);
     if (!response) {
         g_warning ("sending request to device failed: %s", error->message);
         g_error_free (error);
+        if (request->cache_key)
+            cache_process_response (request, NULL);
+        request_free (request);
+        return;
+    }
+
+    /* Coalesced requests are replied even if the original client is gone */
+    if (request->cache_key)
+        cache_process_response (request, response);
+
+    /* The client may have been untracked in the meantime, and the proxy
+     * itself may be gone; nothing else to do */
+    if (!request->client->connection) {
+        qmi_message_unref (response);
         request_free (request);
         return;
     }
@@ -559,15 +1510,23 @@ device_command_ready (QmiDevice *device,
     if (qmi_message_get_service (response) == QMI_SERVICE_CTL) {
         qmi_message_set_transaction_id (response, request->in_trid);
         if (qmi_message_get_message_id (response) == QMI_MESSAGE_CTL_ALLOCATE_CID)
-            track_cid (request->client, TRUE, response);
+            track_cid (request->client->proxy, request->client, TRUE, response);
         else if (qmi_message_get_message_id (response) == QMI_MESSAGE_CTL_RELEASE_CID)
-            track_cid (request->client, FALSE, response);
+            track_cid (request->client->proxy, request->client, FALSE, response);
     }
 
+    /* Nothing cached is valid after a reset */
+    if (((qmi_message_get_service (response) == QMI_SERVICE_CTL &&
+          qmi_message_get_message_id (response) == QMI_MESSAGE_CTL_SYNC) ||
+         (qmi_message_get_service (response) == QMI_SERVICE_DMS &&
+          qmi_message_get_message_id (response) == QMI_MESSAGE_DMS_SET_OPERATING_MODE)) &&
+        request->client->device)
+        cache_invalidate (request->client->device, QMI_SERVICE_CTL);
+
     if (!client_send_message (request->client, response, &error)) {
         g_warning ("sending request to device failed: %s", error->message);
         g_error_free (error);
-        untrack_client (request->self, request->client);
+        untrack_client (request->client->proxy, request->client);
     }
 
     qmi_message_unref (response);
@@ -591,29 +1550,19 @@ process_message (QmiProxy   *self,
         qmi_message_get_message_id (message) == QMI_MESSAGE_CTL_INTERNAL_PROXY_OPEN)
         return process_internal_proxy_open (self, client, message);
 
+    if (!client->attached) {
+        g_debug ("ignoring message from client: device not open yet");
+        return FALSE;
+    }
+
     request = g_slice_new0 (Request);
-    request->self = g_object_ref (self);
     request->client = client_ref (client);
+    request->message = qmi_message_ref (message);
+    request->in_cid = qmi_message_get_client_id (message);
+    request->in_trid = qmi_message_get_transaction_id (message);
 
-    if (qmi_message_get_service (message) == QMI_SERVICE_CTL) {
-        request->in_trid = qmi_message_get_transaction_id (message);
-        qmi_message_set_transaction_id (message, 0);
-    }
-
-    /* The timeout needs to be big enough for any kind of transaction to
-     * complete, otherwise the remote clients will lose the reply if they
-     * configured a timeout bigger than this internal one. We should likely
-     * make this value configurable per-client, instead of a hardcoded value.
-     *
-     * Note: the proxy will not translate vendor-specific messages in its
-     * logs (as it doesn't have the orignal message context with the vendor id).
-     */
-    qmi_device_command (client->device,
-                        message,
-                        300,
-                        NULL,
-                        (GAsyncReadyCallback)device_command_ready,
-                        request);
+    if (!cache_process_request (self, client->device, message, request))
+        request_queue (request);
     return TRUE;
 }
 
@@ -621,26 +1570,39 @@ static void
 parse_request (QmiProxy *self,
                Client   *client)
 {
-    do {
+    gsize offset = 0;
+
+    /* Requests replied right away from the cache may untrack the client if
+     * sending the response fails */
+    client_ref (client);
+
+    /* Parse all complete messages in place, and only remove them from the
+     * buffer once all have been processed */
+    while (offset < client->buffer->len && client->connection) {
         GError *error = NULL;
         QmiMessage *message;
+        gsize consumed = 0;
 
         /* Every message received must start with the QMUX marker.
          * If it doesn't, we broke framing :-/
          * If we broke framing, an error should be reported and the device
          * should get closed */
-        if (client->buffer->len > 0 &&
-            client->buffer->data[0] != QMI_MESSAGE_QMUX_MARKER) {
+        if (client->buffer->data[offset] != QMI_MESSAGE_QMUX_MARKER) {
             /* TODO: Report fatal error */
             g_warning ("QMI framing error detected");
-            return;
+            break;
         }
 
-        message = qmi_message_new_from_raw (client->buffer, &error);
+        message = qmi_message_new_from_raw_buffer (&client->buffer->data[offset],
+                                                   client->buffer->len - offset,
+                                                   &consumed,
+                                                   &error);
+        offset += consumed;
+
         if (!message) {
             if (!error)
                 /* More data we need */
-                return;
+                break;
 
             /* Warn about the issue */
             g_warning ("Invalid QMI message received: '%s'",
@@ -650,8 +1612,21 @@ parse_request (QmiProxy *self,
             /* Play with the received message */
             process_message (self, client, message);
             qmi_message_unref (message);
+
+            /* Once the device is known, the remaining messages are
+             * processed in its context */
+            if (client->device && !client->attached)
+                break;
         }
-    } while (client->buffer->len > 0);
+    }
+
+    if (offset > 0)
+        g_byte_array_remove_range (client->buffer, 0, offset);
+
+    if (client->connection && client->device && !client->attached)
+        client_hand_off (client);
+
+    client_unref (client);
 }
 
 static gboolean
@@ -661,8 +1636,7 @@ connection_readable_cb (GSocket *socket,
 {
     QmiProxy *self;
     guint8 buffer[BUFFER_SIZE];
-    GError *error = NULL;
-    gssize r;
+    guint total = 0;
 
     self = client->proxy;
 
@@ -674,29 +1648,45 @@ connection_readable_cb (GSocket *socket,
     if (!(condition & G_IO_IN || condition & G_IO_PRI))
         return TRUE;
 
-    r = g_input_stream_read (g_io_stream_get_input_stream (G_IO_STREAM (client->connection)),
-                             buffer,
-                             BUFFER_SIZE,
-                             NULL,
-                             &error);
-    if (r < 0) {
-        g_warning ("Error reading from istream: %s", error ? error->message : "unknown");
-        if (error)
-            g_error_free (error);
-        untrack_client (self, client);
-        return FALSE;
-    }
+    /* Drain as much data as available (up to the read budget) before
+     * parsing, so that a burst of requests is processed in a single wakeup */
+    do {
+        GError *error = NULL;
+        gssize r;
+
+        r = g_socket_receive_with_blocking (socket,
+                                            (gchar *)buffer,
+                                            BUFFER_SIZE,
+                                            FALSE,
+                                            NULL,
+                                            &error);
+        if (r < 0) {
+            if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+                /* Nothing else to read right now */
+                g_error_free (error);
+                break;
+            }
 
-    if (r == 0)
-        return TRUE;
+            g_warning ("Error reading from istream: %s", error ? error->message : "unknown");
+            if (error)
+                g_error_free (error);
+            untrack_client (self, client);
+            return FALSE;
+        }
 
-    /* else, r > 0 */
-    if (!G_UNLIKELY (client->buffer))
-        client->buffer = g_byte_array_sized_new (r);
-    g_byte_array_append (client->buffer, buffer, r);
+        if (r == 0)
+            break;
+
+        /* else, r > 0 */
+        if (!G_UNLIKELY (client->buffer))
+            client->buffer = g_byte_array_sized_new (r);
+        g_byte_array_append (client->buffer, buffer, r);
+        total += r;
+    } while (total < READ_BUDGET);
 
     /* Try to parse input messages */
-    parse_request (self, client);
+    if (total > 0)
+        parse_request (self, client);
 
     return TRUE;
 }
@@ -739,14 +1729,15 @@ incoming_cb (GSocketService *service,
     client->ref_count = 1;
     client->proxy = self;
     client->connection = g_object_ref (connection);
-    client->connection_readable_source = g_socket_create_source (g_socket_connection_get_socket (client->connection),
-                                                                 G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
-                                                                 NULL);
-    g_source_set_callback (client->connection_readable_source,
-                           (GSourceFunc)connection_readable_cb,
-                           client,
-                           NULL);
-    g_source_attach (client->connection_readable_source, g_main_context_get_thread_default ());
+    client->uid = uid;
+
+    /* Clients of users without a weight get the default one */
+    g_mutex_lock (&self->priv->lock);
+    client->queue = __qmi_proxy_scheduler_queue_new (self->priv->uid_weights ?
+                                                     GPOINTER_TO_UINT (g_hash_table_lookup (self->priv->uid_weights, GUINT_TO_POINTER (uid))) :
+                                                     1);
+    g_mutex_unlock (&self->priv->lock);
+    client_start_reading (client);
     client->qmi_client_info_array = g_array_sized_new (FALSE, FALSE, sizeof (QmiClientInfo), 8);
 
     /* Keep the client info around */
@@ -827,6 +1818,32 @@ qmi_proxy_init (QmiProxy *self)
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                               QMI_TYPE_PROXY,
                                               QmiProxyPrivate);
+
+    self->priv->context = g_main_context_ref_thread_default ();
+    g_mutex_init (&self->priv->lock);
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    QmiProxy *self = QMI_PROXY (object);
+
+    switch (prop_id) {
+    case PROP_DEVICE_THREADS:
+        self->priv->device_threads = g_value_get_boolean (value);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        g_mutex_lock (&self->priv->lock);
+        self->priv->max_in_flight = g_value_get_uint (value);
+        g_mutex_unlock (&self->priv->lock);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
 }
 
 static void
@@ -839,7 +1856,13 @@ get_property (GObject *object,
 
     switch (prop_id) {
     case PROP_N_CLIENTS:
-        g_value_set_uint (value, g_list_length (self->priv->clients));
+        g_value_set_uint (value, qmi_proxy_get_n_clients (self));
+        break;
+    case PROP_DEVICE_THREADS:
+        g_value_set_boolean (value, self->priv->device_threads);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        g_value_set_uint (value, self->priv->max_in_flight);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -847,15 +1870,76 @@ get_property (GObject *object,
     }
 }
 
+static gboolean
+device_shutdown_cb (Device *device)
+{
+    QmiProxyPrivate *priv = device->proxy->priv;
+    GList *clients = NULL;
+    GList *l;
+
+    /* Untrack all clients of the device in its own context; the last one
+     * closes and frees the device, and stops its thread */
+    g_mutex_lock (&priv->lock);
+    for (l = priv->clients; l; l = g_list_next (l)) {
+        Client *client = l->data;
+
+        if (client->device == device)
+            clients = g_list_prepend (clients, client_ref (client));
+    }
+    g_mutex_unlock (&priv->lock);
+
+    for (l = clients; l; l = g_list_next (l))
+        untrack_client (device->proxy, (Client *)l->data);
+    g_list_free_full (clients, (GDestroyNotify) client_unref);
+
+    return G_SOURCE_REMOVE;
+}
+
 static void
 dispose (GObject *object)
 {
-    QmiProxyPrivate *priv = QMI_PROXY (object)->priv;
+    QmiProxy *self = QMI_PROXY (object);
+    QmiProxyPrivate *priv = self->priv;
+    GList *devices = NULL;
+    GList *threads = NULL;
+    GList *clients;
+    GList *l;
 
-    if (priv->clients) {
-        g_list_free_full (priv->clients, (GDestroyNotify) client_unref);
-        priv->clients = NULL;
+    /* Devices go first, so that no indication is routed to clients being
+     * disposed. Devices with their own thread are shut down right away, as
+     * they may be freed as soon as the lock is released; the others run in
+     * this same context */
+    g_mutex_lock (&priv->lock);
+    priv->disposing = TRUE;
+    for (l = priv->devices; l; l = g_list_next (l)) {
+        Device *device = l->data;
+
+        if (device->thread) {
+            threads = g_list_prepend (threads, g_thread_ref (device->thread));
+            g_main_context_invoke (device->context, (GSourceFunc) device_shutdown_cb, device);
+        } else
+            devices = g_list_prepend (devices, device);
     }
+    g_mutex_unlock (&priv->lock);
+
+    for (l = devices; l; l = g_list_next (l))
+        device_shutdown_cb ((Device *)l->data);
+    g_list_free (devices);
+
+    for (l = threads; l; l = g_list_next (l))
+        g_thread_join ((GThread *)l->data);
+    g_list_free (threads);
+
+    /* Devices stopped before disposing, if not joined yet */
+    join_stopped_threads (self);
+
+    /* Clients which never opened a device */
+    g_mutex_lock (&priv->lock);
+    clients = g_list_copy_deep (priv->clients, (GCopyFunc) client_ref, NULL);
+    g_mutex_unlock (&priv->lock);
+    for (l = clients; l; l = g_list_next (l))
+        untrack_client (self, (Client *)l->data);
+    g_list_free_full (clients, (GDestroyNotify) client_unref);
 
     if (priv->socket_service) {
         if (g_socket_service_is_active (priv->socket_service))
@@ -868,6 +1952,23 @@ dispose (GObject *object)
     G_OBJECT_CLASS (qmi_proxy_parent_class)->dispose (object);
 }
 
+static void
+finalize (GObject *object)
+{
+    QmiProxyPrivate *priv = QMI_PROXY (object)->priv;
+
+    g_assert (!priv->stopped_threads);
+
+    if (priv->cache_ttls)
+        g_hash_table_unref (priv->cache_ttls);
+    if (priv->uid_weights)
+        g_hash_table_unref (priv->uid_weights);
+    g_mutex_clear (&priv->lock);
+    g_main_context_unref (priv->context);
+
+    G_OBJECT_CLASS (qmi_proxy_parent_class)->finalize (object);
+}
+
 static void
 qmi_proxy_class_init (QmiProxyClass *proxy_class)
 {
@@ -876,7 +1977,9 @@ qmi_proxy_class_init (QmiProxyClass *proxy_class)
     g_type_class_add_private (object_class, sizeof (QmiProxyPrivate));
 
     object_class->get_property = get_property;
+    object_class->set_property = set_property;
     object_class->dispose = dispose;
+    object_class->finalize = finalize;
 
     /**
      * QmiProxy:qmi-proxy-n-clients
@@ -892,4 +1995,32 @@ qmi_proxy_class_init (QmiProxyClass *proxy_class)
                            0,
                            G_PARAM_READABLE);
     g_object_class_install_property (object_class, PROP_N_CLIENTS, properties[PROP_N_CLIENTS]);
+
+    /**
+     * QmiProxy:qmi-proxy-device-threads
+     *
+     * Since: 1.24
+     */
+    properties[PROP_DEVICE_THREADS] =
+        g_param_spec_boolean (QMI_PROXY_DEVICE_THREADS,
+                              "Device threads",
+                              "Whether each device opened from now on runs in its own thread",
+                              FALSE,
+                              G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_DEVICE_THREADS, properties[PROP_DEVICE_THREADS]);
+
+    /**
+     * QmiProxy:qmi-proxy-max-in-flight
+     *
+     * Since: 1.24
+     */
+    properties[PROP_MAX_IN_FLIGHT] =
+        g_param_spec_uint (QMI_PROXY_MAX_IN_FLIGHT,
+                           "Max in flight",
+                           "Maximum number of requests in flight in each device opened from now on, 0 if unlimited",
+                           0,
+                           G_MAXUINT,
+                           0,
+                           G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_MAX_IN_FLIGHT, properties[PROP_MAX_IN_FLIGHT]);
 }
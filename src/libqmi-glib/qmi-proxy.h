@@ -41,6 +41,8 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 
+#include "qmi-enums.h"
+
 #define QMI_TYPE_PROXY            (qmi_proxy_get_type ())
 #define QMI_PROXY(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), QMI_TYPE_PROXY, QmiProxy))
 #define QMI_PROXY_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), QMI_TYPE_PROXY, QmiProxyClass))
@@ -70,6 +72,45 @@ typedef struct _QmiProxyPrivate QmiProxyPrivate;
  */
 #define QMI_PROXY_N_CLIENTS   "qmi-proxy-n-clients"
 
+/**
+ * QMI_PROXY_DEVICE_THREADS:
+ *
+ * Symbol defining the #QmiProxy:qmi-proxy-device-threads property.
+ *
+ * When enabled, each device opened afterwards, along with all the clients
+ * using it, runs in its own thread with its own #GMainContext, so that a busy
+ * device doesn't delay the requests sent to any other one. Connections are
+ * still accepted in the context where the #QmiProxy was created.
+ *
+ * Since: 1.24
+ */
+#define QMI_PROXY_DEVICE_THREADS "qmi-proxy-device-threads"
+
+/**
+ * QMI_PROXY_MAX_IN_FLIGHT:
+ *
+ * Symbol defining the #QmiProxy:qmi-proxy-max-in-flight property.
+ *
+ * When set, each device opened afterwards keeps at most this number of
+ * requests in flight. The remaining ones are queued per client, and released
+ * fairly among all the clients of the device, so that a client sending lots
+ * of requests doesn't delay the ones of other clients. See
+ * qmi_proxy_set_uid_weight().
+ *
+ * Since: 1.24
+ */
+#define QMI_PROXY_MAX_IN_FLIGHT "qmi-proxy-max-in-flight"
+
+/**
+ * QMI_PROXY_MAX_UID_WEIGHT:
+ *
+ * Maximum weight that may be given to the clients of a user, see
+ * qmi_proxy_set_uid_weight().
+ *
+ * Since: 1.24
+ */
+#define QMI_PROXY_MAX_UID_WEIGHT 100
+
 /**
  * QmiProxy:
  *
@@ -113,4 +154,90 @@ QmiProxy *qmi_proxy_new (GError **error);
  */
 guint qmi_proxy_get_n_clients (QmiProxy *self);
 
+/**
+ * qmi_proxy_set_cache_ttl:
+ * @self: a #QmiProxy.
+ * @service: a #QmiService.
+ * @message_id: the ID of a request message of @service.
+ * @ttl: time to live of the cached responses, in seconds, or 0 to disable caching.
+ *
+ * Enables caching the successful responses to the given request message,
+ * which must not change the state of the device, e.g. a query of static
+ * information.
+ *
+ * Identical requests from any client, i.e. with the same TLVs, are replied
+ * from the cache during @ttl seconds, and identical requests received while
+ * the first one is still in flight are all replied with the same response.
+ * Cached responses are invalidated when an indication of @service is
+ * received, and when the device is reset.
+ *
+ * Caching is disabled for all messages by default. Responses already cached
+ * are not affected by changes in the configuration.
+ *
+ * Since: 1.24
+ */
+void qmi_proxy_set_cache_ttl (QmiProxy   *self,
+                              QmiService  service,
+                              guint16     message_id,
+                              guint       ttl);
+
+/**
+ * qmi_proxy_set_uid_weight:
+ * @self: a #QmiProxy.
+ * @uid: a user ID.
+ * @weight: the scheduling weight, between 1 and %QMI_PROXY_MAX_UID_WEIGHT.
+ *
+ * Sets the weight of the clients of the given user when scheduling their
+ * requests, once the #QmiProxy:qmi-proxy-max-in-flight cap of the device is
+ * reached: a client with weight N gets N times the share of the device of
+ * a client with the default weight of 1.
+ *
+ * Only clients connected afterwards are affected.
+ *
+ * Since: 1.24
+ */
+void qmi_proxy_set_uid_weight (QmiProxy *self,
+                               guint     uid,
+                               guint     weight);
+
+/**
+ * QmiProxyClientStatsForeachFn:
+ * @uid: the user ID of the client.
+ * @device_path: the path of the device open by the client, or %NULL if none.
+ * @n_requests: the number of requests of the client sent to the device.
+ * @total_wait_time: the time spent by all those requests queued in the proxy, in microseconds.
+ * @max_wait_time: the longest time spent by one of those requests queued in the proxy, in microseconds.
+ * @user_data: the data given to qmi_proxy_foreach_client_stats().
+ *
+ * Callback type for qmi_proxy_foreach_client_stats().
+ *
+ * Since: 1.24
+ */
+typedef void (* QmiProxyClientStatsForeachFn) (guint        uid,
+                                               const gchar *device_path,
+                                               guint        n_requests,
+                                               gint64       total_wait_time,
+                                               gint64       max_wait_time,
+                                               gpointer     user_data);
+
+/**
+ * qmi_proxy_foreach_client_stats:
+ * @self: a #QmiProxy.
+ * @callback: a #QmiProxyClientStatsForeachFn.
+ * @user_data: user data to pass to @callback.
+ *
+ * Reports the scheduling statistics of each client currently connected to
+ * the proxy: how many requests were sent to the device, and how long they
+ * waited in the queue of the client, which is only relevant once the
+ * #QmiProxy:qmi-proxy-max-in-flight cap of the device is reached.
+ *
+ * The statistics are collected first, and @callback is called afterwards,
+ * so it may use any other method of @self.
+ *
+ * Since: 1.24
+ */
+void qmi_proxy_foreach_client_stats (QmiProxy                     *self,
+                                     QmiProxyClientStatsForeachFn  callback,
+                                     gpointer                      user_data);
+
 #endif /* QMI_PROXY_H */
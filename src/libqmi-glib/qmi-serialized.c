@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include "qmi-serialized.h"
+
+void
+__qmi_serialized_keep (QmiMessage **serialized,
+                       QmiMessage  *request)
+{
+    qmi_message_ref (request);
+    if (!g_atomic_pointer_compare_and_exchange (serialized, NULL, request))
+        qmi_message_unref (request);
+}
+
+QmiMessage *
+__qmi_serialized_reuse (QmiMessage **serialized,
+                        guint8       client_id,
+                        guint16      transaction_id)
+{
+    QmiMessage *request;
+
+    request = g_atomic_pointer_get (serialized);
+    if (!request)
+        return NULL;
+
+    return __qmi_message_copy (request, client_id, transaction_id);
+}
+
+void
+__qmi_serialized_drop (QmiMessage **serialized)
+{
+    QmiMessage *request;
+
+    do {
+        request = g_atomic_pointer_get (serialized);
+    } while (request && !g_atomic_pointer_compare_and_exchange (serialized, request, NULL));
+
+    if (request)
+        qmi_message_unref (request);
+}
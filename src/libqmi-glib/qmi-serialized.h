@@ -0,0 +1,68 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_SERIALIZED_H_
+#define _LIBQMI_GLIB_QMI_SERIALIZED_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+#include "qmi-message.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Request last serialized from an input bundle, kept by the bundle so that
+ * it can be sent again without encoding its TLVs, as long as the bundle is
+ * not modified.
+ *
+ * The bundle keeps a reference to the request actually sent, not a copy of
+ * it, and each reuse sends a copy with the client and transaction IDs
+ * replaced, as the request kept may still be in flight. The header is the
+ * only part of a request ever modified once sent, and it is always replaced
+ * in the copies.
+ *
+ * The same bundle may be sent from several threads at once, but, as with any
+ * other change to the bundle, it must not be modified while being sent.
+ */
+
+/* Keeps a reference to the request, unless one was already kept */
+G_GNUC_INTERNAL
+void        __qmi_serialized_keep  (QmiMessage **serialized,
+                                    QmiMessage  *request);
+
+/* Copy of the request kept, if any, with the given IDs */
+G_GNUC_INTERNAL
+QmiMessage *__qmi_serialized_reuse (QmiMessage **serialized,
+                                    guint8       client_id,
+                                    guint16      transaction_id);
+
+/* Releases the request kept, if any */
+G_GNUC_INTERNAL
+void        __qmi_serialized_drop  (QmiMessage **serialized);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_SERIALIZED_H_ */
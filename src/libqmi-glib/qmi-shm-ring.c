@@ -0,0 +1,377 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+#include "qmi-shm-ring.h"
+#include "qmi-errors.h"
+#include "qmi-error-types.h"
+
+#ifndef MFD_CLOEXEC
+# define MFD_CLOEXEC 0x0001U
+#endif
+
+#define RING_MAGIC    0x52494d51 /* "QMIR" */
+#define RING_MIN_SIZE (4 * 1024)
+#define RING_MAX_SIZE (4 * 1024 * 1024)
+
+/* Header at the start of the shared memory, followed by the ring data. The
+ * fields written by the producer and by the consumer live in different cache
+ * lines. Offsets are free-running counters, only masked when accessing the
+ * data. */
+typedef struct {
+    /* Written by the producer */
+    guint32 magic;
+    guint32 size;
+    gint    head;
+    gint    closed;
+    guint8  padding0[48];
+
+    /* Written by the consumer; the producer only clears 'waiting' when
+     * ringing the doorbell */
+    gint    tail;
+    gint    active;
+    gint    waiting;
+    guint8  padding1[52];
+} RingHeader;
+
+G_STATIC_ASSERT (sizeof (RingHeader) == 128);
+
+struct _QmiShmRing {
+    RingHeader *header;
+    guint8     *data;
+    gsize       map_size;
+    guint32     size;
+    gint        memfd;
+    gint        eventfd;
+
+    /* Producer copy of the head; the shared one may be overwritten by the
+     * consumer */
+    guint32     head;
+};
+
+/*****************************************************************************/
+
+static QmiShmRing *
+ring_map (gint     memfd,
+          gint     eventfd,
+          gsize    map_size,
+          GError **error)
+{
+    QmiShmRing *self;
+    gpointer map;
+
+    map = mmap (NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (map == MAP_FAILED) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Couldn't map shared memory ring: %s",
+                     g_strerror (errno));
+        return NULL;
+    }
+
+    self = g_slice_new0 (QmiShmRing);
+    self->header = map;
+    self->data = (guint8 *)map + sizeof (RingHeader);
+    self->map_size = map_size;
+    self->size = map_size - sizeof (RingHeader);
+    self->memfd = memfd;
+    self->eventfd = eventfd;
+    return self;
+}
+
+QmiShmRing *
+__qmi_shm_ring_new (guint32   size,
+                    GError  **error)
+{
+    QmiShmRing *self;
+    gint memfd = -1;
+    gint eventfd_ = -1;
+    guint32 ring_size;
+
+    /* The size must be a power of 2 so that offsets can be masked */
+    for (ring_size = RING_MIN_SIZE; ring_size < size && ring_size < RING_MAX_SIZE; ring_size <<= 1);
+
+#if defined __NR_memfd_create
+    memfd = syscall (__NR_memfd_create, "qmi-proxy-ring", MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+#endif
+    if (memfd < 0) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_UNSUPPORTED,
+                     "Couldn't create shared memory: %s",
+                     g_strerror (errno));
+        return NULL;
+    }
+
+    if (ftruncate (memfd, sizeof (RingHeader) + ring_size) < 0) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Couldn't allocate shared memory: %s",
+                     g_strerror (errno));
+        goto out;
+    }
+
+    eventfd_ = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventfd_ < 0) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Couldn't create doorbell: %s",
+                     g_strerror (errno));
+        goto out;
+    }
+
+    self = ring_map (memfd, eventfd_, sizeof (RingHeader) + ring_size, error);
+    if (!self)
+        goto out;
+
+    self->header->magic = RING_MAGIC;
+    self->header->size = ring_size;
+    /* The consumer isn't reading yet, so the first frame rings the doorbell */
+    self->header->waiting = 1;
+    return self;
+
+out:
+    if (eventfd_ >= 0)
+        close (eventfd_);
+    close (memfd);
+    return NULL;
+}
+
+QmiShmRing *
+__qmi_shm_ring_new_from_fds (gint     memfd,
+                             gint     eventfd_,
+                             GError **error)
+{
+    QmiShmRing *self;
+    struct stat st;
+    guint32 size;
+
+    if (fstat (memfd, &st) < 0 || (gsize) st.st_size < sizeof (RingHeader) + RING_MIN_SIZE) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Invalid shared memory ring");
+        goto out;
+    }
+
+    self = ring_map (memfd, eventfd_, st.st_size, error);
+    if (!self)
+        goto out;
+
+    /* Don't trust the header beyond the size that was actually mapped */
+    size = self->header->size;
+    if (self->header->magic != RING_MAGIC ||
+        size > self->size ||
+        (size & (size - 1)) != 0) {
+        g_set_error (error,
+                     QMI_CORE_ERROR,
+                     QMI_CORE_ERROR_FAILED,
+                     "Invalid shared memory ring header");
+        __qmi_shm_ring_free (self);
+        return NULL;
+    }
+    self->size = size;
+    return self;
+
+out:
+    close (memfd);
+    close (eventfd_);
+    return NULL;
+}
+
+void
+__qmi_shm_ring_free (QmiShmRing *self)
+{
+    munmap (self->header, self->map_size);
+    close (self->memfd);
+    close (self->eventfd);
+    g_slice_free (QmiShmRing, self);
+}
+
+guint32
+__qmi_shm_ring_get_size (QmiShmRing *self)
+{
+    return self->size;
+}
+
+gint
+__qmi_shm_ring_get_memfd (QmiShmRing *self)
+{
+    return self->memfd;
+}
+
+gint
+__qmi_shm_ring_get_eventfd (QmiShmRing *self)
+{
+    return self->eventfd;
+}
+
+/*****************************************************************************/
+/* Producer */
+
+gboolean
+__qmi_shm_ring_is_active (QmiShmRing *self)
+{
+    return (g_atomic_int_get (&self->header->active) &&
+            !g_atomic_int_get (&self->header->closed));
+}
+
+gboolean
+__qmi_shm_ring_write (QmiShmRing   *self,
+                      const guint8 *data,
+                      gsize         len)
+{
+    guint32 head;
+    guint32 tail;
+    guint32 offset;
+    guint32 first;
+
+    head = self->head;
+    tail = (guint32) g_atomic_int_get (&self->header->tail);
+
+    /* A broken consumer must not make us write out of the ring */
+    if (head - tail > self->size) {
+        g_warning ("invalid shared memory ring state");
+        __qmi_shm_ring_close (self);
+        return FALSE;
+    }
+
+    if (len > self->size || len > self->size - (head - tail))
+        return FALSE;
+
+    offset = head & (self->size - 1);
+    first = MIN (len, self->size - offset);
+    memcpy (&self->data[offset], data, first);
+    if (first < len)
+        memcpy (self->data, &data[first], len - first);
+
+    /* Publish the frame, then ring the doorbell only if the consumer is
+     * waiting for it */
+    self->head = head + len;
+    g_atomic_int_set (&self->header->head, (gint) self->head);
+    if (g_atomic_int_get (&self->header->waiting) &&
+        g_atomic_int_compare_and_exchange (&self->header->waiting, 1, 0)) {
+        guint64 value = 1;
+
+        if (write (self->eventfd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+            g_warning ("couldn't ring shared memory doorbell: %s", g_strerror (errno));
+    }
+
+    return TRUE;
+}
+
+void
+__qmi_shm_ring_close (QmiShmRing *self)
+{
+    guint64 value = 1;
+
+    /* Always wake up the consumer, so that it stops waiting on the ring */
+    g_atomic_int_set (&self->header->closed, 1);
+    if (write (self->eventfd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+        g_warning ("couldn't ring shared memory doorbell: %s", g_strerror (errno));
+}
+
+/*****************************************************************************/
+/* Consumer */
+
+void
+__qmi_shm_ring_activate (QmiShmRing *self)
+{
+    g_atomic_int_set (&self->header->active, 1);
+}
+
+gsize
+__qmi_shm_ring_read (QmiShmRing *self,
+                     guint8     *buffer,
+                     gsize       len)
+{
+    guint32 head;
+    guint32 tail;
+    guint32 available;
+    guint32 offset;
+    guint32 first;
+
+    head = (guint32) g_atomic_int_get (&self->header->head);
+    tail = (guint32) self->header->tail;
+    available = head - tail;
+
+    /* A broken producer must not make us read out of the ring */
+    if (available > self->size) {
+        g_warning ("invalid shared memory ring state");
+        g_atomic_int_set (&self->header->closed, 1);
+        return 0;
+    }
+
+    len = MIN (len, available);
+    if (!len)
+        return 0;
+
+    offset = tail & (self->size - 1);
+    first = MIN (len, self->size - offset);
+    memcpy (buffer, &self->data[offset], first);
+    if (first < len)
+        memcpy (&buffer[first], self->data, len - first);
+
+    /* Release the space back to the producer */
+    g_atomic_int_set (&self->header->tail, (gint)(tail + len));
+    return len;
+}
+
+gboolean
+__qmi_shm_ring_prepare_wait (QmiShmRing *self)
+{
+    guint64 value;
+
+    /* Reset the doorbell, any new frame from now on rings it again */
+    if (read (self->eventfd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+        g_warning ("couldn't reset shared memory doorbell: %s", g_strerror (errno));
+
+    g_atomic_int_set (&self->header->waiting, 1);
+
+    /* A frame may have been published before the flag was set */
+    if (g_atomic_int_get (&self->header->head) != self->header->tail ||
+        g_atomic_int_get (&self->header->closed)) {
+        g_atomic_int_set (&self->header->waiting, 0);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean
+__qmi_shm_ring_is_closed (QmiShmRing *self)
+{
+    return !!g_atomic_int_get (&self->header->closed);
+}
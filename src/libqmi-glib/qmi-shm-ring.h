@@ -0,0 +1,90 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+
+#ifndef _LIBQMI_GLIB_QMI_SHM_RING_H_
+#define _LIBQMI_GLIB_QMI_SHM_RING_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Single-producer single-consumer ring of bytes in a memfd shared between
+ * the qmi-proxy and one of its clients, carrying raw QMI frames from the
+ * proxy to the client. An eventfd is used as doorbell, only written when the
+ * consumer has announced it is about to wait, so that a consumer which keeps
+ * up with the producer never needs a syscall to get new frames.
+ *
+ * The ring is created by the producer, and the consumer maps it from the
+ * memfd and eventfd passed over the proxy socket. The producer only writes
+ * to the ring once the consumer has activated it, and closes it for good
+ * when a frame doesn't fit, so that both sides fall back to the socket.
+ */
+typedef struct _QmiShmRing QmiShmRing;
+
+/* Producer */
+G_GNUC_INTERNAL
+QmiShmRing *__qmi_shm_ring_new           (guint32       size,
+                                          GError      **error);
+G_GNUC_INTERNAL
+gint        __qmi_shm_ring_get_memfd     (QmiShmRing   *self);
+G_GNUC_INTERNAL
+gint        __qmi_shm_ring_get_eventfd   (QmiShmRing   *self);
+G_GNUC_INTERNAL
+gboolean    __qmi_shm_ring_is_active     (QmiShmRing   *self);
+G_GNUC_INTERNAL
+gboolean    __qmi_shm_ring_write         (QmiShmRing   *self,
+                                          const guint8 *data,
+                                          gsize         len);
+G_GNUC_INTERNAL
+void        __qmi_shm_ring_close         (QmiShmRing   *self);
+
+/* Consumer */
+G_GNUC_INTERNAL
+QmiShmRing *__qmi_shm_ring_new_from_fds  (gint          memfd,
+                                          gint          eventfd,
+                                          GError      **error);
+G_GNUC_INTERNAL
+void        __qmi_shm_ring_activate      (QmiShmRing   *self);
+G_GNUC_INTERNAL
+gsize       __qmi_shm_ring_read          (QmiShmRing   *self,
+                                          guint8       *buffer,
+                                          gsize         len);
+G_GNUC_INTERNAL
+gboolean    __qmi_shm_ring_prepare_wait  (QmiShmRing   *self);
+G_GNUC_INTERNAL
+gboolean    __qmi_shm_ring_is_closed     (QmiShmRing   *self);
+
+/* Both */
+G_GNUC_INTERNAL
+guint32     __qmi_shm_ring_get_size      (QmiShmRing   *self);
+G_GNUC_INTERNAL
+void        __qmi_shm_ring_free          (QmiShmRing   *self);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_SHM_RING_H_ */
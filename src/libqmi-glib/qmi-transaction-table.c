@@ -0,0 +1,195 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include "qmi-transaction-table.h"
+
+/* Initial number of buckets, must be a power of 2 */
+#define INITIAL_BITS 6
+
+typedef struct {
+    guint32  key;
+    gpointer value; /* NULL if the bucket is empty */
+} Bucket;
+
+struct _QmiTransactionTable {
+    Bucket *buckets;
+    guint   bits;
+    guint   mask;
+    guint   size;
+};
+
+static inline guint
+bucket_index (QmiTransactionTable *self,
+              guint32              key)
+{
+    /* Fibonacci hashing, so that consecutive transaction ids of the same
+     * client spread over the whole table */
+    return (guint) ((key * 2654435769u) >> (32 - self->bits));
+}
+
+static void
+allocate_buckets (QmiTransactionTable *self,
+                  guint                bits)
+{
+    self->bits = bits;
+    self->mask = (1u << bits) - 1;
+    self->buckets = g_new0 (Bucket, 1u << bits);
+}
+
+static void
+insert_new (QmiTransactionTable *self,
+            guint32              key,
+            gpointer             value)
+{
+    guint i;
+
+    for (i = bucket_index (self, key); self->buckets[i].value; i = (i + 1) & self->mask)
+        ;
+    self->buckets[i].key = key;
+    self->buckets[i].value = value;
+    self->size++;
+}
+
+static void
+grow (QmiTransactionTable *self)
+{
+    Bucket *old_buckets;
+    guint old_n_buckets;
+    guint i;
+
+    old_buckets = self->buckets;
+    old_n_buckets = self->mask + 1;
+
+    allocate_buckets (self, self->bits + 1);
+    self->size = 0;
+    for (i = 0; i < old_n_buckets; i++) {
+        if (old_buckets[i].value)
+            insert_new (self, old_buckets[i].key, old_buckets[i].value);
+    }
+    g_free (old_buckets);
+}
+
+/* Returns the index of the bucket with the given key, or -1 if not found */
+static gint
+find (QmiTransactionTable *self,
+      guint32              key)
+{
+    guint i;
+
+    for (i = bucket_index (self, key); self->buckets[i].value; i = (i + 1) & self->mask) {
+        if (self->buckets[i].key == key)
+            return (gint) i;
+    }
+    return -1;
+}
+
+gpointer
+__qmi_transaction_table_lookup (QmiTransactionTable *self,
+                                guint32              key)
+{
+    gint i;
+
+    i = find (self, key);
+    return (i >= 0 ? self->buckets[i].value : NULL);
+}
+
+gpointer
+__qmi_transaction_table_insert (QmiTransactionTable *self,
+                                guint32              key,
+                                gpointer             value)
+{
+    gpointer previous;
+    gint i;
+
+    g_assert (value != NULL);
+
+    /* Replace if already there */
+    i = find (self, key);
+    if (i >= 0) {
+        previous = self->buckets[i].value;
+        self->buckets[i].value = value;
+        return previous;
+    }
+
+    /* Keep the load factor below 1/2 so that probe sequences stay short */
+    if ((self->size + 1) * 2 > self->mask + 1)
+        grow (self);
+
+    insert_new (self, key, value);
+    return NULL;
+}
+
+gpointer
+__qmi_transaction_table_take (QmiTransactionTable *self,
+                              guint32              key)
+{
+    gpointer value;
+    gint found;
+    guint i;
+    guint j;
+
+    found = find (self, key);
+    if (found < 0)
+        return NULL;
+
+    value = self->buckets[found].value;
+    self->size--;
+
+    /* Shift back the entries following the removed one in the same cluster
+     * if their ideal bucket is not between the hole and themselves */
+    i = (guint) found;
+    for (j = (i + 1) & self->mask; self->buckets[j].value; j = (j + 1) & self->mask) {
+        guint ideal;
+
+        ideal = bucket_index (self, self->buckets[j].key);
+        if (((j - ideal) & self->mask) >= ((j - i) & self->mask)) {
+            self->buckets[i] = self->buckets[j];
+            i = j;
+        }
+    }
+    self->buckets[i].value = NULL;
+
+    return value;
+}
+
+guint
+__qmi_transaction_table_size (QmiTransactionTable *self)
+{
+    return self->size;
+}
+
+QmiTransactionTable *
+__qmi_transaction_table_new (void)
+{
+    QmiTransactionTable *self;
+
+    self = g_slice_new0 (QmiTransactionTable);
+    allocate_buckets (self, INITIAL_BITS);
+    return self;
+}
+
+void
+__qmi_transaction_table_free (QmiTransactionTable *self)
+{
+    g_free (self->buckets);
+    g_slice_free (QmiTransactionTable, self);
+}
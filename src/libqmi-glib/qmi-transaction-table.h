@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * libqmi-glib -- GLib/GIO based library to control QMI devices
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#ifndef _LIBQMI_GLIB_QMI_TRANSACTION_TABLE_H_
+#define _LIBQMI_GLIB_QMI_TRANSACTION_TABLE_H_
+
+#if !defined (LIBQMI_GLIB_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Open-addressed table of in-flight transactions, keyed by the 32-bit value
+ * packing service, client id and transaction id. Linear probing is used, and
+ * removals shift back the following entries instead of leaving tombstones,
+ * so that a lookup or take never needs more than one probe sequence.
+ */
+typedef struct _QmiTransactionTable QmiTransactionTable;
+
+G_GNUC_INTERNAL
+QmiTransactionTable *__qmi_transaction_table_new    (void);
+G_GNUC_INTERNAL
+void                 __qmi_transaction_table_free   (QmiTransactionTable *self);
+G_GNUC_INTERNAL
+guint                __qmi_transaction_table_size   (QmiTransactionTable *self);
+G_GNUC_INTERNAL
+gpointer             __qmi_transaction_table_lookup (QmiTransactionTable *self,
+                                                     guint32              key);
+G_GNUC_INTERNAL
+gpointer             __qmi_transaction_table_insert (QmiTransactionTable *self,
+                                                     guint32              key,
+                                                     gpointer             value);
+G_GNUC_INTERNAL
+gpointer             __qmi_transaction_table_take   (QmiTransactionTable *self,
+                                                     guint32              key);
+
+G_END_DECLS
+
+#endif /* _LIBQMI_GLIB_QMI_TRANSACTION_TABLE_H_ */
@@ -44,15 +44,31 @@
 
 /*****************************************************************************/
 
+/* Writes the 3N-1 chars of the hexadecimal representation of the N given
+ * bytes, plus the trailing NUL */
+static void
+str_hex_write (gchar        *out,
+               const guint8 *data,
+               gsize         size,
+               gchar         delimiter)
+{
+    static const gchar digits[] = "0123456789ABCDEF";
+    gsize i;
+
+    for (i = 0; i < size; i++) {
+        if (i > 0)
+            *(out++) = delimiter;
+        *(out++) = digits[data[i] >> 4];
+        *(out++) = digits[data[i] & 0x0F];
+    }
+    *out = '\0';
+}
+
 gchar *
 __qmi_utils_str_hex (gconstpointer mem,
                      gsize size,
                      gchar delimiter)
 {
-    const guint8 *data = mem;
-    gsize i;
-    gsize j;
-    gsize new_str_length;
     gchar *new_str;
 
     /* Get new string length. If input string has N bytes, we need:
@@ -60,24 +76,28 @@ __qmi_utils_str_hex (gconstpointer mem,
      * - 2N bytes for hexadecimal char representation of each byte...
      * - N-1 bytes for the separator ':'
      * So... a total of (1+2N+N-1) = 3N bytes are needed... */
-    new_str_length =  3 * size;
-
-    /* Allocate memory for new array and initialize contents to NUL */
-    new_str = g_malloc0 (new_str_length);
-
-    /* Print hexadecimal representation of each byte... */
-    for (i = 0, j = 0; i < size; i++, j += 3) {
-        /* Print character in output string... */
-        snprintf (&new_str[j], 3, "%02X", data[i]);
-        /* And if needed, add separator */
-        if (i != (size - 1) )
-            new_str[j + 2] = delimiter;
-    }
-
-    /* Set output string */
+    new_str = g_malloc (3 * size);
+    if (new_str)
+        str_hex_write (new_str, mem, size, delimiter);
     return new_str;
 }
 
+void
+__qmi_utils_str_hex_append (GString       *str,
+                            gconstpointer  mem,
+                            gsize          size,
+                            gchar          delimiter)
+{
+    gsize len;
+
+    if (!size)
+        return;
+
+    len = str->len;
+    g_string_set_size (str, len + 3 * size - 1);
+    str_hex_write (&str->str[len], mem, size, delimiter);
+}
+
 /*****************************************************************************/
 
 gboolean
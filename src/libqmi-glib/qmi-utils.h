@@ -81,6 +81,12 @@ G_GNUC_INTERNAL
 gchar *__qmi_utils_str_hex (gconstpointer mem,
                             gsize size,
                             gchar delimiter);
+/* Like __qmi_utils_str_hex(), but appending to the given string */
+G_GNUC_INTERNAL
+void __qmi_utils_str_hex_append (GString       *str,
+                                 gconstpointer  mem,
+                                 gsize          size,
+                                 gchar          delimiter);
 G_GNUC_INTERNAL
 gboolean __qmi_user_allowed (uid_t uid,
                              GError **error);
@@ -0,0 +1,348 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "qmi-capture.h"
+#include "qmi-message.h"
+#include "qmi-errors.h"
+#include "qmi-error-types.h"
+
+/*****************************************************************************/
+
+/* Each message has a different transaction id and a varying number of TLVs,
+ * so that records have different sizes */
+static QmiMessage *
+build_message (guint16 transaction_id)
+{
+    QmiMessage *message;
+    guint i;
+
+    message = qmi_message_new (QMI_SERVICE_DMS, 0x01, transaction_id, 0x0020);
+    for (i = 0; i < (transaction_id % 5); i++) {
+        gsize init_offset;
+
+        init_offset = qmi_message_tlv_write_init (message, 0x10 + i, NULL);
+        g_assert (init_offset);
+        g_assert (qmi_message_tlv_write_guint32 (message, QMI_ENDIAN_LITTLE, transaction_id, NULL));
+        g_assert (qmi_message_tlv_write_complete (message, init_offset, NULL));
+    }
+    return message;
+}
+
+typedef struct {
+    guint16 next_transaction_id;
+    guint   n_messages;
+} CheckContext;
+
+static void
+check_captured_message (gint64               timestamp,
+                        QmiCaptureDirection  direction,
+                        guint16              vendor_id,
+                        const guint8        *frame,
+                        gsize                frame_length,
+                        CheckContext        *ctx)
+{
+    QmiMessage *expected;
+    const guint8 *expected_frame;
+    gsize expected_frame_length = 0;
+
+    expected = build_message (ctx->next_transaction_id);
+    expected_frame = qmi_message_get_raw (expected, &expected_frame_length, NULL);
+
+    g_assert_cmpint (timestamp, >, 0);
+    g_assert_cmpuint (direction, ==, (ctx->next_transaction_id % 2) ? QMI_CAPTURE_DIRECTION_SENT : QMI_CAPTURE_DIRECTION_RECEIVED);
+    g_assert_cmpuint (vendor_id, ==, (ctx->next_transaction_id % 3) ? QMI_MESSAGE_VENDOR_GENERIC : 0x1234);
+    g_assert_cmpuint (frame_length, ==, expected_frame_length);
+    g_assert (memcmp (frame, expected_frame, frame_length) == 0);
+
+    qmi_message_unref (expected);
+    ctx->next_transaction_id++;
+    ctx->n_messages++;
+}
+
+static void
+capture_messages (QmiCapture *capture,
+                  guint16     first,
+                  guint16     last)
+{
+    QmiMessageContext *context;
+    guint16 trid;
+
+    context = qmi_message_context_new ();
+    qmi_message_context_set_vendor_id (context, 0x1234);
+
+    for (trid = first; trid <= last; trid++) {
+        QmiMessage *message;
+
+        message = build_message (trid);
+        qmi_capture_add_message (capture,
+                                 (trid % 2) ? QMI_CAPTURE_DIRECTION_SENT : QMI_CAPTURE_DIRECTION_RECEIVED,
+                                 message,
+                                 (trid % 3) ? NULL : context);
+        qmi_message_unref (message);
+    }
+
+    qmi_message_context_unref (context);
+}
+
+/*****************************************************************************/
+
+static void
+test_capture_ring (void)
+{
+    QmiCapture *capture;
+    CheckContext ctx;
+    guint n_messages = 0;
+    guint64 n_lost = 0;
+
+    /* Small enough to wrap several times, with records split at the end of
+     * the buffer */
+    capture = qmi_capture_new (1000);
+    capture_messages (capture, 1, 500);
+
+    qmi_capture_get_stats (capture, &n_messages, &n_lost);
+    g_assert_cmpuint (n_messages, >, 0);
+    g_assert_cmpuint (n_messages + n_lost, ==, 500);
+
+    /* Only the most recent messages must be kept, in order */
+    ctx.next_transaction_id = 500 - n_messages + 1;
+    ctx.n_messages = 0;
+    qmi_capture_foreach (capture, (QmiCaptureForeachFn) check_captured_message, &ctx);
+    g_assert_cmpuint (ctx.n_messages, ==, n_messages);
+    g_assert_cmpuint (ctx.next_transaction_id, ==, 501);
+
+    qmi_capture_clear (capture);
+    qmi_capture_get_stats (capture, &n_messages, NULL);
+    g_assert_cmpuint (n_messages, ==, 0);
+
+    qmi_capture_unref (capture);
+}
+
+/* Captures one more message for each message iterated */
+static void
+recapture_message (gint64               timestamp,
+                   QmiCaptureDirection  direction,
+                   guint16              vendor_id,
+                   const guint8        *frame,
+                   gsize                frame_length,
+                   QmiCapture          *capture)
+{
+    capture_messages (capture, 11, 11);
+}
+
+static void
+test_capture_foreach_reentrant (void)
+{
+    QmiCapture *capture;
+    guint n_messages = 0;
+
+    capture = qmi_capture_new (4096);
+    capture_messages (capture, 1, 10);
+
+    /* The capture isn't locked while the callback runs, and the messages
+     * captured meanwhile are not iterated */
+    qmi_capture_foreach (capture, (QmiCaptureForeachFn) recapture_message, capture);
+    qmi_capture_get_stats (capture, &n_messages, NULL);
+    g_assert_cmpuint (n_messages, ==, 20);
+
+    qmi_capture_unref (capture);
+}
+
+static void
+test_capture_too_large (void)
+{
+    QmiCapture *capture;
+    QmiMessage *message;
+    guint n_messages = 0;
+    guint64 n_lost = 0;
+
+    capture = qmi_capture_new (32);
+    message = build_message (4);
+    qmi_capture_add_message (capture, QMI_CAPTURE_DIRECTION_SENT, message, NULL);
+    qmi_message_unref (message);
+
+    qmi_capture_get_stats (capture, &n_messages, &n_lost);
+    g_assert_cmpuint (n_messages, ==, 0);
+    g_assert_cmpuint (n_lost, ==, 1);
+
+    qmi_capture_unref (capture);
+}
+
+static void
+test_capture_save_load (void)
+{
+    QmiCapture *capture;
+    QmiCapture *loaded;
+    GError *error = NULL;
+    gchar *path;
+    gint fd;
+    CheckContext ctx;
+    guint n_messages = 0;
+
+    fd = g_file_open_tmp ("test-capture-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    capture = qmi_capture_new (4096);
+    capture_messages (capture, 1, 20);
+    g_assert (qmi_capture_save (capture, path, &error));
+    g_assert_no_error (error);
+    qmi_capture_unref (capture);
+
+    loaded = qmi_capture_new_from_file (path, &error);
+    g_assert_no_error (error);
+    g_assert (loaded);
+
+    qmi_capture_get_stats (loaded, &n_messages, NULL);
+    g_assert_cmpuint (n_messages, ==, 20);
+
+    ctx.next_transaction_id = 1;
+    ctx.n_messages = 0;
+    qmi_capture_foreach (loaded, (QmiCaptureForeachFn) check_captured_message, &ctx);
+    g_assert_cmpuint (ctx.n_messages, ==, 20);
+
+    qmi_capture_unref (loaded);
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+test_capture_spill (void)
+{
+    QmiCapture *capture;
+    QmiCapture *loaded;
+    GError *error = NULL;
+    gchar *path;
+    gint fd;
+    CheckContext ctx;
+    guint64 n_lost = 0;
+
+    fd = g_file_open_tmp ("test-capture-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    /* Messages evicted from the ring go to the file, and the remaining ones
+     * are written when the capture is disposed, so nothing is lost */
+    capture = qmi_capture_new (1000);
+    g_assert (qmi_capture_set_spill_file (capture, path, &error));
+    g_assert_no_error (error);
+    capture_messages (capture, 1, 500);
+    qmi_capture_get_stats (capture, NULL, &n_lost);
+    g_assert_cmpuint (n_lost, ==, 0);
+    qmi_capture_unref (capture);
+
+    loaded = qmi_capture_new_from_file (path, &error);
+    g_assert_no_error (error);
+    g_assert (loaded);
+
+    ctx.next_transaction_id = 1;
+    ctx.n_messages = 0;
+    qmi_capture_foreach (loaded, (QmiCaptureForeachFn) check_captured_message, &ctx);
+    g_assert_cmpuint (ctx.n_messages, ==, 500);
+
+    qmi_capture_unref (loaded);
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+test_capture_invalid_file (void)
+{
+    static const guint8 truncated[] = {
+        0x51, 0x4d, 0x49, 0x43, /* magic */
+        0x01, 0x00,             /* version */
+        0x10, 0x00,             /* record header size */
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* timestamp */
+        0x40, 0x00, 0x00, 0x00, /* length, beyond the end of the file */
+        0x00, 0x00, 0x00, 0x00,
+        0x01, 0x0c
+    };
+    QmiCapture *loaded;
+    GError *error = NULL;
+    gchar *path;
+    gint fd;
+
+    fd = g_file_open_tmp ("test-capture-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert (g_file_set_contents (path, "not a capture", -1, &error));
+    loaded = qmi_capture_new_from_file (path, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED);
+    g_assert (!loaded);
+    g_clear_error (&error);
+
+    g_assert (g_file_set_contents (path, (const gchar *) truncated, sizeof (truncated), &error));
+    loaded = qmi_capture_new_from_file (path, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED);
+    g_assert (!loaded);
+    g_clear_error (&error);
+
+    g_unlink (path);
+    g_free (path);
+}
+
+/*****************************************************************************/
+
+#define BENCHMARK_N_MESSAGES 1000000
+
+static void
+test_capture_benchmark (void)
+{
+    QmiCapture *capture;
+    QmiMessage *message;
+    GTimer *timer;
+    gdouble elapsed;
+    guint i;
+
+    capture = qmi_capture_new (1024 * 1024);
+    message = build_message (4);
+
+    timer = g_timer_new ();
+    for (i = 0; i < BENCHMARK_N_MESSAGES; i++)
+        qmi_capture_add_message (capture, QMI_CAPTURE_DIRECTION_RECEIVED, message, NULL);
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_test_maximized_result (BENCHMARK_N_MESSAGES / elapsed,
+                             "capture: %.0f messages/s",
+                             BENCHMARK_N_MESSAGES / elapsed);
+
+    g_timer_destroy (timer);
+    qmi_message_unref (message);
+    qmi_capture_unref (capture);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/capture/ring",         test_capture_ring);
+    g_test_add_func ("/libqmi-glib/capture/reentrant",    test_capture_foreach_reentrant);
+    g_test_add_func ("/libqmi-glib/capture/too-large",    test_capture_too_large);
+    g_test_add_func ("/libqmi-glib/capture/save-load",    test_capture_save_load);
+    g_test_add_func ("/libqmi-glib/capture/spill",        test_capture_spill);
+    g_test_add_func ("/libqmi-glib/capture/invalid-file", test_capture_invalid_file);
+    if (g_test_perf ())
+        g_test_add_func ("/libqmi-glib/capture/benchmark", test_capture_benchmark);
+
+    return g_test_run ();
+}
@@ -230,7 +230,7 @@ device_release_client_ready (QmiDevice    *device,
 }
 
 void
-test_fixture_teardown (TestFixture *fixture)
+test_fixture_release_clients (TestFixture *fixture)
 {
     guint i;
 
@@ -277,6 +277,10 @@ test_fixture_teardown (TestFixture *fixture)
             0x01,       /* cid: 1 */
         };
 
+        /* Already released */
+        if (!fixture->service_info[services[i]].client)
+            continue;
+
         expected[15] = services[i];
         response[22] = services[i];
         test_port_context_set_command (fixture->ctx,
@@ -293,7 +297,14 @@ test_fixture_teardown (TestFixture *fixture)
         g_clear_object (&fixture->service_info[services[i]].client);
         fixture->service_info[services[i]].transaction_id = 0x0000;
     }
+}
+
+void
+test_fixture_teardown (TestFixture *fixture)
+{
+    test_fixture_release_clients (fixture);
 
+    /* The test may have already disposed the device */
     if (fixture->device) {
         GError *error = NULL;
         gboolean ret;
@@ -39,6 +39,7 @@ typedef struct {
 
 void test_fixture_setup     (TestFixture *fixture);
 void test_fixture_teardown  (TestFixture *fixture);
+void test_fixture_release_clients (TestFixture *fixture);
 void test_fixture_loop_run  (TestFixture *fixture);
 void test_fixture_loop_stop (TestFixture *fixture);
 
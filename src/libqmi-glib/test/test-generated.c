@@ -26,6 +26,282 @@ test_generated_core (TestFixture *fixture)
     /* Noop */
 }
 
+/*****************************************************************************/
+/* Transaction timeouts */
+
+#define N_TRANSACTIONS 5000
+
+typedef struct {
+    TestFixture *fixture;
+    guint        n_timed_out;
+    guint        n_aborted;
+} TransactionsContext;
+
+static void
+command_ready (QmiDevice           *device,
+               GAsyncResult        *res,
+               TransactionsContext *ctx)
+{
+    GError *error = NULL;
+    QmiMessage *reply;
+
+    reply = qmi_device_command_full_finish (device, res, &error);
+    g_assert (!reply);
+    if (g_error_matches (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TIMEOUT))
+        ctx->n_timed_out++;
+    else if (g_error_matches (error, QMI_PROTOCOL_ERROR, QMI_PROTOCOL_ERROR_ABORTED))
+        ctx->n_aborted++;
+    else
+        g_assert_not_reached ();
+    g_error_free (error);
+
+    if (ctx->n_timed_out + ctx->n_aborted == N_TRANSACTIONS)
+        test_fixture_loop_stop (ctx->fixture);
+}
+
+static void
+test_generated_core_transaction_timeouts (TestFixture *fixture)
+{
+    TransactionsContext ctx = { fixture, 0, 0 };
+    GCancellable *cancellable;
+    guint8 cid;
+    guint i;
+
+    /* Don't trace thousands of requests */
+    qmi_utils_set_traces_enabled (FALSE);
+
+    /* None of the requests will get a response */
+    test_port_context_set_discard_commands (fixture->ctx, TRUE);
+
+    cancellable = g_cancellable_new ();
+    cid = qmi_client_get_cid (fixture->service_info[QMI_SERVICE_DMS].client);
+    for (i = 0; i < N_TRANSACTIONS; i++) {
+        QmiMessage *message;
+
+        /* DMS Get IDs requests, all with different transaction ids */
+        message = qmi_message_new (QMI_SERVICE_DMS, cid, i + 1, 0x0025);
+        qmi_device_command_full (fixture->device, message, NULL, 1,
+                                 (i % 2) ? cancellable : NULL,
+                                 (GAsyncReadyCallback) command_ready,
+                                 &ctx);
+        qmi_message_unref (message);
+    }
+
+    /* Cancel half of them right away, the other half should time out */
+    g_cancellable_cancel (cancellable);
+    test_fixture_loop_run (fixture);
+    g_object_unref (cancellable);
+
+    g_assert_cmpuint (ctx.n_aborted, ==, N_TRANSACTIONS / 2);
+    g_assert_cmpuint (ctx.n_timed_out, ==, N_TRANSACTIONS / 2);
+
+    test_port_context_set_discard_commands (fixture->ctx, FALSE);
+    qmi_utils_set_traces_enabled (TRUE);
+}
+
+/* The device may be disposed when the request times out */
+
+static void
+last_ref_command_ready (QmiDevice    *device,
+                        GAsyncResult *res,
+                        TestFixture  *fixture)
+{
+    GError *error = NULL;
+    QmiMessage *reply;
+    gboolean ret;
+
+    reply = qmi_device_command_full_finish (device, res, &error);
+    g_assert (!reply);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TIMEOUT);
+    g_error_free (error);
+
+    /* Drop the last reference held outside of the device itself */
+    ret = qmi_device_close (fixture->device, &error);
+    g_assert_no_error (error);
+    g_assert (ret);
+    g_clear_object (&fixture->device);
+
+    test_fixture_loop_stop (fixture);
+}
+
+static void
+test_generated_core_transaction_timeout_last_ref (TestFixture *fixture)
+{
+    QmiMessage *message;
+
+    /* Clients can't be released once the device is gone */
+    test_fixture_release_clients (fixture);
+
+    /* The request will not get a response */
+    test_port_context_set_discard_commands (fixture->ctx, TRUE);
+
+    message = qmi_message_new (QMI_SERVICE_DMS, 1, 1, 0x0025);
+    qmi_device_command_full (fixture->device, message, NULL, 1, NULL,
+                             (GAsyncReadyCallback) last_ref_command_ready,
+                             fixture);
+    qmi_message_unref (message);
+    test_fixture_loop_run (fixture);
+
+    g_assert (!fixture->device);
+    test_port_context_set_discard_commands (fixture->ctx, FALSE);
+}
+
+/*****************************************************************************/
+/* Send window */
+
+#define N_WINDOWED_TRANSACTIONS 20
+#define SEND_WINDOW_SIZE        4
+
+static void
+windowed_command_ready (QmiDevice           *device,
+                        GAsyncResult        *res,
+                        TransactionsContext *ctx)
+{
+    GError *error = NULL;
+    QmiMessage *reply;
+
+    reply = qmi_device_command_full_finish (device, res, &error);
+    g_assert (!reply);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TIMEOUT);
+    g_error_free (error);
+
+    if (++ctx->n_timed_out == N_WINDOWED_TRANSACTIONS)
+        test_fixture_loop_stop (ctx->fixture);
+}
+
+static void
+test_generated_core_send_window (TestFixture *fixture)
+{
+    TransactionsContext ctx = { fixture, 0, 0 };
+    guint n_in_flight;
+    guint n_queued;
+    guint max_queued;
+    guint8 cid;
+    guint i;
+
+    /* None of the requests will get a response */
+    test_port_context_set_discard_commands (fixture->ctx, TRUE);
+
+    qmi_device_set_send_window (fixture->device, QMI_SERVICE_DMS, SEND_WINDOW_SIZE);
+
+    cid = qmi_client_get_cid (fixture->service_info[QMI_SERVICE_DMS].client);
+    for (i = 0; i < N_WINDOWED_TRANSACTIONS; i++) {
+        QmiMessage *message;
+
+        /* DMS Get IDs requests, all with different transaction ids */
+        message = qmi_message_new (QMI_SERVICE_DMS, cid, i + 1, 0x0025);
+        qmi_device_command_full (fixture->device, message, NULL, 1, NULL,
+                                 (GAsyncReadyCallback) windowed_command_ready,
+                                 &ctx);
+        qmi_message_unref (message);
+    }
+
+    qmi_device_get_send_window_stats (fixture->device, QMI_SERVICE_DMS, &n_in_flight, &n_queued, &max_queued);
+    g_assert_cmpuint (n_in_flight, ==, SEND_WINDOW_SIZE);
+    g_assert_cmpuint (n_queued, ==, N_WINDOWED_TRANSACTIONS - SEND_WINDOW_SIZE);
+    g_assert_cmpuint (max_queued, ==, N_WINDOWED_TRANSACTIONS - SEND_WINDOW_SIZE);
+
+    /* Queued requests also time out */
+    test_fixture_loop_run (fixture);
+    g_assert_cmpuint (ctx.n_timed_out, ==, N_WINDOWED_TRANSACTIONS);
+
+    qmi_device_get_send_window_stats (fixture->device, QMI_SERVICE_DMS, &n_in_flight, &n_queued, &max_queued);
+    g_assert_cmpuint (n_in_flight, ==, 0);
+    g_assert_cmpuint (n_queued, ==, 0);
+    g_assert_cmpuint (max_queued, ==, N_WINDOWED_TRANSACTIONS - SEND_WINDOW_SIZE);
+
+    qmi_device_set_send_window (fixture->device, QMI_SERVICE_DMS, 0);
+    test_port_context_set_discard_commands (fixture->ctx, FALSE);
+}
+
+/*****************************************************************************/
+/* Request/response round trips */
+
+#define N_ROUND_TRIPS 10000
+
+typedef struct {
+    TestFixture *fixture;
+    guint        n_completed;
+} RoundTripsContext;
+
+static void round_trip_next (RoundTripsContext *ctx);
+
+static void
+round_trip_ready (QmiDevice         *device,
+                  GAsyncResult      *res,
+                  RoundTripsContext *ctx)
+{
+    GError *error = NULL;
+    QmiMessage *reply;
+
+    reply = qmi_device_command_full_finish (device, res, &error);
+    g_assert_no_error (error);
+    g_assert (reply);
+    qmi_message_unref (reply);
+
+    if (++ctx->n_completed == N_ROUND_TRIPS)
+        test_fixture_loop_stop (ctx->fixture);
+    else
+        round_trip_next (ctx);
+}
+
+static void
+round_trip_next (RoundTripsContext *ctx)
+{
+    /* DMS Get Operating Mode response */
+    guint8 response[] = {
+        0x01,
+        0x17, 0x00, 0x80, 0x02, 0x01,
+        0x02, 0xFF, 0xFF, 0x2D, 0x00, 0x0B, 0x00,
+        0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x01, 0x00, 0x00
+    };
+    QmiMessage *request;
+    const guint8 *raw;
+    gsize raw_len;
+    GError *error = NULL;
+    guint16 transaction_id;
+
+    transaction_id = ctx->fixture->service_info[QMI_SERVICE_DMS].transaction_id++;
+    request = qmi_message_new (QMI_SERVICE_DMS,
+                               qmi_client_get_cid (ctx->fixture->service_info[QMI_SERVICE_DMS].client),
+                               transaction_id,
+                               0x002D);
+    raw = qmi_message_get_raw (request, &raw_len, &error);
+    g_assert_no_error (error);
+
+    test_port_context_set_command (ctx->fixture->ctx,
+                                   raw, raw_len,
+                                   response, G_N_ELEMENTS (response),
+                                   transaction_id);
+    qmi_device_command_full (ctx->fixture->device, request, NULL, 10, NULL,
+                             (GAsyncReadyCallback) round_trip_ready,
+                             ctx);
+    qmi_message_unref (request);
+}
+
+static void
+test_generated_core_round_trips (TestFixture *fixture)
+{
+    RoundTripsContext ctx = { fixture, 0 };
+    gdouble elapsed;
+
+    /* Don't measure the traces */
+    qmi_utils_set_traces_enabled (FALSE);
+
+    g_test_timer_start ();
+    round_trip_next (&ctx);
+    test_fixture_loop_run (fixture);
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (ctx.n_completed, ==, N_ROUND_TRIPS);
+    g_test_maximized_result (N_ROUND_TRIPS / elapsed,
+                             "%u round trips in %.3f s: %.0f round trips/s",
+                             N_ROUND_TRIPS, elapsed, N_ROUND_TRIPS / elapsed);
+
+    qmi_utils_set_traces_enabled (TRUE);
+}
+
 /*****************************************************************************/
 /* DMS Get IDs */
 
@@ -337,6 +613,61 @@ test_generated_dms_get_time (TestFixture *fixture)
     test_fixture_loop_run (fixture);
 }
 
+/*****************************************************************************/
+/* DMS Get Time, parsed into caller storage */
+
+static void
+dms_get_time_into_ready (QmiClientDms *client,
+                         GAsyncResult *res,
+                         TestFixture  *fixture)
+{
+    QmiMessageDmsGetTimeOutputValues values;
+    GError *error = NULL;
+    gboolean st;
+
+    st = qmi_client_dms_get_time_finish_into (client, res, &values, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+
+    g_assert (values.device_time_set);
+    g_assert_cmpuint (values.device_time_time_count, == , 884789480513ULL);
+    g_assert_cmpuint (values.device_time_time_source, ==, QMI_DMS_TIME_SOURCE_HDR_NETWORK);
+    g_assert (values.system_time_set);
+    g_assert_cmpuint (values.system_time, ==, 1105986850641ULL);
+    g_assert (!values.user_time_set);
+
+    test_fixture_loop_stop (fixture);
+}
+
+static void
+test_generated_dms_get_time_into (TestFixture *fixture)
+{
+    guint8 expected[] = {
+        0x01,
+        0x0C, 0x00, 0x00, 0x02, 0x01, 0x00, 0x01, 0x00, 0x2F, 0x00,
+        0x00, 0x00
+    };
+    guint8 response[] = {
+        0x01,
+        0x29, 0x00, 0x80, 0x02, 0x01, 0x02, 0x01, 0x00, 0x2F, 0x00,
+        0x1D, 0x00,
+        0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x08, 0x00, 0x41, 0x0C, 0x90, 0x01, 0xCE, 0x00, 0x02, 0x00, /* Note: last 0x0200 for HDR network source */
+        0x10, 0x08, 0x00, 0x51, 0x0F, 0xF4, 0x81, 0x01, 0x01, 0x00, 0x00
+    };
+
+    test_port_context_set_command (fixture->ctx,
+                                   expected, G_N_ELEMENTS (expected),
+                                   response, G_N_ELEMENTS (response),
+                                   fixture->service_info[QMI_SERVICE_DMS].transaction_id++);
+
+    qmi_client_dms_get_time (QMI_CLIENT_DMS (fixture->service_info[QMI_SERVICE_DMS].client), NULL, 3, NULL,
+                             (GAsyncReadyCallback) dms_get_time_into_ready,
+                             fixture);
+
+    test_fixture_loop_run (fixture);
+}
+
 /*****************************************************************************/
 /* NAS Network Scan */
 typedef struct {
@@ -608,6 +939,101 @@ test_generated_nas_network_scan (TestFixture *fixture)
     test_fixture_loop_run (fixture);
 }
 
+/* Optional TLVs of the output are parsed when first read, so a malformed one
+ * doesn't make the whole response fail, but is reported by its getter */
+
+static void
+nas_network_scan_lazy_ready (QmiClientNas *client,
+                             GAsyncResult *res,
+                             TestFixture  *fixture)
+{
+    QmiMessageNasNetworkScanOutput *output;
+    GError *error = NULL;
+    gboolean st;
+    GArray *network_information = NULL;
+    GArray *network_information_again = NULL;
+    GArray *radio_access_technology = NULL;
+    QmiMessageNasNetworkScanOutputNetworkInformationElement *el;
+
+    output = qmi_client_nas_network_scan_finish (client, res, &error);
+    g_assert_no_error (error);
+    g_assert (output);
+
+    st = qmi_message_nas_network_scan_output_get_result (output, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+
+    /* Parsed on the first call, and kept for the next ones */
+    st = qmi_message_nas_network_scan_output_get_network_information (output, &network_information, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpuint (network_information->len, ==, 1);
+    el = &g_array_index (network_information, QmiMessageNasNetworkScanOutputNetworkInformationElement, 0);
+    g_assert_cmpuint (el->mcc, ==, 214);
+    g_assert_cmpuint (el->mnc, ==, 1);
+    g_assert_cmpstr  (el->description, ==, "");
+    st = qmi_message_nas_network_scan_output_get_network_information (output, &network_information_again, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert (network_information_again == network_information);
+
+    /* The error parsing the malformed TLV goes to the getter... */
+    st = qmi_message_nas_network_scan_output_get_radio_access_technology (output, &radio_access_technology, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_TOO_LONG);
+    g_assert (!st);
+    g_clear_error (&error);
+
+    /* ...and is kept for the next calls */
+    st = qmi_message_nas_network_scan_output_get_radio_access_technology (output, &radio_access_technology, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_TOO_LONG);
+    g_assert (!st);
+    g_clear_error (&error);
+
+    /* Missing TLVs are just not found */
+    st = qmi_message_nas_network_scan_output_get_mnc_pcs_digit_include_status (output, NULL, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_NOT_FOUND);
+    g_assert (!st);
+    g_clear_error (&error);
+
+    qmi_message_nas_network_scan_output_unref (output);
+
+    test_fixture_loop_stop (fixture);
+}
+
+static void
+test_generated_nas_network_scan_lazy (TestFixture *fixture)
+{
+    guint8 expected[] = {
+        0x01,
+        0x0C, 0x00, 0x00, 0x03, 0x01,
+        0x00, 0xFF, 0xFF, 0x21, 0x00, 0x00, 0x00
+    };
+    guint8 response[] = {
+        0x01,
+        0x28, 0x00, 0x80, 0x03, 0x01,
+        0x02, 0xFF, 0xFF, 0x21, 0x00, 0x1C, 0x00,
+        /* Result */
+        0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+        /* Network Information, 1 item */
+        0x10, 0x08, 0x00, 0x01, 0x00, 0xD6, 0x00, 0x01,
+        0x00, 0xAA, 0x00,
+        /* Radio Access Technology, 2 items announced but only 1 given */
+        0x11, 0x07, 0x00, 0x02, 0x00, 0xD6, 0x00, 0x01,
+        0x00, 0x04
+    };
+
+    test_port_context_set_command (fixture->ctx,
+                                   expected, G_N_ELEMENTS (expected),
+                                   response, G_N_ELEMENTS (response),
+                                   fixture->service_info[QMI_SERVICE_NAS].transaction_id++);
+
+    qmi_client_nas_network_scan (QMI_CLIENT_NAS (fixture->service_info[QMI_SERVICE_NAS].client), NULL, 3, NULL,
+                                 (GAsyncReadyCallback) nas_network_scan_lazy_ready,
+                                 fixture);
+
+    test_fixture_loop_run (fixture);
+}
+
 static void
 test_generated_nas_get_cell_location_info (TestFixture *fixture)
 {
@@ -646,21 +1072,377 @@ test_generated_nas_get_cell_location_info (TestFixture *fixture)
 
 /*****************************************************************************/
 
+/*****************************************************************************/
+/* NAS Event Report broadcast indication */
+
+static void
+nas_event_report_broadcast_cb (QmiClientNas                      *client,
+                               QmiIndicationNasEventReportOutput *output,
+                               TestFixture                       *fixture)
+{
+    test_fixture_loop_stop (fixture);
+}
+
+static void
+test_generated_nas_event_report_broadcast (TestFixture *fixture)
+{
+    guint8 indication[] = {
+        0x01,
+        0x11, 0x00, 0x80, 0x03, 0xFF,
+        0x04, 0x00, 0x00, 0x02, 0x00, 0x05, 0x00,
+        0x10, 0x02, 0x00, 0xB5, 0x08
+    };
+    gulong indication_id;
+    guint64 n_indications = 0;
+    guint64 n_deliveries = 0;
+
+    indication_id = g_signal_connect (fixture->service_info[QMI_SERVICE_NAS].client,
+                                      "event-report",
+                                      G_CALLBACK (nas_event_report_broadcast_cb),
+                                      fixture);
+
+    test_port_context_send_indications (fixture->ctx, indication, G_N_ELEMENTS (indication), 1);
+    test_fixture_loop_run (fixture);
+
+    /* Only reported to the single NAS client */
+    qmi_device_get_broadcast_stats (fixture->device, &n_indications, &n_deliveries);
+    g_assert_cmpuint (n_indications, ==, 1);
+    g_assert_cmpuint (n_deliveries, ==, 1);
+
+    g_signal_handler_disconnect (fixture->service_info[QMI_SERVICE_NAS].client, indication_id);
+}
+
+/*****************************************************************************/
+/* NAS Event Report indications throughput */
+
+#define N_INDICATIONS 100000
+
+typedef struct {
+    TestFixture *fixture;
+    guint        n_received;
+} IndicationsContext;
+
+static void
+nas_event_report_cb (QmiClientNas                      *client,
+                     QmiIndicationNasEventReportOutput *output,
+                     IndicationsContext                *ctx)
+{
+    GError *error = NULL;
+    gboolean st;
+    gint8 strength;
+    QmiNasRadioInterface radio_interface;
+
+    st = qmi_indication_nas_event_report_output_get_signal_strength (output, &strength, &radio_interface, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (strength, ==, -75);
+    g_assert_cmpint (radio_interface, ==, QMI_NAS_RADIO_INTERFACE_LTE);
+
+    if (++ctx->n_received == N_INDICATIONS)
+        test_fixture_loop_stop (ctx->fixture);
+}
+
+static void
+test_generated_nas_event_report_throughput (TestFixture *fixture)
+{
+    guint8 indication[] = {
+        0x01,
+        0x11, 0x00, 0x80, 0x03, 0x01,
+        0x04, 0x00, 0x00, 0x02, 0x00, 0x05, 0x00,
+        0x10, 0x02, 0x00, 0xB5, 0x08
+    };
+    IndicationsContext ctx = { fixture, 0 };
+    gulong indication_id;
+    gdouble elapsed;
+
+    /* Don't measure the traces */
+    qmi_utils_set_traces_enabled (FALSE);
+
+    indication_id = g_signal_connect (fixture->service_info[QMI_SERVICE_NAS].client,
+                                      "event-report",
+                                      G_CALLBACK (nas_event_report_cb),
+                                      &ctx);
+
+    g_test_timer_start ();
+    test_port_context_send_indications (fixture->ctx, indication, G_N_ELEMENTS (indication), N_INDICATIONS);
+    test_fixture_loop_run (fixture);
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (ctx.n_received, ==, N_INDICATIONS);
+    g_test_maximized_result (N_INDICATIONS / elapsed,
+                             "%u indications in %.3f s: %.0f indications/s",
+                             N_INDICATIONS, elapsed, N_INDICATIONS / elapsed);
+
+    g_signal_handler_disconnect (fixture->service_info[QMI_SERVICE_NAS].client, indication_id);
+    qmi_utils_set_traces_enabled (TRUE);
+}
+
+/*****************************************************************************/
+/* NAS Event Report indications decoding, with several TLVs to parse. Compare
+ * the results of builds with --with-codegen-backend=unrolled and =tables. */
+
+typedef struct {
+    TestFixture *fixture;
+    guint        n_received;
+    gdouble      first_elapsed;
+} DecodeContext;
+
+static void
+nas_event_report_decode_cb (QmiClientNas                      *client,
+                            QmiIndicationNasEventReportOutput *output,
+                            DecodeContext                     *ctx)
+{
+    GError *error = NULL;
+    gboolean st;
+    gint8 strength;
+    QmiNasRadioInterface radio_interface;
+    GArray *array = NULL;
+    QmiIndicationNasEventReportOutputRfBandInformationElement *element;
+    gint32 io;
+    QmiNasEvdoSinrLevel sinr;
+    gint16 lte_snr;
+    gint16 lte_rsrp;
+
+    if (ctx->n_received == 0)
+        ctx->first_elapsed = g_test_timer_elapsed ();
+
+    st = qmi_indication_nas_event_report_output_get_signal_strength (output, &strength, &radio_interface, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (strength, ==, -75);
+    g_assert_cmpint (radio_interface, ==, QMI_NAS_RADIO_INTERFACE_LTE);
+
+    st = qmi_indication_nas_event_report_output_get_rf_band_information (output, &array, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpuint (array->len, ==, 2);
+    element = &g_array_index (array, QmiIndicationNasEventReportOutputRfBandInformationElement, 1);
+    g_assert_cmpint (element->radio_interface, ==, QMI_NAS_RADIO_INTERFACE_LTE);
+    g_assert_cmpuint (element->active_channel, ==, 1680);
+
+    st = qmi_indication_nas_event_report_output_get_io (output, &io, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (io, ==, -100);
+
+    st = qmi_indication_nas_event_report_output_get_sinr (output, &sinr, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (sinr, ==, QMI_NAS_EVDO_SINR_LEVEL_5);
+
+    st = qmi_indication_nas_event_report_output_get_lte_snr (output, &lte_snr, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (lte_snr, ==, 100);
+
+    st = qmi_indication_nas_event_report_output_get_lte_rsrp (output, &lte_rsrp, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpint (lte_rsrp, ==, -90);
+
+    if (++ctx->n_received == N_INDICATIONS)
+        test_fixture_loop_stop (ctx->fixture);
+}
+
+static void
+test_generated_nas_event_report_decode (TestFixture *fixture)
+{
+    guint8 indication[] = {
+        0x01,
+        0x34, 0x00, 0x80, 0x03, 0x01,
+        0x04, 0x00, 0x00, 0x02, 0x00, 0x28, 0x00,
+        /* Signal strength */
+        0x10, 0x02, 0x00, 0xB5, 0x08,
+        /* RF band information */
+        0x11, 0x0B, 0x00, 0x02,
+        0x08, 0x7A, 0x00, 0x2C, 0x01,
+        0x08, 0x7D, 0x00, 0x90, 0x06,
+        /* IO */
+        0x15, 0x04, 0x00, 0x9C, 0xFF, 0xFF, 0xFF,
+        /* SINR */
+        0x16, 0x01, 0x00, 0x05,
+        /* LTE SNR */
+        0x19, 0x02, 0x00, 0x64, 0x00,
+        /* LTE RSRP */
+        0x1A, 0x02, 0x00, 0xA6, 0xFF
+    };
+    DecodeContext ctx = { fixture, 0, 0.0 };
+    gulong indication_id;
+    gdouble elapsed;
+
+    /* Don't measure the traces */
+    qmi_utils_set_traces_enabled (FALSE);
+
+    indication_id = g_signal_connect (fixture->service_info[QMI_SERVICE_NAS].client,
+                                      "event-report",
+                                      G_CALLBACK (nas_event_report_decode_cb),
+                                      &ctx);
+
+    g_test_timer_start ();
+    test_port_context_send_indications (fixture->ctx, indication, G_N_ELEMENTS (indication), N_INDICATIONS);
+    test_fixture_loop_run (fixture);
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (ctx.n_received, ==, N_INDICATIONS);
+
+    /* Only meaningful as cold-start latency when the test is run on its own */
+    g_test_minimized_result (ctx.first_elapsed * 1e6,
+                             "first indication decoded in %.0f us",
+                             ctx.first_elapsed * 1e6);
+    g_test_maximized_result (N_INDICATIONS / elapsed,
+                             "%u indications decoded in %.3f s: %.0f indications/s",
+                             N_INDICATIONS, elapsed, N_INDICATIONS / elapsed);
+
+    g_signal_handler_disconnect (fixture->service_info[QMI_SERVICE_NAS].client, indication_id);
+    qmi_utils_set_traces_enabled (TRUE);
+}
+
+/*****************************************************************************/
+/* WDS Start Network
+ *
+ * Multiple TLVs, some of them variable-length strings; the generated request
+ * creator warns if the buffer size it computed up front doesn't match what
+ * ends up being written. The request is sent several times with the same
+ * input, which reuses the serialized request until the input is modified. */
+
+static void
+wds_start_network_ready (QmiClientWds *client,
+                         GAsyncResult *res,
+                         TestFixture  *fixture)
+{
+    QmiMessageWdsStartNetworkOutput *output;
+    GError *error = NULL;
+    gboolean st;
+    guint32 packet_data_handle;
+
+    output = qmi_client_wds_start_network_finish (client, res, &error);
+    g_assert_no_error (error);
+    g_assert (output);
+
+    st = qmi_message_wds_start_network_output_get_result (output, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+
+    st = qmi_message_wds_start_network_output_get_packet_data_handle (output, &packet_data_handle, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    g_assert_cmpuint (packet_data_handle, ==, 0x12345678);
+
+    qmi_message_wds_start_network_output_unref (output);
+
+    test_fixture_loop_stop (fixture);
+}
+
+static void
+test_generated_wds_start_network (TestFixture *fixture)
+{
+    QmiMessageWdsStartNetworkInput *input;
+    gboolean st;
+    GError *error = NULL;
+    guint8 expected[] = {
+        0x01,
+        0x2D, 0x00, 0x00, 0x01, 0x01,
+        0x00, 0xFF, 0xFF, 0x20, 0x00, 0x21, 0x00,
+        0x19, 0x01, 0x00, 0x04,
+        0x18, 0x04, 0x00, 0x70, 0x61, 0x73, 0x73,
+        0x17, 0x04, 0x00, 0x75, 0x73, 0x65, 0x72,
+        0x16, 0x01, 0x00, 0x03,
+        0x14, 0x08, 0x00, 0x69, 0x6E, 0x74, 0x65, 0x72, 0x6E, 0x65, 0x74
+    };
+    guint8 response[] = {
+        0x01,
+        0x1A, 0x00, 0x80, 0x01, 0x01,
+        0x02, 0xFF, 0xFF, 0x20, 0x00, 0x0E, 0x00,
+        0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x04, 0x00, 0x78, 0x56, 0x34, 0x12
+    };
+
+    test_port_context_set_command (fixture->ctx,
+                                   expected, G_N_ELEMENTS (expected),
+                                   response, G_N_ELEMENTS (response),
+                                   fixture->service_info[QMI_SERVICE_WDS].transaction_id++);
+
+    input = qmi_message_wds_start_network_input_new ();
+    st = qmi_message_wds_start_network_input_set_apn (input, "internet", &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    st = qmi_message_wds_start_network_input_set_authentication_preference (input, QMI_WDS_AUTHENTICATION_PAP | QMI_WDS_AUTHENTICATION_CHAP, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    st = qmi_message_wds_start_network_input_set_username (input, "user", &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    st = qmi_message_wds_start_network_input_set_password (input, "pass", &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    st = qmi_message_wds_start_network_input_set_ip_family_preference (input, QMI_WDS_IP_FAMILY_IPV4, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+
+    qmi_client_wds_start_network (QMI_CLIENT_WDS (fixture->service_info[QMI_SERVICE_WDS].client), input, 3, NULL,
+                                  (GAsyncReadyCallback) wds_start_network_ready,
+                                  fixture);
+    test_fixture_loop_run (fixture);
+
+    /* Same input again, reusing the serialized request with a new
+     * transaction id */
+    test_port_context_set_command (fixture->ctx,
+                                   expected, G_N_ELEMENTS (expected),
+                                   response, G_N_ELEMENTS (response),
+                                   fixture->service_info[QMI_SERVICE_WDS].transaction_id++);
+    qmi_client_wds_start_network (QMI_CLIENT_WDS (fixture->service_info[QMI_SERVICE_WDS].client), input, 3, NULL,
+                                  (GAsyncReadyCallback) wds_start_network_ready,
+                                  fixture);
+    test_fixture_loop_run (fixture);
+
+    /* Modified input must not reuse it */
+    st = qmi_message_wds_start_network_input_set_ip_family_preference (input, QMI_WDS_IP_FAMILY_IPV6, &error);
+    g_assert_no_error (error);
+    g_assert (st);
+    expected[16] = 0x06;
+
+    test_port_context_set_command (fixture->ctx,
+                                   expected, G_N_ELEMENTS (expected),
+                                   response, G_N_ELEMENTS (response),
+                                   fixture->service_info[QMI_SERVICE_WDS].transaction_id++);
+    qmi_client_wds_start_network (QMI_CLIENT_WDS (fixture->service_info[QMI_SERVICE_WDS].client), input, 3, NULL,
+                                  (GAsyncReadyCallback) wds_start_network_ready,
+                                  fixture);
+    test_fixture_loop_run (fixture);
+
+    qmi_message_wds_start_network_input_unref (input);
+}
+
 int main (int argc, char **argv)
 {
     g_test_init (&argc, &argv, NULL);
 
     /* Test the setup/teardown test methods */
     TEST_ADD ("/libqmi-glib/generated/core", test_generated_core);
+    TEST_ADD ("/libqmi-glib/generated/core/transaction-timeouts", test_generated_core_transaction_timeouts);
+    TEST_ADD ("/libqmi-glib/generated/core/transaction-timeout-last-ref", test_generated_core_transaction_timeout_last_ref);
+    TEST_ADD ("/libqmi-glib/generated/core/send-window", test_generated_core_send_window);
 
     /* DMS */
     TEST_ADD ("/libqmi-glib/generated/dms/get-ids",                test_generated_dms_get_ids);
     TEST_ADD ("/libqmi-glib/generated/dms/uim-get-pin-status",     test_generated_dms_uim_get_pin_status);
     TEST_ADD ("/libqmi-glib/generated/dms/uim-verify-pin",         test_generated_dms_uim_verify_pin);
     TEST_ADD ("/libqmi-glib/generated/dms/get-time",               test_generated_dms_get_time);
+    TEST_ADD ("/libqmi-glib/generated/dms/get-time-into",          test_generated_dms_get_time_into);
     /* NAS */
     TEST_ADD ("/libqmi-glib/generated/nas/network-scan",           test_generated_nas_network_scan);
+    TEST_ADD ("/libqmi-glib/generated/nas/network-scan/lazy",      test_generated_nas_network_scan_lazy);
     TEST_ADD ("/libqmi-glib/generated/nas/get-cell-location-info", test_generated_nas_get_cell_location_info);
+    TEST_ADD ("/libqmi-glib/generated/nas/event-report-broadcast", test_generated_nas_event_report_broadcast);
+    /* WDS */
+    TEST_ADD ("/libqmi-glib/generated/wds/start-network",          test_generated_wds_start_network);
+
+    /* Benchmarks */
+    if (g_test_perf ()) {
+        TEST_ADD ("/libqmi-glib/generated/core/round-trips",             test_generated_core_round_trips);
+        TEST_ADD ("/libqmi-glib/generated/nas/event-report-throughput", test_generated_nas_event_report_throughput);
+        TEST_ADD ("/libqmi-glib/generated/nas/event-report-decode",     test_generated_nas_event_report_decode);
+    }
 
     return g_test_run ();
 }
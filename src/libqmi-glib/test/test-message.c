@@ -174,6 +174,31 @@ test_message_parse_complete_and_complete (void)
     test_message_parse_common (buffer, sizeof (buffer), 2);
 }
 
+static void
+test_message_printable_translated (void)
+{
+    QmiMessage *request;
+    QmiMessage *response;
+    gchar *printable;
+
+    request = qmi_message_new (QMI_SERVICE_DMS, 0x01, 0x02, 0x002F);
+    response = qmi_message_response_new (request, QMI_PROTOCOL_ERROR_NONE);
+
+    /* The translated TLV is streamed into the same printable as its header */
+    printable = qmi_message_get_printable_full (response, NULL, ">> ");
+    g_assert (strstr (printable,
+                      ">>   message     = \"Get Time\" (0x002F)\n"
+                      ">> TLV:\n"
+                      ">>   type       = \"Result\" (0x02)\n"
+                      ">>   length     = 4\n"
+                      ">>   value      = 00:00:00:00\n"
+                      ">>   translated = SUCCESS\n"));
+    g_free (printable);
+
+    qmi_message_unref (request);
+    qmi_message_unref (response);
+}
+
 static void
 test_message_overflow_common (const guint8 *buffer,
                               guint buffer_len)
@@ -237,6 +262,136 @@ test_message_parse_missing_size (void)
     test_message_overflow_common (buffer, G_N_ELEMENTS (buffer));
 }
 
+/* DMS Get IDs response, 39 bytes */
+static const guint8 backlog_message[] = {
+    0x01, 0x26, 0x00, 0x80, 0x03, 0x01, 0x02, 0x01, 0x00, 0x20, 0x00, 0x1a,
+    0x00, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x9b,
+    0x05, 0x11, 0x04, 0x00, 0x01, 0x00, 0x65, 0x05, 0x12, 0x04, 0x00, 0x01,
+    0x00, 0x11, 0x05
+};
+
+static GByteArray *
+build_backlog (guint n_messages,
+               guint n_trailing_bytes)
+{
+    GByteArray *backlog;
+    guint i;
+
+    g_assert_cmpuint (n_trailing_bytes, <, sizeof (backlog_message));
+
+    backlog = g_byte_array_sized_new (n_messages * sizeof (backlog_message) + n_trailing_bytes);
+    for (i = 0; i < n_messages; i++)
+        g_byte_array_append (backlog, backlog_message, sizeof (backlog_message));
+    g_byte_array_append (backlog, backlog_message, n_trailing_bytes);
+    return backlog;
+}
+
+static guint
+parse_backlog (GByteArray *backlog)
+{
+    gsize offset = 0;
+    guint n_messages = 0;
+
+    while (offset < backlog->len) {
+        GError *error = NULL;
+        QmiMessage *message;
+        gsize consumed = 0;
+
+        message = qmi_message_new_from_raw_buffer (&backlog->data[offset],
+                                                   backlog->len - offset,
+                                                   &consumed,
+                                                   &error);
+        g_assert_no_error (error);
+        if (!message) {
+            g_assert_cmpuint (consumed, ==, 0);
+            break;
+        }
+
+        g_assert_cmpuint (consumed, ==, sizeof (backlog_message));
+        g_assert_cmpuint (((GByteArray *)message)->len, ==, sizeof (backlog_message));
+        g_assert_cmpuint (qmi_message_get_service (message), ==, QMI_SERVICE_DMS);
+        offset += consumed;
+        n_messages++;
+        qmi_message_unref (message);
+    }
+
+    /* Only the trailing partial message is left */
+    g_assert_cmpuint (backlog->len - offset, <, sizeof (backlog_message));
+    return n_messages;
+}
+
+static void
+test_message_parse_raw_buffer (void)
+{
+    GByteArray *backlog;
+
+    /* Partial header */
+    backlog = build_backlog (0, 2);
+    g_assert_cmpuint (parse_backlog (backlog), ==, 0);
+    g_byte_array_unref (backlog);
+
+    /* Complete messages plus a partial one */
+    backlog = build_backlog (10, 20);
+    g_assert_cmpuint (parse_backlog (backlog), ==, 10);
+    g_assert_cmpuint (backlog->len, ==, 10 * sizeof (backlog_message) + 20);
+    g_byte_array_unref (backlog);
+}
+
+static void
+test_message_parse_raw_buffer_invalid (void)
+{
+    GError *error = NULL;
+    QmiMessage *message;
+    guint8 buffer[sizeof (backlog_message) * 2];
+    gsize consumed = 0;
+
+    memcpy (buffer, backlog_message, sizeof (backlog_message));
+    memcpy (&buffer[sizeof (backlog_message)], backlog_message, sizeof (backlog_message));
+    /* Break the all-TLVs length of the first message */
+    buffer[10] = 0x00;
+
+    message = qmi_message_new_from_raw_buffer (buffer, sizeof (buffer), &consumed, &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_INVALID_MESSAGE);
+    g_assert (!message);
+    g_assert_cmpuint (consumed, ==, sizeof (backlog_message));
+    g_clear_error (&error);
+
+    /* The next message can still be read */
+    message = qmi_message_new_from_raw_buffer (&buffer[consumed], sizeof (buffer) - consumed, &consumed, &error);
+    g_assert_no_error (error);
+    g_assert (message);
+    g_assert_cmpuint (consumed, ==, sizeof (backlog_message));
+    qmi_message_unref (message);
+}
+
+static void
+test_message_parse_backlog_cost (void)
+{
+    static const guint n_messages[] = { 1000, 10000, 100000 };
+    gdouble per_message[G_N_ELEMENTS (n_messages)];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (n_messages); i++) {
+        GByteArray *backlog;
+        gdouble elapsed;
+
+        backlog = build_backlog (n_messages[i], 0);
+        g_test_timer_start ();
+        g_assert_cmpuint (parse_backlog (backlog), ==, n_messages[i]);
+        elapsed = g_test_timer_elapsed ();
+        g_byte_array_unref (backlog);
+
+        per_message[i] = elapsed / n_messages[i];
+        g_test_minimized_result (per_message[i] * 1e9,
+                                 "%u queued messages: %.1f ns per message",
+                                 n_messages[i], per_message[i] * 1e9);
+    }
+
+    /* Framing cost must not grow with the backlog size (allow some slack
+     * for cache effects) */
+    g_assert_cmpfloat (per_message[G_N_ELEMENTS (n_messages) - 1], <, per_message[0] * 4);
+}
+
 /*****************************************************************************/
 
 static void
@@ -272,6 +427,54 @@ test_message_new_request (void)
     qmi_message_unref (self);
 }
 
+static void
+test_message_new_request_with_capacity (void)
+{
+    QmiMessage *self;
+    QmiMessage *expected;
+    GError *error = NULL;
+    const guint8 *data;
+    guint i;
+
+    /* Two TLVs: 1-byte value plus a 4-byte string, 3-byte headers each */
+    self = qmi_message_new_with_capacity (QMI_SERVICE_DMS, 0x01, 0x02, 0xFFFF, 4 + 7);
+    g_assert (self);
+    expected = qmi_message_new (QMI_SERVICE_DMS, 0x01, 0x02, 0xFFFF);
+    g_assert (expected);
+
+    /* Same contents as a message created without capacity */
+    g_assert_cmpuint (self->len, ==, expected->len);
+    g_assert (memcmp (self->data, expected->data, self->len) == 0);
+
+    /* Filling the capacity must not reallocate the buffer */
+    data = self->data;
+    for (i = 0; i < 2; i++) {
+        QmiMessage *message = (i == 0 ? self : expected);
+        gsize init_offset;
+
+        init_offset = qmi_message_tlv_write_init (message, 0x01, &error);
+        g_assert_no_error (error);
+        g_assert (qmi_message_tlv_write_guint8 (message, 0xAA, &error));
+        g_assert_no_error (error);
+        g_assert (qmi_message_tlv_write_complete (message, init_offset, &error));
+        g_assert_no_error (error);
+
+        init_offset = qmi_message_tlv_write_init (message, 0x02, &error);
+        g_assert_no_error (error);
+        g_assert (qmi_message_tlv_write_string (message, 0, "1234", -1, &error));
+        g_assert_no_error (error);
+        g_assert (qmi_message_tlv_write_complete (message, init_offset, &error));
+        g_assert_no_error (error);
+    }
+    g_assert (self->data == data);
+
+    g_assert_cmpuint (self->len, ==, expected->len);
+    g_assert (memcmp (self->data, expected->data, self->len) == 0);
+
+    qmi_message_unref (expected);
+    qmi_message_unref (self);
+}
+
 static void
 test_message_new_request_from_data (void)
 {
@@ -1502,6 +1705,380 @@ test_message_tlv_read_overflow_tlv (void)
 
 /*****************************************************************************/
 
+static void
+add_guint8_tlv (QmiMessage *self,
+                guint8      type,
+                guint8      value)
+{
+    GError *error = NULL;
+    gsize init_offset;
+
+    init_offset = qmi_message_tlv_write_init (self, type, &error);
+    g_assert_no_error (error);
+    g_assert (init_offset > 0);
+    g_assert (qmi_message_tlv_write_guint8 (self, value, &error));
+    g_assert_no_error (error);
+    g_assert (qmi_message_tlv_write_complete (self, init_offset, &error));
+    g_assert_no_error (error);
+}
+
+static guint8
+read_guint8_tlv (QmiMessage *self,
+                 guint8      type)
+{
+    GError *error = NULL;
+    gsize init_offset;
+    gsize offset = 0;
+    guint8 value;
+
+    init_offset = qmi_message_tlv_read_init (self, type, NULL, &error);
+    g_assert_no_error (error);
+    g_assert (init_offset > 0);
+    g_assert (qmi_message_tlv_read_guint8 (self, init_offset, &offset, &value, &error));
+    g_assert_no_error (error);
+    return value;
+}
+
+static void
+test_message_tlv_read_index (void)
+{
+    QmiMessage *self;
+    QmiMessage *other;
+    GError *error = NULL;
+
+    self = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x02, 0x0021);
+    add_guint8_tlv (self, 0x10, 0xAA);
+    add_guint8_tlv (self, 0x11, 0xBB);
+    /* Duplicated TLV, lookups must return the first one */
+    add_guint8_tlv (self, 0x10, 0xCC);
+
+    g_assert_cmpuint (read_guint8_tlv (self, 0x10), ==, 0xAA);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x11), ==, 0xBB);
+    g_assert_cmpuint (qmi_message_tlv_read_init (self, 0x12, NULL, &error), ==, 0);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_NOT_FOUND);
+    g_clear_error (&error);
+
+    /* Lookups in a different message in between */
+    other = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x03, 0x0021);
+    add_guint8_tlv (other, 0x12, 0xDD);
+    g_assert_cmpuint (read_guint8_tlv (other, 0x12), ==, 0xDD);
+    g_assert_cmpuint (qmi_message_tlv_read_init (other, 0x10, NULL, &error), ==, 0);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_NOT_FOUND);
+    g_clear_error (&error);
+    qmi_message_unref (other);
+
+    /* TLVs added after having done lookups must be found */
+    g_assert_cmpuint (read_guint8_tlv (self, 0x10), ==, 0xAA);
+    add_guint8_tlv (self, 0x12, 0xEE);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x12), ==, 0xEE);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x11), ==, 0xBB);
+
+    qmi_message_unref (self);
+}
+
+static void
+test_message_tlv_read_index_released (void)
+{
+    QmiMessage *self;
+    guint i;
+
+    /* Messages released without qmi_message_unref(), so that the next one
+     * may be allocated in the same place with the same length but with a
+     * different TLV; lookups must never report the TLV as not found */
+    for (i = 0; i < 10; i++) {
+        self = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x02, 0x0021);
+        add_guint8_tlv (self, 0x10 + (i % 2), i);
+        g_assert_cmpuint (read_guint8_tlv (self, 0x10 + (i % 2)), ==, i);
+        g_assert_cmpuint (read_guint8_tlv (self, 0x10 + (i % 2)), ==, i);
+        g_byte_array_unref ((GByteArray *) self);
+    }
+}
+
+/* Replaces the TLVs with others of the same size, with the types swapped */
+static gpointer
+rewrite_tlvs (QmiMessage *self)
+{
+    qmi_message_tlv_write_reset (self, qmi_message_get_length (self) - 8);
+    add_guint8_tlv (self, 0x11, 0xCC);
+    add_guint8_tlv (self, 0x10, 0xDD);
+    return NULL;
+}
+
+static QmiMessage *
+build_indexed_message (void)
+{
+    QmiMessage *self;
+
+    self = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x02, 0x0021);
+    add_guint8_tlv (self, 0x10, 0xAA);
+    add_guint8_tlv (self, 0x11, 0xBB);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x10), ==, 0xAA);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x11), ==, 0xBB);
+    return self;
+}
+
+static void
+test_message_tlv_read_index_rewritten (void)
+{
+    QmiMessage *self;
+    GThread *thread;
+
+    /* Same buffer and length, but different TLV layout */
+    self = build_indexed_message ();
+    rewrite_tlvs (self);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x10), ==, 0xDD);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x11), ==, 0xCC);
+    qmi_message_unref (self);
+
+    /* Also if rewritten in a different thread, which can't drop the index
+     * of this one */
+    self = build_indexed_message ();
+    thread = g_thread_new ("rewrite", (GThreadFunc) rewrite_tlvs, self);
+    g_thread_join (thread);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x10), ==, 0xDD);
+    g_assert_cmpuint (read_guint8_tlv (self, 0x11), ==, 0xCC);
+    qmi_message_unref (self);
+}
+
+static void
+test_message_tlv_read_index_alternate (void)
+{
+    QmiMessage *messages[6];
+    guint i;
+    guint j;
+
+    /* Lookups alternating among more messages than indexes cached */
+    for (i = 0; i < G_N_ELEMENTS (messages); i++) {
+        messages[i] = qmi_message_new (QMI_SERVICE_NAS, 0x01, i + 1, 0x0021);
+        add_guint8_tlv (messages[i], 0x10, i);
+        add_guint8_tlv (messages[i], 0x11 + i, i);
+    }
+
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < G_N_ELEMENTS (messages); i++) {
+            g_assert_cmpuint (read_guint8_tlv (messages[i], 0x10), ==, i);
+            g_assert_cmpuint (read_guint8_tlv (messages[i], 0x11 + i), ==, i);
+            g_assert_cmpuint (qmi_message_tlv_read_init (messages[i], 0x11 + ((i + 1) % G_N_ELEMENTS (messages)), NULL, NULL), ==, 0);
+        }
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (messages); i++)
+        qmi_message_unref (messages[i]);
+}
+
+static gdouble
+measure_tlv_lookups (guint n_tlvs)
+{
+    QmiMessage *self;
+    gdouble elapsed;
+    guint n_lookups = 0;
+    guint i;
+    guint j;
+
+    self = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x02, 0x0021);
+    for (i = 0; i < n_tlvs; i++)
+        add_guint8_tlv (self, 0x10 + i, i);
+
+    /* Emulate a generated parser, which looks up each of the output TLVs */
+    g_test_timer_start ();
+    for (j = 0; j < 1000; j++) {
+        for (i = 0; i < n_tlvs; i++) {
+            g_assert (qmi_message_tlv_read_init (self, 0x10 + i, NULL, NULL) > 0);
+            n_lookups++;
+        }
+    }
+    elapsed = g_test_timer_elapsed ();
+
+    qmi_message_unref (self);
+    return elapsed / n_lookups;
+}
+
+static void
+test_message_tlv_read_lookup_cost (void)
+{
+    /* From the amount of TLVs in a basic response to the amount of TLVs in
+     * large responses like NAS Get Cell Location Info or Network Scan */
+    static const guint n_tlvs[] = { 4, 32, 128 };
+    gdouble per_lookup[G_N_ELEMENTS (n_tlvs)];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (n_tlvs); i++) {
+        per_lookup[i] = measure_tlv_lookups (n_tlvs[i]);
+        g_test_minimized_result (per_lookup[i] * 1e9,
+                                 "%u TLVs: %.1f ns per lookup",
+                                 n_tlvs[i], per_lookup[i] * 1e9);
+    }
+
+    /* Lookup cost must not grow with the number of TLVs (allow some slack
+     * for cache effects) */
+    g_assert_cmpfloat (per_lookup[G_N_ELEMENTS (n_tlvs) - 1], <, per_lookup[0] * 4);
+}
+
+/*****************************************************************************/
+
+static void
+test_message_tlv_rw_arrays (void)
+{
+    static const guint16 values16[] = { 0x0102, 0xA1B2, 0xFFFE, 0x0000, 0x1234 };
+    static const guint32 values32[] = { 0x01020304, 0xA1B2C3D4, 0xFFFFFFFE };
+    static const guint64 values64[] = { 0x0102030405060708, 0xA1B2C3D4E5F60718 };
+    guint n_bytes_prefixed;
+    guint e;
+
+    /* Check both endiannesses and all possible memory alignments, and
+     * compare against the result of writing the values one by one */
+    for (e = 0; e < 2; e++) {
+        QmiEndian endian = (e == 0 ? QMI_ENDIAN_LITTLE : QMI_ENDIAN_BIG);
+
+        for (n_bytes_prefixed = 0; n_bytes_prefixed < 8; n_bytes_prefixed++) {
+            QmiMessage *self;
+            QmiMessage *expected;
+            GError *error = NULL;
+            gsize init_offset;
+            gsize offset;
+            guint16 out16[G_N_ELEMENTS (values16)];
+            guint32 out32[G_N_ELEMENTS (values32)];
+            guint64 out64[G_N_ELEMENTS (values64)];
+            guint i;
+
+            self = qmi_message_new (QMI_SERVICE_DMS, 0x01, 0x02, 0xFFFF);
+            expected = qmi_message_new (QMI_SERVICE_DMS, 0x01, 0x02, 0xFFFF);
+
+            init_offset = qmi_message_tlv_write_init (self, 0x01, &error);
+            g_assert_no_error (error);
+            for (i = 0; i < n_bytes_prefixed; i++)
+                g_assert (qmi_message_tlv_write_guint8 (self, 0xFF, &error));
+            g_assert (qmi_message_tlv_write_guint16_array (self, endian, values16, G_N_ELEMENTS (values16), &error));
+            g_assert_no_error (error);
+            g_assert (qmi_message_tlv_write_guint32_array (self, endian, values32, G_N_ELEMENTS (values32), &error));
+            g_assert_no_error (error);
+            g_assert (qmi_message_tlv_write_guint64_array (self, endian, values64, G_N_ELEMENTS (values64), &error));
+            g_assert_no_error (error);
+            g_assert (qmi_message_tlv_write_guint16_array (self, endian, NULL, 0, &error));
+            g_assert_no_error (error);
+            g_assert (qmi_message_tlv_write_complete (self, init_offset, &error));
+            g_assert_no_error (error);
+
+            init_offset = qmi_message_tlv_write_init (expected, 0x01, &error);
+            g_assert_no_error (error);
+            for (i = 0; i < n_bytes_prefixed; i++)
+                g_assert (qmi_message_tlv_write_guint8 (expected, 0xFF, &error));
+            for (i = 0; i < G_N_ELEMENTS (values16); i++)
+                g_assert (qmi_message_tlv_write_guint16 (expected, endian, values16[i], &error));
+            for (i = 0; i < G_N_ELEMENTS (values32); i++)
+                g_assert (qmi_message_tlv_write_guint32 (expected, endian, values32[i], &error));
+            for (i = 0; i < G_N_ELEMENTS (values64); i++)
+                g_assert (qmi_message_tlv_write_guint64 (expected, endian, values64[i], &error));
+            g_assert (qmi_message_tlv_write_complete (expected, init_offset, &error));
+            g_assert_no_error (error);
+
+            g_assert_cmpuint (self->len, ==, expected->len);
+            g_assert (memcmp (self->data, expected->data, self->len) == 0);
+
+            /* Now read */
+            init_offset = qmi_message_tlv_read_init (self, 0x01, NULL, &error);
+            g_assert_no_error (error);
+            g_assert (init_offset > 0);
+            offset = n_bytes_prefixed;
+
+            g_assert (qmi_message_tlv_read_guint16_array (self, init_offset, &offset, endian, G_N_ELEMENTS (out16), out16, &error));
+            g_assert_no_error (error);
+            g_assert (memcmp (out16, values16, sizeof (values16)) == 0);
+            g_assert (qmi_message_tlv_read_guint32_array (self, init_offset, &offset, endian, G_N_ELEMENTS (out32), out32, &error));
+            g_assert_no_error (error);
+            g_assert (memcmp (out32, values32, sizeof (values32)) == 0);
+            g_assert (qmi_message_tlv_read_guint64_array (self, init_offset, &offset, endian, G_N_ELEMENTS (out64), out64, &error));
+            g_assert_no_error (error);
+            g_assert (memcmp (out64, values64, sizeof (values64)) == 0);
+
+            /* Nothing else to read */
+            g_assert (!qmi_message_tlv_read_guint16_array (self, init_offset, &offset, endian, 1, out16, &error));
+            g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_TLV_TOO_LONG);
+            g_clear_error (&error);
+            g_assert (qmi_message_tlv_read_guint16_array (self, init_offset, &offset, endian, 0, NULL, &error));
+            g_assert_no_error (error);
+
+            qmi_message_unref (expected);
+            qmi_message_unref (self);
+        }
+    }
+}
+
+static gdouble
+measure_array_reads (guint    n_items,
+                     gboolean bulk)
+{
+    QmiMessage *self;
+    GError *error = NULL;
+    GArray *array;
+    gsize init_offset;
+    gdouble elapsed;
+    guint i;
+    guint j;
+
+    array = g_array_sized_new (FALSE, FALSE, sizeof (guint16), n_items);
+    for (i = 0; i < n_items; i++) {
+        guint16 value = (guint16) i;
+
+        g_array_append_val (array, value);
+    }
+
+    self = qmi_message_new (QMI_SERVICE_NAS, 0x01, 0x02, 0x0021);
+    init_offset = qmi_message_tlv_write_init (self, 0x10, &error);
+    g_assert_no_error (error);
+    g_assert (qmi_message_tlv_write_guint16_array (self, QMI_ENDIAN_BIG, (const guint16 *)array->data, array->len, &error));
+    g_assert_no_error (error);
+    g_assert (qmi_message_tlv_write_complete (self, init_offset, &error));
+    g_assert_no_error (error);
+
+    /* Emulate a generated parser, loading the values into a GArray */
+    init_offset = qmi_message_tlv_read_init (self, 0x10, NULL, &error);
+    g_assert_no_error (error);
+    g_test_timer_start ();
+    for (j = 0; j < 100; j++) {
+        gsize offset = 0;
+
+        if (bulk) {
+            g_array_set_size (array, n_items);
+            g_assert (qmi_message_tlv_read_guint16_array (self, init_offset, &offset, QMI_ENDIAN_BIG, n_items, (guint16 *)array->data, NULL));
+        } else {
+            g_array_set_size (array, 0);
+            for (i = 0; i < n_items; i++) {
+                guint16 aux;
+
+                g_assert (qmi_message_tlv_read_guint16 (self, init_offset, &offset, QMI_ENDIAN_BIG, &aux, NULL));
+                g_array_insert_val (array, i, aux);
+            }
+        }
+    }
+    elapsed = g_test_timer_elapsed ();
+
+    for (i = 0; i < n_items; i++)
+        g_assert_cmpuint (g_array_index (array, guint16, i), ==, (guint16) i);
+
+    g_array_unref (array);
+    qmi_message_unref (self);
+    return elapsed / (100 * n_items);
+}
+
+static void
+test_message_tlv_read_array_cost (void)
+{
+    gdouble per_item;
+    gdouble per_item_bulk;
+
+    /* Large enough to fill a whole message */
+    per_item = measure_array_reads (30000, FALSE);
+    per_item_bulk = measure_array_reads (30000, TRUE);
+
+    g_test_minimized_result (per_item * 1e9, "item by item: %.2f ns per item", per_item * 1e9);
+    g_test_minimized_result (per_item_bulk * 1e9, "bulk: %.2f ns per item", per_item_bulk * 1e9);
+
+    g_assert_cmpfloat (per_item_bulk, <, per_item);
+}
+
+/*****************************************************************************/
+
 static void
 test_message_set_transaction_id_ctl (void)
 {
@@ -1564,8 +2141,12 @@ int main (int argc, char **argv)
     g_test_add_func ("/libqmi-glib/message/parse/complete-and-complete", test_message_parse_complete_and_complete);
     g_test_add_func ("/libqmi-glib/message/parse/wrong-tlv",             test_message_parse_wrong_tlv);
     g_test_add_func ("/libqmi-glib/message/parse/missing-size",          test_message_parse_missing_size);
+    g_test_add_func ("/libqmi-glib/message/parse/raw-buffer",            test_message_parse_raw_buffer);
+    g_test_add_func ("/libqmi-glib/message/parse/raw-buffer-invalid",    test_message_parse_raw_buffer_invalid);
+    g_test_add_func ("/libqmi-glib/message/printable/translated",       test_message_printable_translated);
 
     g_test_add_func ("/libqmi-glib/message/new/request",           test_message_new_request);
+    g_test_add_func ("/libqmi-glib/message/new/request-with-capacity", test_message_new_request_with_capacity);
     g_test_add_func ("/libqmi-glib/message/new/request-from-data", test_message_new_request_from_data);
     g_test_add_func ("/libqmi-glib/message/new/response/ok",       test_message_new_response_ok);
     g_test_add_func ("/libqmi-glib/message/new/response/error",    test_message_new_response_error);
@@ -1582,9 +2163,21 @@ int main (int argc, char **argv)
     g_test_add_func ("/libqmi-glib/message/tlv-write/overflow",        test_message_tlv_write_overflow);
     g_test_add_func ("/libqmi-glib/message/tlv-read/overflow-message", test_message_tlv_read_overflow_message);
     g_test_add_func ("/libqmi-glib/message/tlv-read/overflow-tlv",     test_message_tlv_read_overflow_tlv);
+    g_test_add_func ("/libqmi-glib/message/tlv-read/index",            test_message_tlv_read_index);
+    g_test_add_func ("/libqmi-glib/message/tlv-read/index-released",   test_message_tlv_read_index_released);
+    g_test_add_func ("/libqmi-glib/message/tlv-read/index-rewritten",  test_message_tlv_read_index_rewritten);
+    g_test_add_func ("/libqmi-glib/message/tlv-read/index-alternate",  test_message_tlv_read_index_alternate);
+    g_test_add_func ("/libqmi-glib/message/tlv-rw/arrays",             test_message_tlv_rw_arrays);
 
     g_test_add_func ("/libqmi-glib/message/set-transaction-id/ctl",      test_message_set_transaction_id_ctl);
     g_test_add_func ("/libqmi-glib/message/set-transaction-id/services", test_message_set_transaction_id_services);
 
+    /* Benchmarks */
+    if (g_test_perf ()) {
+        g_test_add_func ("/libqmi-glib/message/parse/backlog-cost",    test_message_parse_backlog_cost);
+        g_test_add_func ("/libqmi-glib/message/tlv-read/lookup-cost",  test_message_tlv_read_lookup_cost);
+        g_test_add_func ("/libqmi-glib/message/tlv-read/array-cost",   test_message_tlv_read_array_cost);
+    }
+
     return g_test_run ();
 }
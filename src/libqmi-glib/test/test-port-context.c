@@ -40,6 +40,7 @@ struct _TestPortContext {
     GMutex command_mutex;
     GByteArray *command;
     GByteArray *response;
+    volatile gint discard_commands;
 };
 
 /*****************************************************************************/
@@ -102,6 +103,27 @@ test_port_context_set_command (TestPortContext *ctx,
     g_mutex_unlock (&ctx->command_mutex);
 }
 
+void
+test_port_context_set_discard_commands (TestPortContext *ctx,
+                                        gboolean         discard)
+{
+    g_atomic_int_set (&ctx->discard_commands, discard);
+}
+
+static gboolean
+discard_next_command (GByteArray *buffer)
+{
+    QmiMessage *message;
+    GError     *error = NULL;
+
+    message = qmi_message_new_from_raw (buffer, &error);
+    g_assert_no_error (error);
+    if (!message)
+        return FALSE;
+    qmi_message_unref (message);
+    return TRUE;
+}
+
 static GByteArray *
 process_next_command (TestPortContext *ctx,
                       GByteArray      *buffer)
@@ -196,6 +218,13 @@ client_parse_request (Client *client)
 {
     GByteArray *response;
 
+    /* Commands that will never get a response */
+    if (g_atomic_int_get (&client->ctx->discard_commands)) {
+        while (discard_next_command (client->buffer))
+            ;
+        return;
+    }
+
     do {
         response = process_next_command (client->ctx, client->buffer);
         if (response) {
@@ -283,6 +312,62 @@ client_new (TestPortContext *ctx,
     return client;
 }
 
+/*****************************************************************************/
+
+typedef struct {
+    TestPortContext *ctx;
+    GByteArray      *indications;
+} SendIndicationsContext;
+
+static gboolean
+send_indications_cb (SendIndicationsContext *send_ctx)
+{
+    GList *l;
+
+    /* Indications are sent to all connected clients */
+    for (l = send_ctx->ctx->clients; l; l = g_list_next (l)) {
+        Client *client = l->data;
+        GError *error = NULL;
+
+        if (!g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
+                                        send_ctx->indications->data,
+                                        send_ctx->indications->len,
+                                        NULL, /* bytes_written */
+                                        NULL, /* cancellable */
+                                        &error)) {
+            g_warning ("Cannot send indications to client: %s", error->message);
+            g_error_free (error);
+        }
+    }
+
+    g_byte_array_unref (send_ctx->indications);
+    g_slice_free (SendIndicationsContext, send_ctx);
+    return G_SOURCE_REMOVE;
+}
+
+void
+test_port_context_send_indications (TestPortContext *ctx,
+                                    const guint8    *indication,
+                                    gsize            indication_size,
+                                    guint            n_indications)
+{
+    SendIndicationsContext *send_ctx;
+    guint i;
+
+    g_assert (ctx->loop != NULL);
+
+    send_ctx = g_slice_new (SendIndicationsContext);
+    send_ctx->ctx = ctx;
+    send_ctx->indications = g_byte_array_sized_new (indication_size * n_indications);
+    for (i = 0; i < n_indications; i++)
+        g_byte_array_append (send_ctx->indications, indication, indication_size);
+
+    /* Write all of them at once from the port thread */
+    g_main_context_invoke (g_main_loop_get_context (ctx->loop),
+                           (GSourceFunc)send_indications_cb,
+                           send_ctx);
+}
+
 /* /\*****************************************************************************\/ */
 
 static void
@@ -33,5 +33,11 @@ void             test_port_context_set_command   (TestPortContext *ctx,
                                                   const guint8    *response,
                                                   gsize            response_size,
                                                   guint16          transaction_id);
+void             test_port_context_set_discard_commands (TestPortContext *ctx,
+                                                         gboolean         discard);
+void             test_port_context_send_indications (TestPortContext *ctx,
+                                                     const guint8    *indication,
+                                                     gsize            indication_size,
+                                                     guint            n_indications);
 
 #endif /* TEST_PORT_CONTEXT_H */
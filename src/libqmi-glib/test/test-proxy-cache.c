@@ -0,0 +1,347 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+/* The cache is private to the library, so build it right here */
+#include "qmi-proxy-cache.c"
+
+/*****************************************************************************/
+
+#define TTL  5
+#define T0   (1000 * G_USEC_PER_SEC)
+
+static guint n_waiters_freed;
+
+static void
+waiter_free (gpointer waiter)
+{
+    n_waiters_freed++;
+}
+
+static QmiMessage *
+build_request (QmiService service,
+               guint8     client_id,
+               guint16    transaction_id,
+               guint8     value)
+{
+    QmiMessage *message;
+    gsize init_offset;
+
+    message = qmi_message_new (service, client_id, transaction_id, 0x0020);
+    init_offset = qmi_message_tlv_write_init (message, 0x01, NULL);
+    g_assert (init_offset);
+    g_assert (qmi_message_tlv_write_guint8 (message, value, NULL));
+    g_assert (qmi_message_tlv_write_complete (message, init_offset, NULL));
+    return message;
+}
+
+/* Looks up a request expected to be a miss, returning the key of the entry
+ * in flight */
+static GBytes *
+lookup_miss (QmiProxyCache *cache,
+             QmiMessage    *request,
+             gint64         now)
+{
+    QmiMessage *response = NULL;
+    GBytes *key = NULL;
+
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, now, NULL, &response, &key), ==, QMI_PROXY_CACHE_LOOKUP_MISS);
+    g_assert (key);
+    g_assert (!response);
+    return key;
+}
+
+static void
+lookup_hit (QmiProxyCache *cache,
+            QmiMessage    *request,
+            gint64         now,
+            QmiMessage    *expected)
+{
+    QmiMessage *response = NULL;
+    GBytes *key = NULL;
+
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, now, NULL, &response, &key), ==, QMI_PROXY_CACHE_LOOKUP_HIT);
+    g_assert (response == expected);
+    g_assert (!key);
+    qmi_message_unref (response);
+}
+
+/* Sends a request through the cache and completes it with a successful
+ * response, which is returned */
+static QmiMessage *
+cache_fill (QmiProxyCache *cache,
+            QmiMessage    *request,
+            gint64         now)
+{
+    QmiMessage *response;
+    GBytes *key;
+
+    key = lookup_miss (cache, request, now);
+    response = qmi_message_response_new (request, QMI_PROTOCOL_ERROR_NONE);
+    g_assert (!__qmi_proxy_cache_complete (cache, key, response, now));
+    g_bytes_unref (key);
+    return response;
+}
+
+/*****************************************************************************/
+
+static void
+test_proxy_cache_hit (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *other;
+    QmiMessage *response;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    response = cache_fill (cache, request, T0);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 1);
+
+    /* Client and transaction IDs are not part of the key */
+    other = build_request (QMI_SERVICE_DMS, 2, 10, 0xAA);
+    lookup_hit (cache, other, T0, response);
+    qmi_message_unref (other);
+
+    /* TLV contents are */
+    other = build_request (QMI_SERVICE_DMS, 1, 1, 0xBB);
+    g_bytes_unref (lookup_miss (cache, other, T0));
+    qmi_message_unref (other);
+
+    /* And so is the service */
+    other = build_request (QMI_SERVICE_NAS, 1, 1, 0xAA);
+    g_bytes_unref (lookup_miss (cache, other, T0));
+    qmi_message_unref (other);
+
+    qmi_message_unref (response);
+    qmi_message_unref (request);
+    __qmi_proxy_cache_unref (cache);
+}
+
+static void
+test_proxy_cache_error_response (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *response;
+    GBytes *key;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    /* Error responses are not cached */
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    key = lookup_miss (cache, request, T0);
+    response = qmi_message_response_new (request, QMI_PROTOCOL_ERROR_INTERNAL);
+    g_assert (!__qmi_proxy_cache_complete (cache, key, response, T0));
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 0);
+    g_bytes_unref (key);
+    qmi_message_unref (response);
+
+    g_bytes_unref (lookup_miss (cache, request, T0));
+
+    qmi_message_unref (request);
+    __qmi_proxy_cache_unref (cache);
+}
+
+static void
+test_proxy_cache_coalescing (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *response;
+    QmiMessage *none = NULL;
+    GBytes *key;
+    GBytes *none_key = NULL;
+    GList *waiters;
+
+    n_waiters_freed = 0;
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    key = lookup_miss (cache, request, T0);
+
+    /* Identical requests wait for the one in flight, in order */
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, T0, GUINT_TO_POINTER (1), &none, &none_key), ==, QMI_PROXY_CACHE_LOOKUP_COALESCED);
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, T0, GUINT_TO_POINTER (2), &none, &none_key), ==, QMI_PROXY_CACHE_LOOKUP_COALESCED);
+    g_assert (!none);
+    g_assert (!none_key);
+
+    response = qmi_message_response_new (request, QMI_PROTOCOL_ERROR_NONE);
+    waiters = __qmi_proxy_cache_complete (cache, key, response, T0);
+    g_assert_cmpuint (g_list_length (waiters), ==, 2);
+    g_assert (waiters->data == GUINT_TO_POINTER (1));
+    g_assert (waiters->next->data == GUINT_TO_POINTER (2));
+    g_list_free (waiters);
+    g_bytes_unref (key);
+
+    lookup_hit (cache, request, T0, response);
+
+    qmi_message_unref (response);
+    qmi_message_unref (request);
+    __qmi_proxy_cache_unref (cache);
+    g_assert_cmpuint (n_waiters_freed, ==, 0);
+}
+
+static void
+test_proxy_cache_coalescing_failed (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *none = NULL;
+    GBytes *key;
+    GBytes *none_key = NULL;
+    GList *waiters;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    key = lookup_miss (cache, request, T0);
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, T0, GUINT_TO_POINTER (1), &none, &none_key), ==, QMI_PROXY_CACHE_LOOKUP_COALESCED);
+
+    /* Waiters are given back even if the request failed, and the next
+     * identical request takes over */
+    waiters = __qmi_proxy_cache_complete (cache, key, NULL, T0);
+    g_assert_cmpuint (g_list_length (waiters), ==, 1);
+    g_assert (waiters->data == GUINT_TO_POINTER (1));
+    g_list_free (waiters);
+    g_bytes_unref (key);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 0);
+
+    key = lookup_miss (cache, request, T0);
+    g_bytes_unref (key);
+
+    /* Waiters of the entries still in flight are freed along with the cache */
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, T0, GUINT_TO_POINTER (1), &none, &none_key), ==, QMI_PROXY_CACHE_LOOKUP_COALESCED);
+    n_waiters_freed = 0;
+    __qmi_proxy_cache_unref (cache);
+    g_assert_cmpuint (n_waiters_freed, ==, 1);
+
+    qmi_message_unref (request);
+}
+
+static void
+test_proxy_cache_ttl (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *response;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    response = cache_fill (cache, request, T0);
+
+    lookup_hit (cache, request, T0 + TTL * G_USEC_PER_SEC - 1, response);
+    qmi_message_unref (response);
+
+    /* Expired entries are replaced by a new one in flight */
+    response = cache_fill (cache, request, T0 + TTL * G_USEC_PER_SEC);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 1);
+    lookup_hit (cache, request, T0 + TTL * G_USEC_PER_SEC, response);
+
+    qmi_message_unref (response);
+    qmi_message_unref (request);
+    __qmi_proxy_cache_unref (cache);
+}
+
+static void
+test_proxy_cache_invalidate (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *dms_request;
+    QmiMessage *nas_request;
+    QmiMessage *dms_response;
+    QmiMessage *nas_response;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    dms_request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    nas_request = build_request (QMI_SERVICE_NAS, 2, 1, 0xAA);
+    dms_response = cache_fill (cache, dms_request, T0);
+    nas_response = cache_fill (cache, nas_request, T0);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 2);
+
+    /* Only the entries of the given service */
+    __qmi_proxy_cache_invalidate (cache, QMI_SERVICE_NAS);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 1);
+    lookup_hit (cache, dms_request, T0, dms_response);
+    qmi_message_unref (nas_response);
+    nas_response = cache_fill (cache, nas_request, T0);
+
+    /* All of them */
+    __qmi_proxy_cache_invalidate (cache, QMI_SERVICE_CTL);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 0);
+
+    qmi_message_unref (nas_response);
+    qmi_message_unref (dms_response);
+    qmi_message_unref (nas_request);
+    qmi_message_unref (dms_request);
+    __qmi_proxy_cache_unref (cache);
+}
+
+static void
+test_proxy_cache_invalidate_in_flight (void)
+{
+    QmiProxyCache *cache;
+    QmiMessage *request;
+    QmiMessage *response;
+    QmiMessage *none = NULL;
+    GBytes *key;
+    GBytes *none_key = NULL;
+
+    cache = __qmi_proxy_cache_new (waiter_free);
+
+    request = build_request (QMI_SERVICE_DMS, 1, 1, 0xAA);
+    key = lookup_miss (cache, request, T0);
+
+    /* The entry in flight is kept but no longer used */
+    __qmi_proxy_cache_invalidate (cache, QMI_SERVICE_DMS);
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 1);
+    g_assert_cmpuint (__qmi_proxy_cache_lookup (cache, request, TTL, T0, GUINT_TO_POINTER (1), &none, &none_key), ==, QMI_PROXY_CACHE_LOOKUP_UNCACHEABLE);
+    g_assert (!none);
+    g_assert (!none_key);
+
+    /* And its response is not cached */
+    response = qmi_message_response_new (request, QMI_PROTOCOL_ERROR_NONE);
+    g_assert (!__qmi_proxy_cache_complete (cache, key, response, T0));
+    g_assert_cmpuint (__qmi_proxy_cache_get_size (cache), ==, 0);
+    g_bytes_unref (key);
+    qmi_message_unref (response);
+
+    g_bytes_unref (lookup_miss (cache, request, T0));
+
+    qmi_message_unref (request);
+    __qmi_proxy_cache_unref (cache);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/proxy-cache/hit",                test_proxy_cache_hit);
+    g_test_add_func ("/libqmi-glib/proxy-cache/error-response",     test_proxy_cache_error_response);
+    g_test_add_func ("/libqmi-glib/proxy-cache/coalescing",         test_proxy_cache_coalescing);
+    g_test_add_func ("/libqmi-glib/proxy-cache/coalescing-failed",  test_proxy_cache_coalescing_failed);
+    g_test_add_func ("/libqmi-glib/proxy-cache/ttl",                test_proxy_cache_ttl);
+    g_test_add_func ("/libqmi-glib/proxy-cache/invalidate",         test_proxy_cache_invalidate);
+    g_test_add_func ("/libqmi-glib/proxy-cache/invalidate-in-flight", test_proxy_cache_invalidate_in_flight);
+
+    return g_test_run ();
+}
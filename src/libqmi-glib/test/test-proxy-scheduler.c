@@ -0,0 +1,331 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+/* The scheduler is private to the library, so build it right here */
+#include "qmi-proxy-scheduler.c"
+
+/*****************************************************************************/
+
+/* Items encode the queue they were pushed to and their position in it */
+#define ITEM(queue, i)    GUINT_TO_POINTER (((queue) << 16) | ((i) + 1))
+#define ITEM_QUEUE(item)  (GPOINTER_TO_UINT (item) >> 16)
+
+typedef struct {
+    GPtrArray *sent;
+    GArray    *wait_times;
+} SendContext;
+
+static void
+send_item (gpointer     item,
+           gint64       wait_time,
+           SendContext *ctx)
+{
+    g_ptr_array_add (ctx->sent, item);
+    g_array_append_val (ctx->wait_times, wait_time);
+}
+
+static QmiProxyScheduler *
+scheduler_new (guint        max_in_flight,
+               SendContext *ctx)
+{
+    ctx->sent = g_ptr_array_new ();
+    ctx->wait_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+    return __qmi_proxy_scheduler_new (max_in_flight, (QmiProxySchedulerSendFn) send_item, ctx);
+}
+
+static void
+scheduler_free (QmiProxyScheduler *scheduler,
+                SendContext       *ctx)
+{
+    __qmi_proxy_scheduler_unref (scheduler);
+    g_ptr_array_unref (ctx->sent);
+    g_array_unref (ctx->wait_times);
+}
+
+static void
+push_items (QmiProxyScheduler      *scheduler,
+            QmiProxySchedulerQueue *queue,
+            guint                   queue_id,
+            guint                   n_items,
+            gsize                   size)
+{
+    guint i;
+
+    for (i = 0; i < n_items; i++)
+        __qmi_proxy_scheduler_push (scheduler, queue, ITEM (queue_id, i), size, 0);
+}
+
+/* Completes items one by one until all are sent */
+static void
+complete_all (QmiProxyScheduler *scheduler)
+{
+    while (__qmi_proxy_scheduler_get_n_in_flight (scheduler) > 0)
+        __qmi_proxy_scheduler_complete (scheduler, 0);
+}
+
+/*****************************************************************************/
+
+static void
+test_proxy_scheduler_unlimited (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    QmiProxySchedulerQueue *b;
+    SendContext ctx;
+
+    scheduler = scheduler_new (0, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+    b = __qmi_proxy_scheduler_queue_new (1);
+
+    /* Nothing is sent until started */
+    push_items (scheduler, a, 1, 2, 100);
+    g_assert_cmpuint (ctx.sent->len, ==, 0);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+    g_assert_cmpuint (ctx.sent->len, ==, 2);
+
+    /* Without a cap, in arrival order, whatever the size */
+    __qmi_proxy_scheduler_push (scheduler, b, ITEM (2, 0), 4000, 0);
+    __qmi_proxy_scheduler_push (scheduler, a, ITEM (1, 2), 100, 0);
+    g_assert_cmpuint (ctx.sent->len, ==, 4);
+    g_assert (g_ptr_array_index (ctx.sent, 2) == ITEM (2, 0));
+    g_assert (g_ptr_array_index (ctx.sent, 3) == ITEM (1, 2));
+    g_assert_cmpuint (__qmi_proxy_scheduler_get_n_in_flight (scheduler), ==, 4);
+
+    /* Nothing else is sent once stopped */
+    __qmi_proxy_scheduler_stop (scheduler);
+    __qmi_proxy_scheduler_push (scheduler, a, ITEM (1, 3), 100, 0);
+    g_assert_cmpuint (ctx.sent->len, ==, 4);
+    g_assert (!__qmi_proxy_scheduler_flush (scheduler, b));
+    g_list_free (__qmi_proxy_scheduler_flush (scheduler, a));
+
+    __qmi_proxy_scheduler_queue_free (a);
+    __qmi_proxy_scheduler_queue_free (b);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_max_in_flight (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    SendContext ctx;
+    guint i;
+
+    scheduler = scheduler_new (2, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+
+    push_items (scheduler, a, 1, 5, 10);
+    g_assert_cmpuint (ctx.sent->len, ==, 2);
+    g_assert_cmpuint (__qmi_proxy_scheduler_get_n_in_flight (scheduler), ==, 2);
+
+    /* Each completion releases exactly one more */
+    for (i = 3; i <= 5; i++) {
+        __qmi_proxy_scheduler_complete (scheduler, 0);
+        g_assert_cmpuint (ctx.sent->len, ==, i);
+        g_assert_cmpuint (__qmi_proxy_scheduler_get_n_in_flight (scheduler), ==, 2);
+    }
+
+    for (i = 0; i < 5; i++)
+        g_assert (g_ptr_array_index (ctx.sent, i) == ITEM (1, i));
+
+    complete_all (scheduler);
+    g_assert_cmpuint (__qmi_proxy_scheduler_get_n_in_flight (scheduler), ==, 0);
+
+    __qmi_proxy_scheduler_queue_free (a);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_fairness (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    QmiProxySchedulerQueue *b;
+    SendContext ctx;
+    guint i;
+
+    scheduler = scheduler_new (1, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+    b = __qmi_proxy_scheduler_queue_new (1);
+
+    /* A floods the device before B sends anything */
+    push_items (scheduler, a, 1, 10, 100);
+    push_items (scheduler, b, 2, 10, 100);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+    complete_all (scheduler);
+    g_assert_cmpuint (ctx.sent->len, ==, 20);
+
+    /* Each visit sends as many items as fit in the quantum, 5 of 100 bytes
+     * in 512 bytes, so B doesn't wait for all the items of A */
+    for (i = 0; i < 20; i++)
+        g_assert_cmpuint (ITEM_QUEUE (g_ptr_array_index (ctx.sent, i)), ==, ((i / 5) % 2) ? 2 : 1);
+
+    __qmi_proxy_scheduler_queue_free (a);
+    __qmi_proxy_scheduler_queue_free (b);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_weights (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    QmiProxySchedulerQueue *b;
+    SendContext ctx;
+    guint n_a = 0;
+    guint i;
+
+    scheduler = scheduler_new (1, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (2);
+    b = __qmi_proxy_scheduler_queue_new (1);
+
+    push_items (scheduler, a, 1, 30, 100);
+    push_items (scheduler, b, 2, 30, 100);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+    complete_all (scheduler);
+    g_assert_cmpuint (ctx.sent->len, ==, 60);
+
+    /* Twice the share of the device while both have items queued */
+    for (i = 0; i < 45; i++) {
+        if (ITEM_QUEUE (g_ptr_array_index (ctx.sent, i)) == 1)
+            n_a++;
+    }
+    g_assert_cmpuint (n_a, ==, 30);
+
+    __qmi_proxy_scheduler_queue_free (a);
+    __qmi_proxy_scheduler_queue_free (b);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_large_items (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    QmiProxySchedulerQueue *b;
+    SendContext ctx;
+    gsize bytes_a = 0;
+    gsize bytes_b = 0;
+    guint i;
+
+    scheduler = scheduler_new (1, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+    b = __qmi_proxy_scheduler_queue_new (1);
+
+    /* Items larger than the quantum are sent once enough deficit is
+     * accumulated, and the share of the device is kept in bytes */
+    push_items (scheduler, a, 1, 10, 1000);
+    push_items (scheduler, b, 2, 100, 100);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+    complete_all (scheduler);
+    g_assert_cmpuint (ctx.sent->len, ==, 110);
+
+    for (i = 0; i < ctx.sent->len && bytes_a < 10 * 1000; i++) {
+        if (ITEM_QUEUE (g_ptr_array_index (ctx.sent, i)) == 1)
+            bytes_a += 1000;
+        else
+            bytes_b += 100;
+    }
+    g_assert_cmpuint (bytes_a, ==, 10 * 1000);
+    g_assert_cmpuint (bytes_b, <=, bytes_a + QMI_PROXY_SCHEDULER_QUANTUM);
+    g_assert_cmpuint (bytes_b + 1000, >=, bytes_a - QMI_PROXY_SCHEDULER_QUANTUM);
+
+    __qmi_proxy_scheduler_queue_free (a);
+    __qmi_proxy_scheduler_queue_free (b);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_flush (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    QmiProxySchedulerQueue *b;
+    SendContext ctx;
+    GList *items;
+    GList *l;
+    guint i;
+
+    scheduler = scheduler_new (1, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+    b = __qmi_proxy_scheduler_queue_new (1);
+    __qmi_proxy_scheduler_start (scheduler, 0);
+
+    /* The first item of A is in flight, the remaining ones are queued */
+    push_items (scheduler, a, 1, 4, 100);
+    push_items (scheduler, b, 2, 2, 100);
+    g_assert_cmpuint (ctx.sent->len, ==, 1);
+
+    items = __qmi_proxy_scheduler_flush (scheduler, a);
+    g_assert_cmpuint (g_list_length (items), ==, 3);
+    for (l = items, i = 1; l; l = g_list_next (l), i++)
+        g_assert (l->data == ITEM (1, i));
+    g_list_free (items);
+
+    /* Only B is left */
+    complete_all (scheduler);
+    g_assert_cmpuint (ctx.sent->len, ==, 3);
+    g_assert (g_ptr_array_index (ctx.sent, 1) == ITEM (2, 0));
+    g_assert (g_ptr_array_index (ctx.sent, 2) == ITEM (2, 1));
+
+    __qmi_proxy_scheduler_queue_free (a);
+    __qmi_proxy_scheduler_queue_free (b);
+    scheduler_free (scheduler, &ctx);
+}
+
+static void
+test_proxy_scheduler_wait_time (void)
+{
+    QmiProxyScheduler *scheduler;
+    QmiProxySchedulerQueue *a;
+    SendContext ctx;
+
+    scheduler = scheduler_new (1, &ctx);
+    a = __qmi_proxy_scheduler_queue_new (1);
+
+    __qmi_proxy_scheduler_push (scheduler, a, ITEM (1, 0), 100, 1000);
+    __qmi_proxy_scheduler_push (scheduler, a, ITEM (1, 1), 100, 2000);
+    __qmi_proxy_scheduler_start (scheduler, 5000);
+    __qmi_proxy_scheduler_complete (scheduler, 9000);
+    __qmi_proxy_scheduler_complete (scheduler, 9000);
+
+    g_assert_cmpuint (ctx.wait_times->len, ==, 2);
+    g_assert_cmpint (g_array_index (ctx.wait_times, gint64, 0), ==, 4000);
+    g_assert_cmpint (g_array_index (ctx.wait_times, gint64, 1), ==, 7000);
+
+    __qmi_proxy_scheduler_queue_free (a);
+    scheduler_free (scheduler, &ctx);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/unlimited",     test_proxy_scheduler_unlimited);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/max-in-flight", test_proxy_scheduler_max_in_flight);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/fairness",      test_proxy_scheduler_fairness);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/weights",       test_proxy_scheduler_weights);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/large-items",   test_proxy_scheduler_large_items);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/flush",         test_proxy_scheduler_flush);
+    g_test_add_func ("/libqmi-glib/proxy-scheduler/wait-time",     test_proxy_scheduler_wait_time);
+
+    return g_test_run ();
+}
@@ -0,0 +1,336 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <sys/socket.h>
+#include <glib.h>
+
+/* The routing and lifecycle of the devices are private to the proxy, so
+ * build it right here, along with the private modules it uses */
+#include "qmi-shm-ring.c"
+#include "qmi-proxy-cache.c"
+#include "qmi-proxy-scheduler.c"
+#include "qmi-proxy.c"
+
+/*****************************************************************************/
+
+/* Hidden in the library, and never reached by these tests */
+
+QmiMessage *
+__qmi_message_copy (QmiMessage *self,
+                    guint8      client_id,
+                    guint16     transaction_id)
+{
+    g_assert_not_reached ();
+    return NULL;
+}
+
+guint16
+__qmi_message_tlv_read_remaining_size (QmiMessage *self,
+                                       gsize       tlv_offset,
+                                       gsize       offset)
+{
+    g_assert_not_reached ();
+    return 0;
+}
+
+gboolean
+__qmi_user_allowed (uid_t    uid,
+                    GError **error)
+{
+    g_assert_not_reached ();
+    return FALSE;
+}
+
+/*****************************************************************************/
+
+/* Client as if just connected, with the peer socket of its connection if
+ * requested */
+static Client *
+test_client_new (QmiProxy  *proxy,
+                 GSocket  **peer)
+{
+    Client *client;
+
+    client = g_slice_new0 (Client);
+    client->ref_count = 1;
+    client->proxy = proxy;
+    client->qmi_client_info_array = g_array_sized_new (FALSE, FALSE, sizeof (QmiClientInfo), 8);
+    client->queue = __qmi_proxy_scheduler_queue_new (1);
+
+    if (peer) {
+        GSocket *socket;
+        GError *error = NULL;
+        int fds[2];
+
+        g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+        socket = g_socket_new_from_fd (fds[0], &error);
+        g_assert_no_error (error);
+        client->connection = g_socket_connection_factory_create_connection (socket);
+        g_object_unref (socket);
+        *peer = g_socket_new_from_fd (fds[1], &error);
+        g_assert_no_error (error);
+    }
+
+    return client;
+}
+
+static void
+test_client_add_cid (Client     *client,
+                     Device     *device,
+                     QmiService  service,
+                     guint8      cid)
+{
+    QmiClientInfo info;
+
+    info.service = service;
+    info.cid = cid;
+    g_array_append_val (client->qmi_client_info_array, info);
+    device_add_route (device, client, service, cid);
+}
+
+/* Same order as track_cid(): the route goes before the CID */
+static void
+test_client_remove_cid (Client     *client,
+                        Device     *device,
+                        QmiService  service,
+                        guint8      cid)
+{
+    guint i;
+
+    device_remove_route (device, client, service, cid);
+    for (i = 0; i < client->qmi_client_info_array->len; i++) {
+        QmiClientInfo *info;
+
+        info = &g_array_index (client->qmi_client_info_array, QmiClientInfo, i);
+        if (info->service == service && info->cid == cid) {
+            g_array_remove_index (client->qmi_client_info_array, i);
+            return;
+        }
+    }
+    g_assert_not_reached ();
+}
+
+static guint
+broadcast_count (Device     *device,
+                 QmiService  service,
+                 Client     *client)
+{
+    GPtrArray *clients;
+    guint n = 0;
+    guint i;
+
+    clients = device->broadcast_routes[(guint8) service];
+    for (i = 0; clients && i < clients->len; i++) {
+        if (g_ptr_array_index (clients, i) == client)
+            n++;
+    }
+    return n;
+}
+
+/* Receives exactly one message of the given length, if any */
+static gboolean
+peer_receive (GSocket *peer,
+              gsize    length)
+{
+    guint8 buffer[64];
+    GError *error = NULL;
+    gssize r;
+
+    g_assert_cmpuint (length, <=, sizeof (buffer));
+    if (!g_socket_condition_check (peer, G_IO_IN))
+        return FALSE;
+    r = g_socket_receive (peer, (gchar *) buffer, sizeof (buffer), NULL, &error);
+    g_assert_no_error (error);
+    g_assert_cmpint (r, ==, length);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static void
+test_proxy_routes (void)
+{
+    Device device = { 0 };
+    Client *a;
+    Client *b;
+    guint i;
+
+    device.routes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    a = test_client_new (NULL, NULL);
+    b = test_client_new (NULL, NULL);
+
+    test_client_add_cid (a, &device, QMI_SERVICE_DMS, 1);
+    test_client_add_cid (a, &device, QMI_SERVICE_DMS, 2);
+    test_client_add_cid (b, &device, QMI_SERVICE_DMS, 3);
+    test_client_add_cid (b, &device, QMI_SERVICE_NAS, 1);
+
+    g_assert (g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 1)) == a);
+    g_assert (g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 2)) == a);
+    g_assert (g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 3)) == b);
+    g_assert (g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_NAS, 1)) == b);
+    g_assert (!g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_NAS, 2)));
+
+    /* Once per client in the broadcast list, however many CIDs it has */
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_DMS, a), ==, 1);
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_DMS, b), ==, 1);
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_NAS, a), ==, 0);
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_NAS, b), ==, 1);
+
+    /* Kept in the broadcast list while other CIDs of the service remain */
+    test_client_remove_cid (a, &device, QMI_SERVICE_DMS, 1);
+    g_assert (!g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 1)));
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_DMS, a), ==, 1);
+    test_client_remove_cid (a, &device, QMI_SERVICE_DMS, 2);
+    g_assert (!g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 2)));
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_DMS, a), ==, 0);
+
+    /* Routes of other clients are not touched by a stale release */
+    device_remove_route (&device, a, QMI_SERVICE_DMS, 3);
+    g_assert (g_hash_table_lookup (device.routes, ROUTE_KEY (QMI_SERVICE_DMS, 3)) == b);
+
+    /* All routes of a client are removed when untracked */
+    device_remove_client_routes (&device, b);
+    g_assert_cmpuint (g_hash_table_size (device.routes), ==, 0);
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_DMS, b), ==, 0);
+    g_assert_cmpuint (broadcast_count (&device, QMI_SERVICE_NAS, b), ==, 0);
+
+    client_unref (a);
+    client_unref (b);
+    g_hash_table_unref (device.routes);
+    for (i = 0; i < G_N_ELEMENTS (device.broadcast_routes); i++)
+        g_clear_pointer (&device.broadcast_routes[i], g_ptr_array_unref);
+}
+
+static void
+test_proxy_routes_indications (void)
+{
+    Device device = { 0 };
+    Client *a;
+    Client *b;
+    GSocket *peer_a;
+    GSocket *peer_b;
+    QmiMessage *indication;
+    guint i;
+
+    device.routes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    a = test_client_new (NULL, &peer_a);
+    b = test_client_new (NULL, &peer_b);
+
+    test_client_add_cid (a, &device, QMI_SERVICE_DMS, 1);
+    test_client_add_cid (a, &device, QMI_SERVICE_DMS, 2);
+    test_client_add_cid (b, &device, QMI_SERVICE_DMS, 3);
+
+    /* Unicast indications go to the owner of the CID only */
+    indication = qmi_message_new (QMI_SERVICE_DMS, 3, 0, 0x0001);
+    device_indication_cb (NULL, indication, &device);
+    g_assert (!peer_receive (peer_a, qmi_message_get_length (indication)));
+    g_assert (peer_receive (peer_b, qmi_message_get_length (indication)));
+    qmi_message_unref (indication);
+
+    /* Unknown CIDs go nowhere */
+    indication = qmi_message_new (QMI_SERVICE_DMS, 4, 0, 0x0001);
+    device_indication_cb (NULL, indication, &device);
+    g_assert (!peer_receive (peer_a, qmi_message_get_length (indication)));
+    g_assert (!peer_receive (peer_b, qmi_message_get_length (indication)));
+    qmi_message_unref (indication);
+
+    /* Broadcast indications go once to each client of the service */
+    indication = qmi_message_new (QMI_SERVICE_DMS, QMI_CID_BROADCAST, 0, 0x0001);
+    device_indication_cb (NULL, indication, &device);
+    g_assert (peer_receive (peer_a, qmi_message_get_length (indication)));
+    g_assert (peer_receive (peer_b, qmi_message_get_length (indication)));
+    g_assert (!peer_receive (peer_a, qmi_message_get_length (indication)));
+    qmi_message_unref (indication);
+
+    indication = qmi_message_new (QMI_SERVICE_NAS, QMI_CID_BROADCAST, 0, 0x0001);
+    device_indication_cb (NULL, indication, &device);
+    g_assert (!peer_receive (peer_a, qmi_message_get_length (indication)));
+    g_assert (!peer_receive (peer_b, qmi_message_get_length (indication)));
+    qmi_message_unref (indication);
+
+    client_unref (a);
+    client_unref (b);
+    g_object_unref (peer_a);
+    g_object_unref (peer_b);
+    g_hash_table_unref (device.routes);
+    for (i = 0; i < G_N_ELEMENTS (device.broadcast_routes); i++)
+        g_clear_pointer (&device.broadcast_routes[i], g_ptr_array_unref);
+}
+
+/*****************************************************************************/
+
+static gboolean
+proxy_is_idle (QmiProxy *proxy)
+{
+    gboolean idle;
+
+    g_mutex_lock (&proxy->priv->lock);
+    idle = (!proxy->priv->clients && !proxy->priv->devices && !proxy->priv->stopped_threads);
+    g_mutex_unlock (&proxy->priv->lock);
+    return idle;
+}
+
+static void
+test_proxy_device_teardown (gconstpointer data)
+{
+    QmiProxy *proxy;
+    Client *client;
+    Device *device;
+    gboolean device_threads;
+
+    device_threads = GPOINTER_TO_UINT (data);
+    proxy = g_object_new (QMI_TYPE_PROXY,
+                          QMI_PROXY_DEVICE_THREADS, device_threads,
+                          NULL);
+
+    /* Same as when a client requests to open a device */
+    client = test_client_new (proxy, NULL);
+    track_client (proxy, client);
+    g_mutex_lock (&proxy->priv->lock);
+    device = device_new (proxy, "/dev/qmi-test-proxy-nonexistent");
+    proxy->priv->devices = g_list_append (proxy->priv->devices, device);
+    device->n_clients++;
+    client->device = device;
+    g_mutex_unlock (&proxy->priv->lock);
+    g_assert (device_threads == !!device->thread);
+    client_hand_off (client);
+    client_unref (client);
+
+    /* The device cannot be opened, so its only client is untracked, which
+     * stops the device, frees it, and joins its thread if any */
+    while (!proxy_is_idle (proxy))
+        g_main_context_iteration (NULL, TRUE);
+    g_assert_cmpuint (qmi_proxy_get_n_clients (proxy), ==, 0);
+
+    /* Pending notifications keep the proxy around */
+    while (g_main_context_iteration (NULL, FALSE));
+
+    g_object_unref (proxy);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/proxy/routes",                      test_proxy_routes);
+    g_test_add_func ("/libqmi-glib/proxy/routes/indications",          test_proxy_routes_indications);
+    g_test_add_data_func ("/libqmi-glib/proxy/device-teardown",        GUINT_TO_POINTER (FALSE), test_proxy_device_teardown);
+    g_test_add_data_func ("/libqmi-glib/proxy/device-teardown/thread", GUINT_TO_POINTER (TRUE),  test_proxy_device_teardown);
+
+    return g_test_run ();
+}
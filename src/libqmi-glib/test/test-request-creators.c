@@ -0,0 +1,121 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <libqmi-glib.h>
+
+#include "qmi-ctl-private.h"
+#include "qmi-dms-private.h"
+#include "qmi-nas-private.h"
+#include "qmi-wds-private.h"
+#include "qmi-wms-private.h"
+#include "qmi-pds-private.h"
+#include "qmi-pdc-private.h"
+#include "qmi-pbm-private.h"
+#include "qmi-uim-private.h"
+#include "qmi-oma-private.h"
+#include "qmi-wda-private.h"
+#include "qmi-voice-private.h"
+#include "qmi-loc-private.h"
+#include "qmi-qos-private.h"
+
+/* Private to the library, so build them right here for the generated code */
+#include "qmi-serialized.c"
+#include "qmi-codec.c"
+
+/*****************************************************************************/
+
+/* Hidden in the library, and never used when creating requests */
+
+QmiMessage *
+__qmi_message_copy (QmiMessage *self,
+                    guint8      client_id,
+                    guint16     transaction_id)
+{
+    g_assert_not_reached ();
+    return NULL;
+}
+
+guint16
+__qmi_message_tlv_read_remaining_size (QmiMessage *self,
+                                       gsize       tlv_offset,
+                                       gsize       offset)
+{
+    g_assert_not_reached ();
+    return 0;
+}
+
+gboolean
+__qmi_message_tlv_read_string_into (QmiMessage  *self,
+                                    gsize        tlv_offset,
+                                    gsize       *offset,
+                                    guint8       n_size_prefix_bytes,
+                                    guint16      max_size,
+                                    gchar       *out,
+                                    gsize        out_size,
+                                    gsize       *out_length,
+                                    GError     **error)
+{
+    g_assert_not_reached ();
+    return FALSE;
+}
+
+void
+__qmi_message_append_tlv_printable (GString      *printable,
+                                    const gchar  *line_prefix,
+                                    guint8        type,
+                                    const guint8 *raw,
+                                    gsize         raw_length)
+{
+    g_assert_not_reached ();
+}
+
+void
+__qmi_utils_str_hex_append (GString       *str,
+                            gconstpointer  mem,
+                            gsize          size,
+                            gchar          delimiter)
+{
+    g_assert_not_reached ();
+}
+
+/*****************************************************************************/
+
+/* Each service builds a request with every one of its request creators, with
+ * all the input fields set. The creators warn if the size they computed for
+ * the TLVs doesn't match the ones written, i.e. if the message buffer was
+ * allocated more than once, and warnings are fatal in tests. */
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/request-creators/ctl",   __qmi_message_ctl_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/dms",   __qmi_message_dms_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/nas",   __qmi_message_nas_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/wds",   __qmi_message_wds_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/wms",   __qmi_message_wms_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/pds",   __qmi_message_pds_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/pdc",   __qmi_message_pdc_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/pbm",   __qmi_message_pbm_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/uim",   __qmi_message_uim_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/oma",   __qmi_message_oma_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/wda",   __qmi_message_wda_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/voice", __qmi_message_voice_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/loc",   __qmi_message_loc_test_request_creators);
+    g_test_add_func ("/libqmi-glib/request-creators/qos",   __qmi_message_qos_test_request_creators);
+
+    return g_test_run ();
+}
@@ -0,0 +1,125 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+/* Private to the library, so build it right here */
+#include "qmi-serialized.c"
+
+/*****************************************************************************/
+
+/* Hidden in the library; counts the copies, recording what was copied */
+
+static guint       n_copies;
+static QmiMessage *copied;
+
+QmiMessage *
+__qmi_message_copy (QmiMessage *self,
+                    guint8      client_id,
+                    guint16     transaction_id)
+{
+    n_copies++;
+    copied = self;
+    return qmi_message_new (qmi_message_get_service (self),
+                            client_id,
+                            transaction_id,
+                            qmi_message_get_message_id (self));
+}
+
+/*****************************************************************************/
+
+static void
+test_serialized_keep (void)
+{
+    QmiMessage *serialized = NULL;
+    QmiMessage *request;
+    QmiMessage *other;
+
+    n_copies = 0;
+    request = qmi_message_new (QMI_SERVICE_WDS, 1, 1, 0x0020);
+    other = qmi_message_new (QMI_SERVICE_WDS, 1, 2, 0x0020);
+
+    /* The request itself is kept, not a copy */
+    __qmi_serialized_keep (&serialized, request);
+    g_assert (serialized == request);
+    g_assert_cmpuint (n_copies, ==, 0);
+
+    /* Already kept, so the first one stays */
+    __qmi_serialized_keep (&serialized, other);
+    g_assert (serialized == request);
+    qmi_message_unref (other);
+
+    /* The reference kept outlives the one of the caller */
+    qmi_message_unref (request);
+    g_assert_cmpuint (qmi_message_get_transaction_id (serialized), ==, 1);
+
+    __qmi_serialized_drop (&serialized);
+    g_assert (!serialized);
+    __qmi_serialized_drop (&serialized);
+    g_assert (!serialized);
+}
+
+static void
+test_serialized_reuse (void)
+{
+    QmiMessage *serialized = NULL;
+    QmiMessage *request;
+    QmiMessage *reused;
+
+    n_copies = 0;
+    copied = NULL;
+
+    /* Nothing to reuse */
+    g_assert (!__qmi_serialized_reuse (&serialized, 1, 2));
+    g_assert_cmpuint (n_copies, ==, 0);
+
+    request = qmi_message_new (QMI_SERVICE_WDS, 1, 1, 0x0020);
+    __qmi_serialized_keep (&serialized, request);
+
+    /* Each reuse copies the request kept, with the new IDs */
+    reused = __qmi_serialized_reuse (&serialized, 3, 2);
+    g_assert (reused);
+    g_assert (reused != request);
+    g_assert (copied == request);
+    g_assert_cmpuint (n_copies, ==, 1);
+    g_assert_cmpuint (qmi_message_get_client_id (reused), ==, 3);
+    g_assert_cmpuint (qmi_message_get_transaction_id (reused), ==, 2);
+    qmi_message_unref (reused);
+
+    /* And the request kept is left untouched */
+    g_assert (serialized == request);
+    g_assert_cmpuint (qmi_message_get_client_id (request), ==, 1);
+    g_assert_cmpuint (qmi_message_get_transaction_id (request), ==, 1);
+
+    /* Not reused once dropped */
+    __qmi_serialized_drop (&serialized);
+    g_assert (!__qmi_serialized_reuse (&serialized, 3, 3));
+    g_assert_cmpuint (n_copies, ==, 1);
+
+    qmi_message_unref (request);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/serialized/keep",  test_serialized_keep);
+    g_test_add_func ("/libqmi-glib/serialized/reuse", test_serialized_reuse);
+
+    return g_test_run ();
+}
@@ -0,0 +1,229 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+/* The ring is private to the library, so build it right here */
+#include "qmi-shm-ring.c"
+
+/*****************************************************************************/
+
+/* Consumer side of the ring, mapped from duplicates of the producer fds as
+ * if they had been passed over the proxy socket */
+static QmiShmRing *
+ring_new_consumer (QmiShmRing *producer)
+{
+    QmiShmRing *consumer;
+    GError *error = NULL;
+
+    consumer = __qmi_shm_ring_new_from_fds (dup (__qmi_shm_ring_get_memfd (producer)),
+                                            dup (__qmi_shm_ring_get_eventfd (producer)),
+                                            &error);
+    g_assert_no_error (error);
+    g_assert (consumer);
+    g_assert_cmpuint (__qmi_shm_ring_get_size (consumer), ==, __qmi_shm_ring_get_size (producer));
+    return consumer;
+}
+
+static gboolean
+doorbell_rung (QmiShmRing *ring)
+{
+    guint64 value = 0;
+
+    return (read (__qmi_shm_ring_get_eventfd (ring), &value, sizeof (value)) == sizeof (value) && value > 0);
+}
+
+static void
+test_shm_ring_write_read (void)
+{
+    QmiShmRing *producer;
+    QmiShmRing *consumer;
+    GError *error = NULL;
+    guint8 frame[100];
+    guint8 buffer[100];
+    guint i;
+
+    producer = __qmi_shm_ring_new (1000, &error);
+    g_assert_no_error (error);
+    g_assert (producer);
+    /* Rounded up to a power of 2 */
+    g_assert_cmpuint (__qmi_shm_ring_get_size (producer), ==, 4096);
+
+    consumer = ring_new_consumer (producer);
+    g_assert (!__qmi_shm_ring_is_active (producer));
+    __qmi_shm_ring_activate (consumer);
+    g_assert (__qmi_shm_ring_is_active (producer));
+
+    /* Enough frames to wrap around the end of the ring several times */
+    for (i = 0; i < 500; i++) {
+        memset (frame, i & 0xFF, sizeof (frame));
+        g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame) - (i % 7)));
+        g_assert_cmpuint (__qmi_shm_ring_read (consumer, buffer, sizeof (buffer)), ==, sizeof (frame) - (i % 7));
+        g_assert (memcmp (buffer, frame, sizeof (frame) - (i % 7)) == 0);
+    }
+    g_assert_cmpuint (__qmi_shm_ring_read (consumer, buffer, sizeof (buffer)), ==, 0);
+
+    __qmi_shm_ring_free (consumer);
+    __qmi_shm_ring_free (producer);
+}
+
+static void
+test_shm_ring_full (void)
+{
+    QmiShmRing *producer;
+    QmiShmRing *consumer;
+    GError *error = NULL;
+    guint8 frame[1000] = { 0 };
+    guint8 buffer[1000];
+    guint n_written = 0;
+
+    producer = __qmi_shm_ring_new (4096, &error);
+    g_assert_no_error (error);
+    consumer = ring_new_consumer (producer);
+    __qmi_shm_ring_activate (consumer);
+
+    while (__qmi_shm_ring_write (producer, frame, sizeof (frame)))
+        n_written++;
+    g_assert_cmpuint (n_written, ==, 4);
+
+    /* The producer falls back to the socket for good */
+    __qmi_shm_ring_close (producer);
+    g_assert (!__qmi_shm_ring_is_active (producer));
+    g_assert (__qmi_shm_ring_is_closed (consumer));
+
+    /* But whatever was written before is still available */
+    while (n_written > 0) {
+        g_assert_cmpuint (__qmi_shm_ring_read (consumer, buffer, sizeof (buffer)), ==, sizeof (frame));
+        n_written--;
+    }
+    g_assert_cmpuint (__qmi_shm_ring_read (consumer, buffer, sizeof (buffer)), ==, 0);
+
+    __qmi_shm_ring_free (consumer);
+    __qmi_shm_ring_free (producer);
+}
+
+static void
+test_shm_ring_doorbell (void)
+{
+    QmiShmRing *producer;
+    QmiShmRing *consumer;
+    GError *error = NULL;
+    guint8 frame[16] = { 0 };
+    guint8 buffer[64];
+
+    producer = __qmi_shm_ring_new (4096, &error);
+    g_assert_no_error (error);
+    consumer = ring_new_consumer (producer);
+    __qmi_shm_ring_activate (consumer);
+
+    /* The consumer hasn't read anything yet, so the first frame rings */
+    g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+    g_assert (doorbell_rung (consumer));
+
+    /* While the consumer is busy, frames don't ring */
+    g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+    g_assert (!doorbell_rung (consumer));
+
+    /* Cannot wait while there is data */
+    g_assert (!__qmi_shm_ring_prepare_wait (consumer));
+    g_assert_cmpuint (__qmi_shm_ring_read (consumer, buffer, sizeof (buffer)), ==, 2 * sizeof (frame));
+
+    /* Once waiting, the next frame rings once */
+    g_assert (__qmi_shm_ring_prepare_wait (consumer));
+    g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+    g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+    g_assert (doorbell_rung (consumer));
+    g_assert (!doorbell_rung (consumer));
+
+    __qmi_shm_ring_free (consumer);
+    __qmi_shm_ring_free (producer);
+}
+
+static void
+test_shm_ring_invalid (void)
+{
+    QmiShmRing *producer;
+    QmiShmRing *consumer;
+    GError *error = NULL;
+    RingHeader *header;
+
+    producer = __qmi_shm_ring_new (4096, &error);
+    g_assert_no_error (error);
+
+    header = producer->header;
+    header->magic = 0;
+    consumer = __qmi_shm_ring_new_from_fds (dup (__qmi_shm_ring_get_memfd (producer)),
+                                            dup (__qmi_shm_ring_get_eventfd (producer)),
+                                            &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED);
+    g_assert (!consumer);
+    g_clear_error (&error);
+
+    /* Size beyond the shared memory */
+    header->magic = RING_MAGIC;
+    header->size = 8192;
+    consumer = __qmi_shm_ring_new_from_fds (dup (__qmi_shm_ring_get_memfd (producer)),
+                                            dup (__qmi_shm_ring_get_eventfd (producer)),
+                                            &error);
+    g_assert_error (error, QMI_CORE_ERROR, QMI_CORE_ERROR_FAILED);
+    g_assert (!consumer);
+    g_clear_error (&error);
+
+    __qmi_shm_ring_free (producer);
+}
+
+static void
+test_shm_ring_invalid_tail (void)
+{
+    QmiShmRing *producer;
+    QmiShmRing *consumer;
+    GError *error = NULL;
+    guint8 frame[100] = { 0 };
+
+    producer = __qmi_shm_ring_new (4096, &error);
+    g_assert_no_error (error);
+    consumer = ring_new_consumer (producer);
+    __qmi_shm_ring_activate (consumer);
+
+    g_assert (__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+
+    /* A tail beyond the head would make the free space wrap around */
+    consumer->header->tail = 1000;
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*invalid shared memory ring state*");
+    g_assert (!__qmi_shm_ring_write (producer, frame, sizeof (frame)));
+    g_test_assert_expected_messages ();
+    g_assert (__qmi_shm_ring_is_closed (consumer));
+
+    __qmi_shm_ring_free (consumer);
+    __qmi_shm_ring_free (producer);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/shm-ring/write-read", test_shm_ring_write_read);
+    g_test_add_func ("/libqmi-glib/shm-ring/full",       test_shm_ring_full);
+    g_test_add_func ("/libqmi-glib/shm-ring/doorbell",   test_shm_ring_doorbell);
+    g_test_add_func ("/libqmi-glib/shm-ring/invalid",    test_shm_ring_invalid);
+    g_test_add_func ("/libqmi-glib/shm-ring/invalid-tail", test_shm_ring_invalid_tail);
+
+    return g_test_run ();
+}
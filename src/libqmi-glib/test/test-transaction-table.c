@@ -0,0 +1,214 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+/* The table is private to the library, so build it right here */
+#include "qmi-transaction-table.c"
+
+/*****************************************************************************/
+
+static inline guint32
+build_key (guint8  service,
+           guint8  client_id,
+           guint16 transaction_id)
+{
+    return (((guint32)service << 24) | ((guint32)client_id << 16) | transaction_id);
+}
+
+#define VALUE(key) GUINT_TO_POINTER ((key) + 1)
+
+static void
+test_transaction_table_insert_take (void)
+{
+    QmiTransactionTable *table;
+    guint16 trid;
+
+    table = __qmi_transaction_table_new ();
+
+    /* Enough entries to force the table to grow several times */
+    for (trid = 1; trid <= 5000; trid++)
+        g_assert (!__qmi_transaction_table_insert (table, build_key (2, 1, trid), VALUE (build_key (2, 1, trid))));
+    g_assert_cmpuint (__qmi_transaction_table_size (table), ==, 5000);
+
+    for (trid = 1; trid <= 5000; trid++)
+        g_assert (__qmi_transaction_table_lookup (table, build_key (2, 1, trid)) == VALUE (build_key (2, 1, trid)));
+    g_assert (!__qmi_transaction_table_lookup (table, build_key (2, 2, 1)));
+    g_assert (!__qmi_transaction_table_lookup (table, build_key (3, 1, 1)));
+
+    /* Take every other one */
+    for (trid = 1; trid <= 5000; trid += 2)
+        g_assert (__qmi_transaction_table_take (table, build_key (2, 1, trid)) == VALUE (build_key (2, 1, trid)));
+    g_assert_cmpuint (__qmi_transaction_table_size (table), ==, 2500);
+
+    /* The remaining ones must still be reachable */
+    for (trid = 1; trid <= 5000; trid++) {
+        if (trid % 2)
+            g_assert (!__qmi_transaction_table_take (table, build_key (2, 1, trid)));
+        else
+            g_assert (__qmi_transaction_table_take (table, build_key (2, 1, trid)) == VALUE (build_key (2, 1, trid)));
+    }
+    g_assert_cmpuint (__qmi_transaction_table_size (table), ==, 0);
+
+    __qmi_transaction_table_free (table);
+}
+
+static void
+test_transaction_table_replace (void)
+{
+    QmiTransactionTable *table;
+    guint32 key;
+
+    table = __qmi_transaction_table_new ();
+
+    key = build_key (0, 0, 1);
+    g_assert (!__qmi_transaction_table_insert (table, key, GUINT_TO_POINTER (1)));
+    g_assert (__qmi_transaction_table_insert (table, key, GUINT_TO_POINTER (2)) == GUINT_TO_POINTER (1));
+    g_assert_cmpuint (__qmi_transaction_table_size (table), ==, 1);
+    g_assert (__qmi_transaction_table_take (table, key) == GUINT_TO_POINTER (2));
+    g_assert (!__qmi_transaction_table_take (table, key));
+
+    __qmi_transaction_table_free (table);
+}
+
+static void
+test_transaction_table_random (void)
+{
+    QmiTransactionTable *table;
+    GHashTable *reference;
+    GRand *rand;
+    guint i;
+
+    table = __qmi_transaction_table_new ();
+    reference = g_hash_table_new (g_direct_hash, g_direct_equal);
+    rand = g_rand_new_with_seed (1234);
+
+    /* Random inserts and takes over a small key space, so that clusters get
+     * built and broken continuously */
+    for (i = 0; i < 200000; i++) {
+        guint32 key;
+
+        key = build_key (g_rand_int_range (rand, 1, 4),
+                         g_rand_int_range (rand, 1, 8),
+                         g_rand_int_range (rand, 1, 512));
+        if (g_rand_boolean (rand)) {
+            g_assert (__qmi_transaction_table_insert (table, key, VALUE (key)) ==
+                      g_hash_table_lookup (reference, GUINT_TO_POINTER (key)));
+            g_hash_table_insert (reference, GUINT_TO_POINTER (key), VALUE (key));
+        } else {
+            g_assert (__qmi_transaction_table_take (table, key) ==
+                      g_hash_table_lookup (reference, GUINT_TO_POINTER (key)));
+            g_hash_table_remove (reference, GUINT_TO_POINTER (key));
+        }
+        g_assert_cmpuint (__qmi_transaction_table_size (table), ==, g_hash_table_size (reference));
+    }
+
+    g_rand_free (rand);
+    g_hash_table_unref (reference);
+    __qmi_transaction_table_free (table);
+}
+
+/*****************************************************************************/
+
+#define N_IN_FLIGHT 4096
+#define N_ROUNDS    1000
+
+static gdouble
+benchmark_transaction_table (void)
+{
+    QmiTransactionTable *table;
+    guint round;
+    guint16 trid = 0;
+
+    table = __qmi_transaction_table_new ();
+
+    g_test_timer_start ();
+    for (round = 0; round < N_ROUNDS; round++) {
+        guint i;
+
+        /* Insert a batch of in-flight transactions, then match them all */
+        for (i = 0; i < N_IN_FLIGHT; i++)
+            __qmi_transaction_table_insert (table, build_key (3, i % 16, ++trid), VALUE (trid));
+        trid -= N_IN_FLIGHT;
+        for (i = 0; i < N_IN_FLIGHT; i++)
+            g_assert (__qmi_transaction_table_take (table, build_key (3, i % 16, ++trid)));
+    }
+
+    __qmi_transaction_table_free (table);
+    return g_test_timer_elapsed ();
+}
+
+static gdouble
+benchmark_hash_table (void)
+{
+    GHashTable *table;
+    guint round;
+    guint16 trid = 0;
+
+    table = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    g_test_timer_start ();
+    for (round = 0; round < N_ROUNDS; round++) {
+        guint i;
+
+        for (i = 0; i < N_IN_FLIGHT; i++)
+            g_hash_table_insert (table, GUINT_TO_POINTER (build_key (3, i % 16, ++trid)), VALUE (trid));
+        trid -= N_IN_FLIGHT;
+        for (i = 0; i < N_IN_FLIGHT; i++) {
+            gpointer key;
+
+            /* Lookup + remove, as done before */
+            key = GUINT_TO_POINTER (build_key (3, i % 16, ++trid));
+            g_assert (g_hash_table_lookup (table, key));
+            g_hash_table_remove (table, key);
+        }
+    }
+
+    g_hash_table_unref (table);
+    return g_test_timer_elapsed ();
+}
+
+static void
+test_transaction_table_benchmark (void)
+{
+    gdouble elapsed;
+    guint n_operations = 2 * N_IN_FLIGHT * N_ROUNDS;
+
+    elapsed = benchmark_transaction_table ();
+    g_test_maximized_result (n_operations / elapsed,
+                             "transaction table: %.0f insert/match operations/s",
+                             n_operations / elapsed);
+
+    elapsed = benchmark_hash_table ();
+    g_test_maximized_result (n_operations / elapsed,
+                             "GHashTable: %.0f insert/match operations/s",
+                             n_operations / elapsed);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/libqmi-glib/transaction-table/insert-take", test_transaction_table_insert_take);
+    g_test_add_func ("/libqmi-glib/transaction-table/replace",     test_transaction_table_replace);
+    g_test_add_func ("/libqmi-glib/transaction-table/random",      test_transaction_table_random);
+    if (g_test_perf ())
+        g_test_add_func ("/libqmi-glib/transaction-table/benchmark", test_transaction_table_benchmark);
+
+    return g_test_run ();
+}
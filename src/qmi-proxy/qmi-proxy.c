@@ -46,12 +46,32 @@ static guint timeout_id;
 static gboolean verbose_flag;
 static gboolean version_flag;
 static gboolean no_exit_flag;
+static gboolean device_threads_flag;
+static gchar **cache_ttl_strv;
+static gint max_in_flight_int;
+static gchar **uid_weight_strv;
 
 static GOptionEntry main_entries[] = {
     { "no-exit", 0, 0, G_OPTION_ARG_NONE, &no_exit_flag,
       "Don't exit after being idle without clients",
       NULL
     },
+    { "device-threads", 0, 0, G_OPTION_ARG_NONE, &device_threads_flag,
+      "Run each device and its clients in a separate thread",
+      NULL
+    },
+    { "cache-ttl", 0, 0, G_OPTION_ARG_STRING_ARRAY, &cache_ttl_strv,
+      "Cache the responses to the given request for some seconds (can be given multiple times)",
+      "[SERVICE:MESSAGE-ID:SECONDS]"
+    },
+    { "max-in-flight", 0, 0, G_OPTION_ARG_INT, &max_in_flight_int,
+      "Maximum number of requests in flight in each device, scheduling the remaining ones fairly among clients (SIGUSR1 prints the queue wait time of each client)",
+      "[N]"
+    },
+    { "uid-weight", 0, 0, G_OPTION_ARG_STRING_ARRAY, &uid_weight_strv,
+      "Scheduling weight of the clients of the given user (can be given multiple times)",
+      "[UID:WEIGHT]"
+    },
     { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_flag,
       "Run action with verbose logs, including the debug ones",
       NULL
@@ -151,7 +171,10 @@ static void
 proxy_n_clients_changed (QmiProxy *_proxy)
 {
     if (qmi_proxy_get_n_clients (proxy) == 0) {
-        g_assert (timeout_id == 0);
+        /* With device threads, notifications are queued, and the last
+         * ones may all see the proxy without clients */
+        if (timeout_id)
+            return;
         timeout_id = g_timeout_add_seconds (EMPTY_PROXY_LIFETIME_SECS,
                                             (GSourceFunc)stop_loop_cb,
                                             NULL);
@@ -165,6 +188,110 @@ proxy_n_clients_changed (QmiProxy *_proxy)
     }
 }
 
+static void
+print_client_stats (guint        uid,
+                    const gchar *device_path,
+                    guint        n_requests,
+                    gint64       total_wait_time,
+                    gint64       max_wait_time,
+                    gpointer     user_data)
+{
+    g_print ("[%s] uid %u: %u requests sent, queue wait time %.3f ms average, %.3f ms max\n",
+             device_path ? device_path : "no device",
+             uid,
+             n_requests,
+             n_requests ? (gdouble) total_wait_time / n_requests / 1000.0 : 0.0,
+             (gdouble) max_wait_time / 1000.0);
+}
+
+static gboolean
+print_stats_cb (gpointer user_data)
+{
+    if (proxy)
+        qmi_proxy_foreach_client_stats (proxy, print_client_stats, NULL);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static gboolean
+parse_cache_ttl (const gchar  *str,
+                 QmiService   *service,
+                 guint16      *message_id,
+                 guint        *ttl)
+{
+    gchar **split;
+    GEnumClass *enum_class;
+    GEnumValue *enum_value;
+    guint64 num;
+    gchar *end;
+    gboolean success = FALSE;
+
+    split = g_strsplit (str, ":", -1);
+    if (g_strv_length (split) != 3)
+        goto out;
+
+    /* The service may be given either by nickname or by number */
+    enum_class = G_ENUM_CLASS (g_type_class_ref (QMI_TYPE_SERVICE));
+    enum_value = g_enum_get_value_by_nick (enum_class, split[0]);
+    g_type_class_unref (enum_class);
+    if (enum_value)
+        *service = (QmiService) enum_value->value;
+    else {
+        num = g_ascii_strtoull (split[0], &end, 0);
+        if (!split[0][0] || *end || num > G_MAXUINT8)
+            goto out;
+        *service = (QmiService) num;
+    }
+
+    num = g_ascii_strtoull (split[1], &end, 0);
+    if (!split[1][0] || *end || num > G_MAXUINT16)
+        goto out;
+    *message_id = (guint16) num;
+
+    num = g_ascii_strtoull (split[2], &end, 0);
+    if (!split[2][0] || *end || num > G_MAXUINT)
+        goto out;
+    *ttl = (guint) num;
+
+    success = TRUE;
+
+out:
+    g_strfreev (split);
+    return success;
+}
+
+static gboolean
+parse_uid_weight (const gchar *str,
+                  guint       *uid,
+                  guint       *weight)
+{
+    gchar **split;
+    guint64 num;
+    gchar *end;
+    gboolean success = FALSE;
+
+    split = g_strsplit (str, ":", -1);
+    if (g_strv_length (split) != 2)
+        goto out;
+
+    num = g_ascii_strtoull (split[0], &end, 10);
+    if (!split[0][0] || *end || num > G_MAXUINT)
+        goto out;
+    *uid = (guint) num;
+
+    num = g_ascii_strtoull (split[1], &end, 10);
+    if (!split[1][0] || *end || num < 1 || num > QMI_PROXY_MAX_UID_WEIGHT)
+        goto out;
+    *weight = (guint) num;
+
+    success = TRUE;
+
+out:
+    g_strfreev (split);
+    return success;
+}
+
 /*****************************************************************************/
 
 int main (int argc, char **argv)
@@ -196,6 +323,7 @@ int main (int argc, char **argv)
     g_unix_signal_add (SIGINT,  quit_cb, NULL);
     g_unix_signal_add (SIGHUP,  quit_cb, NULL);
     g_unix_signal_add (SIGTERM, quit_cb, NULL);
+    g_unix_signal_add (SIGUSR1, print_stats_cb, NULL);
 
     /* Setup proxy */
     proxy = qmi_proxy_new (&error);
@@ -204,6 +332,51 @@ int main (int argc, char **argv)
         exit (EXIT_FAILURE);
     }
 
+    if (device_threads_flag)
+        g_object_set (proxy, QMI_PROXY_DEVICE_THREADS, TRUE, NULL);
+
+    if (max_in_flight_int < 0) {
+        g_printerr ("error: invalid maximum number of requests in flight: %d\n", max_in_flight_int);
+        exit (EXIT_FAILURE);
+    }
+    if (max_in_flight_int > 0)
+        g_object_set (proxy, QMI_PROXY_MAX_IN_FLIGHT, (guint) max_in_flight_int, NULL);
+
+    if (uid_weight_strv) {
+        guint i;
+
+        for (i = 0; uid_weight_strv[i]; i++) {
+            guint uid;
+            guint weight;
+
+            if (!parse_uid_weight (uid_weight_strv[i], &uid, &weight)) {
+                g_printerr ("error: invalid uid weight '%s', expected UID:WEIGHT with WEIGHT between 1 and %u\n",
+                            uid_weight_strv[i], QMI_PROXY_MAX_UID_WEIGHT);
+                exit (EXIT_FAILURE);
+            }
+            qmi_proxy_set_uid_weight (proxy, uid, weight);
+        }
+        g_strfreev (uid_weight_strv);
+    }
+
+    if (cache_ttl_strv) {
+        guint i;
+
+        for (i = 0; cache_ttl_strv[i]; i++) {
+            QmiService service;
+            guint16 message_id;
+            guint ttl;
+
+            if (!parse_cache_ttl (cache_ttl_strv[i], &service, &message_id, &ttl)) {
+                g_printerr ("error: invalid cache TTL '%s', expected SERVICE:MESSAGE-ID:SECONDS\n",
+                            cache_ttl_strv[i]);
+                exit (EXIT_FAILURE);
+            }
+            qmi_proxy_set_cache_ttl (proxy, service, message_id, ttl);
+        }
+        g_strfreev (cache_ttl_strv);
+    }
+
     /* Don't exit the proxy when no clients are found */
     if (!no_exit_flag) {
         proxy_n_clients_changed (proxy);
@@ -67,6 +67,8 @@ static gboolean device_open_mbim_flag;
 static gboolean device_open_auto_flag;
 static gchar *client_cid_str;
 static gboolean client_no_release_cid_flag;
+static gchar *device_capture_str;
+static gchar *decode_capture_str;
 static gboolean verbose_flag;
 static gboolean silent_flag;
 static gboolean version_flag;
@@ -132,6 +134,14 @@ static GOptionEntry main_entries[] = {
       "Do not release the CID when exiting",
       NULL
     },
+    { "device-capture", 0, 0, G_OPTION_ARG_FILENAME, &device_capture_str,
+      "Capture all messages sent and received in the given file",
+      "[PATH]"
+    },
+    { "decode-capture", 0, 0, G_OPTION_ARG_FILENAME, &decode_capture_str,
+      "Decode the messages stored in the given capture file",
+      "[PATH]"
+    },
     { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_flag,
       "Run action with verbose logs, including the debug ones",
       NULL
@@ -234,6 +244,89 @@ print_version_and_exit (void)
     exit (EXIT_SUCCESS);
 }
 
+/* Size of the in-memory ring used with --device-capture, which is spilled to
+ * the capture file whenever it gets full */
+#define DEVICE_CAPTURE_RING_SIZE (64 * 1024)
+
+static void
+decode_captured_message (gint64               timestamp,
+                         QmiCaptureDirection  direction,
+                         guint16              vendor_id,
+                         const guint8        *frame,
+                         gsize                frame_length,
+                         gpointer             user_data)
+{
+    guint *n_messages = user_data;
+    GDateTime *date_time;
+    gchar *date_time_str;
+    const gchar *prefix_str;
+    QmiMessage *message;
+    gsize consumed = 0;
+    GError *error = NULL;
+
+    (*n_messages)++;
+
+    date_time = g_date_time_new_from_unix_local (timestamp / G_USEC_PER_SEC);
+    date_time_str = g_date_time_format (date_time, "%d %b %Y, %H:%M:%S");
+    prefix_str = (direction == QMI_CAPTURE_DIRECTION_SENT ? ">>>>>> " : "<<<<<< ");
+
+    g_print ("[%s.%06u] %s message #%u...\n",
+             date_time_str,
+             (guint) (timestamp % G_USEC_PER_SEC),
+             direction == QMI_CAPTURE_DIRECTION_SENT ? "sent" : "received",
+             *n_messages);
+    g_free (date_time_str);
+    g_date_time_unref (date_time);
+
+    message = qmi_message_new_from_raw_buffer (frame, frame_length, &consumed, &error);
+    if (!message) {
+        g_print ("%sinvalid message (%" G_GSIZE_FORMAT " bytes): %s\n\n",
+                 prefix_str,
+                 frame_length,
+                 error ? error->message : "incomplete frame");
+        g_clear_error (&error);
+        return;
+    }
+
+    {
+        QmiMessageContext *context = NULL;
+        gchar *printable;
+
+        if (vendor_id != QMI_MESSAGE_VENDOR_GENERIC) {
+            context = qmi_message_context_new ();
+            qmi_message_context_set_vendor_id (context, vendor_id);
+        }
+
+        printable = qmi_message_get_printable_full (message, context, prefix_str);
+        g_print ("%s\n", printable);
+        g_free (printable);
+
+        if (context)
+            qmi_message_context_unref (context);
+    }
+
+    qmi_message_unref (message);
+}
+
+static void
+decode_capture_and_exit (void)
+{
+    QmiCapture *capture;
+    GError *error = NULL;
+    guint n_messages = 0;
+
+    capture = qmi_capture_new_from_file (decode_capture_str, &error);
+    if (!capture) {
+        g_printerr ("error: couldn't load capture file: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+
+    qmi_capture_foreach (capture, decode_captured_message, &n_messages);
+    g_print ("%u messages decoded\n", n_messages);
+    qmi_capture_unref (capture);
+    exit (EXIT_SUCCESS);
+}
+
 static gboolean
 generic_options_enabled (void)
 {
@@ -651,6 +744,21 @@ device_new_ready (GObject *unused,
         exit (EXIT_FAILURE);
     }
 
+    if (device_capture_str) {
+        QmiCapture *capture;
+
+        capture = qmi_capture_new (DEVICE_CAPTURE_RING_SIZE);
+        if (!qmi_capture_set_spill_file (capture, device_capture_str, &error)) {
+            g_printerr ("error: couldn't setup device capture: %s\n",
+                        error->message);
+            exit (EXIT_FAILURE);
+        }
+        /* The device owns the capture; all messages still in the ring are
+         * written to the capture file once the device is disposed */
+        g_object_set (device, QMI_DEVICE_CAPTURE, capture, NULL);
+        qmi_capture_unref (capture);
+    }
+
     if (device_open_mbim_flag + device_open_qmi_flag + device_open_auto_flag > 1) {
         g_printerr ("error: cannot specify multiple mode flags to open device\n");
         exit (EXIT_FAILURE);
@@ -819,6 +927,9 @@ int main (int argc, char **argv)
     if (version_flag)
         print_version_and_exit ();
 
+    if (decode_capture_str)
+        decode_capture_and_exit ();
+
     g_log_set_handler (NULL, G_LOG_LEVEL_MASK, log_handler, NULL);
     g_log_set_handler ("Qmi", G_LOG_LEVEL_MASK, log_handler, NULL);
     if (verbose_flag)